@@ -0,0 +1,64 @@
+#include "Arguments.h"
+#include <cctype>
+#include <climits>
+#include <stdexcept>
+using namespace std;
+
+namespace
+{
+    string optionName(const string& arg)
+    {
+        return arg.substr(0, arg.find('='));
+    }
+
+    string optionValue(const string& arg)
+    {
+        return arg.find('=') == string::npos ? "" : arg.substr(arg.find('=') + 1);
+    }
+
+    // false if the digits are missing, aren't all digits or don't fit
+    bool parseDigits(const string& digits, unsigned long long& result)
+    {
+        if (digits.empty() || digits.find_first_not_of("0123456789") != string::npos)
+            return false;
+        result = 0;
+        for (char digit : digits)
+        {
+            if (result > (ULLONG_MAX - (digit - '0')) / 10)
+                return false;
+            result = result * 10 + (digit - '0');
+        }
+        return true;
+    }
+}
+
+unsigned long long parseCount(const string& arg)
+{
+    unsigned long long result;
+    if (!parseDigits(optionValue(arg), result))
+        throw runtime_error(optionName(arg) + " expects a number from 0 to " + to_string(ULLONG_MAX)
+                            + ", \"" + optionValue(arg) + "\" given");
+    return result;
+}
+
+unsigned long long parseSize(const string& arg)
+{
+    string value = optionValue(arg), digits = value;
+    int shift = 0;
+    if (!value.empty())
+    {
+        const string suffixes = "KMG";
+        size_t suffix = suffixes.find(toupper(value.back()));
+        if (suffix != string::npos)
+        {
+            shift = 10 * (suffix + 1);
+            digits.pop_back();
+        }
+    }
+
+    unsigned long long result;
+    if (!parseDigits(digits, result) || result > (ULLONG_MAX >> shift))
+        throw runtime_error(optionName(arg) + " expects a number of bytes from 0 to " + to_string(ULLONG_MAX)
+                            + ", optionally followed by K, M or G, \"" + value + "\" given");
+    return result << shift;
+}
@@ -0,0 +1,19 @@
+#ifndef RGR_ARGUMENTS_H
+#define RGR_ARGUMENTS_H
+
+#include <string>
+
+/*
+ * Numbers given to the tools on their command lines.
+ *
+ * Budgets, counts and sizes come from whoever runs a tool, so anything but a plain decimal number is refused with
+ * an error naming the option: signs, spaces, fractions and values out of range, which std::stoull would accept or
+ * wrap around. Both take the whole "--name=value" argument.
+ */
+
+// a number from 0 to ULLONG_MAX
+unsigned long long parseCount(const std::string& arg);
+// a number of bytes, optionally followed by K, M or G in either case for units of 2^10, 2^20 and 2^30 bytes
+unsigned long long parseSize(const std::string& arg);
+
+#endif //RGR_ARGUMENTS_H
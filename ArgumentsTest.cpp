@@ -0,0 +1,33 @@
+#include "catch.hpp"
+#include "Arguments.h"
+#include <climits>
+
+using namespace std;
+
+TEST_CASE( "command line numbers", "[arguments]" ) {
+    REQUIRE (parseCount("--fuel=0") == 0);
+    REQUIRE (parseCount("--fuel=18446744073709551615") == ULLONG_MAX);
+    for (auto bad : { "--fuel=", "--fuel", "--fuel=-1", "--fuel=+1", "--fuel= 1", "--fuel=1 ", "--fuel=1.5", "--fuel=0x10",
+                      "--fuel=18446744073709551616", "--fuel=1K" })
+        REQUIRE_THROWS_AS (parseCount(bad), runtime_error&);
+
+    REQUIRE (parseSize("--size=100") == 100);
+    REQUIRE (parseSize("--size=64K") == 64 << 10);
+    REQUIRE (parseSize("--size=64k") == 64 << 10);
+    REQUIRE (parseSize("--size=4M") == 4 << 20);
+    REQUIRE (parseSize("--size=1g") == 1 << 30);
+    REQUIRE (parseSize("--size=17179869183G") == (17179869183ull << 30));
+    for (auto bad : { "--size=", "--size=K", "--size=-1", "--size=-1K", "--size=1KB", "--size=1T", "--size=1.5M",
+                      "--size=17179869184G", "--size=18446744073709551616" })
+        REQUIRE_THROWS_AS (parseSize(bad), runtime_error&);
+
+    try
+    {
+        parseSize("--max-output=-1");
+    }
+    catch (runtime_error& e)
+    {
+        REQUIRE (string(e.what()).find("--max-output expects a number of bytes") == 0);
+        REQUIRE (string(e.what()).find("\"-1\" given") != string::npos);
+    }
+}
@@ -0,0 +1,54 @@
+# Builds PROGRAM into a binary and checks that the binary behaves as the VM does on the input from the .in file
+# next to the program: the same output, errors and exit status. The VM runs the program unoptimized and not
+# precomputed. MODE is "emit-c" to emit C and build it with the C compiler CC, "build" to let rgr write
+# the executable itself, or "jit" to run the program with the JIT instead of a binary, which also fails the test
+# when the JIT falls back to the VM. FLAGS are passed to rgr for the translation.
+#
+# cmake -DMODE=<emit-c|build|jit> -DRGR=<rgr> [-DCC=<cc>] [-DFLAGS=<flags>] -DPROGRAM=<file.rgr> -DWORK_DIR=<dir> -P BackendTest.cmake
+
+get_filename_component(name ${PROGRAM} NAME_WE)
+get_filename_component(directory ${PROGRAM} PATH)
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+set(input ${directory}/${name}.in)
+if(NOT EXISTS ${input})
+    set(input ${WORK_DIR}/${name}.in)
+    file(WRITE ${input} "")
+endif()
+
+if(MODE STREQUAL "jit")
+    set(command ${RGR} --run --engine=jit ${FLAGS} ${PROGRAM})
+elseif(MODE STREQUAL "build")
+    execute_process(COMMAND ${RGR} --build ${FLAGS} --output=${WORK_DIR}/${name} ${PROGRAM}
+                    RESULT_VARIABLE status ERROR_VARIABLE errors)
+    if(NOT status EQUAL 0)
+        message(FATAL_ERROR "Couldn't build an executable for ${PROGRAM}:\n${errors}")
+    endif()
+else()
+    execute_process(COMMAND ${RGR} --emit-c ${FLAGS} ${PROGRAM} OUTPUT_FILE ${WORK_DIR}/${name}.c RESULT_VARIABLE status)
+    if(NOT status EQUAL 0)
+        message(FATAL_ERROR "Couldn't emit C for ${PROGRAM}")
+    endif()
+
+    execute_process(COMMAND ${CC} -O2 -std=c99 -o ${WORK_DIR}/${name} ${WORK_DIR}/${name}.c -lm
+                    RESULT_VARIABLE status ERROR_VARIABLE errors)
+    if(NOT status EQUAL 0)
+        message(FATAL_ERROR "Couldn't compile the emitted C:\n${errors}")
+    endif()
+endif()
+
+if(NOT command)
+    set(command ${WORK_DIR}/${name})
+endif()
+
+execute_process(COMMAND ${RGR} --run --no-optimize --precompute-budget=0 ${PROGRAM} INPUT_FILE ${input}
+                OUTPUT_VARIABLE expected ERROR_VARIABLE expectedErrors RESULT_VARIABLE expectedStatus)
+execute_process(COMMAND ${command} INPUT_FILE ${input}
+                OUTPUT_VARIABLE actual ERROR_VARIABLE actualErrors RESULT_VARIABLE actualStatus)
+
+if(NOT actual STREQUAL expected)
+    message(FATAL_ERROR "Output differs\nexpected:\n${expected}\nactual:\n${actual}")
+endif()
+if(NOT actualErrors STREQUAL expectedErrors OR NOT actualStatus EQUAL expectedStatus)
+    message(FATAL_ERROR "Errors differ\nexpected (${expectedStatus}):\n${expectedErrors}\nactual (${actualStatus}):\n${actualErrors}")
+endif()
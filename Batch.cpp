@@ -0,0 +1,331 @@
+#include "Batch.h"
+using namespace std;
+
+namespace
+{
+    // one flag per lane, 1 if the lane takes part
+    typedef vector<char> Mask;
+
+    class LaneGroup
+    {
+    private:
+        const TypedProgram& program;
+        size_t lanes;
+        BatchResult* results;
+        vector<InputBuffer> inputs;
+        vector<vector<Value>> slots;        // column of every variable
+        Mask alive;                         // lanes not stopped by an error
+
+        // columns of intermediate values, taken in stack order while a statement's expressions are computed
+        vector<vector<Value>> temporaries;
+        size_t used;
+
+        Value* column()
+        {
+            if (used == temporaries.size())
+                temporaries.emplace_back(lanes);
+            return temporaries[used++].data();
+        }
+
+        bool any(const Mask& mask)
+        {
+            for (auto flag : mask)
+                if (flag)
+                    return true;
+            return false;
+        }
+
+        Mask active(const Mask& mask)
+        {
+            Mask result(lanes);
+            for (size_t lane = 0; lane < lanes; lane++)
+                result[lane] = mask[lane] & alive[lane];
+            return result;
+        }
+
+        void fail(size_t lane, const exception& error)
+        {
+            alive[lane] = 0;
+            results[lane].error = error.what();
+        }
+
+        template<class T>
+        static void compare(BinaryOp op, const T* a, const T* b, long long* out, size_t lanes)
+        {
+            switch (op)
+            {
+                case BinaryOp::Less: for (size_t l = 0; l < lanes; l++) out[l] = a[l] < b[l]; break;
+                case BinaryOp::Greater: for (size_t l = 0; l < lanes; l++) out[l] = a[l] > b[l]; break;
+                case BinaryOp::LessEqual: for (size_t l = 0; l < lanes; l++) out[l] = a[l] <= b[l]; break;
+                case BinaryOp::GreaterEqual: for (size_t l = 0; l < lanes; l++) out[l] = a[l] >= b[l]; break;
+                case BinaryOp::Equal: for (size_t l = 0; l < lanes; l++) out[l] = a[l] == b[l]; break;
+                default: for (size_t l = 0; l < lanes; l++) out[l] = a[l] != b[l]; break;
+            }
+        }
+
+        // the kernels work on all lanes, only the division looks at the mask as it may fail
+        const Value* evaluate(ExprPtr expr, const Mask& mask)
+        {
+            if (expr->kind == ExprKind::Variable)
+                return slots[expr->slot].data();
+
+            Value* out = column();
+            switch (expr->kind)
+            {
+                case ExprKind::IntConst:
+                case ExprKind::BoolConst:
+                    for (size_t l = 0; l < lanes; l++)
+                        out[l].i = expr->intValue;
+                    return out;
+                case ExprKind::FloatConst:
+                    for (size_t l = 0; l < lanes; l++)
+                        out[l].f = expr->floatValue;
+                    return out;
+                case ExprKind::Not:
+                {
+                    const Value* a = evaluate(expr->left, mask);
+                    if (expr->type == DataType::Bool)
+                        for (size_t l = 0; l < lanes; l++)
+                            out[l].i = a[l].i ^ 1;
+                    else
+                        for (size_t l = 0; l < lanes; l++)
+                            out[l].i = ~a[l].i;
+                    return out;
+                }
+                case ExprKind::IntToFloat:
+                {
+                    const Value* a = evaluate(expr->left, mask);
+                    for (size_t l = 0; l < lanes; l++)
+                        out[l].f = (double)a[l].i;
+                    return out;
+                }
+                default:
+                    break;
+            }
+
+            const Value* a = evaluate(expr->left, mask);
+            const Value* b = evaluate(expr->right, mask);
+            if (expr->left->type == DataType::Float)
+            {
+                // the union's members share the storage, the columns are read as arrays of their type
+                const double* x = &a[0].f;
+                const double* y = &b[0].f;
+                double* z = &out[0].f;
+                switch (expr->op)
+                {
+                    case BinaryOp::Add: for (size_t l = 0; l < lanes; l++) z[l] = x[l] + y[l]; break;
+                    case BinaryOp::Sub: for (size_t l = 0; l < lanes; l++) z[l] = x[l] - y[l]; break;
+                    case BinaryOp::Mul: for (size_t l = 0; l < lanes; l++) z[l] = x[l] * y[l]; break;
+                    case BinaryOp::Div: for (size_t l = 0; l < lanes; l++) z[l] = x[l] / y[l]; break;
+                    default: compare(expr->op, x, y, &out[0].i, lanes); break;
+                }
+                return out;
+            }
+
+            const long long* x = &a[0].i;
+            const long long* y = &b[0].i;
+            long long* z = &out[0].i;
+            switch (expr->op)
+            {
+                case BinaryOp::Add: for (size_t l = 0; l < lanes; l++) z[l] = wrapAdd(x[l], y[l]); break;
+                case BinaryOp::Sub: for (size_t l = 0; l < lanes; l++) z[l] = wrapSub(x[l], y[l]); break;
+                case BinaryOp::Mul: for (size_t l = 0; l < lanes; l++) z[l] = wrapMul(x[l], y[l]); break;
+                case BinaryOp::And: for (size_t l = 0; l < lanes; l++) z[l] = x[l] & y[l]; break;
+                case BinaryOp::Or: for (size_t l = 0; l < lanes; l++) z[l] = x[l] | y[l]; break;
+                case BinaryOp::Div:
+                    for (size_t l = 0; l < lanes; l++)
+                    {
+                        if (!mask[l] || !alive[l])
+                            continue;
+                        try
+                        {
+                            z[l] = divideInt(x[l], y[l], expr->line);
+                        }
+                        catch (exception& e)
+                        {
+                            fail(l, e);
+                        }
+                    }
+                    break;
+                default: compare(expr->op, x, y, z, lanes); break;
+            }
+            return out;
+        }
+
+        void write(size_t lane, DataType type, Value value)
+        {
+            string& output = results[lane].output;
+            if (type == DataType::Bool)
+            {
+                output += value.i ? "true" : "false";
+                return;
+            }
+
+            char buffer[maxFormattedLength];
+            size_t length = type == DataType::Float ? formatFloat(value.f, buffer) : formatInt(value.i, buffer);
+            output.append(buffer, length);
+        }
+
+        void read(size_t lane, size_t slot, size_t line)
+        {
+            Value& value = slots[slot][lane];
+            InputBuffer& input = inputs[lane];
+            switch (program.variables[slot].type)
+            {
+                case DataType::Float: value.f = input.readFloat(line); break;
+                case DataType::Bool: value.i = input.readBool(line); break;
+                default: value.i = input.readInt(line); break;
+            }
+        }
+
+        // narrows the loop's lanes to those that stay alive and whose condition holds
+        void keep(Mask& running, const Value* condition)
+        {
+            for (size_t lane = 0; lane < lanes; lane++)
+                running[lane] &= alive[lane] & (condition[lane].i != 0);
+        }
+
+        void execute(StmtPtr stmt, const Mask& mask)
+        {
+            Mask lanesOn = active(mask);
+            if (!any(lanesOn))
+                return;
+
+            used = 0;
+            switch (stmt->kind)
+            {
+                case StmtKind::Assign:
+                {
+                    const Value* value = evaluate(stmt->value, lanesOn);
+                    long long* target = &slots[stmt->slot][0].i;
+                    for (size_t l = 0; l < lanes; l++)
+                        target[l] = lanesOn[l] & alive[l] ? value[l].i : target[l];
+                    break;
+                }
+
+                case StmtKind::If:
+                {
+                    const Value* condition = evaluate(stmt->value, lanesOn);
+                    Mask otherwise = lanesOn;
+                    for (size_t l = 0; l < lanes; l++)
+                    {
+                        lanesOn[l] &= condition[l].i != 0;
+                        otherwise[l] &= condition[l].i == 0;
+                    }
+                    execute(stmt->body, lanesOn);
+                    if (stmt->elseBody)
+                        execute(stmt->elseBody, otherwise);
+                    break;
+                }
+
+                case StmtKind::While:
+                    while (true)
+                    {
+                        used = 0;
+                        keep(lanesOn, evaluate(stmt->value, lanesOn));
+                        if (!any(lanesOn))
+                            break;
+                        execute(stmt->body, lanesOn);
+                    }
+                    break;
+
+                case StmtKind::For:
+                {
+                    vector<Value>& counter = slots[stmt->slot];
+                    const Value* initial = evaluate(stmt->value, lanesOn);
+                    for (size_t l = 0; l < lanes; l++)
+                        if (lanesOn[l])
+                            counter[l] = initial[l];
+
+                    const Value* limitColumn = evaluate(stmt->limit, lanesOn);
+                    vector<Value> limit(limitColumn, limitColumn + lanes);
+                    vector<Value> condition(lanes);
+                    while (true)
+                    {
+                        for (size_t l = 0; l < lanes; l++)
+                            condition[l].i = counter[l].i <= limit[l].i;
+                        keep(lanesOn, condition.data());
+                        if (!any(lanesOn))
+                            break;
+
+                        execute(stmt->body, lanesOn);
+                        for (size_t l = 0; l < lanes; l++)
+                            if (lanesOn[l])
+                                counter[l].i = wrapAdd(counter[l].i, 1);
+                    }
+                    break;
+                }
+
+                case StmtKind::Read:
+                    for (size_t l = 0; l < lanes; l++)
+                    {
+                        if (!lanesOn[l])
+                            continue;
+                        try
+                        {
+                            for (auto slot : stmt->slots)
+                                read(l, slot, stmt->line);
+                        }
+                        catch (exception& e)
+                        {
+                            fail(l, e);
+                        }
+                    }
+                    break;
+
+                case StmtKind::Write:
+                    // the separator is written once the value is known, as the VM does
+                    for (size_t i = 0; i < stmt->values.size(); i++)
+                    {
+                        used = 0;
+                        const Value* value = evaluate(stmt->values[i], lanesOn);
+                        for (size_t l = 0; l < lanes; l++)
+                        {
+                            if (!lanesOn[l] || !alive[l])
+                                continue;
+                            if (i > 0)
+                                results[l].output += ' ';
+                            write(l, stmt->values[i]->type, value[l]);
+                        }
+                    }
+                    for (size_t l = 0; l < lanes; l++)
+                        if (lanesOn[l] && alive[l])
+                            results[l].output += '\n';
+                    break;
+
+                case StmtKind::Block:
+                    for (auto& inner : stmt->statements)
+                        execute(inner, lanesOn);
+                    break;
+            }
+        }
+    public:
+        LaneGroup(const TypedProgram& _program, const string* _inputs, size_t _lanes, BatchResult* _results)
+                : program(_program), lanes(_lanes), results(_results), alive(_lanes, 1), used(0)
+        {
+            for (size_t lane = 0; lane < lanes; lane++)
+                inputs.emplace_back(_inputs[lane]);
+
+            Value zero;
+            zero.i = 0;
+            slots.assign(program.variables.size(), vector<Value>(lanes, zero));
+        }
+
+        void run()
+        {
+            execute(program.body, Mask(lanes, 1));
+        }
+    };
+}
+
+BatchEngine::BatchEngine(const TypedProgram& _program, size_t _width) : program(_program), width(_width)
+{
+}
+
+vector<BatchResult> BatchEngine::run(const vector<string>& inputs)
+{
+    vector<BatchResult> results(inputs.size());
+    for (size_t first = 0; first < inputs.size(); first += width)
+        LaneGroup(program, &inputs[first], min(width, inputs.size() - first), &results[first]).run();
+    return results;
+}
@@ -0,0 +1,37 @@
+#ifndef RGR_BATCH_H
+#define RGR_BATCH_H
+
+#include "TypedTree.h"
+#include "Runtime.h"
+
+/*
+ * SPMD batch execution engine.
+ *
+ * Runs one program over many independent inputs at once. The inputs are processed in groups of lanes: every variable
+ * is a column holding its value in each lane and every expression is computed for the whole column by a loop the
+ * compiler can vectorize. Lanes taking different paths through "if", "while" and "for" are handled with masks:
+ * a statement runs for the lanes of its mask and a loop repeats while any of its lanes goes on.
+ *
+ * Only divisions, "read" and "write" look at single lanes. A lane stopped by a runtime error keeps the output it
+ * wrote and its error, the other lanes go on.
+ */
+
+struct BatchResult
+{
+    std::string output;
+    std::string error;      // runtime error the lane stopped with, empty if it finished
+};
+
+class BatchEngine
+{
+private:
+    TypedProgram program;
+    size_t width;
+public:
+    // lanes run together in groups of the width
+    explicit BatchEngine(const TypedProgram& _program, size_t _width = 256);
+
+    std::vector<BatchResult> run(const std::vector<std::string>& inputs);
+};
+
+#endif //RGR_BATCH_H
@@ -0,0 +1,41 @@
+#include "catch.hpp"
+#include "TestSupport.h"
+#include "Batch.h"
+
+using namespace std;
+
+TEST_CASE( "batch engine matches the VM in every lane", "[batch]" ) {
+    vector<string> programs = {
+            "dim a, b integer : read(a, b) : write(a + b, a * b, a - b, a / b, 3)",
+            "dim n, s, i integer : read(n) : n as n and 1023 : for i as 1 to n do if (i and 1) = 1 then s as s + i else s as s - 1 : write(s, i)",
+            "dim n, steps integer : read(n) : while (n > 1) and (steps < 1000) do begin if n / 2 * 2 = n then n as n / 2 else n as 3 * n + 1 : steps as steps + 1 end : write(steps)",
+            "dim f, g float : dim b bool : read(f, b) : g as f * 2.5 - 1 : if b then write(g, f < g, not b) else write(0.0 / f)",
+            "dim a integer : dim b bool : read(a) : b as a > 3 : write(b, not a, a or 6) : read(b) : write(b)",
+            "dim i, n integer : read(n) : n as n and 15 : for i as 9223372036854775806 - n to 9223372036854775806 do write(i)",
+    };
+    vector<string> inputs = { "7 2", "1 0", "0 1", "", "abc", "5 true", "27 false", "2.5 true", "-3 1.5", "9223372036854775807 1",
+                              "-9223372036854775807 -1", "6", "3 ", "0.5 false true", "12 true" };
+
+    for (auto& code : programs)
+    {
+        TypedProgram program = lower(code);
+        for (size_t width : { 1, 4, 256 })
+        {
+            vector<BatchResult> results = BatchEngine(program, width).run(inputs);
+            REQUIRE( results.size() == inputs.size() );
+            for (size_t lane = 0; lane < inputs.size(); lane++)
+                REQUIRE( (results[lane].output + results[lane].error) == runVM(compileBytecode(program), inputs[lane]) );
+        }
+    }
+}
+
+TEST_CASE( "batch engine errors", "[batch]" ) {
+    TypedProgram program = lower("dim a integer : read(a) : write(1, 10 / a, 2) : write(a)");
+    vector<BatchResult> results = BatchEngine(program).run({ "5", "0", "x" });
+    REQUIRE( results[0].output == "1 2 2\n5\n" );
+    REQUIRE( results[0].error == "" );
+    REQUIRE( results[1].output == "1" );
+    REQUIRE( results[1].error == "Runtime error on line 1: Division by zero" );
+    REQUIRE( results[2].output == "" );
+    REQUIRE( results[2].error != "" );
+}
@@ -0,0 +1,220 @@
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "Arguments.h"
+#include "Counters.h"
+#include "Generator.h"
+#include "Parser.h"
+#include "Stats.h"
+
+using namespace std;
+
+/*
+ * rgr_bench: front end microbenchmarks over generated programs.
+ *
+ * Every shape of generated program is benchmarked at sizes from --min-size to --max-size, growing 4 times a step
+ * (sizes take K, M and G suffixes). Each benchmark repeats until it has run --min-time seconds and reports its mean
+ * time and the source bytes, tokens and syntax nodes it went through per second, one CSV row per benchmark, so that
+ * results of two releases can be compared line by line. The dump grows with the square of the program (every program
+ * item nests one level deeper in the tree), so it is only benchmarked up to --max-dump-size.
+ *
+ * Hardware counters, when the system lets the benchmark thread read them, add cycles, instructions, branch misses and
+ * L1 data and last level cache misses per run, IPC and the misses per token and per syntax node; the cells of an
+ * unavailable counter stay empty. --no-counters leaves them all empty.
+ */
+
+namespace
+{
+    struct Options
+    {
+        size_t minSize = 1 << 10, maxSize = 4 << 20, maxDumpSize = 16 << 10;
+        double minTime = 0.2;
+        uint64_t seed = 1;
+        bool counters = true;
+        vector<string> shapes;
+    };
+
+    struct Subject
+    {
+        const ProgramShape& shape;
+        string code;
+        vector<Token> tokens;
+        SyntaxNodePtr tree;
+        size_t nodes;
+    };
+
+    const HardwareCounter misses[] = { HardwareCounter::BranchMisses, HardwareCounter::L1dMisses, HardwareCounter::LlcMisses };
+
+    // an empty cell when the counter is not read
+    string counted(HardwareCounters* counters, HardwareCounter counter, double divisor)
+    {
+        if (!counters || !counters->available(counter) || divisor == 0)
+            return "";
+        ostringstream out;
+        out.precision(6);
+        out << counters->total(counter) / divisor;
+        return out.str();
+    }
+
+    // runs the benchmark until the minimum time is over and prints its row
+    void measure(const string& name, const Subject& subject, const Options& options, HardwareCounters* counters,
+                 const function<void()>& benchmark)
+    {
+        size_t runs = 0;
+        double seconds = 0;
+        if (counters)
+            counters->reset();
+        while (runs == 0 || seconds < options.minTime)
+        {
+            if (counters)
+                counters->start();
+            auto start = chrono::steady_clock::now();
+            benchmark();
+            seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            if (counters)
+                counters->stop();
+            runs++;
+        }
+
+        double mean = seconds / runs;
+        cout << name << "," << subject.shape.name << "," << options.seed << "," << subject.code.size() << ","
+             << subject.tokens.size() << "," << subject.nodes << "," << runs << "," << mean << ","
+             << subject.code.size() / mean << "," << subject.tokens.size() / mean << "," << subject.nodes / mean;
+
+        for (size_t i = 0; i < hardwareCounterCount; i++)
+            cout << "," << counted(counters, (HardwareCounter)i, runs);
+        bool ipc = counters && counters->available(HardwareCounter::Instructions);
+        cout << "," << (ipc ? counted(counters, HardwareCounter::Instructions, counters->total(HardwareCounter::Cycles)) : "");
+        for (auto counter : misses)
+            cout << "," << counted(counters, counter, (double)runs * subject.tokens.size());
+        for (auto counter : misses)
+            cout << "," << counted(counters, counter, (double)runs * subject.nodes);
+        cout << endl;
+    }
+
+    void benchmark(const ProgramShape& shape, size_t size, const Options& options, HardwareCounters* counters)
+    {
+        Subject subject { shape, generateProgram(shape, size, options.seed), {}, nullptr, 0 };
+        subject.tokens = lexString(subject.code);
+        subject.tree = parseInputWithSemantic(make_shared<ProgramNode>(), subject.code);
+        subject.nodes = countSyntaxNodes(subject.tree);
+
+        measure("lexString", subject, options, counters, [&] { lexString(subject.code); });
+        measure("parseToken", subject, options, counters, [&] {
+            for (auto& token : subject.tokens)
+                parseToken(token.content, token.line);
+        });
+        measure("parseInput", subject, options, counters, [&] { parseInput(make_shared<ProgramNode>(), subject.tokens); });
+        measure("semanticProcess", subject, options, counters, [&] {
+            SemanticContext context;
+            subject.tree->semanticProcess(context);
+        });
+        if (subject.code.size() <= options.maxDumpSize)
+            measure("dump", subject, options, counters, [&] { subject.tree->dump(); });
+    }
+
+    int runBenchmarks(const Options& options)
+    {
+        cout.precision(6);
+        cout << "benchmark,shape,seed,bytes,tokens,nodes,runs,seconds,bytes_per_second,tokens_per_second,nodes_per_second";
+        for (size_t i = 0; i < hardwareCounterCount; i++)
+            cout << "," << hardwareCounterName((HardwareCounter)i);
+        cout << ",ipc";
+        for (auto counter : misses)
+            cout << "," << hardwareCounterName(counter) << "_per_token";
+        for (auto counter : misses)
+            cout << "," << hardwareCounterName(counter) << "_per_node";
+        cout << endl;
+
+        // counters count the thread opening them, the one running the benchmarks
+        unique_ptr<HardwareCounters> counters;
+        if (options.counters)
+        {
+            counters.reset(new HardwareCounters);
+            if (!counters->getProblem().empty())
+                cerr << "Some hardware counters are unavailable: " << counters->getProblem() << endl;
+        }
+
+        vector<const ProgramShape*> shapes;
+        for (auto& name : options.shapes)
+            shapes.push_back(&findProgramShape(name));
+        if (shapes.empty())
+            for (auto& shape : programShapes())
+                shapes.push_back(&shape);
+
+        for (size_t size = options.minSize; size <= options.maxSize; size *= 4)
+            for (auto shape : shapes)
+                benchmark(*shape, size, options, counters.get());
+        return 0;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            string arg = argv[i];
+            if (arg.compare(0, 11, "--min-size=") == 0)
+                options.minSize = max<size_t>(1, parseSize(arg));
+            else if (arg.compare(0, 11, "--max-size=") == 0)
+                options.maxSize = parseSize(arg);
+            else if (arg.compare(0, 16, "--max-dump-size=") == 0)
+                options.maxDumpSize = parseSize(arg);
+            else if (arg.compare(0, 11, "--min-time=") == 0)
+                options.minTime = stod(arg.substr(11));
+            else if (arg.compare(0, 7, "--seed=") == 0)
+                options.seed = parseCount(arg);
+            else if (arg == "--no-counters")
+                options.counters = false;
+            else if (arg.compare(0, 8, "--shape=") == 0)
+                options.shapes.push_back(findProgramShape(arg.substr(8)).name);
+            else
+                throw runtime_error("Unknown option " + arg);
+        }
+    }
+    catch (exception& e)
+    {
+        cerr << e.what() << "\nUsage: rgr_bench [--min-size=1K] [--max-size=4M] [--max-dump-size=16K] [--min-time=0.2]"
+                            " [--seed=1] [--shape=NAME]... [--no-counters]\n";
+        return 2;
+    }
+
+    // the front end recurses once per program item, the main thread's stack would overflow on big programs
+    struct Work
+    {
+        const Options& options;
+        int status;
+    } work { options, 1 };
+    // the stack is only reserved, pages are taken as the recursion reaches them
+    size_t stackSize = max((size_t)64 << 20, options.maxSize * 64);
+    void* stack = mmap(nullptr, stackSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_t thread;
+    if (stack == MAP_FAILED || pthread_attr_setstack(&attributes, stack, stackSize) != 0
+        || pthread_create(&thread, &attributes, [](void* argument) -> void* {
+            Work& work = *(Work*)argument;
+            try
+            {
+                work.status = runBenchmarks(work.options);
+            }
+            catch (exception& e)
+            {
+                cerr << e.what() << endl;
+            }
+            return nullptr;
+        }, &work) != 0)
+    {
+        cerr << "Couldn't start the benchmark thread" << endl;
+        return 1;
+    }
+    pthread_join(thread, nullptr);
+    return work.status;
+}
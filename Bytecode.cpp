@@ -0,0 +1,437 @@
+#include "Bytecode.h"
+#include "Trace.h"
+#include "Runtime.h"
+#include <cassert>
+#include <cstring>
+using namespace std;
+
+namespace
+{
+    // comparison opcodes of every operand type pair go in the order of the comparison operations in BinaryOp
+    OpCode comparisonOpCode(BinaryOp op, OpCode first)
+    {
+        return OpCode((int)first + ((int)op - (int)BinaryOp::Less));
+    }
+
+    OpCode binaryOpCode(BinaryOp op, DataType type)
+    {
+        if (isComparison(op))
+        {
+            if (type == DataType::Bool)
+                return op == BinaryOp::Equal ? OpCode::CMP_EQ_BB : OpCode::CMP_NE_BB;
+            return comparisonOpCode(op, type == DataType::Integer ? OpCode::CMP_LT_II : OpCode::CMP_LT_FF);
+        }
+
+        static map<pair<BinaryOp, DataType>, OpCode> opCodes = {
+                { { BinaryOp::Add, DataType::Integer }, OpCode::ADD_I },
+                { { BinaryOp::Sub, DataType::Integer }, OpCode::SUB_I },
+                { { BinaryOp::Mul, DataType::Integer }, OpCode::MUL_I },
+                { { BinaryOp::Div, DataType::Integer }, OpCode::DIV_I },
+                { { BinaryOp::And, DataType::Integer }, OpCode::AND_I },
+                { { BinaryOp::Or, DataType::Integer }, OpCode::OR_I },
+                { { BinaryOp::Add, DataType::Float }, OpCode::ADD_F },
+                { { BinaryOp::Sub, DataType::Float }, OpCode::SUB_F },
+                { { BinaryOp::Mul, DataType::Float }, OpCode::MUL_F },
+                { { BinaryOp::Div, DataType::Float }, OpCode::DIV_F },
+                { { BinaryOp::And, DataType::Bool }, OpCode::AND_B },
+                { { BinaryOp::Or, DataType::Bool }, OpCode::OR_B },
+        };
+
+        return opCodes.at(make_pair(op, type));
+    }
+
+    class BytecodeCompiler
+    {
+    private:
+        const TypedProgram& program;
+        BytecodeProgram& result;
+
+        // constants are keyed by type and bit pattern
+        map<pair<DataType, long long>, int> constants;
+        int temporaryBase, nextTemporary, temporaryCount;
+
+        void collectConstants(ExprPtr expr)
+        {
+            if (!expr)
+                return;
+
+            if (expr->kind == ExprKind::IntConst || expr->kind == ExprKind::BoolConst || expr->kind == ExprKind::FloatConst)
+            {
+                auto key = constantKey(expr);
+                if (constants.count(key) == 0)
+                {
+                    int reg = program.variables.size() + constants.size();
+                    constants[key] = reg;
+
+                    Value value;
+                    if (expr->kind == ExprKind::FloatConst)
+                        value.f = expr->floatValue;
+                    else
+                        value.i = expr->intValue;
+
+                    result.initialRegisters.push_back(value);
+                    result.registerTypes.push_back(expr->type);
+                }
+            }
+
+            collectConstants(expr->left);
+            collectConstants(expr->right);
+        }
+
+        void collectConstants(StmtPtr stmt)
+        {
+            if (!stmt)
+                return;
+
+            // "for" loops step by one
+            if (stmt->kind == StmtKind::For)
+                collectConstants(makeIntConst(1, stmt->line));
+
+            collectConstants(stmt->value);
+            collectConstants(stmt->limit);
+            collectConstants(stmt->body);
+            collectConstants(stmt->elseBody);
+            for (auto& value : stmt->values)
+                collectConstants(value);
+            for (auto& inner : stmt->statements)
+                collectConstants(inner);
+        }
+
+        pair<DataType, long long> constantKey(ExprPtr expr)
+        {
+            long long bits = expr->intValue;
+            if (expr->kind == ExprKind::FloatConst)
+                memcpy(&bits, &expr->floatValue, sizeof(bits));
+            return make_pair(expr->type, bits);
+        }
+
+        int emit(OpCode op, int a, int b, int c, size_t line)
+        {
+            result.code.push_back(Instruction { op, a, b, c });
+            result.lines.push_back(line);
+            return result.code.size() - 1;
+        }
+
+        int here()
+        {
+            return result.code.size();
+        }
+
+        void patch(int instruction, int target)
+        {
+            Instruction& patched = result.code[instruction];
+            if (patched.op == OpCode::JMP)
+                patched.a = target;
+            else
+                patched.b = target;
+        }
+
+        int allocateTemporary()
+        {
+            int reg = temporaryBase + nextTemporary++;
+            temporaryCount = max(temporaryCount, nextTemporary);
+            return reg;
+        }
+
+        // compiles the expression into the target register if it's given, or returns the register with its value
+        int compileExpr(ExprPtr expr, int target = -1)
+        {
+            int source = -1;
+            switch (expr->kind)
+            {
+                case ExprKind::IntConst:
+                case ExprKind::FloatConst:
+                case ExprKind::BoolConst:
+                    source = constants.at(constantKey(expr));
+                    break;
+                case ExprKind::Variable:
+                    source = expr->slot;
+                    break;
+                default:
+                    break;
+            }
+
+            if (source >= 0)
+            {
+                if (target >= 0 && target != source)
+                    emit(OpCode::MOV, target, source, 0, expr->line);
+                return target >= 0 ? target : source;
+            }
+
+            int saved = nextTemporary;
+            OpCode op;
+            int left, right = 0;
+
+            if (expr->kind == ExprKind::Binary)
+            {
+                ExprPtr leftExpr = expr->left, rightExpr = expr->right;
+                op = binaryOpCode(expr->op, leftExpr->type);
+
+                // mixed comparisons don't need a separate conversion
+                if (isComparison(expr->op) && leftExpr->type == DataType::Float)
+                {
+                    if (leftExpr->kind == ExprKind::IntToFloat && rightExpr->kind != ExprKind::IntToFloat)
+                    {
+                        op = comparisonOpCode(expr->op, OpCode::CMP_LT_IF);
+                        leftExpr = leftExpr->left;
+                    }
+                    else if (rightExpr->kind == ExprKind::IntToFloat && leftExpr->kind != ExprKind::IntToFloat)
+                    {
+                        op = comparisonOpCode(expr->op, OpCode::CMP_LT_FI);
+                        rightExpr = rightExpr->left;
+                    }
+                }
+
+                left = compileExpr(leftExpr);
+                right = compileExpr(rightExpr);
+            }
+            else
+            {
+                if (expr->kind == ExprKind::IntToFloat)
+                    op = OpCode::I2F;
+                else
+                    op = expr->type == DataType::Integer ? OpCode::NOT_I : OpCode::NOT_B;
+
+                left = compileExpr(expr->left);
+            }
+
+            // operands are read before the result is written, so their temporaries can be reused
+            nextTemporary = saved;
+            if (target < 0)
+                target = allocateTemporary();
+
+            emit(op, target, left, right, expr->line);
+            return target;
+        }
+
+        void compileStmt(StmtPtr stmt)
+        {
+            int saved = nextTemporary;
+
+            switch (stmt->kind)
+            {
+                case StmtKind::Assign:
+                    compileExpr(stmt->value, stmt->slot);
+                    break;
+
+                case StmtKind::If:
+                {
+                    int condition = compileExpr(stmt->value);
+                    int jumpToElse = emit(OpCode::JMP_IF_FALSE, condition, 0, 0, stmt->line);
+                    nextTemporary = saved;
+
+                    compileStmt(stmt->body);
+                    if (stmt->elseBody)
+                    {
+                        int jumpToEnd = emit(OpCode::JMP, 0, 0, 0, stmt->line);
+                        patch(jumpToElse, here());
+                        compileStmt(stmt->elseBody);
+                        patch(jumpToEnd, here());
+                    }
+                    else
+                        patch(jumpToElse, here());
+                    break;
+                }
+
+                case StmtKind::While:
+                {
+                    int jumpToCondition = emit(OpCode::JMP, 0, 0, 0, stmt->line);
+                    int body = here();
+                    compileStmt(stmt->body);
+
+                    patch(jumpToCondition, here());
+                    int condition = compileExpr(stmt->value);
+                    emit(OpCode::JMP_IF_TRUE, condition, body, 0, stmt->line);
+                    break;
+                }
+
+                case StmtKind::For:
+                {
+                    int counter = stmt->slot;
+                    compileExpr(stmt->value, counter);
+
+                    // the limit is evaluated once, so it's kept in its own register unless it's a constant
+                    int limit = stmt->limit->kind == ExprKind::IntConst ? compileExpr(stmt->limit)
+                                                                         : compileExpr(stmt->limit, allocateTemporary());
+
+                    // the loop is entered through a guard, so that the increment, the comparison and the branch
+                    // back to the body go one after another and can be fused by an execution engine
+                    int condition = allocateTemporary();
+                    emit(OpCode::CMP_LE_II, condition, counter, limit, stmt->line);
+                    int jumpToEnd = emit(OpCode::JMP_IF_FALSE, condition, 0, 0, stmt->line);
+
+                    int body = here();
+                    compileStmt(stmt->body);
+                    emit(OpCode::ADD_I, counter, counter, compileExpr(makeIntConst(1, stmt->line)), stmt->line);
+                    emit(OpCode::CMP_LE_II, condition, counter, limit, stmt->line);
+                    emit(OpCode::JMP_IF_TRUE, condition, body, 0, stmt->line);
+                    patch(jumpToEnd, here());
+                    break;
+                }
+
+                case StmtKind::Read:
+                    for (auto slot : stmt->slots)
+                    {
+                        DataType type = program.variables[slot].type;
+                        emit(type == DataType::Integer ? OpCode::READ_I : type == DataType::Float ? OpCode::READ_F : OpCode::READ_B,
+                             slot, 0, 0, stmt->line);
+                    }
+                    break;
+
+                case StmtKind::Write:
+                    for (size_t i = 0; i < stmt->values.size(); i++)
+                    {
+                        ExprPtr value = stmt->values[i];
+                        int reg = compileExpr(value);
+                        if (i > 0)
+                            emit(OpCode::WRITE_SPACE, 0, 0, 0, stmt->line);
+                        emit(value->type == DataType::Integer ? OpCode::WRITE_I : value->type == DataType::Float ? OpCode::WRITE_F : OpCode::WRITE_B,
+                             reg, 0, 0, stmt->line);
+                        nextTemporary = saved;
+                    }
+                    emit(OpCode::WRITE_LINE, 0, 0, 0, stmt->line);
+                    break;
+
+                case StmtKind::Block:
+                    for (auto& inner : stmt->statements)
+                        compileStmt(inner);
+                    break;
+            }
+
+            nextTemporary = saved;
+        }
+    public:
+        BytecodeCompiler(const TypedProgram& _program, BytecodeProgram& _result)
+                : program(_program), result(_result), temporaryBase(0), nextTemporary(0), temporaryCount(0) {}
+
+        void compile()
+        {
+            result.variables = program.variables;
+            for (auto& variable : program.variables)
+            {
+                Value zero;
+                zero.i = 0;
+                result.initialRegisters.push_back(zero);
+                result.registerTypes.push_back(variable.type);
+            }
+
+            collectConstants(program.body);
+            result.constantCount = constants.size();
+            temporaryBase = result.initialRegisters.size();
+
+            compileStmt(program.body);
+            emit(OpCode::HALT, 0, 0, 0, program.body->line);
+
+            Value zero;
+            zero.i = 0;
+            result.initialRegisters.resize(temporaryBase + temporaryCount, zero);
+            result.registerTypes.resize(temporaryBase + temporaryCount, DataType::None);
+        }
+    };
+
+    // operand kinds of every opcode: r - register, j - jump target
+    string operandFormat(OpCode op)
+    {
+        switch (op)
+        {
+            case OpCode::HALT:
+            case OpCode::WRITE_SPACE:
+            case OpCode::WRITE_LINE:
+                return "";
+            case OpCode::JMP:
+                return "j";
+            case OpCode::JMP_IF_FALSE:
+            case OpCode::JMP_IF_TRUE:
+                return "rj";
+            case OpCode::READ_I:
+            case OpCode::READ_F:
+            case OpCode::READ_B:
+            case OpCode::WRITE_I:
+            case OpCode::WRITE_F:
+            case OpCode::WRITE_B:
+                return "r";
+            case OpCode::MOV:
+            case OpCode::I2F:
+            case OpCode::NOT_I:
+            case OpCode::NOT_B:
+                return "rr";
+            default:
+                return "rrr";
+        }
+    }
+
+    string registerName(const BytecodeProgram& program, int reg)
+    {
+        size_t index = reg;
+        if (index < program.variables.size())
+            return program.variables[index].name;
+
+        if (index < program.variables.size() + program.constantCount)
+        {
+            char buffer[maxFormattedLength];
+            Value value = program.initialRegisters[index];
+            switch (program.registerTypes[index])
+            {
+                case DataType::Integer:
+                    return "#" + string(buffer, formatInt(value.i, buffer));
+                case DataType::Float:
+                    return "#" + string(buffer, formatFloat(value.f, buffer)) + "f";
+                default:
+                    return value.i ? "#true" : "#false";
+            }
+        }
+
+        return "t" + to_string(index - program.variables.size() - program.constantCount);
+    }
+}
+
+BytecodeProgram compileBytecode(const TypedProgram& program)
+{
+    TraceSpan span("compileBytecode");
+    BytecodeProgram result;
+    BytecodeCompiler(program, result).compile();
+    return result;
+}
+
+BytecodeProgram compileBytecode(SyntaxNodePtr program)
+{
+    return compileBytecode(lowerProgram(program));
+}
+
+std::string opCodeName(OpCode op)
+{
+#define RGR_OPCODE_NAME(name) #name,
+    static const char* names[] = { RGR_OPCODES(RGR_OPCODE_NAME) };
+#undef RGR_OPCODE_NAME
+
+    return names[(int)op];
+}
+
+std::string disassemble(const BytecodeProgram& program)
+{
+    string result = "; " + to_string(program.variables.size()) + " variables, " + to_string(program.constantCount)
+                    + " constants, " + to_string(program.initialRegisters.size() - program.variables.size() - program.constantCount)
+                    + " temporaries\n";
+
+    for (size_t i = 0; i < program.code.size(); i++)
+    {
+        const Instruction& instruction = program.code[i];
+        string line = to_string(i);
+        line.resize(max<size_t>(line.size() + 1, 6), ' ');
+        line += opCodeName(instruction.op);
+
+        string format = operandFormat(instruction.op);
+        int operands[] = { instruction.a, instruction.b, instruction.c };
+        for (size_t j = 0; j < format.size(); j++)
+        {
+            line.resize(max<size_t>(line.size(), 20), ' ');
+            line += j ? ", " : "";
+            line += format[j] == 'r' ? registerName(program, operands[j]) : "@" + to_string(operands[j]);
+        }
+
+        line.resize(max<size_t>(line.size() + 1, 44), ' ');
+        result += line + "; line " + to_string(program.lines[i]) + "\n";
+    }
+
+    return result;
+}
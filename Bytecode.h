@@ -0,0 +1,86 @@
+#ifndef RGR_BYTECODE_H
+#define RGR_BYTECODE_H
+
+#include <cstdint>
+#include "TypedTree.h"
+#include "Runtime.h"
+
+/*
+ * Register bytecode compiled from a typed program.
+ *
+ * Every opcode is specialized for the types of its operands (suffix _I for integer, _F for float, _B for bool,
+ * two letters for comparisons of the left and the right operand), so the virtual machine never checks types.
+ * Conversions are explicit instructions.
+ *
+ * The register file is flat: variables occupy the first registers, then go constants, which are loaded
+ * once before the execution, then temporaries. Operands are register indices, jump targets are instruction indices.
+ */
+
+#define RGR_OPCODES(X) \
+    X(HALT) X(MOV) X(I2F) \
+    X(ADD_I) X(SUB_I) X(MUL_I) X(DIV_I) X(AND_I) X(OR_I) X(NOT_I) \
+    X(ADD_F) X(SUB_F) X(MUL_F) X(DIV_F) \
+    X(AND_B) X(OR_B) X(NOT_B) \
+    X(CMP_LT_II) X(CMP_GT_II) X(CMP_LE_II) X(CMP_GE_II) X(CMP_EQ_II) X(CMP_NE_II) \
+    X(CMP_LT_FF) X(CMP_GT_FF) X(CMP_LE_FF) X(CMP_GE_FF) X(CMP_EQ_FF) X(CMP_NE_FF) \
+    X(CMP_LT_IF) X(CMP_GT_IF) X(CMP_LE_IF) X(CMP_GE_IF) X(CMP_EQ_IF) X(CMP_NE_IF) \
+    X(CMP_LT_FI) X(CMP_GT_FI) X(CMP_LE_FI) X(CMP_GE_FI) X(CMP_EQ_FI) X(CMP_NE_FI) \
+    X(CMP_EQ_BB) X(CMP_NE_BB) \
+    X(JMP) X(JMP_IF_FALSE) X(JMP_IF_TRUE) \
+    X(READ_I) X(READ_F) X(READ_B) \
+    X(WRITE_I) X(WRITE_F) X(WRITE_B) X(WRITE_SPACE) X(WRITE_LINE)
+
+#define RGR_OPCODE_ENUM(name) name,
+
+enum class OpCode : uint8_t { RGR_OPCODES(RGR_OPCODE_ENUM) };
+
+#undef RGR_OPCODE_ENUM
+
+struct Instruction
+{
+    OpCode op;
+    int32_t a, b, c;
+};
+
+struct BytecodeProgram
+{
+    std::vector<Instruction> code;
+    std::vector<size_t> lines;              // source line of every instruction, used for error messages
+
+    std::vector<Variable> variables;
+    size_t constantCount;
+    std::vector<DataType> registerTypes;
+    std::vector<Value> initialRegisters;    // zeroed variables and temporaries, loaded constants
+
+    // instruction the VM starts with, past 0 only in a program restored from a snapshot with its registers saved
+    // as the initial ones
+    size_t entry = 0;
+};
+
+// the parts of a program the VM runs, pointing into a BytecodeProgram, which must outlive it, or into a snapshot
+// mapped from its file
+struct BytecodeImage
+{
+    const Instruction* code;
+    const size_t* lines;
+    size_t size;
+    const Value* initialRegisters;
+    size_t registerCount;
+    size_t entry;
+
+    BytecodeImage(const Instruction* _code, const size_t* _lines, size_t _size,
+                  const Value* _initialRegisters, size_t _registerCount, size_t _entry)
+            : code(_code), lines(_lines), size(_size), initialRegisters(_initialRegisters),
+              registerCount(_registerCount), entry(_entry) {}
+    BytecodeImage(const BytecodeProgram& program)
+            : BytecodeImage(program.code.data(), program.lines.data(), program.code.size(),
+                            program.initialRegisters.data(), program.initialRegisters.size(), program.entry) {}
+};
+
+BytecodeProgram compileBytecode(const TypedProgram& program);
+BytecodeProgram compileBytecode(SyntaxNodePtr program);
+
+std::string opCodeName(OpCode op);
+std::string disassemble(const BytecodeProgram& program);
+
+#endif //RGR_BYTECODE_H
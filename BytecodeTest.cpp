@@ -0,0 +1,112 @@
+#include "catch.hpp"
+#include "TestSupport.h"
+
+using namespace std;
+
+TEST_CASE( "bytecode execution", "[vm]" ) {
+    SECTION( "arithmetic" ) {
+        REQUIRE (runVM("write(1 + 2 * 3)") == "7\n");
+        REQUIRE (runVM("write(10 - 3 - 2, 100 / 10 / 5)") == "5 2\n");
+        REQUIRE (runVM("write(7 / 2, 0 - 7 / 2, 7.0 / 2)") == "3 -3 3.5\n");
+        REQUIRE (runVM("write(0ffh + 10b + 17o + 5d)") == "277\n");
+        REQUIRE (runVM("write(1 + 2.5, 1.5 * 2, .5e1)") == "3.5 3 5\n");
+        REQUIRE (runVM("write(12 and 10, 12 or 3, not 0)") == "8 15 -1\n");
+        REQUIRE (runVM("write(9223372036854775807 + 1)") == "-9223372036854775808\n");
+        REQUIRE (runVM("write(1 and 2 * 3.0)") == "0\n");
+    }
+
+    SECTION( "comparisons and bools" ) {
+        REQUIRE (runVM("write(1 < 2, 2 <= 1, 1 = 1.0, 1.5 > 1, 2 <> 2)") == "true false true true false\n");
+        REQUIRE (runVM("write(not true, true and false, true or false, true = false)") == "false false true false\n");
+        REQUIRE (runVM("dim b bool : b as 1 < 2 = true : write(b)") == "true\n");
+    }
+
+    SECTION( "variables and assignment" ) {
+        REQUIRE (runVM("dim a integer : dim f float : a as 5 : f as a : f as f / 2 : write(a, f)") == "5 2.5\n");
+        REQUIRE (runVM("dim a, b integer : a as 2 : b as (a + 1) * (a + 2) : a as b - a : write(a, b)") == "10 12\n");
+    }
+
+    SECTION( "control flow" ) {
+        REQUIRE (runVM("dim a integer : a as 5 : if a > 3 then write(1) else write(2)") == "1\n");
+        REQUIRE (runVM("dim a integer : a as 1 : if a > 3 then write(1) else write(2)") == "2\n");
+        REQUIRE (runVM("dim a integer : a as 1 : if a > 3 then write(1)") == "");
+        REQUIRE (runVM("dim i, s integer : s as 0 : for i as 1 to 10 do s as s + i : write(s, i)") == "55 11\n");
+        REQUIRE (runVM("dim i integer : for i as 5 to 1 do write(i) : write(i)") == "5\n");
+        REQUIRE (runVM("dim i, n integer : n as 3 : for i as 1 to n do n as n + 1 : write(n)") == "6\n");
+        REQUIRE (runVM("dim a integer : while a < 5 do a as a + 2 : write(a)") == "6\n");
+        REQUIRE (runVM("dim i, j integer\n"
+                     "for i as 1 to 3 do\n"
+                     "begin\n"
+                     "    j as i * i\n"
+                     "    write(i, j)\n"
+                     "end") == "1 1\n2 4\n3 9\n");
+    }
+
+    SECTION( "input" ) {
+        REQUIRE (runVM("dim a, b integer : dim f float : dim c bool : read(a, b, f, c) : write(a + b, f, c)", "1 10b 2.5 true")
+                 == "3 2.5 true\n");
+        REQUIRE (runVM("dim a integer : read(a)", "").find("Runtime error on line 1: ") == 0);
+        REQUIRE (runVM("dim a integer : read(a)", "1.5").find("Runtime error on line 1: ") == 0);
+    }
+
+    SECTION( "runtime errors" ) {
+        REQUIRE (runVM("dim a integer\nwrite(1 / a)") == "Runtime error on line 2: Division by zero");
+        REQUIRE (runVM("dim a float\nwrite(1 / a)") == "inf\n");
+    }
+}
+
+TEST_CASE( "semantic checks of statements", "[vm]" ) {
+    REQUIRE_THROWS (parse("dim a integer : if a then a as 1"));
+    REQUIRE_THROWS (parse("dim a integer : while a + 1 do a as 1"));
+    REQUIRE_THROWS (parse("dim f float : for f as 1 to 3 do f as 1"));
+    REQUIRE_THROWS (parse("dim i integer : for i as 1 to 3.5 do i as 1"));
+    REQUIRE_NOTHROW (parse("dim f float : f as 1.0 + 2.0 * f"));
+}
+
+TEST_CASE( "disassembler", "[vm]" ) {
+    BytecodeProgram program = compile(
+            "dim i integer : dim f float : for i as 1 to 10 do f as f + i * 1.5 : if i < f then write(f)");
+    string listing = disassemble(program);
+
+    REQUIRE (listing.find("; 2 variables, 3 constants") == 0);
+    REQUIRE (listing.find("MUL_F") != string::npos);
+    REQUIRE (listing.find("I2F") != string::npos);
+    REQUIRE (listing.find("CMP_LT_IF") != string::npos);
+    REQUIRE (listing.find("CMP_LE_II") != string::npos);
+    REQUIRE (listing.find("#1.5f") != string::npos);
+}
+
+TEST_CASE( "limited execution", "[vm]" ) {
+    auto limited = [](string code, string input, ExecutionLimits limits, string& output) {
+        BytecodeProgram program = compile(code);
+        InputBuffer in(input);
+        OutputBuffer out;
+        LimitedRun result = runLimited(program, in, out, limits);
+        output = out.str();
+        return result;
+    };
+    string output;
+
+    ExecutionLimits fuel;
+    fuel.fuel = 1000;
+    LimitedRun endless = limited("dim x integer :\nwhile true do\nx as x + 1", "", fuel, output);
+    REQUIRE (endless.status == LimitStatus::OutOfFuel);
+    REQUIRE (endless.line >= 2);
+
+    string sum = "dim n, i, s integer : read(n) : for i as 1 to n do s as s + i : write(s)";
+    REQUIRE (limited(sum, "10", fuel, output).status == LimitStatus::Finished);
+    REQUIRE (output == "55\n");
+    REQUIRE (limited(sum, "100000", fuel, output).status == LimitStatus::OutOfFuel);
+    REQUIRE (output == "");
+
+    ExecutionLimits bytes;
+    bytes.outputBytes = 7;
+    LimitedRun chatty = limited("dim i integer : for i as 1 to 100 do\nwrite(i)", "", bytes, output);
+    REQUIRE (chatty.status == LimitStatus::OutOfOutput);
+    REQUIRE (chatty.line == 2);
+    REQUIRE (output == "1\n2\n3\n4");
+    REQUIRE (limited("write(12, 3)", "", bytes, output).status == LimitStatus::Finished);
+    REQUIRE (output == "12 3\n");
+
+    REQUIRE_THROWS (limited("write(1 / 0)", "", fuel, output));
+}
@@ -0,0 +1,506 @@
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include "CEmitter.h"
+using namespace std;
+
+namespace
+{
+    const char* runtime = R"(#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char rgr_output[1 << 16];
+static size_t rgr_used;
+
+static char* rgr_input;
+static size_t rgr_input_size, rgr_position;
+
+static void rgr_flush(void)
+{
+    fwrite(rgr_output, 1, rgr_used, stdout);
+    fflush(stdout);
+    rgr_used = 0;
+}
+
+static void rgr_reserve(size_t size)
+{
+    if (rgr_used + size > sizeof(rgr_output))
+        rgr_flush();
+}
+
+static void rgr_error(const char* message, long long line)
+{
+    rgr_flush();
+    fprintf(stderr, "Runtime error on line %lld: %s\n", line, message);
+    exit(1);
+}
+
+static void rgr_token_error(const char* expected, const char* begin, const char* end, long long line)
+{
+    rgr_flush();
+    fprintf(stderr, "Runtime error on line %lld: %s expected, \"%.*s\" found instead\n", line, expected, (int)(end - begin), begin);
+    exit(1);
+}
+
+static long long rgr_add(long long a, long long b) { return (long long)((unsigned long long)a + (unsigned long long)b); }
+static long long rgr_sub(long long a, long long b) { return (long long)((unsigned long long)a - (unsigned long long)b); }
+static long long rgr_mul(long long a, long long b) { return (long long)((unsigned long long)a * (unsigned long long)b); }
+
+static long long rgr_div(long long a, long long b, long long line)
+{
+    if (b == 0)
+        rgr_error("Division by zero", line);
+    return b == -1 ? rgr_sub(0, a) : a / b;
+}
+
+static void rgr_write_char(char c)
+{
+    rgr_reserve(1);
+    rgr_output[rgr_used++] = c;
+}
+
+static void rgr_write_int(long long value)
+{
+    char digits[32];
+    size_t count = 0;
+    unsigned long long magnitude = value < 0 ? 0 - (unsigned long long)value : (unsigned long long)value;
+
+    do
+    {
+        digits[count++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+
+    rgr_reserve(32);
+    if (value < 0)
+        rgr_output[rgr_used++] = '-';
+    while (count)
+        rgr_output[rgr_used++] = digits[--count];
+}
+
+static void rgr_write_float(double value)
+{
+    char buffer[32];
+    int length = 3, precision;
+
+    if (isnan(value))
+        memcpy(buffer, "nan", 3);
+    else
+        for (precision = 1; precision <= 17; precision++)
+        {
+            length = snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+            if (strtod(buffer, 0) == value)
+                break;
+        }
+
+    rgr_reserve(32);
+    memcpy(rgr_output + rgr_used, buffer, (size_t)length);
+    rgr_used += (size_t)length;
+}
+
+static void rgr_write_bool(int value)
+{
+    rgr_reserve(5);
+    memcpy(rgr_output + rgr_used, value ? "true" : "false", value ? 4 : 5);
+    rgr_used += value ? 4 : 5;
+}
+
+/* the separator of "write" goes out once the next value is computed: rgr_write_int(rgr_spaced_int(value)) */
+static long long rgr_spaced_int(long long value) { rgr_write_char(' '); return value; }
+static double rgr_spaced_float(double value) { rgr_write_char(' '); return value; }
+static int rgr_spaced_bool(int value) { rgr_write_char(' '); return value; }
+
+/* the input is terminated with a zero byte, so that strtod stops at the end of the last token */
+static void rgr_load_input(void)
+{
+    size_t capacity = 1 << 16, count;
+    rgr_input = (char*)malloc(capacity);
+    while (rgr_input && (count = fread(rgr_input + rgr_input_size, 1, capacity - rgr_input_size - 1, stdin)) > 0)
+    {
+        rgr_input_size += count;
+        if (rgr_input_size + 1 == capacity)
+            rgr_input = (char*)realloc(rgr_input, capacity *= 2);
+    }
+    if (!rgr_input)
+    {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    rgr_input[rgr_input_size] = 0;
+}
+
+static void rgr_next_token(const char** begin, const char** end, long long line)
+{
+    if (!rgr_input)
+        rgr_load_input();
+
+    while (rgr_position < rgr_input_size && isspace((unsigned char)rgr_input[rgr_position]))
+        rgr_position++;
+    if (rgr_position == rgr_input_size)
+        rgr_error("Unexpected end of input", line);
+
+    *begin = rgr_input + rgr_position;
+    while (rgr_position < rgr_input_size && !isspace((unsigned char)rgr_input[rgr_position]))
+        rgr_position++;
+    *end = rgr_input + rgr_position;
+}
+
+static int rgr_is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static int rgr_parse_int(const char* begin, const char* end, long long* value)
+{
+    int negative = 0, base = 10, digit;
+    unsigned long long result = 0;
+    const char* ptr;
+
+    if (begin < end && (*begin == '-' || *begin == '+'))
+        negative = *begin++ == '-';
+    if (begin == end)
+        return 0;
+
+    switch (end[-1])
+    {
+        case 'b': case 'B': base = 2; end--; break;
+        case 'o': case 'O': base = 8; end--; break;
+        case 'h': case 'H': base = 16; end--; break;
+        case 'd': case 'D': base = 10; end--; break;
+    }
+
+    if (begin == end || !rgr_is_digit(*begin))
+        return 0;
+
+    for (ptr = begin; ptr < end; ptr++)
+    {
+        char c = *ptr;
+        digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : 100;
+        if (digit >= base)
+            return 0;
+        result = result * base + digit;
+    }
+
+    *value = (long long)(negative ? 0 - result : result);
+    return 1;
+}
+
+static int rgr_parse_float(const char* begin, const char* end, double* value)
+{
+    const char* ptr = begin;
+    const char* digits;
+    int hasIntegerPart, hasFraction = 0, hasExponent = 0;
+
+    if (ptr < end && (*ptr == '-' || *ptr == '+'))
+        ptr++;
+
+    for (digits = ptr; ptr < end && rgr_is_digit(*ptr); ptr++);
+    hasIntegerPart = ptr != digits;
+
+    if (ptr < end && *ptr == '.')
+    {
+        for (digits = ++ptr; ptr < end && rgr_is_digit(*ptr); ptr++);
+        if (ptr == digits)
+            return 0;
+        hasFraction = 1;
+    }
+
+    if (ptr < end && (*ptr == 'e' || *ptr == 'E'))
+    {
+        ptr++;
+        if (ptr < end && (*ptr == '-' || *ptr == '+'))
+            ptr++;
+        for (digits = ptr; ptr < end && rgr_is_digit(*ptr); ptr++);
+        if (ptr == digits)
+            return 0;
+        hasExponent = 1;
+    }
+
+    if (ptr != end || !(hasFraction || (hasIntegerPart && hasExponent)))
+        return 0;
+
+    *value = strtod(begin, 0);
+    return 1;
+}
+
+static long long rgr_read_int(long long line)
+{
+    const char *begin, *end;
+    long long value;
+
+    rgr_next_token(&begin, &end, line);
+    if (!rgr_parse_int(begin, end, &value))
+        rgr_token_error("Integer", begin, end, line);
+    return value;
+}
+
+static double rgr_read_float(long long line)
+{
+    const char *begin, *end;
+    double value;
+    long long intValue;
+
+    rgr_next_token(&begin, &end, line);
+    if (rgr_parse_float(begin, end, &value))
+        return value;
+    if (!rgr_parse_int(begin, end, &intValue))
+        rgr_token_error("Float", begin, end, line);
+    return (double)intValue;
+}
+
+static _Bool rgr_read_bool(long long line)
+{
+    const char *begin, *end;
+
+    rgr_next_token(&begin, &end, line);
+    if (end - begin == 4 && memcmp(begin, "true", 4) == 0)
+        return 1;
+    if (end - begin != 5 || memcmp(begin, "false", 5) != 0)
+        rgr_token_error("Bool", begin, end, line);
+    return 0;
+}
+)";
+
+    const char* typeName(DataType type)
+    {
+        switch (type)
+        {
+            case DataType::Integer: return "long long";
+            case DataType::Float: return "double";
+            default: return "_Bool";
+        }
+    }
+
+    const char* typeSuffix(DataType type)
+    {
+        switch (type)
+        {
+            case DataType::Integer: return "int";
+            case DataType::Float: return "float";
+            default: return "bool";
+        }
+    }
+
+    string intLiteral(long long value)
+    {
+        // the magnitude of the smallest value doesn't fit the type, so it can't be written as a literal
+        if (value == LLONG_MIN)
+            return "(-9223372036854775807LL - 1)";
+        if (value < 0)
+            return "(" + to_string(value) + "LL)";
+        return to_string(value) + "LL";
+    }
+
+    string floatLiteral(double value)
+    {
+        if (std::isnan(value))
+            return "NAN";
+        if (std::isinf(value))
+            return value > 0 ? "HUGE_VAL" : "(-HUGE_VAL)";
+
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.17g", value);
+
+        string literal = buffer;
+        if (literal.find_first_of(".en") == string::npos)
+            literal += ".0";
+        return value < 0 ? "(" + literal + ")" : literal;
+    }
+
+    class CEmitter
+    {
+    private:
+        const TypedProgram& program;
+        ostringstream out;
+        size_t limits;
+
+        void indent(size_t depth)
+        {
+            out << string(depth * 4, ' ');
+        }
+
+        string variable(size_t slot)
+        {
+            return "v_" + program.variables[slot].name;
+        }
+
+        string expression(ExprPtr expr)
+        {
+            switch (expr->kind)
+            {
+                case ExprKind::IntConst: return intLiteral(expr->intValue);
+                case ExprKind::FloatConst: return floatLiteral(expr->floatValue);
+                case ExprKind::BoolConst: return expr->intValue ? "1" : "0";
+                case ExprKind::Variable: return variable(expr->slot);
+                case ExprKind::Not: return (expr->type == DataType::Integer ? "(~" : "(!") + expression(expr->left) + ")";
+                case ExprKind::IntToFloat: return "((double)" + expression(expr->left) + ")";
+                case ExprKind::Binary: break;
+            }
+
+            string left = expression(expr->left), right = expression(expr->right);
+            if (expr->type == DataType::Integer)
+            {
+                switch (expr->op)
+                {
+                    case BinaryOp::Add: return "rgr_add(" + left + ", " + right + ")";
+                    case BinaryOp::Sub: return "rgr_sub(" + left + ", " + right + ")";
+                    case BinaryOp::Mul: return "rgr_mul(" + left + ", " + right + ")";
+                    case BinaryOp::Div: return "rgr_div(" + left + ", " + right + ", " + to_string(expr->line) + ")";
+                    default: break;
+                }
+            }
+
+            // bools are 0 or 1, so the bitwise operators serve them too
+            string op = binaryOpName(expr->op);
+            if (expr->op == BinaryOp::And)
+                op = "&";
+            else if (expr->op == BinaryOp::Or)
+                op = "|";
+            else if (expr->op == BinaryOp::Equal)
+                op = "==";
+            else if (expr->op == BinaryOp::NotEqual)
+                op = "!=";
+
+            return "(" + left + " " + op + " " + right + ")";
+        }
+
+        void statement(StmtPtr stmt, size_t depth)
+        {
+            switch (stmt->kind)
+            {
+                case StmtKind::Assign:
+                    indent(depth);
+                    out << variable(stmt->slot) << " = " << expression(stmt->value) << ";\n";
+                    break;
+
+                case StmtKind::If:
+                    indent(depth);
+                    out << "if (" << expression(stmt->value) << ")\n";
+                    block(stmt->body, depth);
+                    if (stmt->elseBody)
+                    {
+                        indent(depth);
+                        out << "else\n";
+                        block(stmt->elseBody, depth);
+                    }
+                    break;
+
+                case StmtKind::While:
+                    indent(depth);
+                    out << "while (" << expression(stmt->value) << ")\n";
+                    block(stmt->body, depth);
+                    break;
+
+                case StmtKind::For:
+                {
+                    string counter = variable(stmt->slot), limit = "rgr_limit" + to_string(++limits);
+
+                    indent(depth);
+                    out << counter << " = " << expression(stmt->value) << ";\n";
+                    indent(depth);
+                    out << "{\n";
+                    indent(depth + 1);
+                    out << "long long " << limit << " = " << expression(stmt->limit) << ";\n";
+                    indent(depth + 1);
+                    out << "for (; " << counter << " <= " << limit << "; " << counter << " = rgr_add(" << counter << ", 1))\n";
+                    block(stmt->body, depth + 1);
+                    indent(depth);
+                    out << "}\n";
+                    break;
+                }
+
+                case StmtKind::Read:
+                    for (auto slot : stmt->slots)
+                    {
+                        indent(depth);
+                        out << variable(slot) << " = rgr_read_" << typeSuffix(program.variables[slot].type)
+                            << "(" << stmt->line << ");\n";
+                    }
+                    break;
+
+                case StmtKind::Write:
+                    for (size_t i = 0; i < stmt->values.size(); i++)
+                    {
+                        const char* suffix = typeSuffix(stmt->values[i]->type);
+                        indent(depth);
+                        if (i > 0)
+                            out << "rgr_write_" << suffix << "(rgr_spaced_" << suffix << "(" << expression(stmt->values[i]) << "));\n";
+                        else
+                            out << "rgr_write_" << suffix << "(" << expression(stmt->values[i]) << ");\n";
+                    }
+                    indent(depth);
+                    out << "rgr_write_char('\\n');\n";
+                    break;
+
+                case StmtKind::Block:
+                    for (auto& inner : stmt->statements)
+                        statement(inner, depth);
+                    break;
+            }
+        }
+
+        void block(StmtPtr stmt, size_t depth)
+        {
+            indent(depth);
+            out << "{\n";
+            statement(stmt, depth + 1);
+            indent(depth);
+            out << "}\n";
+        }
+    public:
+        CEmitter(const TypedProgram& _program) : program(_program), limits(0) {}
+
+        string emit()
+        {
+            out << "/* generated by rgr */\n" << runtime << "\nint main(void)\n{\n";
+
+            for (auto& variable : program.variables)
+                out << "    " << typeName(variable.type) << " v_" << variable.name << " = 0;\n";
+            out << "\n";
+
+            statement(program.body, 1);
+
+            out << "\n    rgr_flush();\n    return 0;\n}\n";
+            return out.str();
+        }
+    };
+}
+
+string emitC(const TypedProgram& program)
+{
+    return CEmitter(program).emit();
+}
+
+string emitPrecomputedC(const PrecomputedOutput& result)
+{
+    // one string literal piece per line of the text
+    auto literal = [](const string& text) {
+        string pieces = "\"";
+        for (char c : text)
+        {
+            if (c == '\\' || c == '"')
+                pieces += '\\';
+            if (c == '\n')
+                pieces += "\\n\"\n    \"";
+            else
+                pieces += c;
+        }
+        return pieces + "\"";
+    };
+
+    ostringstream out;
+    out << "/* generated by rgr, the output is precomputed */\n#include <stdio.h>\n\n"
+        << "static const char rgr_output[] =\n    " << literal(result.output) << ";\n\n"
+        << "int main(void)\n{\n"
+        << "    fwrite(rgr_output, 1, sizeof(rgr_output) - 1, stdout);\n";
+    if (!result.error.empty())
+        out << "    fflush(stdout);\n    fputs(" << literal(result.error + "\n") << ", stderr);\n    return 1;\n";
+    else
+        out << "    return 0;\n";
+    out << "}\n";
+    return out.str();
+}
@@ -0,0 +1,21 @@
+#ifndef RGR_CEMITTER_H
+#define RGR_CEMITTER_H
+
+#include "PartialEval.h"
+
+/*
+ * C source backend.
+ *
+ * The typed program becomes a standalone C99 file: variables are typed locals of main (long long, double, _Bool),
+ * control flow stays structured, integer arithmetic goes through small inline helpers keeping the wrapping and
+ * division semantics, "read" and "write" use a buffered stdio runtime emitted into the same file.
+ * The output of the compiled program and its runtime errors match the other engines, except that the input is read
+ * whole on the first "read".
+ */
+
+std::string emitC(const TypedProgram& program);
+
+// program writing the precomputed output of a program without input and stopping with its error, if any
+std::string emitPrecomputedC(const PrecomputedOutput& result);
+
+#endif //RGR_CEMITTER_H
@@ -0,0 +1,51 @@
+#include "catch.hpp"
+#include "TestSupport.h"
+#include "CEmitter.h"
+
+using namespace std;
+
+namespace
+{
+    string emit(string code)
+    {
+        return emitC(lower(code));
+    }
+
+    bool contains(const string& text, const string& part)
+    {
+        return text.find(part) != string::npos;
+    }
+}
+
+TEST_CASE( "C emitter", "[emitc]" ) {
+    string code = emit("dim i, n integer : dim f float : dim b bool\n"
+                       "read(n)\n"
+                       "for i as 1 to n * 2 do if (i / 3 > 1) and not b then f as f + i else b as f >= 2.5\n"
+                       "while n > 0 do n as n - 1\n"
+                       "write(i, f, b, 0 - 9223372036854775807 - 1, 1.0, not 7)");
+
+    REQUIRE (contains(code, "long long v_i = 0;"));
+    REQUIRE (contains(code, "double v_f = 0;"));
+    REQUIRE (contains(code, "_Bool v_b = 0;"));
+    REQUIRE (contains(code, "v_n = rgr_read_int(2);"));
+    REQUIRE (contains(code, "long long rgr_limit1 = rgr_mul(v_n, 2LL);"));
+    REQUIRE (contains(code, "for (; v_i <= rgr_limit1; v_i = rgr_add(v_i, 1))"));
+    REQUIRE (contains(code, "if (((rgr_div(v_i, 3LL, 3) > 1LL) & (!v_b)))"));
+    REQUIRE (contains(code, "v_f = (v_f + ((double)v_i));"));
+    REQUIRE (contains(code, "v_b = (v_f >= 2.5);"));
+    REQUIRE (contains(code, "while ((v_n > 0LL))"));
+    REQUIRE (contains(code, "rgr_write_int(v_i);"));
+    REQUIRE (contains(code, "rgr_write_float(rgr_spaced_float(1.0));"));
+    REQUIRE (contains(code, "rgr_write_int(rgr_spaced_int((~7LL)));"));
+    REQUIRE (contains(code, "int main(void)"));
+}
+
+TEST_CASE( "C emitter with precomputed output", "[emitc]" ) {
+    PrecomputedOutput result { "1 \"a\\\n2\n", "Runtime error on line 3: Division by zero" };
+    string code = emitPrecomputedC(result);
+
+    REQUIRE (contains(code, "\"1 \\\"a\\\\\\n\"\n    \"2\\n\""));
+    REQUIRE (contains(code, "fputs(\"Runtime error on line 3: Division by zero\\n\""));
+    REQUIRE (contains(code, "return 1;"));
+    REQUIRE (contains(emitPrecomputedC(PrecomputedOutput { "", "" }), "return 0;"));
+}
@@ -0,0 +1,515 @@
+#include "Closure.h"
+#include <chrono>
+#include <climits>
+using namespace std;
+
+namespace
+{
+    // operations take operands of the same type, the line is used for error messages
+    struct AddI { static long long apply(long long a, long long b, size_t) { return wrapAdd(a, b); } };
+    struct SubI { static long long apply(long long a, long long b, size_t) { return wrapSub(a, b); } };
+    struct MulI { static long long apply(long long a, long long b, size_t) { return wrapMul(a, b); } };
+    struct DivI { static long long apply(long long a, long long b, size_t line) { return divideInt(a, b, line); } };
+    struct AndI { static long long apply(long long a, long long b, size_t) { return a & b; } };
+    struct OrI { static long long apply(long long a, long long b, size_t) { return a | b; } };
+
+    struct AddF { static double apply(double a, double b, size_t) { return a + b; } };
+    struct SubF { static double apply(double a, double b, size_t) { return a - b; } };
+    struct MulF { static double apply(double a, double b, size_t) { return a * b; } };
+    struct DivF { static double apply(double a, double b, size_t) { return a / b; } };
+
+    template<class T> struct Less { static long long apply(T a, T b, size_t) { return a < b; } };
+    template<class T> struct Greater { static long long apply(T a, T b, size_t) { return a > b; } };
+    template<class T> struct LessEqual { static long long apply(T a, T b, size_t) { return a <= b; } };
+    template<class T> struct GreaterEqual { static long long apply(T a, T b, size_t) { return a >= b; } };
+    template<class T> struct Equal { static long long apply(T a, T b, size_t) { return a == b; } };
+    template<class T> struct NotEqual { static long long apply(T a, T b, size_t) { return a != b; } };
+
+    long long& slotValue(ClosureFrame& frame, size_t slot, long long) { return frame.slots[slot].i; }
+    double& slotValue(ClosureFrame& frame, size_t slot, double) { return frame.slots[slot].f; }
+
+    long long constantValue(ExprPtr expr, long long) { return expr->intValue; }
+    double constantValue(ExprPtr expr, double) { return expr->floatValue; }
+
+    struct Cancelled {};
+
+    // ranges shorter than this aren't worth a thread
+    const unsigned long long minimumRange = 1024;
+
+    class ParallelFor
+    {
+    private:
+        ThreadPool& pool;
+        size_t counter, variableCount;
+        IntClosure initial, limitClosure;
+        StmtClosure body;
+        vector<ParallelVariable> variables;
+        vector<long long> identities;           // starting value of each reduction's partial result
+        vector<IntClosure> steps;               // of each induction variable
+
+        static long long combine(BinaryOp op, long long a, long long b)
+        {
+            switch (op)
+            {
+                case BinaryOp::Add: return wrapAdd(a, b);
+                case BinaryOp::Mul: return wrapMul(a, b);
+                case BinaryOp::And: return a & b;
+                default: return a | b;
+            }
+        }
+
+        void runRanges(ClosureFrame& frame, long long first, long long limit, size_t ranges)
+        {
+            unsigned long long count = (unsigned long long)limit - (unsigned long long)first + 1;
+            unsigned long long length = count / ranges, longer = count % ranges;
+            auto offset = [&](size_t range) { return range * length + min<unsigned long long>(range, longer); };
+
+            vector<vector<Value>> frames(ranges, vector<Value>(frame.slots, frame.slots + variableCount));
+            vector<exception_ptr> errors(ranges);
+            unique_ptr<atomic<bool>[]> cancelled(new atomic<bool>[ranges]);
+            for (size_t range = 0; range < ranges; range++)
+                cancelled[range] = false;
+
+            pool.run(ranges, [&](size_t range) {
+                Value* slots = frames[range].data();
+                ClosureFrame rangeFrame { slots, frame.input, frame.output, &cancelled[range] };
+                unsigned long long begin = offset(range), end = offset(range + 1);
+                try
+                {
+                    for (size_t i = 0; i < variables.size(); i++)
+                    {
+                        ParallelVariable& variable = variables[i];
+                        long long& value = slots[variable.slot].i;
+                        if (variable.role == ParallelRole::Reduction)
+                            value = identities[i];
+                        else if (variable.role == ParallelRole::Induction)
+                        {
+                            long long advance = wrapMul((long long)begin, steps[i](rangeFrame));
+                            value = variable.op == BinaryOp::Add ? wrapAdd(value, advance) : wrapSub(value, advance);
+                        }
+                    }
+
+                    for (unsigned long long iteration = begin; iteration < end; iteration++)
+                    {
+                        if (cancelled[range])
+                            throw Cancelled();
+                        slots[counter].i = (long long)((unsigned long long)first + iteration);
+                        body(rangeFrame);
+                    }
+                }
+                catch (...)
+                {
+                    errors[range] = current_exception();
+                    for (size_t later = range + 1; later < ranges; later++)
+                        cancelled[later] = true;
+                }
+            });
+
+            for (auto& error : errors)
+                if (error)
+                    rethrow_exception(error);
+
+            for (auto& variable : variables)
+            {
+                long long& value = frame.slots[variable.slot].i;
+                if (variable.role != ParallelRole::Reduction)
+                    value = frames.back()[variable.slot].i;
+                else
+                    for (auto& partial : frames)
+                        value = combine(variable.op, value, partial[variable.slot].i);
+            }
+            frame.slots[counter].i = limit + 1;
+        }
+    public:
+        ParallelFor(ThreadPool& _pool, const TypedProgram& program, StmtPtr loop, const ParallelLoop& analysis,
+                    IntClosure _initial, IntClosure _limit, StmtClosure _body, vector<IntClosure> _steps)
+                : pool(_pool), counter(loop->slot), variableCount(program.variables.size()), initial(_initial),
+                  limitClosure(_limit), body(_body), variables(analysis.variables), steps(_steps)
+        {
+            for (auto& variable : variables)
+            {
+                bool isBool = program.variables[variable.slot].type == DataType::Bool;
+                identities.push_back(variable.op == BinaryOp::Mul ? 1 : variable.op != BinaryOp::And ? 0 : isBool ? 1 : -1);
+            }
+        }
+
+        // endless loops, the ones ending at the largest integer, and short ones run serially
+        void run(ClosureFrame& frame)
+        {
+            long long& counter = frame.slots[this->counter].i;
+            counter = initial(frame);
+            long long limit = limitClosure(frame);
+
+            if (counter <= limit && limit < LLONG_MAX)
+            {
+                unsigned long long count = (unsigned long long)limit - (unsigned long long)counter + 1;
+                size_t ranges = (size_t)min<unsigned long long>(pool.size() * 4, count / minimumRange);
+                if (ranges > 1)
+                {
+                    runRanges(frame, counter, limit, ranges);
+                    return;
+                }
+            }
+
+            for (; counter <= limit; counter = wrapAdd(counter, 1))
+                body(frame);
+        }
+    };
+
+    class ClosureCompiler
+    {
+    private:
+        const TypedProgram& program;
+        ThreadPool* pool;
+        Profile* profile;
+        bool inParallel;                // loops in a parallel loop's body run serially and stop when cancelled
+
+        IntClosure compile(ExprPtr expr, long long) { return compileInt(expr); }
+        FloatClosure compile(ExprPtr expr, double) { return compileFloat(expr); }
+
+        // the most common operand shapes are bound directly instead of calling closures of the operands
+        template<class Op, class T, class Result>
+        function<Result(ClosureFrame&)> binary(ExprPtr left, ExprPtr right, size_t line)
+        {
+            if (left->kind == ExprKind::Variable && isConstant(right))
+            {
+                size_t slot = left->slot;
+                T value = constantValue(right, T());
+                return [=](ClosureFrame& frame) -> Result { return Op::apply(slotValue(frame, slot, T()), value, line); };
+            }
+
+            if (left->kind == ExprKind::Variable && right->kind == ExprKind::Variable)
+            {
+                size_t leftSlot = left->slot, rightSlot = right->slot;
+                return [=](ClosureFrame& frame) -> Result {
+                    return Op::apply(slotValue(frame, leftSlot, T()), slotValue(frame, rightSlot, T()), line);
+                };
+            }
+
+            if (isConstant(right))
+            {
+                auto leftClosure = compile(left, T());
+                T value = constantValue(right, T());
+                return [=](ClosureFrame& frame) -> Result { return Op::apply(leftClosure(frame), value, line); };
+            }
+
+            auto leftClosure = compile(left, T());
+            auto rightClosure = compile(right, T());
+            return [=](ClosureFrame& frame) -> Result { return Op::apply(leftClosure(frame), rightClosure(frame), line); };
+        }
+
+        template<class T>
+        IntClosure comparison(ExprPtr expr)
+        {
+            switch (expr->op)
+            {
+                case BinaryOp::Less: return binary<Less<T>, T, long long>(expr->left, expr->right, expr->line);
+                case BinaryOp::Greater: return binary<Greater<T>, T, long long>(expr->left, expr->right, expr->line);
+                case BinaryOp::LessEqual: return binary<LessEqual<T>, T, long long>(expr->left, expr->right, expr->line);
+                case BinaryOp::GreaterEqual: return binary<GreaterEqual<T>, T, long long>(expr->left, expr->right, expr->line);
+                case BinaryOp::Equal: return binary<Equal<T>, T, long long>(expr->left, expr->right, expr->line);
+                default: return binary<NotEqual<T>, T, long long>(expr->left, expr->right, expr->line);
+            }
+        }
+
+        IntClosure compileInt(ExprPtr expr)
+        {
+            switch (expr->kind)
+            {
+                case ExprKind::IntConst:
+                case ExprKind::BoolConst:
+                {
+                    long long value = expr->intValue;
+                    return [=](ClosureFrame&) { return value; };
+                }
+                case ExprKind::Variable:
+                {
+                    size_t slot = expr->slot;
+                    return [=](ClosureFrame& frame) { return frame.slots[slot].i; };
+                }
+                case ExprKind::Not:
+                {
+                    IntClosure operand = compileInt(expr->left);
+                    if (expr->type == DataType::Integer)
+                        return [=](ClosureFrame& frame) { return ~operand(frame); };
+                    return [=](ClosureFrame& frame) { return (long long)!operand(frame); };
+                }
+                default:
+                    break;
+            }
+
+            DataType operandType = expr->left->type;
+            if (isComparison(expr->op))
+                return operandType == DataType::Float ? comparison<double>(expr) : comparison<long long>(expr);
+
+            switch (expr->op)
+            {
+                case BinaryOp::Add: return binary<AddI, long long, long long>(expr->left, expr->right, expr->line);
+                case BinaryOp::Sub: return binary<SubI, long long, long long>(expr->left, expr->right, expr->line);
+                case BinaryOp::Mul: return binary<MulI, long long, long long>(expr->left, expr->right, expr->line);
+                case BinaryOp::Div: return binary<DivI, long long, long long>(expr->left, expr->right, expr->line);
+                case BinaryOp::And: return binary<AndI, long long, long long>(expr->left, expr->right, expr->line);
+                default: return binary<OrI, long long, long long>(expr->left, expr->right, expr->line);
+            }
+        }
+
+        FloatClosure compileFloat(ExprPtr expr)
+        {
+            switch (expr->kind)
+            {
+                case ExprKind::FloatConst:
+                {
+                    double value = expr->floatValue;
+                    return [=](ClosureFrame&) { return value; };
+                }
+                case ExprKind::Variable:
+                {
+                    size_t slot = expr->slot;
+                    return [=](ClosureFrame& frame) { return frame.slots[slot].f; };
+                }
+                case ExprKind::IntToFloat:
+                {
+                    if (expr->left->kind == ExprKind::Variable)
+                    {
+                        size_t slot = expr->left->slot;
+                        return [=](ClosureFrame& frame) { return (double)frame.slots[slot].i; };
+                    }
+                    IntClosure operand = compileInt(expr->left);
+                    return [=](ClosureFrame& frame) { return (double)operand(frame); };
+                }
+                default:
+                    break;
+            }
+
+            switch (expr->op)
+            {
+                case BinaryOp::Add: return binary<AddF, double, double>(expr->left, expr->right, expr->line);
+                case BinaryOp::Sub: return binary<SubF, double, double>(expr->left, expr->right, expr->line);
+                case BinaryOp::Mul: return binary<MulF, double, double>(expr->left, expr->right, expr->line);
+                default: return binary<DivF, double, double>(expr->left, expr->right, expr->line);
+            }
+        }
+
+        StmtClosure compileAssignment(size_t slot, ExprPtr value)
+        {
+            if (value->type == DataType::Float)
+            {
+                FloatClosure closure = compileFloat(value);
+                return [=](ClosureFrame& frame) { frame.slots[slot].f = closure(frame); };
+            }
+
+            IntClosure closure = compileInt(value);
+            return [=](ClosureFrame& frame) { frame.slots[slot].i = closure(frame); };
+        }
+
+        // the separator is written once the value is computed, as the VM does
+        StmtClosure compileWrite(ExprPtr value, bool separated)
+        {
+            if (value->type == DataType::Float)
+            {
+                FloatClosure closure = compileFloat(value);
+                return [=](ClosureFrame& frame) {
+                    double result = closure(frame);
+                    if (separated)
+                        frame.output->writeChar(' ');
+                    frame.output->writeFloat(result);
+                };
+            }
+
+            IntClosure closure = compileInt(value);
+            bool isBool = value->type == DataType::Bool;
+            return [=](ClosureFrame& frame) {
+                long long result = closure(frame);
+                if (separated)
+                    frame.output->writeChar(' ');
+                if (isBool)
+                    frame.output->writeBool(result != 0);
+                else
+                    frame.output->writeInt(result);
+            };
+        }
+    public:
+        ClosureCompiler(const TypedProgram& _program, ThreadPool* _pool, Profile* _profile)
+                : program(_program), pool(_pool), profile(_profile), inParallel(false) {}
+
+        StmtClosure compileStmt(StmtPtr stmt)
+        {
+            StmtClosure closure = compileUnprofiled(stmt);
+            ProfiledStatement* counter = profile ? profile->find(stmt) : nullptr;
+            if (!counter)
+                return closure;
+
+            if (stmt->kind != StmtKind::While && stmt->kind != StmtKind::For)
+                return [=](ClosureFrame& frame) {
+                    counter->count++;
+                    closure(frame);
+                };
+
+            // the time is added when the loop stops with an error as well
+            return [=](ClosureFrame& frame) {
+                struct Timer
+                {
+                    ProfiledStatement* counter;
+                    chrono::steady_clock::time_point start;
+                    ~Timer() { counter->nanoseconds += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count(); }
+                } timer { counter, chrono::steady_clock::now() };
+                counter->count++;
+                closure(frame);
+            };
+        }
+
+        StmtClosure compileUnprofiled(StmtPtr stmt)
+        {
+            size_t line = stmt->line;
+
+            switch (stmt->kind)
+            {
+                case StmtKind::Assign:
+                    return compileAssignment(stmt->slot, stmt->value);
+
+                case StmtKind::If:
+                {
+                    IntClosure condition = compileInt(stmt->value);
+                    StmtClosure thenBranch = compileStmt(stmt->body);
+                    if (!stmt->elseBody)
+                        return [=](ClosureFrame& frame) { if (condition(frame)) thenBranch(frame); };
+
+                    StmtClosure elseBranch = compileStmt(stmt->elseBody);
+                    return [=](ClosureFrame& frame) {
+                        if (condition(frame))
+                            thenBranch(frame);
+                        else
+                            elseBranch(frame);
+                    };
+                }
+
+                case StmtKind::While:
+                {
+                    IntClosure condition = compileInt(stmt->value);
+                    StmtClosure body = compileStmt(stmt->body);
+                    if (inParallel)
+                        return [=](ClosureFrame& frame) {
+                            while (condition(frame))
+                            {
+                                if (frame.cancelled && *frame.cancelled)
+                                    throw Cancelled();
+                                body(frame);
+                            }
+                        };
+                    return [=](ClosureFrame& frame) {
+                        while (condition(frame))
+                            body(frame);
+                    };
+                }
+
+                case StmtKind::For:
+                {
+                    size_t slot = stmt->slot;
+                    IntClosure initial = compileInt(stmt->value);
+                    IntClosure limitClosure = compileInt(stmt->limit);
+
+                    ParallelLoop analysis;
+                    if (pool && !inParallel && analyzeParallelLoop(program, stmt, analysis))
+                    {
+                        inParallel = true;
+                        StmtClosure body = compileStmt(stmt->body);
+                        inParallel = false;
+
+                        vector<IntClosure> steps;
+                        for (auto& variable : analysis.variables)
+                            steps.push_back(variable.step ? compileInt(variable.step) : IntClosure());
+
+                        auto loop = make_shared<ParallelFor>(*pool, program, stmt, analysis, initial, limitClosure, body, steps);
+                        return [=](ClosureFrame& frame) { loop->run(frame); };
+                    }
+
+                    StmtClosure body = compileStmt(stmt->body);
+                    if (inParallel)
+                        return [=](ClosureFrame& frame) {
+                            long long& counter = frame.slots[slot].i;
+                            counter = initial(frame);
+                            long long limit = limitClosure(frame);
+                            for (; counter <= limit; counter = wrapAdd(counter, 1))
+                            {
+                                if (frame.cancelled && *frame.cancelled)
+                                    throw Cancelled();
+                                body(frame);
+                            }
+                        };
+                    return [=](ClosureFrame& frame) {
+                        long long& counter = frame.slots[slot].i;
+                        counter = initial(frame);
+                        long long limit = limitClosure(frame);
+                        for (; counter <= limit; counter = wrapAdd(counter, 1))
+                            body(frame);
+                    };
+                }
+
+                case StmtKind::Read:
+                {
+                    vector<pair<size_t, DataType>> targets;
+                    for (auto slot : stmt->slots)
+                        targets.push_back(make_pair(slot, program.variables[slot].type));
+
+                    return [=](ClosureFrame& frame) {
+                        for (auto& target : targets)
+                        {
+                            Value& value = frame.slots[target.first];
+                            if (target.second == DataType::Integer)
+                                value.i = frame.input->readInt(line);
+                            else if (target.second == DataType::Float)
+                                value.f = frame.input->readFloat(line);
+                            else
+                                value.i = frame.input->readBool(line);
+                        }
+                    };
+                }
+
+                case StmtKind::Write:
+                {
+                    vector<StmtClosure> writers;
+                    for (size_t i = 0; i < stmt->values.size(); i++)
+                        writers.push_back(compileWrite(stmt->values[i], i > 0));
+
+                    return [=](ClosureFrame& frame) {
+                        for (auto& writer : writers)
+                            writer(frame);
+                        frame.output->writeChar('\n');
+                    };
+                }
+
+                case StmtKind::Block:
+                    break;
+            }
+
+            vector<StmtClosure> statements;
+            for (auto& inner : stmt->statements)
+                statements.push_back(compileStmt(inner));
+
+            if (statements.size() == 1)
+                return statements[0];
+
+            return [=](ClosureFrame& frame) {
+                for (auto& statement : statements)
+                    statement(frame);
+            };
+        }
+    };
+}
+
+ClosureEngine::ClosureEngine(const TypedProgram& program, size_t threads, Profile* profile)
+{
+    Value zero;
+    zero.i = 0;
+    slots.assign(program.variables.size(), zero);
+
+    if (threads > 1 && !profile)
+        pool.reset(new ThreadPool(threads));
+    body = ClosureCompiler(program, pool.get(), profile).compileStmt(program.body);
+}
+
+void ClosureEngine::run(InputBuffer& input, OutputBuffer& output)
+{
+    ClosureFrame frame { slots.data(), &input, &output, nullptr };
+    body(frame);
+}
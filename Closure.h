@@ -0,0 +1,55 @@
+#ifndef RGR_CLOSURE_H
+#define RGR_CLOSURE_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include "TypedTree.h"
+#include "Runtime.h"
+#include "Parallel.h"
+#include "Profile.h"
+
+/*
+ * Closure-compilation execution engine.
+ *
+ * The typed program is walked once and every expression and statement becomes a callable object
+ * specialized for its types, with variables bound by slot and literals already decoded. Running the
+ * program is just calling the closure of its body, and compiling it costs about as much as lowering,
+ * which suits programs that run only a few times.
+ *
+ * With more than one thread, "for" loops with independent iterations (see Parallel.h) and enough of them are split
+ * into ranges run on a thread pool, each with its own copy of the variables; the partial results are combined in
+ * the order of the ranges, so the result is the same as running serially. When ranges fail, the error of the first
+ * one is reported, loops of the later ones stop early.
+ *
+ * With a profile, every statement counts its runs and loops add up their time in it (see Profile.h); loops then run
+ * serially, so the counters need no synchronization.
+ */
+
+struct ClosureFrame
+{
+    Value* slots;
+    InputBuffer* input;
+    OutputBuffer* output;
+    const std::atomic<bool>* cancelled;     // set when the range of iterations running this frame is no longer needed
+};
+
+// integer and bool expressions share the representation, bools are 0 or 1
+typedef std::function<long long(ClosureFrame&)> IntClosure;
+typedef std::function<double(ClosureFrame&)> FloatClosure;
+typedef std::function<void(ClosureFrame&)> StmtClosure;
+
+class ClosureEngine
+{
+private:
+    std::vector<Value> slots;
+    std::unique_ptr<ThreadPool> pool;
+    StmtClosure body;
+public:
+    explicit ClosureEngine(const TypedProgram& program, size_t threads = 1, Profile* profile = nullptr);
+
+    void run(InputBuffer& input, OutputBuffer& output);
+    const std::vector<Value>& getSlots() { return slots; }
+};
+
+#endif //RGR_CLOSURE_H
@@ -0,0 +1,57 @@
+#include "catch.hpp"
+#include "TestSupport.h"
+#include "Closure.h"
+
+using namespace std;
+
+namespace
+{
+    string runClosure(string code, string input = "")
+    {
+        return run(ClosureEngine(lower(code)), input);
+    }
+}
+
+TEST_CASE( "closure engine matches the VM", "[closure]" ) {
+    vector<string> programs = {
+            "write(10 - 3 - 2, 7 / 2, 7.0 / 2, 0ffh and 10b, not 0, not true)",
+            "dim i, s integer : for i as 1 to 100 do s as s + i * i : write(s, i)",
+            "dim i integer : for i as 5 to 1 do write(i) : write(i)",
+            "dim a integer : while a < 10 do a as a + 3 : write(a)",
+            "dim f float : dim i integer : for i as 1 to 4 do f as f + i / 2 : write(f, f > i, i < f)",
+            "dim f float : f as 0.0 / 0.0 : write(f = f, f <> f, f < 1)",
+            "dim i, j, n integer\n"
+            "for i as 1 to 10 do\n"
+            "    for j as i to 10 do\n"
+            "        if i * j > 50 then n as n + 1 else if i = j then n as n - 1\n"
+            "write(n)",
+            "dim a, b integer : dim f float : dim c bool : read(a, b, f, c) : if c then write(a / b, f * a) else write(0)",
+    };
+
+    for (auto& program : programs)
+        REQUIRE (runClosure(program, "7 2 1.5 true") == runVM(program, "7 2 1.5 true"));
+}
+
+TEST_CASE( "closure engine state and errors", "[closure]" ) {
+    TypedProgram program = lower("dim a, b integer : dim f float : a as 6 : f as a * 1.5 : b as a / 4");
+    ClosureEngine engine(program);
+
+    InputBuffer in("");
+    OutputBuffer out;
+    engine.run(in, out);
+
+    REQUIRE (engine.getSlots()[0].i == 6);
+    REQUIRE (engine.getSlots()[1].i == 1);
+    REQUIRE (engine.getSlots()[2].f == 9.0);
+
+    REQUIRE (runClosure("dim a integer : write(1 / a)") == "Runtime error on line 1: Division by zero");
+    REQUIRE (runClosure("dim a integer : read(a)", "abc") == runVM("dim a integer : read(a)", "abc"));
+    REQUIRE (runClosure("dim a integer : read(a)", "abc").find("line 1") != string::npos);
+
+    // the separator before a failing value isn't written
+    InputBuffer empty("");
+    OutputBuffer partial;
+    ClosureEngine failing(lower("dim a integer : write(3, 1.5, a / a)"));
+    REQUIRE_THROWS (failing.run(empty, partial));
+    REQUIRE (partial.str() == "3 1.5");
+}
@@ -0,0 +1,133 @@
+#include "Counters.h"
+#include <cstring>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstdint>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+    const char* names[hardwareCounterCount] = { "cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses" };
+}
+
+const char* hardwareCounterName(HardwareCounter counter)
+{
+    return names[(size_t)counter];
+}
+
+#ifdef __linux__
+
+namespace
+{
+    uint64_t cacheMisses(uint64_t cache)
+    {
+        return cache | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+    }
+
+    struct CounterEvent
+    {
+        uint32_t type;
+        uint64_t config;
+    };
+
+    const CounterEvent events[hardwareCounterCount] = {
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+            { PERF_TYPE_HW_CACHE, cacheMisses(PERF_COUNT_HW_CACHE_L1D) },
+            { PERF_TYPE_HW_CACHE, cacheMisses(PERF_COUNT_HW_CACHE_LL) },
+    };
+
+    // the value, then the time the counter was enabled and the time it actually counted
+    struct CounterRead
+    {
+        uint64_t value, enabled, running;
+    };
+}
+
+HardwareCounters::HardwareCounters()
+{
+    for (size_t i = 0; i < hardwareCounterCount; i++)
+    {
+        perf_event_attr attributes;
+        memset(&attributes, 0, sizeof(attributes));
+        attributes.size = sizeof(attributes);
+        attributes.type = events[i].type;
+        attributes.config = events[i].config;
+        attributes.disabled = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        descriptors[i] = syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+        if (descriptors[i] < 0 && problem.empty())
+            problem = string("perf_event_open for ") + names[i] + ": " + strerror(errno)
+                      + (errno == EACCES || errno == EPERM ? " (see /proc/sys/kernel/perf_event_paranoid)" : "");
+    }
+    reset();
+}
+
+HardwareCounters::~HardwareCounters()
+{
+    for (int descriptor : descriptors)
+        if (descriptor >= 0)
+            close(descriptor);
+}
+
+void HardwareCounters::start()
+{
+    for (int descriptor : descriptors)
+        if (descriptor >= 0)
+        {
+            ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+            ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+        }
+}
+
+void HardwareCounters::stop()
+{
+    for (size_t i = 0; i < hardwareCounterCount; i++)
+    {
+        if (descriptors[i] < 0)
+            continue;
+        ioctl(descriptors[i], PERF_EVENT_IOC_DISABLE, 0);
+        CounterRead counted;
+        if (read(descriptors[i], &counted, sizeof(counted)) == sizeof(counted) && counted.running)
+            totals[i] += (double)counted.value * counted.enabled / counted.running;
+    }
+}
+
+#else
+
+HardwareCounters::HardwareCounters() : problem("hardware counters need Linux perf_event_open")
+{
+    for (int& descriptor : descriptors)
+        descriptor = -1;
+    reset();
+}
+
+HardwareCounters::~HardwareCounters()
+{
+}
+
+void HardwareCounters::start()
+{
+}
+
+void HardwareCounters::stop()
+{
+}
+
+#endif
+
+void HardwareCounters::reset()
+{
+    for (double& total : totals)
+        total = 0;
+}
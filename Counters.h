@@ -0,0 +1,44 @@
+#ifndef RGR_COUNTERS_H
+#define RGR_COUNTERS_H
+
+#include <string>
+
+/*
+ * Hardware performance counters of the calling thread, read through Linux perf_event_open.
+ *
+ * Each counter is opened on its own and counts user space only, so a counter the processor or the kernel's
+ * perf_event_paranoid setting refuses leaves the others working; on other systems, or in virtual machines without a
+ * PMU, none is available and problem() says why. Counts are summed over start() ... stop() intervals and scaled up
+ * when the kernel had to multiplex more counters than the processor has.
+ */
+
+enum class HardwareCounter { Cycles, Instructions, BranchMisses, L1dMisses, LlcMisses };
+const size_t hardwareCounterCount = 5;
+
+const char* hardwareCounterName(HardwareCounter counter);
+
+class HardwareCounters
+{
+private:
+    int descriptors[hardwareCounterCount];
+    double totals[hardwareCounterCount];
+    std::string problem;
+public:
+    HardwareCounters();
+    ~HardwareCounters();
+
+    HardwareCounters(const HardwareCounters&) = delete;
+    HardwareCounters& operator=(const HardwareCounters&) = delete;
+
+    bool available(HardwareCounter counter) const { return descriptors[(size_t)counter] >= 0; }
+    // why some counter is unavailable, empty when all of them are
+    const std::string& getProblem() const { return problem; }
+
+    void start();
+    void stop();
+    void reset();
+    // counted since the last reset, 0 for an unavailable counter
+    double total(HardwareCounter counter) const { return totals[(size_t)counter]; }
+};
+
+#endif //RGR_COUNTERS_H
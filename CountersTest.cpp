@@ -0,0 +1,38 @@
+#include "catch.hpp"
+#include "Counters.h"
+#include <vector>
+
+using namespace std;
+
+TEST_CASE( "hardware counters", "[counters]" ) {
+    REQUIRE (string(hardwareCounterName(HardwareCounter::Cycles)) == "cycles");
+    REQUIRE (string(hardwareCounterName(HardwareCounter::LlcMisses)) == "llc_misses");
+
+    // without a PMU or permission the counters stay unavailable and read 0
+    HardwareCounters counters;
+    bool all = true;
+    for (size_t i = 0; i < hardwareCounterCount; i++)
+        all = all && counters.available((HardwareCounter)i);
+    REQUIRE (counters.getProblem().empty() == all);
+
+    volatile long sum = 0;
+    for (int run = 0; run < 2; run++)
+    {
+        counters.start();
+        vector<long> values(1 << 16, 1);
+        for (long value : values)
+            sum += value;
+        counters.stop();
+    }
+    REQUIRE (sum == 2 << 16);
+
+    for (size_t i = 0; i < hardwareCounterCount; i++)
+        if (!counters.available((HardwareCounter)i))
+            REQUIRE (counters.total((HardwareCounter)i) == 0);
+    if (counters.available(HardwareCounter::Instructions))
+        REQUIRE (counters.total(HardwareCounter::Instructions) > 2 << 16);
+
+    counters.reset();
+    for (size_t i = 0; i < hardwareCounterCount; i++)
+        REQUIRE (counters.total((HardwareCounter)i) == 0);
+}
@@ -0,0 +1,1628 @@
+#include <cstring>
+#include "Elf.h"
+#include "Runtime.h"
+using namespace std;
+
+namespace
+{
+    const uint64_t textAddress = 0x400000;
+    const uint64_t dataAddress = 0x10000000;
+    const uint64_t pageSize = 0x1000;
+
+    const size_t elfHeaderSize = 64;
+    const size_t programHeaderSize = 56;
+    const size_t headersSize = elfHeaderSize + 2 * programHeaderSize;
+
+    const int32_t tokenCapacity = 64;
+    const int32_t outputCapacity = 1 << 16;
+    const int32_t inputCapacity = 1 << 16;
+
+    // limbs of the numbers reading floats works with: a value of a token read is below 10^310 and 10^389 is
+    // the largest divisor, both fit with the bits they are shifted by
+    const int32_t bigLimbs = 24;
+
+    const long long sysRead = 0, sysWrite = 1, sysExitGroup = 231;
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    void put(vector<uint8_t>& out, uint64_t value, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+            out.push_back((uint8_t)(value >> (8 * i)));
+    }
+
+    class ElfBuilder : public HelperCalls
+    {
+    private:
+        const TypedProgram& program;
+        X86Assembler as;
+        vector<Value> frame;
+
+        Label flush, flushFd, writeChar, writeString, writeInt, writeFloat, writeBool, getByte, readToken, parseIntToken;
+        Label readInt, readFloat, readBool, errorExit;
+        bool writesFloats = false, readsFloats = false;
+
+        // data segment: the frame, runtime state and messages are initialized, the buffers follow zero filled
+        vector<uint8_t> data;
+        int32_t outUsed, inPosition, inFilled, tokenLength;
+        int32_t tokenBuffer, outBuffer, inBuffer, dataSize;
+        int32_t powersTable, inversesTable;
+        int32_t powersOfTen, bigValue, bigDivisor;
+
+        struct Message
+        {
+            int32_t offset, length;
+        };
+
+        Message prefix, colon, divisionByZero, endOfInput, integerExpected, floatExpected, boolExpected, foundInstead;
+        Message trueText, falseText;
+        Message nanText, infText;
+
+        Message addMessage(const string& text)
+        {
+            Message message { (int32_t)data.size(), (int32_t)text.size() };
+            data.insert(data.end(), text.begin(), text.end());
+            return message;
+        }
+
+        int32_t addWord()
+        {
+            int32_t offset = (int32_t)data.size();
+            put(data, 0, 8);
+            return offset;
+        }
+
+        void layoutData()
+        {
+            for (auto& value : frame)
+                put(data, (uint64_t)value.i, 8);
+
+            outUsed = addWord();
+            inPosition = addWord();
+            inFilled = addWord();
+            tokenLength = addWord();
+
+            prefix = addMessage("Runtime error on line ");
+            colon = addMessage(": ");
+            divisionByZero = addMessage("Division by zero");
+            endOfInput = addMessage("Unexpected end of input");
+            integerExpected = addMessage("Integer expected, \"");
+            floatExpected = addMessage("Float expected, \"");
+            boolExpected = addMessage("Bool expected, \"");
+            foundInstead = addMessage("\" found instead");
+            trueText = addMessage("true");
+            falseText = addMessage("false");
+
+            // the tables of formatFloat, only for programs writing floats
+            if (writesFloats)
+            {
+                nanText = addMessage("nan");
+                infText = addMessage("inf");
+
+                const PowerOfFiveTables& tables = powerOfFiveTables();
+                data.resize(alignUp(data.size(), 8), 0);
+                powersTable = (int32_t)data.size();
+                for (auto& entry : tables.powers)
+                {
+                    put(data, entry[0], 8);
+                    put(data, entry[1], 8);
+                }
+                inversesTable = (int32_t)data.size();
+                for (auto& entry : tables.inverses)
+                {
+                    put(data, entry[0], 8);
+                    put(data, entry[1], 8);
+                }
+            }
+
+            // the exact powers of ten up to 10^22 for the fast path of reading floats
+            if (readsFloats)
+            {
+                data.resize(alignUp(data.size(), 8), 0);
+                powersOfTen = (int32_t)data.size();
+                double power = 1;
+                for (int i = 0; i <= 22; i++, power *= 10)
+                {
+                    uint64_t bits;
+                    memcpy(&bits, &power, sizeof(bits));
+                    put(data, bits, 8);
+                }
+            }
+
+            tokenBuffer = (int32_t)alignUp(data.size(), 16);
+            outBuffer = tokenBuffer + tokenCapacity;
+            inBuffer = outBuffer + outputCapacity;
+            bigValue = inBuffer + inputCapacity;
+            bigDivisor = bigValue + 8 * bigLimbs;
+            dataSize = readsFloats ? bigDivisor + 8 * bigLimbs : bigValue;
+        }
+
+        void message(Reg pointer, Reg length, const Message& text)
+        {
+            as.lea(pointer, Reg::RBX, text.offset);
+            as.mov(length, (long long)text.length);
+        }
+
+        // jumps to continueLabel when RAX holds a whitespace character, as isspace in the C locale
+        void jumpIfSpace(Label target)
+        {
+            as.alu(AluOp::Cmp, Reg::RAX, ' ');
+            as.jcc(Cond::E, target);
+            as.mov(Reg::RCX, Reg::RAX);
+            as.alu(AluOp::Sub, Reg::RCX, '\t');
+            as.alu(AluOp::Cmp, Reg::RCX, '\r' - '\t');
+            as.jcc(Cond::BE, target);
+        }
+
+        // RDX = RAX / 10 through the reciprocal, clobbers RAX and RCX
+        void divideBy10()
+        {
+            as.mov(Reg::RCX, (long long)0xCCCCCCCCCCCCCCCDULL);
+            as.mul(Reg::RCX);
+            as.shift(ShiftOp::Shr, Reg::RDX, 3);
+        }
+
+        // writes the digits at [RSP + RDI] up to the count in R15, advancing RDI
+        void writeBufferedDigits()
+        {
+            Label loop = as.newLabel(), done = as.newLabel();
+            as.bind(loop);
+            as.alu(AluOp::Cmp, Reg::RDI, Reg::R15);
+            as.jcc(Cond::GE, done);
+            as.loadByte(Reg::RSI, Reg::RSP, Reg::RDI, 0);
+            as.call(writeChar);
+            as.alu(AluOp::Add, Reg::RDI, 1);
+            as.jmp(loop);
+            as.bind(done);
+        }
+
+        // vr, vp and vm of formatFloat into R8, R9 and R10 from mv in R12 and mv - 1 - mmShift in R13,
+        // the table entry is at RDI and the shift less 64 in RCX
+        void emitBounds(Label multiplyShift)
+        {
+            as.mov(Reg::RSI, Reg::R12);
+            as.call(multiplyShift);
+            as.mov(Reg::R8, Reg::RAX);
+            as.mov(Reg::RSI, Reg::R12);
+            as.alu(AluOp::Add, Reg::RSI, 2);
+            as.call(multiplyShift);
+            as.mov(Reg::R9, Reg::RAX);
+            as.mov(Reg::RSI, Reg::R13);
+            as.call(multiplyShift);
+            as.mov(Reg::R10, Reg::RAX);
+        }
+
+        // value in XMM0, the same digits and layout as formatFloat of the other engines, see shortestDigits there
+        void emitFloatOutput()
+        {
+            Label multiplyShift = as.newLabel(), multipleOfPowerOf5 = as.newLabel(), decimalLength = as.newLabel();
+
+            // ((RSI * low) >> 64 + RSI * high) >> (RCX + 64) for the table entry at RDI, in RAX,
+            // clobbers RDX and RSI
+            as.bind(multiplyShift);
+            as.load(Reg::RAX, Reg::RDI, 0);
+            as.mul(Reg::RSI);
+            as.push(Reg::RDX);
+            as.load(Reg::RAX, Reg::RDI, 8);
+            as.mul(Reg::RSI);
+            as.pop(Reg::RSI);
+            as.alu(AluOp::Add, Reg::RAX, Reg::RSI);
+            as.alu(AluOp::Adc, Reg::RDX, 0);
+            as.shrd(Reg::RAX, Reg::RDX);
+            as.ret();
+
+            // whether 5^RCX divides RAX, in RAX, clobbers RCX, RDX and RSI
+            as.bind(multipleOfPowerOf5);
+            {
+                Label loop = as.newLabel(), yes = as.newLabel(), no = as.newLabel();
+                as.mov(Reg::RSI, 5LL);
+                as.bind(loop);
+                as.test(Reg::RCX, Reg::RCX);
+                as.jcc(Cond::E, yes);
+                as.mov(Reg::RDX, 0LL);
+                as.div(Reg::RSI);
+                as.test(Reg::RDX, Reg::RDX);
+                as.jcc(Cond::NE, no);
+                as.alu(AluOp::Sub, Reg::RCX, 1);
+                as.jmp(loop);
+                as.bind(yes);
+                as.mov(Reg::RAX, 1LL);
+                as.ret();
+                as.bind(no);
+                as.mov(Reg::RAX, 0LL);
+                as.ret();
+            }
+
+            // number of decimal digits of RAX in RCX, clobbers RDX
+            as.bind(decimalLength);
+            {
+                Label loop = as.newLabel(), done = as.newLabel();
+                as.mov(Reg::RCX, 1LL);
+                as.mov(Reg::RDX, 10LL);
+                as.bind(loop);
+                as.alu(AluOp::Cmp, Reg::RCX, 20);
+                as.jcc(Cond::AE, done);
+                as.alu(AluOp::Cmp, Reg::RAX, Reg::RDX);
+                as.jcc(Cond::B, done);
+                as.alu(AluOp::Add, Reg::RCX, 1);
+                as.imul(Reg::RDX, 10);
+                as.jmp(loop);
+                as.bind(done);
+                as.ret();
+            }
+
+            as.bind(writeFloat);
+            Label finite = as.newLabel(), positive = as.newLabel(), notInfinity = as.newLabel(), nonZero = as.newLabel();
+            Label subnormal = as.newLabel(), decoded = as.newLabel(), negativeExponent = as.newLabel(), flagsDone = as.newLabel();
+
+            // the biased exponent in R8, the fraction in R9
+            as.movq(Reg::RAX, XReg::XMM0);
+            as.mov(Reg::R8, Reg::RAX);
+            as.shift(ShiftOp::Shr, Reg::R8, 52);
+            as.alu(AluOp::And, Reg::R8, 0x7FF);
+            as.mov(Reg::R9, Reg::RAX);
+            as.shift(ShiftOp::Shl, Reg::R9, 12);
+            as.shift(ShiftOp::Shr, Reg::R9, 12);
+
+            as.alu(AluOp::Cmp, Reg::R8, 0x7FF);
+            as.jcc(Cond::NE, finite);
+            as.test(Reg::R9, Reg::R9);
+            as.jcc(Cond::E, finite);
+            message(Reg::R8, Reg::R9, nanText);
+            as.jmp(writeString);
+
+            as.bind(finite);
+            as.test(Reg::RAX, Reg::RAX);
+            as.jcc(Cond::NS, positive);
+            as.mov(Reg::RSI, (long long)'-');
+            as.call(writeChar);
+            as.bind(positive);
+            as.alu(AluOp::Cmp, Reg::R8, 0x7FF);
+            as.jcc(Cond::NE, notInfinity);
+            message(Reg::R8, Reg::R9, infText);
+            as.jmp(writeString);
+
+            as.bind(notInfinity);
+            as.mov(Reg::RCX, Reg::R8);
+            as.alu(AluOp::Or, Reg::RCX, Reg::R9);
+            as.jcc(Cond::NE, nonZero);
+            as.mov(Reg::RSI, (long long)'0');
+            as.jmp(writeChar);
+
+            as.bind(nonZero);
+            for (auto reg : { Reg::RBP, Reg::R12, Reg::R13, Reg::R14, Reg::R15 })
+                as.push(reg);
+
+            // m2 in R12, e2 in RCX
+            as.test(Reg::R8, Reg::R8);
+            as.jcc(Cond::E, subnormal);
+            as.mov(Reg::R12, 1LL << 52);
+            as.alu(AluOp::Or, Reg::R12, Reg::R9);
+            as.mov(Reg::RCX, Reg::R8);
+            as.jmp(decoded);
+            as.bind(subnormal);
+            as.mov(Reg::R12, Reg::R9);
+            as.mov(Reg::RCX, 1LL);
+            as.bind(decoded);
+            as.alu(AluOp::Sub, Reg::RCX, 1023 + 52 + 2);
+
+            // acceptBounds in R14, mv in R12, mv - 1 - mmShift in R13
+            as.mov(Reg::R14, Reg::R12);
+            as.alu(AluOp::And, Reg::R14, 1);
+            as.alu(AluOp::Xor, Reg::R14, 1);
+            as.test(Reg::R9, Reg::R9);
+            as.setcc(Cond::NE, Reg::RAX);
+            as.alu(AluOp::Cmp, Reg::R8, 1);
+            as.setcc(Cond::BE, Reg::RDX);
+            as.alu(AluOp::Or, Reg::RAX, Reg::RDX);
+            as.shift(ShiftOp::Shl, Reg::R12, 2);
+            as.mov(Reg::R13, Reg::R12);
+            as.alu(AluOp::Sub, Reg::R13, 1);
+            as.alu(AluOp::Sub, Reg::R13, Reg::RAX);
+
+            // q in RBP, e10 in R15, then vrIsTrailingZeros in R11 and vmIsTrailingZeros in RDI
+            as.test(Reg::RCX, Reg::RCX);
+            as.jcc(Cond::S, negativeExponent);
+            {
+                Label notVr = as.newLabel(), notVm = as.newLabel();
+
+                as.mov(Reg::RBP, Reg::RCX);
+                as.imul(Reg::RBP, 78913);
+                as.shift(ShiftOp::Shr, Reg::RBP, 18);
+                as.alu(AluOp::Cmp, Reg::RCX, 3);
+                as.setcc(Cond::G, Reg::RAX);
+                as.alu(AluOp::Sub, Reg::RBP, Reg::RAX);
+                as.mov(Reg::R15, Reg::RBP);
+
+                // shift - 64 = q - e2 + pow5Bits(q) + 125 - 1 - 64
+                as.mov(Reg::RAX, Reg::RBP);
+                as.imul(Reg::RAX, 1217359);
+                as.shift(ShiftOp::Shr, Reg::RAX, 19);
+                as.alu(AluOp::Add, Reg::RAX, Reg::RBP);
+                as.alu(AluOp::Sub, Reg::RAX, Reg::RCX);
+                as.alu(AluOp::Add, Reg::RAX, 61);
+                as.mov(Reg::RCX, Reg::RAX);
+
+                as.mov(Reg::RDI, Reg::RBP);
+                as.shift(ShiftOp::Shl, Reg::RDI, 4);
+                as.alu(AluOp::Add, Reg::RDI, Reg::RBX);
+                as.alu(AluOp::Add, Reg::RDI, inversesTable);
+                emitBounds(multiplyShift);
+
+                as.mov(Reg::R11, 0LL);
+                as.mov(Reg::RDI, 0LL);
+                as.alu(AluOp::Cmp, Reg::RBP, 21);
+                as.jcc(Cond::G, flagsDone);
+                as.mov(Reg::RAX, Reg::R12);
+                as.mov(Reg::RDX, 0LL);
+                as.mov(Reg::RSI, 5LL);
+                as.div(Reg::RSI);
+                as.test(Reg::RDX, Reg::RDX);
+                as.jcc(Cond::NE, notVr);
+                as.mov(Reg::RAX, Reg::R12);
+                as.mov(Reg::RCX, Reg::RBP);
+                as.call(multipleOfPowerOf5);
+                as.mov(Reg::R11, Reg::RAX);
+                as.jmp(flagsDone);
+                as.bind(notVr);
+                as.test(Reg::R14, Reg::R14);
+                as.jcc(Cond::E, notVm);
+                as.mov(Reg::RAX, Reg::R13);
+                as.mov(Reg::RCX, Reg::RBP);
+                as.call(multipleOfPowerOf5);
+                as.mov(Reg::RDI, Reg::RAX);
+                as.jmp(flagsDone);
+                as.bind(notVm);
+                as.mov(Reg::RAX, Reg::R12);
+                as.alu(AluOp::Add, Reg::RAX, 2);
+                as.mov(Reg::RCX, Reg::RBP);
+                as.call(multipleOfPowerOf5);
+                as.alu(AluOp::Sub, Reg::R9, Reg::RAX);
+                as.jmp(flagsDone);
+            }
+            as.bind(negativeExponent);
+            {
+                Label notSmall = as.newLabel(), vpDown = as.newLabel();
+
+                as.neg(Reg::RCX);
+                as.mov(Reg::RBP, Reg::RCX);
+                as.imul(Reg::RBP, 732923);
+                as.shift(ShiftOp::Shr, Reg::RBP, 20);
+                as.alu(AluOp::Cmp, Reg::RCX, 1);
+                as.setcc(Cond::G, Reg::RAX);
+                as.alu(AluOp::Sub, Reg::RBP, Reg::RAX);
+                as.mov(Reg::RDI, Reg::RCX);
+                as.alu(AluOp::Sub, Reg::RDI, Reg::RBP);
+                as.mov(Reg::R15, Reg::RBP);
+                as.alu(AluOp::Sub, Reg::R15, Reg::RCX);
+
+                // shift - 64 = q - (pow5Bits(i) - 125) - 64 for i = -e2 - q in RDI
+                as.mov(Reg::RAX, Reg::RDI);
+                as.imul(Reg::RAX, 1217359);
+                as.shift(ShiftOp::Shr, Reg::RAX, 19);
+                as.mov(Reg::RCX, Reg::RBP);
+                as.alu(AluOp::Sub, Reg::RCX, Reg::RAX);
+                as.alu(AluOp::Add, Reg::RCX, 60);
+
+                as.shift(ShiftOp::Shl, Reg::RDI, 4);
+                as.alu(AluOp::Add, Reg::RDI, Reg::RBX);
+                as.alu(AluOp::Add, Reg::RDI, powersTable);
+                emitBounds(multiplyShift);
+
+                as.mov(Reg::R11, 0LL);
+                as.mov(Reg::RDI, 0LL);
+                as.alu(AluOp::Cmp, Reg::RBP, 1);
+                as.jcc(Cond::G, notSmall);
+                as.mov(Reg::R11, 1LL);
+                as.test(Reg::R14, Reg::R14);
+                as.jcc(Cond::E, vpDown);
+                // mmShift is 1 when mv - 1 - mmShift is mv - 2
+                as.mov(Reg::RDI, Reg::R12);
+                as.alu(AluOp::Sub, Reg::RDI, Reg::R13);
+                as.alu(AluOp::Cmp, Reg::RDI, 2);
+                as.setcc(Cond::E, Reg::RDI);
+                as.jmp(flagsDone);
+                as.bind(vpDown);
+                as.alu(AluOp::Sub, Reg::R9, 1);
+                as.jmp(flagsDone);
+
+                // mv is a multiple of 2^q
+                as.bind(notSmall);
+                as.alu(AluOp::Cmp, Reg::RBP, 63);
+                as.jcc(Cond::GE, flagsDone);
+                as.mov(Reg::RAX, 1LL);
+                as.mov(Reg::RCX, Reg::RBP);
+                as.shift(ShiftOp::Shl, Reg::RAX);
+                as.alu(AluOp::Sub, Reg::RAX, 1);
+                as.alu(AluOp::And, Reg::RAX, Reg::R12);
+                as.setcc(Cond::E, Reg::R11);
+            }
+            as.bind(flagsDone);
+
+            // removes digits with vr in R8, vp in R9, vm in R10, vrIsTrailingZeros in R11, vmIsTrailingZeros
+            // in R13, lastRemovedDigit in R14, best in R12, bestRemoved in RBP and removed in RDI
+            {
+                Label loop = as.newLabel(), done = as.newLabel(), removeDigit = as.newLabel();
+                Label roundUp = as.newLabel(), rounded = as.newLabel(), accept = as.newLabel();
+
+                as.mov(Reg::R13, Reg::RDI);
+                as.mov(Reg::R12, Reg::R8);
+                as.mov(Reg::RBP, 0LL);
+                as.mov(Reg::RDI, 0LL);
+                as.mov(Reg::R14, 0LL);
+
+                as.bind(loop);
+                as.alu(AluOp::Cmp, Reg::R8, 10);
+                as.jcc(Cond::B, done);
+                as.mov(Reg::RAX, Reg::R9);
+                divideBy10();
+                as.mov(Reg::RSI, Reg::RDX);
+                as.mov(Reg::RAX, Reg::R10);
+                divideBy10();
+                as.alu(AluOp::Cmp, Reg::RSI, Reg::RDX);
+                as.jcc(Cond::B, done);
+                as.jcc(Cond::A, removeDigit);
+                as.test(Reg::R13, Reg::R13);
+                as.jcc(Cond::E, done);
+                as.mov(Reg::RAX, Reg::RDX);
+                as.imul(Reg::RAX, 10);
+                as.alu(AluOp::Cmp, Reg::RAX, Reg::R10);
+                as.jcc(Cond::NE, done);
+
+                as.bind(removeDigit);
+                as.mov(Reg::RAX, Reg::RDX);
+                as.imul(Reg::RAX, 10);
+                as.alu(AluOp::Cmp, Reg::RAX, Reg::R10);
+                as.setcc(Cond::E, Reg::RCX);
+                as.alu(AluOp::And, Reg::R13, Reg::RCX);
+                as.mov(Reg::R10, Reg::RDX);
+                as.mov(Reg::R9, Reg::RSI);
+                as.test(Reg::R14, Reg::R14);
+                as.setcc(Cond::E, Reg::RCX);
+                as.alu(AluOp::And, Reg::R11, Reg::RCX);
+                as.mov(Reg::RAX, Reg::R8);
+                divideBy10();
+                as.mov(Reg::R14, Reg::R8);
+                as.mov(Reg::RAX, Reg::RDX);
+                as.imul(Reg::RAX, 10);
+                as.alu(AluOp::Sub, Reg::R14, Reg::RAX);
+                as.mov(Reg::R8, Reg::RDX);
+                as.alu(AluOp::Add, Reg::RDI, 1);
+
+                // the correctly rounded value in RSI, ties to even when the removed digits are exactly 5000...
+                as.mov(Reg::RSI, Reg::R8);
+                as.alu(AluOp::Cmp, Reg::R14, 5);
+                as.jcc(Cond::B, rounded);
+                as.jcc(Cond::A, roundUp);
+                as.test(Reg::R11, Reg::R11);
+                as.jcc(Cond::E, roundUp);
+                as.mov(Reg::RAX, Reg::R8);
+                as.alu(AluOp::And, Reg::RAX, 1);
+                as.jcc(Cond::E, rounded);
+                as.bind(roundUp);
+                as.alu(AluOp::Add, Reg::RSI, 1);
+                as.bind(rounded);
+
+                as.alu(AluOp::Cmp, Reg::RSI, Reg::R9);
+                as.jcc(Cond::A, loop);
+                as.alu(AluOp::Cmp, Reg::RSI, Reg::R10);
+                as.jcc(Cond::A, accept);
+                as.jcc(Cond::B, loop);
+                as.test(Reg::R13, Reg::R13);
+                as.jcc(Cond::E, loop);
+                as.bind(accept);
+                as.mov(Reg::R12, Reg::RSI);
+                as.mov(Reg::RBP, Reg::RDI);
+                as.jmp(loop);
+                as.bind(done);
+            }
+
+            // precision in R13, exponent in R14, then the digits of best without trailing zeros at RSP, their count in R15
+            {
+                Label strip = as.newLabel(), stripped = as.newLabel(), digit = as.newLabel();
+
+                as.mov(Reg::RAX, Reg::R8);
+                as.call(decimalLength);
+                as.mov(Reg::R13, Reg::RCX);
+                as.alu(AluOp::Add, Reg::R13, Reg::RDI);
+                as.alu(AluOp::Sub, Reg::R13, Reg::RBP);
+                as.mov(Reg::RAX, Reg::R12);
+                as.call(decimalLength);
+                as.mov(Reg::R14, Reg::R15);
+                as.alu(AluOp::Add, Reg::R14, Reg::RBP);
+                as.alu(AluOp::Add, Reg::R14, Reg::RCX);
+                as.alu(AluOp::Sub, Reg::R14, 1);
+
+                as.bind(strip);
+                as.mov(Reg::RAX, Reg::R12);
+                divideBy10();
+                as.mov(Reg::RAX, Reg::RDX);
+                as.imul(Reg::RAX, 10);
+                as.alu(AluOp::Cmp, Reg::RAX, Reg::R12);
+                as.jcc(Cond::NE, stripped);
+                as.mov(Reg::R12, Reg::RDX);
+                as.jmp(strip);
+                as.bind(stripped);
+
+                as.mov(Reg::RAX, Reg::R12);
+                as.call(decimalLength);
+                as.mov(Reg::R15, Reg::RCX);
+                as.alu(AluOp::Sub, Reg::RSP, 32);
+                as.mov(Reg::RDI, Reg::R15);
+                as.bind(digit);
+                as.alu(AluOp::Sub, Reg::RDI, 1);
+                as.mov(Reg::RAX, Reg::R12);
+                divideBy10();
+                as.mov(Reg::RSI, Reg::RDX);
+                as.imul(Reg::RSI, 10);
+                as.alu(AluOp::Sub, Reg::R12, Reg::RSI);
+                as.alu(AluOp::Add, Reg::R12, '0');
+                as.storeByte(Reg::RSP, Reg::RDI, 0, Reg::R12);
+                as.mov(Reg::R12, Reg::RDX);
+                as.test(Reg::RDI, Reg::RDI);
+                as.jcc(Cond::NE, digit);
+            }
+
+            // the layout of "%.*g" with the precision
+            {
+                Label scientific = as.newLabel(), small = as.newLabel(), integerDigit = as.newLabel(), pastDigits = as.newLabel();
+                Label integerDone = as.newLabel(), zeros = as.newLabel(), zerosDone = as.newLabel(), exponentDigits = as.newLabel();
+                Label sign = as.newLabel(), twoDigits = as.newLabel(), done = as.newLabel();
+
+                as.alu(AluOp::Cmp, Reg::R14, -4);
+                as.jcc(Cond::L, scientific);
+                as.alu(AluOp::Cmp, Reg::R14, Reg::R13);
+                as.jcc(Cond::GE, scientific);
+                as.test(Reg::R14, Reg::R14);
+                as.jcc(Cond::S, small);
+
+                // exponent + 1 integer digits, zeros past the significant ones, then the rest after the point
+                as.mov(Reg::RDI, 0LL);
+                as.bind(integerDigit);
+                as.alu(AluOp::Cmp, Reg::RDI, Reg::R14);
+                as.jcc(Cond::G, integerDone);
+                as.mov(Reg::RSI, (long long)'0');
+                as.alu(AluOp::Cmp, Reg::RDI, Reg::R15);
+                as.jcc(Cond::GE, pastDigits);
+                as.loadByte(Reg::RSI, Reg::RSP, Reg::RDI, 0);
+                as.bind(pastDigits);
+                as.call(writeChar);
+                as.alu(AluOp::Add, Reg::RDI, 1);
+                as.jmp(integerDigit);
+                as.bind(integerDone);
+                as.alu(AluOp::Cmp, Reg::RDI, Reg::R15);
+                as.jcc(Cond::GE, done);
+                as.mov(Reg::RSI, (long long)'.');
+                as.call(writeChar);
+                writeBufferedDigits();
+                as.jmp(done);
+
+                // "0." and -exponent - 1 zeros before the digits
+                as.bind(small);
+                as.mov(Reg::RSI, (long long)'0');
+                as.call(writeChar);
+                as.mov(Reg::RSI, (long long)'.');
+                as.call(writeChar);
+                as.mov(Reg::RDI, Reg::R14);
+                as.bind(zeros);
+                as.alu(AluOp::Add, Reg::RDI, 1);
+                as.jcc(Cond::E, zerosDone);
+                as.mov(Reg::RSI, (long long)'0');
+                as.call(writeChar);
+                as.jmp(zeros);
+                as.bind(zerosDone);
+                writeBufferedDigits();
+                as.jmp(done);
+
+                // one digit before the point, the exponent has at least two digits
+                as.bind(scientific);
+                as.mov(Reg::RDI, 0LL);
+                as.loadByte(Reg::RSI, Reg::RSP, Reg::RDI, 0);
+                as.call(writeChar);
+                as.mov(Reg::RDI, 1LL);
+                as.alu(AluOp::Cmp, Reg::RDI, Reg::R15);
+                as.jcc(Cond::GE, exponentDigits);
+                as.mov(Reg::RSI, (long long)'.');
+                as.call(writeChar);
+                writeBufferedDigits();
+                as.bind(exponentDigits);
+                as.mov(Reg::RSI, (long long)'e');
+                as.call(writeChar);
+                as.mov(Reg::RSI, (long long)'+');
+                as.test(Reg::R14, Reg::R14);
+                as.jcc(Cond::NS, sign);
+                as.mov(Reg::RSI, (long long)'-');
+                as.neg(Reg::R14);
+                as.bind(sign);
+                as.call(writeChar);
+                as.alu(AluOp::Cmp, Reg::R14, 10);
+                as.jcc(Cond::GE, twoDigits);
+                as.mov(Reg::RSI, (long long)'0');
+                as.call(writeChar);
+                as.bind(twoDigits);
+                as.mov(Reg::RSI, Reg::R14);
+                as.call(writeInt);
+
+                as.bind(done);
+                as.alu(AluOp::Add, Reg::RSP, 32);
+                for (auto reg : { Reg::R15, Reg::R14, Reg::R13, Reg::R12, Reg::RBP })
+                    as.pop(reg);
+                as.ret();
+            }
+        }
+
+        // the runtime routines keep RBX, RBP and R12-R15 like the helpers of the JIT,
+        // RBX stays the base of the data segment, the frame is at its beginning
+        void emitOutput()
+        {
+            // flush to stdout, flushFd takes the descriptor in RDI
+            as.bind(flush);
+            as.mov(Reg::RDI, 1LL);
+            as.bind(flushFd);
+            {
+                Label loop = as.newLabel(), done = as.newLabel();
+                as.mov(Reg::R8, Reg::RDI);
+                as.mov(Reg::R9, 0LL);
+                as.bind(loop);
+                as.load(Reg::RDX, Reg::RBX, outUsed);
+                as.alu(AluOp::Sub, Reg::RDX, Reg::R9);
+                as.jcc(Cond::LE, done);
+                as.mov(Reg::RAX, sysWrite);
+                as.mov(Reg::RDI, Reg::R8);
+                as.lea(Reg::RSI, Reg::RBX, outBuffer);
+                as.alu(AluOp::Add, Reg::RSI, Reg::R9);
+                as.syscall();
+                as.test(Reg::RAX, Reg::RAX);
+                as.jcc(Cond::LE, done);
+                as.alu(AluOp::Add, Reg::R9, Reg::RAX);
+                as.jmp(loop);
+                as.bind(done);
+                as.mov(Reg::RAX, 0LL);
+                as.store(Reg::RBX, outUsed, Reg::RAX);
+                as.ret();
+            }
+
+            // character in RSI, only RAX is clobbered
+            as.bind(writeChar);
+            {
+                Label room = as.newLabel();
+                const Reg saved[] = { Reg::RCX, Reg::RDX, Reg::RSI, Reg::RDI, Reg::R8, Reg::R9, Reg::R10, Reg::R11 };
+
+                as.load(Reg::RAX, Reg::RBX, outUsed);
+                as.alu(AluOp::Cmp, Reg::RAX, outputCapacity);
+                as.jcc(Cond::L, room);
+                for (auto reg : saved)
+                    as.push(reg);
+                as.call(flush);
+                for (int i = 7; i >= 0; i--)
+                    as.pop(saved[i]);
+                as.mov(Reg::RAX, 0LL);
+                as.bind(room);
+                as.storeByte(Reg::RBX, Reg::RAX, outBuffer, Reg::RSI);
+                as.alu(AluOp::Add, Reg::RAX, 1);
+                as.store(Reg::RBX, outUsed, Reg::RAX);
+                as.ret();
+            }
+
+            // pointer in R8, length in R9
+            as.bind(writeString);
+            {
+                Label loop = as.newLabel(), done = as.newLabel();
+                as.mov(Reg::RCX, 0LL);
+                as.bind(loop);
+                as.alu(AluOp::Cmp, Reg::RCX, Reg::R9);
+                as.jcc(Cond::GE, done);
+                as.loadByte(Reg::RSI, Reg::R8, Reg::RCX, 0);
+                as.call(writeChar);
+                as.alu(AluOp::Add, Reg::RCX, 1);
+                as.jmp(loop);
+                as.bind(done);
+                as.ret();
+            }
+
+            // value in RSI, digits are collected backwards on the stack
+            as.bind(writeInt);
+            {
+                Label positive = as.newLabel(), digits = as.newLabel(), copy = as.newLabel();
+                as.mov(Reg::R8, Reg::RSI);
+                as.test(Reg::R8, Reg::R8);
+                as.jcc(Cond::NS, positive);
+                as.mov(Reg::RSI, (long long)'-');
+                as.call(writeChar);
+                as.neg(Reg::R8);
+                as.bind(positive);
+                as.mov(Reg::RAX, Reg::R8);
+                as.mov(Reg::R9, 10LL);
+                as.alu(AluOp::Sub, Reg::RSP, 32);
+                as.mov(Reg::RCX, 0LL);
+                as.bind(digits);
+                as.mov(Reg::RDX, 0LL);
+                as.div(Reg::R9);
+                as.alu(AluOp::Add, Reg::RDX, '0');
+                as.storeByte(Reg::RSP, Reg::RCX, 0, Reg::RDX);
+                as.alu(AluOp::Add, Reg::RCX, 1);
+                as.test(Reg::RAX, Reg::RAX);
+                as.jcc(Cond::NE, digits);
+                as.bind(copy);
+                as.alu(AluOp::Sub, Reg::RCX, 1);
+                as.loadByte(Reg::RSI, Reg::RSP, Reg::RCX, 0);
+                as.call(writeChar);
+                as.test(Reg::RCX, Reg::RCX);
+                as.jcc(Cond::NE, copy);
+                as.alu(AluOp::Add, Reg::RSP, 32);
+                as.ret();
+            }
+
+            as.bind(writeBool);
+            {
+                Label isFalse = as.newLabel();
+                as.test(Reg::RSI, Reg::RSI);
+                as.jcc(Cond::E, isFalse);
+                message(Reg::R8, Reg::R9, trueText);
+                as.jmp(writeString);
+                as.bind(isFalse);
+                message(Reg::R8, Reg::R9, falseText);
+                as.jmp(writeString);
+            }
+        }
+
+        void emitInput()
+        {
+            // next input byte in RAX, -1 at the end of the input
+            as.bind(getByte);
+            {
+                Label have = as.newLabel(), end = as.newLabel();
+                as.load(Reg::RAX, Reg::RBX, inPosition);
+                as.alu(AluOp::Cmp, Reg::RAX, Reg::RBX, inFilled);
+                as.jcc(Cond::L, have);
+                as.mov(Reg::RAX, sysRead);
+                as.mov(Reg::RDI, 0LL);
+                as.lea(Reg::RSI, Reg::RBX, inBuffer);
+                as.mov(Reg::RDX, (long long)inputCapacity);
+                as.syscall();
+                as.test(Reg::RAX, Reg::RAX);
+                as.jcc(Cond::LE, end);
+                as.store(Reg::RBX, inFilled, Reg::RAX);
+                as.mov(Reg::RAX, 0LL);
+                as.bind(have);
+                as.loadByte(Reg::RCX, Reg::RBX, Reg::RAX, inBuffer);
+                as.alu(AluOp::Add, Reg::RAX, 1);
+                as.store(Reg::RBX, inPosition, Reg::RAX);
+                as.mov(Reg::RAX, Reg::RCX);
+                as.ret();
+                as.bind(end);
+                as.mov(Reg::RAX, -1LL);
+                as.ret();
+            }
+
+            // reads the next whitespace separated token into the token buffer, line in RDX
+            as.bind(readToken);
+            {
+                Label skip = as.newLabel(), collect = as.newLabel(), full = as.newLabel(), done = as.newLabel(), end = as.newLabel();
+                as.push(Reg::RDX);
+                as.bind(skip);
+                as.call(getByte);
+                as.alu(AluOp::Cmp, Reg::RAX, -1);
+                as.jcc(Cond::E, end);
+                jumpIfSpace(skip);
+
+                as.mov(Reg::RCX, 0LL);
+                as.store(Reg::RBX, tokenLength, Reg::RCX);
+                as.bind(collect);
+                as.load(Reg::RCX, Reg::RBX, tokenLength);
+                as.alu(AluOp::Cmp, Reg::RCX, tokenCapacity);
+                as.jcc(Cond::GE, full);
+                as.storeByte(Reg::RBX, Reg::RCX, tokenBuffer, Reg::RAX);
+                as.bind(full);
+                as.alu(AluOp::Add, Reg::RCX, 1);
+                as.store(Reg::RBX, tokenLength, Reg::RCX);
+                as.call(getByte);
+                as.alu(AluOp::Cmp, Reg::RAX, -1);
+                as.jcc(Cond::E, done);
+                jumpIfSpace(done);
+                as.jmp(collect);
+
+                as.bind(done);
+                as.pop(Reg::RDX);
+                as.ret();
+
+                as.bind(end);
+                as.pop(Reg::R12);
+                message(Reg::R13, Reg::R14, endOfInput);
+                as.mov(Reg::R15, 0LL);
+                as.jmp(errorExit);
+            }
+
+            // parses the token with the syntax of parseIntLiteral, the value in R8 and 0 in RAX, or 1 in RAX when
+            // the token isn't an integer, clobbers RCX, RDX and R9-R11
+            as.bind(parseIntToken);
+            {
+                Label fail = as.newLabel(), notMinus = as.newLabel(), signDone = as.newLabel(), suffixDone = as.newLabel();
+                Label digit = as.newLabel(), haveDigit = as.newLabel(), digitsDone = as.newLabel(), positive = as.newLabel();
+
+                as.load(Reg::R9, Reg::RBX, tokenLength);
+                as.alu(AluOp::Cmp, Reg::R9, tokenCapacity);
+                as.jcc(Cond::G, fail);
+                as.mov(Reg::RCX, 0LL);
+                as.mov(Reg::R10, 0LL);
+
+                as.loadByte(Reg::RAX, Reg::RBX, Reg::RCX, tokenBuffer);
+                as.alu(AluOp::Cmp, Reg::RAX, '-');
+                as.jcc(Cond::NE, notMinus);
+                as.mov(Reg::R10, 1LL);
+                as.alu(AluOp::Add, Reg::RCX, 1);
+                as.jmp(signDone);
+                as.bind(notMinus);
+                as.alu(AluOp::Cmp, Reg::RAX, '+');
+                as.jcc(Cond::NE, signDone);
+                as.alu(AluOp::Add, Reg::RCX, 1);
+                as.bind(signDone);
+                as.alu(AluOp::Cmp, Reg::RCX, Reg::R9);
+                as.jcc(Cond::GE, fail);
+
+                // base suffix, letters are compared in lower case
+                as.mov(Reg::R11, 10LL);
+                as.loadByte(Reg::RAX, Reg::RBX, Reg::R9, tokenBuffer - 1);
+                as.alu(AluOp::Or, Reg::RAX, 0x20);
+                const pair<char, int> suffixes[] = { { 'b', 2 }, { 'o', 8 }, { 'h', 16 }, { 'd', 10 } };
+                for (auto& suffix : suffixes)
+                {
+                    Label next = as.newLabel();
+                    as.alu(AluOp::Cmp, Reg::RAX, suffix.first);
+                    as.jcc(Cond::NE, next);
+                    as.mov(Reg::R11, (long long)suffix.second);
+                    as.alu(AluOp::Sub, Reg::R9, 1);
+                    as.jmp(suffixDone);
+                    as.bind(next);
+                }
+                as.bind(suffixDone);
+                as.alu(AluOp::Cmp, Reg::RCX, Reg::R9);
+                as.jcc(Cond::GE, fail);
+
+                // the number has to start with a decimal digit
+                as.loadByte(Reg::RAX, Reg::RBX, Reg::RCX, tokenBuffer);
+                as.alu(AluOp::Sub, Reg::RAX, '0');
+                as.alu(AluOp::Cmp, Reg::RAX, 9);
+                as.jcc(Cond::A, fail);
+
+                as.mov(Reg::R8, 0LL);
+                as.bind(digit);
+                as.alu(AluOp::Cmp, Reg::RCX, Reg::R9);
+                as.jcc(Cond::GE, digitsDone);
+                as.loadByte(Reg::RAX, Reg::RBX, Reg::RCX, tokenBuffer);
+                as.mov(Reg::RDX, Reg::RAX);
+                as.alu(AluOp::Sub, Reg::RDX, '0');
+                as.alu(AluOp::Cmp, Reg::RDX, 9);
+                as.jcc(Cond::BE, haveDigit);
+                as.alu(AluOp::Or, Reg::RAX, 0x20);
+                as.alu(AluOp::Sub, Reg::RAX, 'a');
+                as.alu(AluOp::Cmp, Reg::RAX, 5);
+                as.jcc(Cond::A, fail);
+                as.mov(Reg::RDX, Reg::RAX);
+                as.alu(AluOp::Add, Reg::RDX, 10);
+                as.bind(haveDigit);
+                as.alu(AluOp::Cmp, Reg::RDX, Reg::R11);
+                as.jcc(Cond::AE, fail);
+                as.imul(Reg::R8, Reg::R11);
+                as.alu(AluOp::Add, Reg::R8, Reg::RDX);
+                as.alu(AluOp::Add, Reg::RCX, 1);
+                as.jmp(digit);
+
+                as.bind(digitsDone);
+                as.test(Reg::R10, Reg::R10);
+                as.jcc(Cond::E, positive);
+                as.neg(Reg::R8);
+                as.bind(positive);
+                as.mov(Reg::RAX, 0LL);
+                as.ret();
+
+                as.bind(fail);
+                as.mov(Reg::RAX, 1LL);
+                as.ret();
+            }
+
+            // address of the variable in RSI, line in RDX
+            as.bind(readInt);
+            {
+                Label fail = as.newLabel();
+
+                as.push(Reg::RSI);
+                as.push(Reg::RDX);
+                as.call(readToken);
+                as.call(parseIntToken);
+                as.test(Reg::RAX, Reg::RAX);
+                as.jcc(Cond::NE, fail);
+                as.pop(Reg::RDX);
+                as.pop(Reg::RSI);
+                as.store(Reg::RSI, 0, Reg::R8);
+                as.ret();
+
+                as.bind(fail);
+                as.pop(Reg::R12);
+                as.pop(Reg::RSI);
+                message(Reg::R13, Reg::R14, integerExpected);
+                as.mov(Reg::R15, 1LL);
+                as.jmp(errorExit);
+            }
+
+            as.bind(readBool);
+            {
+                Label fail = as.newLabel(), done = as.newLabel();
+
+                as.push(Reg::RSI);
+                as.push(Reg::RDX);
+                as.call(readToken);
+                as.load(Reg::R9, Reg::RBX, tokenLength);
+
+                for (int value = 1; value >= 0; value--)
+                {
+                    const Message& text = value ? trueText : falseText;
+                    Label next = as.newLabel(), loop = as.newLabel(), matched = as.newLabel();
+
+                    as.alu(AluOp::Cmp, Reg::R9, text.length);
+                    as.jcc(Cond::NE, next);
+                    as.mov(Reg::RCX, 0LL);
+                    as.bind(loop);
+                    as.alu(AluOp::Cmp, Reg::RCX, text.length);
+                    as.jcc(Cond::GE, matched);
+                    as.loadByte(Reg::RAX, Reg::RBX, Reg::RCX, tokenBuffer);
+                    as.loadByte(Reg::RDX, Reg::RBX, Reg::RCX, text.offset);
+                    as.alu(AluOp::Cmp, Reg::RAX, Reg::RDX);
+                    as.jcc(Cond::NE, fail);
+                    as.alu(AluOp::Add, Reg::RCX, 1);
+                    as.jmp(loop);
+                    as.bind(matched);
+                    as.mov(Reg::R8, (long long)value);
+                    as.jmp(done);
+                    as.bind(next);
+                }
+                as.jmp(fail);
+
+                as.bind(done);
+                as.pop(Reg::RDX);
+                as.pop(Reg::RSI);
+                as.store(Reg::RSI, 0, Reg::R8);
+                as.mov(Reg::RAX, 0LL);
+                as.ret();
+
+                as.bind(fail);
+                as.pop(Reg::R12);
+                as.pop(Reg::RSI);
+                message(Reg::R13, Reg::R14, boolExpected);
+                as.mov(Reg::R15, 1LL);
+                as.jmp(errorExit);
+            }
+        }
+
+        // reads a float as InputBuffer::readFloat does: the syntax of parseFloatLiteral, correctly rounded like
+        // strtod, or an integer literal converted. Digits that fit in 53 bits with an exponent up to 22 take one
+        // exact multiplication or division, other values are divided out exactly on numbers of bigLimbs limbs.
+        void emitFloatInput()
+        {
+            Label clear = as.newLabel(), multiplySmall = as.newLabel(), scale = as.newLabel(), doubleUp = as.newLabel();
+            Label shiftLeft = as.newLabel(), bitLength = as.newLabel(), compare = as.newLabel(), subtract = as.newLabel();
+
+            // zeroes the number at RDI, clobbers RAX
+            as.bind(clear);
+            as.mov(Reg::RAX, 0LL);
+            for (int32_t i = 0; i < bigLimbs; i++)
+                as.store(Reg::RDI, 8 * i, Reg::RAX);
+            as.ret();
+
+            // number at RDI = number * RSI + R8, clobbers RAX, RDX and R8
+            as.bind(multiplySmall);
+            for (int32_t i = 0; i < bigLimbs; i++)
+            {
+                as.load(Reg::RAX, Reg::RDI, 8 * i);
+                as.mul(Reg::RSI);
+                as.alu(AluOp::Add, Reg::RAX, Reg::R8);
+                as.alu(AluOp::Adc, Reg::RDX, 0);
+                as.store(Reg::RDI, 8 * i, Reg::RAX);
+                as.mov(Reg::R8, Reg::RDX);
+            }
+            as.ret();
+
+            // number at RDI times 10^RCX, nineteen digits at a time, clobbers RAX, RDX, RSI, R8 and R11
+            as.bind(scale);
+            {
+                Label large = as.newLabel(), small = as.newLabel(), done = as.newLabel();
+                as.mov(Reg::R11, Reg::RCX);
+                as.bind(large);
+                as.alu(AluOp::Cmp, Reg::R11, 19);
+                as.jcc(Cond::L, small);
+                as.mov(Reg::RSI, (long long)10000000000000000000ULL);
+                as.mov(Reg::R8, 0LL);
+                as.call(multiplySmall);
+                as.alu(AluOp::Sub, Reg::R11, 19);
+                as.jmp(large);
+                as.bind(small);
+                as.test(Reg::R11, Reg::R11);
+                as.jcc(Cond::E, done);
+                as.mov(Reg::RSI, 10LL);
+                as.mov(Reg::R8, 0LL);
+                as.call(multiplySmall);
+                as.alu(AluOp::Sub, Reg::R11, 1);
+                as.jmp(small);
+                as.bind(done);
+                as.ret();
+            }
+
+            // number at RDI doubled, the carry runs through the limbs, clobbers RAX
+            as.bind(doubleUp);
+            for (int32_t i = 0; i < bigLimbs; i++)
+            {
+                as.load(Reg::RAX, Reg::RDI, 8 * i);
+                as.alu(i == 0 ? AluOp::Add : AluOp::Adc, Reg::RAX, Reg::RAX);
+                as.store(Reg::RDI, 8 * i, Reg::RAX);
+            }
+            as.ret();
+
+            // number at RDI shifted left by RCX bits, whole limbs are moved first, clobbers RAX, RCX, RDX, R10 and R11
+            as.bind(shiftLeft);
+            {
+                Label move = as.newLabel(), fill = as.newLabel(), bits = as.newLabel(), done = as.newLabel();
+                as.mov(Reg::R10, Reg::RCX);
+                as.alu(AluOp::And, Reg::R10, 63);
+                as.shift(ShiftOp::Shr, Reg::RCX, 6);
+                as.lea(Reg::RDX, Reg::RDI, 8 * (bigLimbs - 1));
+                as.mov(Reg::R11, Reg::RDX);
+                as.shift(ShiftOp::Shl, Reg::RCX, 3);
+                as.alu(AluOp::Sub, Reg::R11, Reg::RCX);
+                as.bind(move);
+                as.alu(AluOp::Cmp, Reg::R11, Reg::RDI);
+                as.jcc(Cond::B, fill);
+                as.load(Reg::RAX, Reg::R11, 0);
+                as.store(Reg::RDX, 0, Reg::RAX);
+                as.alu(AluOp::Sub, Reg::RDX, 8);
+                as.alu(AluOp::Sub, Reg::R11, 8);
+                as.jmp(move);
+                as.bind(fill);
+                as.mov(Reg::RAX, 0LL);
+                as.alu(AluOp::Cmp, Reg::RDX, Reg::RDI);
+                as.jcc(Cond::B, bits);
+                as.store(Reg::RDX, 0, Reg::RAX);
+                as.alu(AluOp::Sub, Reg::RDX, 8);
+                as.jmp(fill);
+                as.bind(bits);
+                as.test(Reg::R10, Reg::R10);
+                as.jcc(Cond::E, done);
+                as.call(doubleUp);
+                as.alu(AluOp::Sub, Reg::R10, 1);
+                as.jmp(bits);
+                as.bind(done);
+                as.ret();
+            }
+
+            // number of significant bits of the number at RDI in RAX, clobbers RCX
+            as.bind(bitLength);
+            {
+                Label count = as.newLabel();
+                for (int32_t i = bigLimbs - 1; i >= 0; i--)
+                {
+                    as.mov(Reg::RCX, (long long)(64 * i));
+                    as.load(Reg::RAX, Reg::RDI, 8 * i);
+                    as.test(Reg::RAX, Reg::RAX);
+                    as.jcc(Cond::NE, count);
+                }
+                as.ret();
+                as.bind(count);
+                as.alu(AluOp::Add, Reg::RCX, 1);
+                as.shift(ShiftOp::Shr, Reg::RAX, 1);
+                as.jcc(Cond::NE, count);
+                as.mov(Reg::RAX, Reg::RCX);
+                as.ret();
+            }
+
+            // compares the numbers at RDI and RSI, the flags are those of an unsigned comparison, clobbers RAX
+            as.bind(compare);
+            {
+                Label done = as.newLabel();
+                for (int32_t i = bigLimbs - 1; i >= 0; i--)
+                {
+                    as.load(Reg::RAX, Reg::RDI, 8 * i);
+                    as.alu(AluOp::Cmp, Reg::RAX, Reg::RSI, 8 * i);
+                    as.jcc(Cond::NE, done);
+                }
+                as.bind(done);
+                as.ret();
+            }
+
+            // number at RDI minus the one at RSI, clobbers RAX
+            as.bind(subtract);
+            for (int32_t i = 0; i < bigLimbs; i++)
+            {
+                as.load(Reg::RAX, Reg::RDI, 8 * i);
+                as.alu(i == 0 ? AluOp::Sub : AluOp::Sbb, Reg::RAX, Reg::RSI, 8 * i);
+                as.store(Reg::RDI, 8 * i, Reg::RAX);
+            }
+            as.ret();
+
+            // address of the variable in RSI, line in RDX; the position in the token is kept in R12, the number
+            // of significant digits in R13, the decimal exponent in R14 and in R15 flags: 1 for integer digits,
+            // 2 for fraction digits, 4 for an exponent and 8 for a minus sign
+            as.bind(readFloat);
+            {
+                Label notMinus = as.newLabel(), signDone = as.newLabel(), integerDigits = as.newLabel();
+                Label fraction = as.newLabel(), fractionDigits = as.newLabel(), exponent = as.newLabel();
+                Label exponentMinus = as.newLabel(), exponentDigits = as.newLabel(), fractionDone = as.newLabel();
+                Label saturated = as.newLabel(), syntaxDone = as.newLabel(), valid = as.newLabel(), notFloat = as.newLabel();
+                Label exact = as.newLabel(), divide = as.newLabel(), slow = as.newLabel(), scaled = as.newLabel();
+                Label aligned = as.newLabel(), normalized = as.newLabel(), subnormal = as.newLabel(), quotient = as.newLabel();
+                Label quotientDone = as.newLabel(), noBit = as.newLabel(), roundUp = as.newLabel(), rounded = as.newLabel();
+                Label infinity = as.newLabel(), zero = as.newLabel(), applySign = as.newLabel(), store = as.newLabel();
+                Label fail = as.newLabel();
+
+                as.push(Reg::RSI);
+                as.push(Reg::RDX);
+                as.call(readToken);
+                for (auto reg : { Reg::RBP, Reg::R12, Reg::R13, Reg::R14, Reg::R15 })
+                    as.push(reg);
+
+                as.load(Reg::RAX, Reg::RBX, tokenLength);
+                as.alu(AluOp::Cmp, Reg::RAX, tokenCapacity);
+                as.jcc(Cond::G, notFloat);
+                as.lea(Reg::RDI, Reg::RBX, bigValue);
+                as.call(clear);
+                as.mov(Reg::R12, 0LL);
+                as.mov(Reg::R13, 0LL);
+                as.mov(Reg::R14, 0LL);
+                as.mov(Reg::R15, 0LL);
+
+                as.loadByte(Reg::RAX, Reg::RBX, Reg::R12, tokenBuffer);
+                as.alu(AluOp::Cmp, Reg::RAX, '-');
+                as.jcc(Cond::NE, notMinus);
+                as.mov(Reg::R15, 8LL);
+                as.alu(AluOp::Add, Reg::R12, 1);
+                as.jmp(signDone);
+                as.bind(notMinus);
+                as.alu(AluOp::Cmp, Reg::RAX, '+');
+                as.jcc(Cond::NE, signDone);
+                as.alu(AluOp::Add, Reg::R12, 1);
+                as.bind(signDone);
+
+                // the digit at R12 into the number unless it's a leading zero, jumps to notDigit past the digits,
+                // flag is set for every digit
+                auto digits = [&](Label loop, Label notDigit, int flag) {
+                    Label leadingZero = as.newLabel();
+                    as.bind(loop);
+                    as.alu(AluOp::Cmp, Reg::R12, Reg::RBX, tokenLength);
+                    as.jcc(Cond::GE, notDigit);
+                    as.loadByte(Reg::R8, Reg::RBX, Reg::R12, tokenBuffer);
+                    as.alu(AluOp::Sub, Reg::R8, '0');
+                    as.alu(AluOp::Cmp, Reg::R8, 9);
+                    as.jcc(Cond::A, notDigit);
+                    as.alu(AluOp::Or, Reg::R15, flag);
+                    as.alu(AluOp::Add, Reg::R12, 1);
+                    if (flag == 2)
+                        as.alu(AluOp::Sub, Reg::R14, 1);
+                    as.mov(Reg::RAX, Reg::R13);
+                    as.alu(AluOp::Or, Reg::RAX, Reg::R8);
+                    as.jcc(Cond::E, leadingZero);
+                    as.alu(AluOp::Add, Reg::R13, 1);
+                    as.lea(Reg::RDI, Reg::RBX, bigValue);
+                    as.mov(Reg::RSI, 10LL);
+                    as.call(multiplySmall);
+                    as.bind(leadingZero);
+                    as.jmp(loop);
+                };
+
+                digits(integerDigits, fraction, 1);
+
+                // a point needs digits after it
+                as.bind(fraction);
+                as.alu(AluOp::Cmp, Reg::R12, Reg::RBX, tokenLength);
+                as.jcc(Cond::GE, syntaxDone);
+                as.loadByte(Reg::RAX, Reg::RBX, Reg::R12, tokenBuffer);
+                as.alu(AluOp::Cmp, Reg::RAX, '.');
+                as.jcc(Cond::NE, exponent);
+                as.alu(AluOp::Add, Reg::R12, 1);
+                as.mov(Reg::RBP, Reg::R12);
+                digits(fractionDigits, fractionDone, 2);
+                as.bind(fractionDone);
+                as.alu(AluOp::Cmp, Reg::R12, Reg::RBP);
+                as.jcc(Cond::E, notFloat);
+
+                // the exponent saturates, any larger one gives infinity or zero all the same
+                as.bind(exponent);
+                as.alu(AluOp::Cmp, Reg::R12, Reg::RBX, tokenLength);
+                as.jcc(Cond::GE, syntaxDone);
+                as.loadByte(Reg::RAX, Reg::RBX, Reg::R12, tokenBuffer);
+                as.alu(AluOp::Or, Reg::RAX, 0x20);
+                as.alu(AluOp::Cmp, Reg::RAX, 'e');
+                as.jcc(Cond::NE, syntaxDone);
+                as.alu(AluOp::Add, Reg::R12, 1);
+                as.mov(Reg::R9, 0LL);
+                as.alu(AluOp::Cmp, Reg::R12, Reg::RBX, tokenLength);
+                as.jcc(Cond::GE, notFloat);
+                as.loadByte(Reg::RAX, Reg::RBX, Reg::R12, tokenBuffer);
+                as.alu(AluOp::Cmp, Reg::RAX, '-');
+                as.jcc(Cond::NE, exponentMinus);
+                as.mov(Reg::R9, 1LL);
+                as.alu(AluOp::Add, Reg::R12, 1);
+                as.jmp(exponentDigits);
+                as.bind(exponentMinus);
+                as.alu(AluOp::Cmp, Reg::RAX, '+');
+                as.jcc(Cond::NE, exponentDigits);
+                as.alu(AluOp::Add, Reg::R12, 1);
+                as.bind(exponentDigits);
+                as.mov(Reg::RBP, Reg::R12);
+                as.mov(Reg::R10, 0LL);
+                {
+                    Label loop = as.newLabel(), done = as.newLabel();
+                    as.bind(loop);
+                    as.alu(AluOp::Cmp, Reg::R12, Reg::RBX, tokenLength);
+                    as.jcc(Cond::GE, done);
+                    as.loadByte(Reg::RAX, Reg::RBX, Reg::R12, tokenBuffer);
+                    as.alu(AluOp::Sub, Reg::RAX, '0');
+                    as.alu(AluOp::Cmp, Reg::RAX, 9);
+                    as.jcc(Cond::A, done);
+                    as.alu(AluOp::Add, Reg::R12, 1);
+                    as.alu(AluOp::Cmp, Reg::R10, 100000);
+                    as.jcc(Cond::GE, loop);
+                    as.imul(Reg::R10, 10);
+                    as.alu(AluOp::Add, Reg::R10, Reg::RAX);
+                    as.jmp(loop);
+                    as.bind(done);
+                }
+                as.alu(AluOp::Cmp, Reg::R12, Reg::RBP);
+                as.jcc(Cond::E, notFloat);
+                as.alu(AluOp::Or, Reg::R15, 4);
+                as.test(Reg::R9, Reg::R9);
+                as.jcc(Cond::E, saturated);
+                as.neg(Reg::R10);
+                as.bind(saturated);
+                as.alu(AluOp::Add, Reg::R14, Reg::R10);
+
+                // the whole token, with fraction digits or with integer digits and an exponent
+                as.bind(syntaxDone);
+                as.alu(AluOp::Cmp, Reg::R12, Reg::RBX, tokenLength);
+                as.jcc(Cond::NE, notFloat);
+                as.mov(Reg::RAX, Reg::R15);
+                as.alu(AluOp::And, Reg::RAX, 2);
+                as.jcc(Cond::NE, valid);
+                as.mov(Reg::RAX, Reg::R15);
+                as.alu(AluOp::And, Reg::RAX, 5);
+                as.alu(AluOp::Cmp, Reg::RAX, 5);
+                as.jcc(Cond::NE, notFloat);
+                as.bind(valid);
+
+                // the value is below 10^(R13 + R14) and at least a tenth of it
+                as.test(Reg::R13, Reg::R13);
+                as.jcc(Cond::E, zero);
+                as.mov(Reg::RAX, Reg::R13);
+                as.alu(AluOp::Add, Reg::RAX, Reg::R14);
+                as.alu(AluOp::Cmp, Reg::RAX, 310);
+                as.jcc(Cond::GE, infinity);
+                as.alu(AluOp::Cmp, Reg::RAX, -325);
+                as.jcc(Cond::LE, zero);
+
+                // up to 15 digits are exact in a double, as are the powers of ten up to 10^22
+                as.alu(AluOp::Cmp, Reg::R13, 15);
+                as.jcc(Cond::G, slow);
+                as.alu(AluOp::Cmp, Reg::R14, 22);
+                as.jcc(Cond::G, slow);
+                as.alu(AluOp::Cmp, Reg::R14, -22);
+                as.jcc(Cond::L, slow);
+                as.cvtsi2sd(XReg::XMM0, Reg::RBX, bigValue);
+                as.test(Reg::R14, Reg::R14);
+                as.jcc(Cond::S, divide);
+                as.mov(Reg::RAX, Reg::R14);
+                as.shift(ShiftOp::Shl, Reg::RAX, 3);
+                as.alu(AluOp::Add, Reg::RAX, Reg::RBX);
+                as.sseOp(SseOp::Mul, XReg::XMM0, Reg::RAX, powersOfTen);
+                as.jmp(exact);
+                as.bind(divide);
+                as.mov(Reg::RAX, Reg::R14);
+                as.neg(Reg::RAX);
+                as.shift(ShiftOp::Shl, Reg::RAX, 3);
+                as.alu(AluOp::Add, Reg::RAX, Reg::RBX);
+                as.sseOp(SseOp::Div, XReg::XMM0, Reg::RAX, powersOfTen);
+                as.bind(exact);
+                as.movq(Reg::RAX, XReg::XMM0);
+                as.jmp(applySign);
+
+                // the digits over the divisor 1 with the power of ten moved to one side
+                as.bind(slow);
+                as.lea(Reg::RDI, Reg::RBX, bigDivisor);
+                as.call(clear);
+                as.mov(Reg::RAX, 1LL);
+                as.store(Reg::RBX, bigDivisor, Reg::RAX);
+                as.lea(Reg::RDI, Reg::RBX, bigValue);
+                as.mov(Reg::RCX, Reg::R14);
+                as.test(Reg::R14, Reg::R14);
+                as.jcc(Cond::NS, scaled);
+                as.lea(Reg::RDI, Reg::RBX, bigDivisor);
+                as.neg(Reg::RCX);
+                as.bind(scaled);
+                as.call(scale);
+
+                // shifts the smaller number to the bit length of the other, then the value once more if it's below
+                // the divisor, so that their ratio is in [1, 2): the binary exponent is the divisor's shift less the
+                // value's, in R14
+                as.lea(Reg::RDI, Reg::RBX, bigValue);
+                as.call(bitLength);
+                as.mov(Reg::R13, Reg::RAX);
+                as.lea(Reg::RDI, Reg::RBX, bigDivisor);
+                as.call(bitLength);
+                as.mov(Reg::RBP, Reg::RAX);
+                as.alu(AluOp::Sub, Reg::RBP, Reg::R13);
+                as.mov(Reg::R13, 0LL);
+                as.jcc(Cond::GE, aligned);
+                as.neg(Reg::RBP);
+                as.mov(Reg::R13, Reg::RBP);
+                as.mov(Reg::RBP, 0LL);
+                as.bind(aligned);
+                as.lea(Reg::RDI, Reg::RBX, bigValue);
+                as.mov(Reg::RCX, Reg::RBP);
+                as.call(shiftLeft);
+                as.lea(Reg::RDI, Reg::RBX, bigDivisor);
+                as.mov(Reg::RCX, Reg::R13);
+                as.call(shiftLeft);
+                as.lea(Reg::RDI, Reg::RBX, bigValue);
+                as.lea(Reg::RSI, Reg::RBX, bigDivisor);
+                as.call(compare);
+                as.jcc(Cond::AE, normalized);
+                as.call(doubleUp);
+                as.alu(AluOp::Add, Reg::RBP, 1);
+                as.bind(normalized);
+                as.mov(Reg::R14, Reg::R13);
+                as.alu(AluOp::Sub, Reg::R14, Reg::RBP);
+                as.alu(AluOp::Cmp, Reg::R14, 1023);
+                as.jcc(Cond::G, infinity);
+
+                // the exponent bits less one in RBP and the bits of the quotient less one in R12: 52 for normal
+                // numbers, fewer for subnormal ones, as the hidden bit of the quotient adds the one
+                as.mov(Reg::RBP, 0LL);
+                as.mov(Reg::R12, Reg::R14);
+                as.alu(AluOp::Add, Reg::R12, 1074);
+                as.alu(AluOp::Cmp, Reg::R14, -1022);
+                as.jcc(Cond::L, subnormal);
+                as.mov(Reg::RBP, Reg::R14);
+                as.alu(AluOp::Add, Reg::RBP, 1022);
+                as.shift(ShiftOp::Shl, Reg::RBP, 52);
+                as.mov(Reg::R12, 52LL);
+                as.bind(subnormal);
+                as.alu(AluOp::Cmp, Reg::R12, -1);
+                as.jcc(Cond::L, zero);
+
+                // long division, the remainder is doubled past the last bit to compare it with half the divisor
+                as.mov(Reg::R13, 0LL);
+                as.lea(Reg::RDI, Reg::RBX, bigValue);
+                as.lea(Reg::RSI, Reg::RBX, bigDivisor);
+                as.bind(quotient);
+                as.test(Reg::R12, Reg::R12);
+                as.jcc(Cond::S, quotientDone);
+                as.alu(AluOp::Add, Reg::R13, Reg::R13);
+                as.call(compare);
+                as.jcc(Cond::B, noBit);
+                as.call(subtract);
+                as.alu(AluOp::Add, Reg::R13, 1);
+                as.bind(noBit);
+                as.call(doubleUp);
+                as.alu(AluOp::Sub, Reg::R12, 1);
+                as.jmp(quotient);
+                as.bind(quotientDone);
+
+                // ties to even, a carry out of the quotient moves into the exponent and may make infinity
+                as.call(compare);
+                as.jcc(Cond::B, rounded);
+                as.jcc(Cond::A, roundUp);
+                as.mov(Reg::RAX, Reg::R13);
+                as.alu(AluOp::And, Reg::RAX, 1);
+                as.alu(AluOp::Add, Reg::R13, Reg::RAX);
+                as.jmp(rounded);
+                as.bind(roundUp);
+                as.alu(AluOp::Add, Reg::R13, 1);
+                as.bind(rounded);
+                as.mov(Reg::RAX, Reg::RBP);
+                as.alu(AluOp::Add, Reg::RAX, Reg::R13);
+                as.jmp(applySign);
+
+                as.bind(infinity);
+                as.mov(Reg::RAX, 0x7FFLL << 52);
+                as.jmp(applySign);
+                as.bind(zero);
+                as.mov(Reg::RAX, 0LL);
+
+                as.bind(applySign);
+                as.mov(Reg::RCX, Reg::R15);
+                as.alu(AluOp::And, Reg::RCX, 8);
+                as.jcc(Cond::E, store);
+                as.mov(Reg::RCX, (long long)(1ULL << 63));
+                as.alu(AluOp::Or, Reg::RAX, Reg::RCX);
+
+                // the bits of the value in RAX
+                as.bind(store);
+                for (auto reg : { Reg::R15, Reg::R14, Reg::R13, Reg::R12, Reg::RBP })
+                    as.pop(reg);
+                as.pop(Reg::RDX);
+                as.pop(Reg::RSI);
+                as.store(Reg::RSI, 0, Reg::RAX);
+                as.mov(Reg::RAX, 0LL);
+                as.ret();
+
+                // an integer literal is converted as the VM does
+                as.bind(notFloat);
+                as.call(parseIntToken);
+                as.test(Reg::RAX, Reg::RAX);
+                as.jcc(Cond::NE, fail);
+                as.cvtsi2sd(XReg::XMM0, Reg::R8);
+                as.movq(Reg::RAX, XReg::XMM0);
+                as.jmp(store);
+
+                as.bind(fail);
+                as.alu(AluOp::Add, Reg::RSP, 40);
+                as.pop(Reg::R12);
+                as.pop(Reg::RSI);
+                message(Reg::R13, Reg::R14, floatExpected);
+                as.mov(Reg::R15, 1LL);
+                as.jmp(errorExit);
+            }
+        }
+
+        // prints "Runtime error on line R12: " and the message at R13 of length R14 to stderr, followed by the token
+        // and a closing quote if R15 is set, then exits with status 1; the output written so far is flushed first
+        void emitErrorExit()
+        {
+            Label noToken = as.newLabel(), fits = as.newLabel();
+
+            as.bind(errorExit);
+            as.call(flush);
+            message(Reg::R8, Reg::R9, prefix);
+            as.call(writeString);
+            as.mov(Reg::RSI, Reg::R12);
+            as.call(writeInt);
+            message(Reg::R8, Reg::R9, colon);
+            as.call(writeString);
+            as.mov(Reg::R8, Reg::R13);
+            as.mov(Reg::R9, Reg::R14);
+            as.call(writeString);
+
+            as.test(Reg::R15, Reg::R15);
+            as.jcc(Cond::E, noToken);
+            as.lea(Reg::R8, Reg::RBX, tokenBuffer);
+            as.load(Reg::R9, Reg::RBX, tokenLength);
+            as.alu(AluOp::Cmp, Reg::R9, tokenCapacity);
+            as.jcc(Cond::LE, fits);
+            as.mov(Reg::R9, (long long)tokenCapacity);
+            as.bind(fits);
+            as.call(writeString);
+            message(Reg::R8, Reg::R9, foundInstead);
+            as.call(writeString);
+
+            as.bind(noToken);
+            as.mov(Reg::RSI, (long long)'\n');
+            as.call(writeChar);
+            as.mov(Reg::RDI, 2LL);
+            as.call(flushFd);
+            as.mov(Reg::RAX, sysExitGroup);
+            as.mov(Reg::RDI, 1LL);
+            as.syscall();
+        }
+
+        // entry point: runs the program function, reports a division by zero or flushes the output and exits
+        void emitStart(Label programLabel)
+        {
+            Label divisionError = as.newLabel();
+
+            as.mov(Reg::RDI, (long long)dataAddress);
+            as.mov(Reg::RSI, 0LL);
+            as.call(programLabel);
+            as.mov(Reg::RBX, (long long)dataAddress);
+            as.test(Reg::RAX, Reg::RAX);
+            as.jcc(Cond::NE, divisionError);
+            as.call(flush);
+            as.mov(Reg::RAX, sysExitGroup);
+            as.mov(Reg::RDI, 0LL);
+            as.syscall();
+
+            as.bind(divisionError);
+            as.mov(Reg::R12, Reg::RAX);
+            message(Reg::R13, Reg::R14, divisionByZero);
+            as.mov(Reg::R15, 0LL);
+            as.jmp(errorExit);
+        }
+
+        vector<uint8_t> link(const vector<uint8_t>& code, size_t entry)
+        {
+            uint64_t textSize = headersSize + code.size();
+            uint64_t dataOffset = alignUp(textSize, pageSize);
+
+            vector<uint8_t> file;
+            const uint8_t identification[] = { 0x7F, 'E', 'L', 'F', 2, 1, 1, 0 };
+            for (uint8_t value : identification)
+                file.push_back(value);
+            put(file, 0, 8);
+            put(file, 2, 2);                                    // executable
+            put(file, 0x3E, 2);                                 // x86-64
+            put(file, 1, 4);
+            put(file, textAddress + headersSize + entry, 8);
+            put(file, elfHeaderSize, 8);                        // program headers follow the header
+            put(file, 0, 8);                                    // no section headers
+            put(file, 0, 4);
+            put(file, elfHeaderSize, 2);
+            put(file, programHeaderSize, 2);
+            put(file, 2, 2);
+            put(file, 64, 2);
+            put(file, 0, 2);
+            put(file, 0, 2);
+
+            // the text segment maps the headers too, the data segment gets its buffers as zero filled memory
+            auto segment = [&](uint32_t flags, uint64_t offset, uint64_t address, uint64_t fileSize, uint64_t memorySize) {
+                put(file, 1, 4);
+                put(file, flags, 4);
+                put(file, offset, 8);
+                put(file, address, 8);
+                put(file, address, 8);
+                put(file, fileSize, 8);
+                put(file, memorySize, 8);
+                put(file, pageSize, 8);
+            };
+            segment(4 | 1, 0, textAddress, textSize, textSize);
+            segment(4 | 2, dataOffset, dataAddress, data.size(), dataSize);
+
+            file.insert(file.end(), code.begin(), code.end());
+            file.resize(dataOffset, 0);
+            file.insert(file.end(), data.begin(), data.end());
+            return file;
+        }
+    public:
+        ElfBuilder(const TypedProgram& _program) : program(_program) {}
+
+        void call(X86Assembler& assembler, RuntimeHelper helper) override
+        {
+            switch (helper)
+            {
+                case RuntimeHelper::ReadInt: assembler.call(readInt); break;
+                case RuntimeHelper::ReadFloat:
+                    readsFloats = true;
+                    assembler.call(readFloat);
+                    break;
+                case RuntimeHelper::ReadBool: assembler.call(readBool); break;
+                case RuntimeHelper::WriteInt: assembler.call(writeInt); break;
+                case RuntimeHelper::WriteFloat:
+                    writesFloats = true;
+                    assembler.call(writeFloat);
+                    break;
+                case RuntimeHelper::WriteBool: assembler.call(writeBool); break;
+                case RuntimeHelper::WriteChar: assembler.call(writeChar); break;
+            }
+        }
+
+        vector<uint8_t> build()
+        {
+            for (Label* label : { &flush, &flushFd, &writeChar, &writeString, &writeInt, &writeFloat, &writeBool,
+                                  &getByte, &readToken, &parseIntToken, &readInt, &readFloat, &readBool, &errorExit })
+                *label = as.newLabel();
+
+            Value zero;
+            zero.i = 0;
+            frame.assign(program.variables.size(), zero);
+
+            Label programLabel = as.newLabel();
+            as.bind(programLabel);
+            compileNative(program, as, frame, *this);
+            layoutData();
+
+            size_t entry = as.size();
+            emitStart(programLabel);
+            emitOutput();
+            if (writesFloats)
+                emitFloatOutput();
+            emitInput();
+            if (readsFloats)
+                emitFloatInput();
+            emitErrorExit();
+
+            return link(as.finish(), entry);
+        }
+    };
+}
+
+vector<uint8_t> buildExecutable(const TypedProgram& program)
+{
+    return ElfBuilder(program).build();
+}
@@ -0,0 +1,21 @@
+#ifndef RGR_ELF_H
+#define RGR_ELF_H
+
+#include "NativeCodegen.h"
+
+/*
+ * Standalone executable builder.
+ *
+ * The typed program is compiled by the shared x86-64 code generator and linked with a small runtime written
+ * with the same assembler into a statically linked Linux ELF executable. The runtime talks to the kernel
+ * through raw system calls, so the executable depends on nothing and starts in no time.
+ *
+ * The runtime buffers the output and reads the input the same way the other engines do, with the same
+ * error messages. Tokens of the input are limited to 64 characters. Floats are written with the digits
+ * of formatFloat, its tables are linked in only when needed. Floats are read with the syntax of parseFloatLiteral
+ * and rounded correctly, as strtod does for the other engines.
+ */
+
+std::vector<uint8_t> buildExecutable(const TypedProgram& program);
+
+#endif //RGR_ELF_H
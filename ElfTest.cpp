@@ -0,0 +1,79 @@
+#include "catch.hpp"
+#include "TestSupport.h"
+#include "Elf.h"
+
+using namespace std;
+
+namespace
+{
+    vector<uint8_t> build(string code)
+    {
+        return buildExecutable(lower(code));
+    }
+
+    uint64_t field(const vector<uint8_t>& image, size_t offset, size_t size)
+    {
+        uint64_t value = 0;
+        for (size_t i = 0; i < size; i++)
+            value |= (uint64_t)image[offset + i] << (8 * i);
+        return value;
+    }
+}
+
+TEST_CASE( "x86 encoding for the runtime", "[elf]" ) {
+    X86Assembler as;
+    as.loadByte(Reg::RSI, Reg::R8, Reg::RCX, 0);
+    as.storeByte(Reg::RBX, Reg::RAX, 16, Reg::RSI);
+    as.div(Reg::R9);
+    as.mul(Reg::RSI);
+    as.shift(ShiftOp::Shr, Reg::R8, 52);
+    as.shift(ShiftOp::Shl, Reg::RAX);
+    as.shrd(Reg::RAX, Reg::RDX);
+    as.alu(AluOp::Adc, Reg::RDX, 0);
+    as.alu(AluOp::Sbb, Reg::RAX, Reg::RSI, 8);
+    as.movq(Reg::RAX, XReg::XMM0);
+    as.syscall();
+
+    Label label = as.newLabel();
+    as.call(label);
+    as.bind(label);
+
+    vector<uint8_t> expected = {
+        0x49, 0x0F, 0xB6, 0x74, 0x08, 0x00,
+        0x40, 0x88, 0x74, 0x03, 0x10,
+        0x49, 0xF7, 0xF1,
+        0x48, 0xF7, 0xE6,
+        0x49, 0xC1, 0xE8, 0x34,
+        0x48, 0xD3, 0xE0,
+        0x48, 0x0F, 0xAD, 0xD0,
+        0x48, 0x83, 0xD2, 0x00,
+        0x48, 0x1B, 0x46, 0x08,
+        0x66, 0x48, 0x0F, 0x7E, 0xC0,
+        0x0F, 0x05,
+        0xE8, 0x00, 0x00, 0x00, 0x00
+    };
+    REQUIRE( as.finish() == expected );
+}
+
+TEST_CASE( "ELF image", "[elf]" ) {
+    vector<uint8_t> image = build("dim a integer : read(a) : write(a * 2)");
+
+    REQUIRE( image.size() > 0x1000 );
+    REQUIRE( vector<uint8_t>(image.begin(), image.begin() + 4) == vector<uint8_t>({ 0x7F, 'E', 'L', 'F' }) );
+    REQUIRE( field(image, 16, 2) == 2 );
+    REQUIRE( field(image, 18, 2) == 0x3E );
+    REQUIRE( field(image, 56, 2) == 2 );
+
+    // the entry point lies in the text segment, the data segment is page aligned in the file
+    uint64_t entry = field(image, 24, 8);
+    uint64_t textSize = field(image, 64 + 32, 8);
+    uint64_t dataOffset = field(image, 64 + 56 + 8, 8);
+    REQUIRE( entry >= field(image, 64 + 16, 8) );
+    REQUIRE( entry < field(image, 64 + 16, 8) + textSize );
+    REQUIRE( (dataOffset & 0xFFF) == 0 );
+    REQUIRE( field(image, 64 + 56 + 40, 8) > field(image, 64 + 56 + 32, 8) );
+
+    // floats are written and read by the runtime and its tables are only linked in when needed
+    REQUIRE( build("dim x float : write(x)").size() > build("dim x integer : write(x)").size() + 10000 );
+    REQUIRE( build("dim x float : read(x)").size() > build("dim x integer : read(x)").size() );
+}
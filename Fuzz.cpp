@@ -0,0 +1,231 @@
+#include "Fuzz.h"
+#include "Parser.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+using namespace std;
+
+namespace
+{
+    const size_t populationSize = 16, longestUnit = 64, longestEnd = 256;
+
+    const char* names[] = { "prefix", "unit", "suffix" };
+
+    const char* tokens[] = { "dim ", " integer", " float", " bool", "if ", " then ", " else ", "for ", " to ", " do ",
+                             "while ", "read(", "write(", " as ", "begin", "end", "true", "false", "not ", " and ",
+                             " or ", "+", "-", "*", "/", "<", ">", "=", "<>", "<=", ">=", "(", ")", ",", ":", "\n",
+                             "{", "}", " ", "a", "1", "0", "1.5", ".5", "1e", "e+", "e-", "1e+5", "0ffh", "101b",
+                             "17o", "9d" };
+
+    const char characters[] = "abdehoxAEH019.+-*/<>=(){}:, \n";
+
+    string escape(const string& part)
+    {
+        string result = "\"";
+        for (char c : part)
+        {
+            if (c == '"' || c == '\\')
+                result += string("\\") + c;
+            else if (c == '\n')
+                result += "\\n";
+            else if (c == '\t')
+                result += "\\t";
+            else if ((unsigned char)c < 0x20 || (unsigned char)c >= 0x7f)
+            {
+                char hex[8];
+                snprintf(hex, sizeof(hex), "\\x%02x", (unsigned char)c);
+                result += hex;
+            }
+            else
+                result += c;
+        }
+        return result + "\"";
+    }
+
+    string unescape(const string& text)
+    {
+        if (text.size() < 2 || text.front() != '"' || text.back() != '"')
+            throw runtime_error("Fuzz case part is not quoted: " + text);
+        string result;
+        for (size_t i = 1; i + 1 < text.size(); i++)
+        {
+            if (text[i] != '\\')
+            {
+                result += text[i];
+                continue;
+            }
+            if (++i + 1 >= text.size())
+                throw runtime_error("Fuzz case part ends with an escape: " + text);
+            switch (text[i])
+            {
+                case 'n': result += '\n'; break;
+                case 't': result += '\t'; break;
+                case 'x':
+                    if (i + 3 >= text.size())
+                        throw runtime_error("Fuzz case part has a short escape: " + text);
+                    result += (char)stoi(text.substr(i + 1, 2), nullptr, 16);
+                    i += 2;
+                    break;
+                default: result += text[i];
+            }
+        }
+        return result;
+    }
+}
+
+string expandCase(const FuzzCase& fuzzCase, size_t bytes)
+{
+    string result = fuzzCase.prefix;
+    if (!fuzzCase.unit.empty())
+        while (result.size() < bytes)
+            result += fuzzCase.unit;
+    return result + fuzzCase.suffix;
+}
+
+string formatCase(const FuzzCase& fuzzCase)
+{
+    return string(names[0]) + " " + escape(fuzzCase.prefix) + "\n" + names[1] + " " + escape(fuzzCase.unit) + "\n"
+           + names[2] + " " + escape(fuzzCase.suffix) + "\n";
+}
+
+FuzzCase parseCase(const string& text)
+{
+    FuzzCase result;
+    string* parts[] = { &result.prefix, &result.unit, &result.suffix };
+    istringstream lines(text);
+    string line;
+    for (size_t i = 0; i < 3; i++)
+    {
+        string name = names[i];
+        if (!getline(lines, line) || line.compare(0, name.size() + 1, name + " ") != 0)
+            throw runtime_error("Fuzz case has no " + name + " line");
+        *parts[i] = unescape(line.substr(name.size() + 1));
+    }
+    if (result.unit.empty())
+        throw runtime_error("Fuzz case has an empty unit");
+    return result;
+}
+
+double frontEndSeconds(const string& input)
+{
+    auto start = chrono::steady_clock::now();
+    try
+    {
+        parseInputWithSemantic(make_shared<ProgramNode>(), input);
+    }
+    catch (exception&)
+    {
+    }
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+Growth measureGrowth(const FuzzCase& fuzzCase, size_t bytes, size_t runs)
+{
+    Growth result;
+    string small = expandCase(fuzzCase, bytes / 4), large = expandCase(fuzzCase, bytes);
+    // the sizes take turns, so a slow spell of the machine hits both rather than skewing the exponent
+    result.smallSeconds = frontEndSeconds(small);
+    result.largeSeconds = frontEndSeconds(large);
+    for (size_t i = 1; i < runs; i++)
+    {
+        result.smallSeconds = min(result.smallSeconds, frontEndSeconds(small));
+        result.largeSeconds = min(result.largeSeconds, frontEndSeconds(large));
+    }
+    result.nanosecondsPerByte = result.largeSeconds * 1e9 / max(large.size(), (size_t)1);
+    // below a microsecond the clock says little
+    result.exponent = log(max(result.largeSeconds, 1e-6) / max(result.smallSeconds, 1e-6)) / log(4.0);
+    return result;
+}
+
+ComplexityFuzzer::ComplexityFuzzer(uint64_t seed, size_t _bytes) : random(seed), bytes(_bytes)
+{
+    add(FuzzCase { "dim a integer\n", "a as 1\n", "" });
+    add(FuzzCase { "", "a", "" });
+    add(FuzzCase { "dim a integer : a as ", "1 + ", "1" });
+}
+
+void ComplexityFuzzer::add(const FuzzCase& fuzzCase)
+{
+    pending.push_back(fuzzCase);
+}
+
+void ComplexityFuzzer::mutatePart(string& part, size_t longest)
+{
+    size_t at = below(part.size() + 1);
+    switch (below(6))
+    {
+        case 0:
+            part.insert(at, 1, characters[below(sizeof(characters) - 1)]);
+            break;
+        case 1:
+            part.insert(at, tokens[below(sizeof(tokens) / sizeof(tokens[0]))]);
+            break;
+        case 2:
+            if (!part.empty())
+                part.erase(min(at, part.size() - 1), below(4) + 1);
+            break;
+        case 3:
+            if (!part.empty())
+                part[min(at, part.size() - 1)] = characters[below(sizeof(characters) - 1)];
+            break;
+        case 4:
+        {
+            size_t from = below(part.size() + 1);
+            part.insert(at, part.substr(from, below(8) + 1));
+            break;
+        }
+        default:
+        {
+            // a piece of another case's unit
+            const string& other = population[below(population.size())].fuzzCase.unit;
+            size_t from = below(other.size() + 1);
+            part.insert(at, other.substr(from, below(8) + 1));
+            break;
+        }
+    }
+    if (part.size() > longest)
+        part.resize(longest);
+}
+
+FuzzCase ComplexityFuzzer::next()
+{
+    if (!pending.empty())
+    {
+        FuzzCase result = pending.back();
+        pending.pop_back();
+        return result;
+    }
+
+    FuzzCase result = population[below(population.size())].fuzzCase;
+    size_t mutations = below(4) + 1;
+    for (size_t i = 0; i < mutations; i++)
+    {
+        // the unit is what grows, it's mutated most
+        switch (below(4))
+        {
+            case 0: mutatePart(result.prefix, longestEnd); break;
+            case 1: mutatePart(result.suffix, longestEnd); break;
+            default: mutatePart(result.unit, longestUnit);
+        }
+    }
+    if (result.unit.empty())
+        result.unit = tokens[below(sizeof(tokens) / sizeof(tokens[0]))];
+    return result;
+}
+
+FuzzFinding ComplexityFuzzer::evaluate(const FuzzCase& fuzzCase)
+{
+    FuzzFinding finding { fuzzCase, measureGrowth(fuzzCase, bytes) };
+    auto worse = [](const FuzzFinding& a, const FuzzFinding& b) {
+        return a.growth.nanosecondsPerByte > b.growth.nanosecondsPerByte;
+    };
+    if (population.size() < populationSize || worse(finding, population.back()))
+    {
+        population.insert(upper_bound(population.begin(), population.end(), finding, worse), finding);
+        if (population.size() > populationSize)
+            population.pop_back();
+    }
+    return finding;
+}
@@ -0,0 +1,72 @@
+#ifndef RGR_FUZZ_H
+#define RGR_FUZZ_H
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * Search for inputs that cost the front end (lexString, then parseInputWithSemantic) more per byte as they grow.
+ *
+ * A case is a prefix, a unit and a suffix: at a size of n bytes the input is the prefix, the unit repeated up to n
+ * bytes and the suffix. Its cost is timed at two sizes 4 times apart, best of a few runs taken in turns, and the
+ * growth exponent log(large / small) / log 4 is about 1 for linear cost and 2 for quadratic. The fuzzer keeps the
+ * cases costing most per byte at the larger size, where superlinear cases stand out as well, and mutates them with
+ * byte edits, tokens of the language, duplicated and spliced pieces. Cases are saved as text, one quoted and escaped
+ * part per line, so slow inputs found can be checked in and rechecked.
+ */
+
+struct FuzzCase
+{
+    std::string prefix, unit, suffix;
+
+    bool operator==(const FuzzCase& b) const { return prefix == b.prefix && unit == b.unit && suffix == b.suffix; }
+};
+
+std::string expandCase(const FuzzCase& fuzzCase, size_t bytes);
+std::string formatCase(const FuzzCase& fuzzCase);
+// throws for text formatCase didn't write
+FuzzCase parseCase(const std::string& text);
+
+// seconds the front end takes, rejecting the input is part of the work
+double frontEndSeconds(const std::string& input);
+
+struct Growth
+{
+    double smallSeconds, largeSeconds;  // at a quarter of the size and at the size
+    double exponent;
+    double nanosecondsPerByte;          // at the size
+};
+
+Growth measureGrowth(const FuzzCase& fuzzCase, size_t bytes, size_t runs = 3);
+
+struct FuzzFinding
+{
+    FuzzCase fuzzCase;
+    Growth growth;
+};
+
+class ComplexityFuzzer
+{
+private:
+    std::mt19937_64 random;
+    size_t bytes;
+    std::vector<FuzzFinding> population;    // costliest per byte first
+    std::vector<FuzzCase> pending;          // added, not measured yet
+
+    size_t below(size_t count) { return random() % count; }
+    void mutatePart(std::string& part, size_t longest);
+public:
+    ComplexityFuzzer(uint64_t seed, size_t _bytes);
+
+    // the cases added, and a few simple ones there from the start, come out of next() before any mutated one
+    void add(const FuzzCase& fuzzCase);
+    FuzzCase next();
+    // measures the case and keeps it when it costs more per byte than some case kept
+    FuzzFinding evaluate(const FuzzCase& fuzzCase);
+
+    const std::vector<FuzzFinding>& getPopulation() const { return population; }
+};
+
+#endif //RGR_FUZZ_H
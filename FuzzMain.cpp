@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Arguments.h"
+#include "Fuzz.h"
+
+using namespace std;
+
+/*
+ * rgr_fuzz: looks for inputs on which the front end's cost grows faster than their size.
+ *
+ * `rgr_fuzz [options] [case or directory]...` mutates cases for --time seconds, starting from the given ones, and
+ * writes each case growing with an exponent above --threshold, confirmed by a second measurement, to slow-N.case
+ * in --output. The case being measured when the process crashes (deep recursion overflowing the stack, say) is written
+ * to crash.case there. `rgr_fuzz --check [case or directory]...` measures the cases and exits with status 1 if any of
+ * them grows above the threshold, so a corpus of cases found once keeps them from coming back.
+ */
+
+namespace
+{
+    struct Options
+    {
+        bool check = false;
+        size_t bytes = 64 << 10;
+        double seconds = 60, threshold = 1.5;
+        uint64_t seed = 1;
+        string output = ".";
+        vector<string> paths;
+    };
+
+    // the crash handler may only write what is prepared before the measurement
+    char crashPath[4096];
+    string crashText;
+
+    void onCrash(int signal)
+    {
+        int file = open(crashPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (file >= 0)
+        {
+            ssize_t written = write(file, crashText.data(), crashText.size());
+            (void)written;
+            close(file);
+        }
+        const char message[] = "Crashed, the case is in crash.case\n";
+        ssize_t written = write(2, message, sizeof(message) - 1);
+        (void)written;
+        ::signal(signal, SIG_DFL);
+        raise(signal);
+    }
+
+    void catchCrashes(const string& output)
+    {
+        snprintf(crashPath, sizeof(crashPath), "%s/crash.case", output.c_str());
+
+        // a stack overflow leaves no stack for the handler
+        static vector<char> stack(1 << 16);
+        stack_t alternate;
+        alternate.ss_sp = stack.data();
+        alternate.ss_size = stack.size();
+        alternate.ss_flags = 0;
+        sigaltstack(&alternate, nullptr);
+
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = onCrash;
+        action.sa_flags = SA_ONSTACK;
+        for (int signal : { SIGSEGV, SIGBUS, SIGABRT, SIGFPE })
+            sigaction(signal, &action, nullptr);
+    }
+
+    // the cases in a file, or in the .case files of a directory
+    vector<pair<string, FuzzCase>> loadCases(const string& path)
+    {
+        vector<pair<string, FuzzCase>> result;
+        if (DIR* directory = opendir(path.c_str()))
+        {
+            vector<string> names;
+            while (dirent* entry = readdir(directory))
+            {
+                string name = entry->d_name;
+                if (name.size() > 5 && name.compare(name.size() - 5, 5, ".case") == 0)
+                    names.push_back(path + "/" + name);
+            }
+            closedir(directory);
+            sort(names.begin(), names.end());
+            for (auto& name : names)
+                for (auto& loaded : loadCases(name))
+                    result.push_back(loaded);
+            return result;
+        }
+
+        ifstream in(path);
+        if (!in)
+            throw runtime_error("Couldn't open " + path);
+        stringstream text;
+        text << in.rdbuf();
+        result.emplace_back(path, parseCase(text.str()));
+        return result;
+    }
+
+    void printGrowth(const string& name, const Growth& growth)
+    {
+        cout << name << ": exponent " << growth.exponent << ", " << growth.nanosecondsPerByte << " ns/byte, "
+             << growth.smallSeconds * 1e3 << " ms to " << growth.largeSeconds * 1e3 << " ms" << endl;
+    }
+
+    int checkCases(const Options& options)
+    {
+        bool slow = false;
+        for (auto& path : options.paths)
+            for (auto& loaded : loadCases(path))
+            {
+                crashText = formatCase(loaded.second);
+                // like a finding of the fuzzer, a slow measurement counts only when a longer one confirms it
+                Growth growth = measureGrowth(loaded.second, options.bytes, 5);
+                if (growth.exponent > options.threshold)
+                    growth = measureGrowth(loaded.second, options.bytes, 9);
+                printGrowth(loaded.first, growth);
+                if (growth.exponent > options.threshold)
+                {
+                    cout << loaded.first << " grows faster than the threshold " << options.threshold << endl;
+                    slow = true;
+                }
+            }
+        return slow ? 1 : 0;
+    }
+
+    int fuzz(const Options& options)
+    {
+        ComplexityFuzzer fuzzer(options.seed, options.bytes);
+        for (auto& path : options.paths)
+            for (auto& loaded : loadCases(path))
+                fuzzer.add(loaded.second);
+
+        set<string> reported;
+        size_t tried = 0;
+        auto start = chrono::steady_clock::now(), status = start;
+        while (chrono::steady_clock::now() - start < chrono::duration<double>(options.seconds))
+        {
+            FuzzCase candidate = fuzzer.next();
+            crashText = formatCase(candidate);
+            FuzzFinding finding = fuzzer.evaluate(candidate);
+            tried++;
+
+            // timing noise makes single measurements grow now and then
+            if (finding.growth.exponent > options.threshold && !reported.count(crashText))
+            {
+                Growth confirmed = measureGrowth(candidate, options.bytes, 7);
+                if (confirmed.exponent > options.threshold)
+                {
+                    reported.insert(crashText);
+                    string name = options.output + "/slow-" + to_string(reported.size()) + ".case";
+                    ofstream(name) << crashText;
+                    printGrowth(name, confirmed);
+                }
+            }
+
+            if (chrono::steady_clock::now() - status > chrono::seconds(10))
+            {
+                status = chrono::steady_clock::now();
+                const FuzzFinding& costliest = fuzzer.getPopulation().front();
+                cout << tried << " cases, costliest " << costliest.growth.nanosecondsPerByte << " ns/byte with exponent "
+                     << costliest.growth.exponent << endl;
+            }
+        }
+
+        cout << tried << " cases tried, " << reported.size() << " slow, the costliest:" << endl;
+        for (auto& finding : fuzzer.getPopulation())
+        {
+            printGrowth("case", finding.growth);
+            cout << formatCase(finding.fuzzCase);
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            string arg = argv[i];
+            if (arg == "--check")
+                options.check = true;
+            else if (arg.compare(0, 7, "--size=") == 0)
+                options.bytes = max<size_t>(4, parseSize(arg));
+            else if (arg.compare(0, 7, "--time=") == 0)
+                options.seconds = stod(arg.substr(7));
+            else if (arg.compare(0, 12, "--threshold=") == 0)
+                options.threshold = stod(arg.substr(12));
+            else if (arg.compare(0, 7, "--seed=") == 0)
+                options.seed = parseCount(arg);
+            else if (arg.compare(0, 9, "--output=") == 0)
+                options.output = arg.substr(9);
+            else if (arg.compare(0, 2, "--") == 0)
+                throw runtime_error("Unknown option " + arg);
+            else
+                options.paths.push_back(arg);
+        }
+
+        catchCrashes(options.output);
+        return options.check ? checkCases(options) : fuzz(options);
+    }
+    catch (exception& e)
+    {
+        cerr << e.what() << "\nUsage: rgr_fuzz [--check] [--size=64K] [--time=60] [--threshold=1.5] [--seed=1]"
+                            " [--output=.] [case or directory]...\n";
+        return 2;
+    }
+}
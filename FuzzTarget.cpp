@@ -0,0 +1,15 @@
+#include "Fuzz.h"
+
+using namespace std;
+
+/*
+ * Entry point for libFuzzer, built as rgr_libfuzzer when configured with -DRGR_LIBFUZZER=ON and clang. libFuzzer
+ * looks for coverage rather than cost, so run it with -report_slow_units=1 and a -timeout to have slow inputs
+ * reported; rgr_fuzz searches for cost growth directly.
+ */
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    frontEndSeconds(string((const char*)data, size));
+    return 0;
+}
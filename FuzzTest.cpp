@@ -0,0 +1,55 @@
+#include "catch.hpp"
+#include "Fuzz.h"
+
+using namespace std;
+
+TEST_CASE( "fuzz cases", "[fuzz]" ) {
+    FuzzCase fuzzCase { "dim a integer\n", "a as \"1\\\t\x01\n", "" };
+    string text = formatCase(fuzzCase);
+    REQUIRE (text == "prefix \"dim a integer\\n\"\nunit \"a as \\\"1\\\\\\t\\x01\\n\"\nsuffix \"\"\n");
+    REQUIRE ((parseCase(text) == fuzzCase));
+
+    REQUIRE_THROWS (parseCase(""));
+    REQUIRE_THROWS (parseCase("prefix \"\"\nunit \"\"\nsuffix \"\"\n"));
+    REQUIRE_THROWS (parseCase("prefix \"\"\nunit a\nsuffix \"\"\n"));
+    REQUIRE_THROWS (parseCase("prefix \"\"\nunit \"a\\\"\nsuffix \"\"\n"));
+    REQUIRE_THROWS (parseCase("unit \"a\"\nprefix \"\"\nsuffix \"\"\n"));
+
+    string input = expandCase(FuzzCase { "<", "ab", ">" }, 6);
+    REQUIRE (input == "<ababab>");
+    REQUIRE (expandCase(FuzzCase { "<", "ab", ">" }, 0) == "<>");
+
+    // rejected inputs are measured like accepted ones
+    REQUIRE (frontEndSeconds("dim a integer : a as (") >= 0);
+    REQUIRE (frontEndSeconds(string(100000, '(')) >= 0);
+    Growth growth = measureGrowth(FuzzCase { "dim a integer\n", "a as 1\n", "" }, 4 << 10, 1);
+    REQUIRE (growth.largeSeconds > 0);
+    REQUIRE (growth.nanosecondsPerByte > 0);
+}
+
+TEST_CASE( "complexity fuzzer", "[fuzz]" ) {
+    ComplexityFuzzer fuzzer(1, 1 << 10);
+    FuzzCase added { "", "{}", "" };
+    fuzzer.add(added);
+    REQUIRE ((fuzzer.next() == added));
+
+    // the built-in seeds come next, then mutations of the cases kept
+    for (int i = 0; i < 3; i++)
+        fuzzer.evaluate(fuzzer.next());
+    REQUIRE (fuzzer.getPopulation().size() == 3);
+
+    for (int i = 0; i < 100; i++)
+    {
+        FuzzCase mutated = fuzzer.next();
+        REQUIRE (!mutated.unit.empty());
+        REQUIRE (mutated.unit.size() <= 64);
+        REQUIRE (mutated.prefix.size() <= 256);
+        REQUIRE (mutated.suffix.size() <= 256);
+        fuzzer.evaluate(mutated);
+    }
+
+    auto& population = fuzzer.getPopulation();
+    REQUIRE (population.size() == 16);
+    for (size_t i = 1; i < population.size(); i++)
+        REQUIRE (population[i - 1].growth.nanosecondsPerByte >= population[i].growth.nanosecondsPerByte);
+}
@@ -0,0 +1,256 @@
+#include "Generator.h"
+#include <random>
+#include <stdexcept>
+using namespace std;
+
+namespace
+{
+    const size_t maxDepth = 3;
+
+    const vector<ProgramShape> shapes = {
+            { "mixed", 3, 4, 15, 10, 10, 40 },
+            { "parens", 60, 2, 0, 2, 0, 0 },
+            { "blocks", 1, 40, 60, 2, 2, 20 },
+            { "dims", 1, 2, 5, 70, 5, 20 },
+            { "comments", 2, 3, 10, 5, 80, 400 },
+    };
+
+    class Generator
+    {
+    private:
+        const ProgramShape& shape;
+        mt19937_64 random;
+        string out;
+        // variables are i1, i2, ... of integer, x1, ... of float and p1, ... of bool; loops at depth n count with kn+1
+        size_t ints = 1, floats = 1, bools = 1;
+
+        size_t below(size_t count) { return random() % count; }
+        bool chance(unsigned percent) { return below(100) < percent; }
+
+        string digits(uint64_t value, unsigned base)
+        {
+            string result;
+            do
+            {
+                result.insert(result.begin(), "0123456789abcdef"[value % base]);
+                value /= base;
+            }
+            while (value);
+            return result;
+        }
+
+        string suffix(char letter)
+        {
+            return string(1, chance(50) ? letter : (char)toupper(letter));
+        }
+
+        string intLiteral()
+        {
+            uint64_t value = below(chance(80) ? 100 : 100000);
+            switch (below(5))
+            {
+                case 0: return digits(value, 10);
+                case 1: return digits(value, 10) + suffix('d');
+                case 2: return digits(value, 2) + suffix('b');
+                case 3: return digits(value, 8) + suffix('o');
+                default: return "0" + digits(value, 16) + suffix('h');     // a leading letter would make a name
+            }
+        }
+
+        string floatLiteral()
+        {
+            string whole = digits(below(1000), 10), fraction = digits(below(1000), 10);
+            // without a whole part the lexer would take a comma or brace after it into the token
+            switch (below(3))
+            {
+                case 0: return whole + "." + fraction;
+                case 1: return whole + suffix('e') + digits(below(10), 10);
+                default: return whole + "." + fraction + suffix('e') + (chance(50) ? "-" : "+") + digits(below(10), 10);
+            }
+        }
+
+        string variable(char prefix, size_t count)
+        {
+            return prefix + to_string(below(count) + 1);
+        }
+
+        string intLeaf()
+        {
+            return chance(50) ? variable('i', ints) : intLiteral();
+        }
+
+        string floatLeaf()
+        {
+            return chance(50) ? variable('x', floats) : floatLiteral();
+        }
+
+        string operation(const char* const* operations, size_t count)
+        {
+            return string(" ") + operations[below(count)] + " ";
+        }
+
+        // the last operand is a leaf, so expressions grow with their depth only
+        string intExpression(size_t depth)
+        {
+            static const char* operations[] = { "+", "-", "*", "and", "or" };
+            string left = depth ? "(" + intExpression(depth - 1) + ")" : intLeaf();
+            return chance(20) ? "not " + left : left + operation(operations, 5) + intLeaf();
+        }
+
+        // ends with a float, whatever the integers before it
+        string floatExpression(size_t depth)
+        {
+            static const char* operations[] = { "+", "-", "*" };
+            string left = depth ? "(" + floatExpression(depth - 1) + ")" : chance(30) ? intLeaf() : floatLeaf();
+            return left + operation(operations, 3) + floatLeaf();
+        }
+
+        string boolExpression(size_t depth)
+        {
+            static const char* relations[] = { "=", "<>", "<", ">", "<=", ">=" };
+            switch (below(3))
+            {
+                case 0: return intExpression(depth) + operation(relations, 6) + intLeaf();
+                case 1: return (chance(50) ? "not " : "") + variable('p', bools);
+                default: return chance(50) ? "true" : "false";
+            }
+        }
+
+        size_t expressionDepth()
+        {
+            return below(shape.parenDepth + 1);
+        }
+
+        void newLine(size_t depth)
+        {
+            out += "\n" + string(4 * depth + 4, ' ');
+        }
+
+        void statement(size_t depth)
+        {
+            string counter = "k" + to_string(depth + 1);
+            unsigned blocks = depth ? shape.blocks / shape.blockLength : shape.blocks;
+            if (depth < maxDepth && chance(blocks))
+            {
+                out += "begin";
+                size_t length = below(shape.blockLength) + 1;
+                for (size_t i = 0; i < length; i++)
+                {
+                    newLine(depth);
+                    statement(depth + 1);
+                }
+                out += "\n" + string(4 * depth, ' ') + "end";
+                return;
+            }
+
+            switch (depth < maxDepth ? below(8) : below(4))
+            {
+                case 0:
+                case 1:
+                    out += variable('i', ints) + " as " + intExpression(expressionDepth());
+                    break;
+                case 2:
+                    out += variable('x', floats) + " as " + floatExpression(expressionDepth());
+                    break;
+                case 3:
+                    out += "write(" + intExpression(expressionDepth()) + ", " + floatExpression(expressionDepth()) + ", "
+                           + boolExpression(expressionDepth()) + ")";
+                    break;
+                case 4:
+                    out += variable('p', bools) + " as " + boolExpression(expressionDepth());
+                    break;
+                case 5:
+                    out += "if " + boolExpression(expressionDepth()) + " then ";
+                    statement(depth + 1);
+                    if (chance(50))
+                    {
+                        out += " else ";
+                        statement(depth + 1);
+                    }
+                    break;
+                case 6:
+                    out += "for " + counter + " as " + intLiteral() + " to " + digits(below(4), 10) + " do";
+                    newLine(depth);
+                    statement(depth + 1);
+                    break;
+                default:
+                    // the counter is set before the loop and moved on at the end of its body
+                    out += "begin";
+                    newLine(depth);
+                    out += counter + " as 0";
+                    newLine(depth);
+                    out += "while " + counter + " < " + digits(below(4), 10) + " do begin";
+                    newLine(depth + 1);
+                    statement(depth + 2 > maxDepth ? maxDepth : depth + 2);
+                    newLine(depth + 1);
+                    out += counter + " as " + counter + " + 1";
+                    newLine(depth);
+                    out += "end";
+                    out += "\n" + string(4 * depth, ' ') + "end";
+                    break;
+            }
+        }
+
+        void declaration()
+        {
+            static const char prefixes[] = { 'i', 'x', 'p' };
+            static const char* types[] = { " integer", " float", " bool" };
+            size_t* counts[] = { &ints, &floats, &bools };
+            size_t kind = below(3), names = below(4) + 1;
+            out += "dim ";
+            for (size_t i = 0; i < names; i++)
+                out += (i ? ", " : "") + string(1, prefixes[kind]) + to_string(++*counts[kind]);
+            out += types[kind];
+        }
+
+        void comment()
+        {
+            static const char* words[] = { "the", "loop", "adds", "values", "of", "each", "result", "for", "now" };
+            out += " {";
+            size_t length = below(shape.commentLength + 1);
+            for (size_t written = 0; written < length; )
+            {
+                string word = chance(10) ? "\n" : string(" ") + words[below(9)];
+                out += word;
+                written += word.size();
+            }
+            out += " }";
+        }
+    public:
+        Generator(const ProgramShape& _shape, uint64_t seed) : shape(_shape), random(seed) {}
+
+        string generate(size_t bytes)
+        {
+            out = "dim i1 integer : dim x1 float : dim p1 bool : dim k1, k2, k3 integer\n";
+            while (out.size() < bytes)
+            {
+                if (chance(shape.declarations))
+                    declaration();
+                else
+                    statement(0);
+                if (chance(shape.comments))
+                    comment();
+                out += "\n";
+            }
+            return out;
+        }
+    };
+}
+
+const vector<ProgramShape>& programShapes()
+{
+    return shapes;
+}
+
+const ProgramShape& findProgramShape(const string& name)
+{
+    for (auto& shape : shapes)
+        if (shape.name == name)
+            return shape;
+    throw runtime_error("Unknown program shape " + name);
+}
+
+string generateProgram(const ProgramShape& shape, size_t bytes, uint64_t seed)
+{
+    return Generator(shape, seed).generate(bytes);
+}
@@ -0,0 +1,36 @@
+#ifndef RGR_GENERATOR_H
+#define RGR_GENERATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Seeded generator of valid programs for benchmarking the front end.
+ *
+ * A shape says how the program looks: how deep its expressions nest parentheses, how long its begin ... end lists
+ * get, how often an item declares variables and how much of it is comments. Literals of every kind show up in every
+ * shape: decimal with and without the d suffix, binary, octal, hexadecimal and floats with and without exponents.
+ * Programs pass the semantic check and also run: they divide by nothing, read nothing and their loops count to small
+ * constants with counters of their own. The same shape, size and seed always give the same program.
+ */
+
+struct ProgramShape
+{
+    std::string name;
+    size_t parenDepth;      // deepest parentheses in an expression
+    size_t blockLength;     // most statements between begin and end
+    unsigned blocks;        // percent of top-level statements that are begin ... end lists
+    unsigned declarations;  // percent of items that are dim declarations
+    unsigned comments;      // percent of items followed by a comment
+    size_t commentLength;   // longest comment
+};
+
+const std::vector<ProgramShape>& programShapes();
+// throws for an unknown name
+const ProgramShape& findProgramShape(const std::string& name);
+
+// a program of at least the given size in bytes, ending once it has grown past it
+std::string generateProgram(const ProgramShape& shape, size_t bytes, uint64_t seed);
+
+#endif //RGR_GENERATOR_H
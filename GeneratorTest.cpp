@@ -0,0 +1,41 @@
+#include "catch.hpp"
+#include "Generator.h"
+#include "TestSupport.h"
+#include <regex>
+
+using namespace std;
+
+TEST_CASE( "generated programs", "[generator]" ) {
+    REQUIRE_THROWS (findProgramShape("unknown"));
+    REQUIRE (&findProgramShape("mixed") == &programShapes()[0]);
+
+    for (auto& shape : programShapes())
+        for (uint64_t seed = 1; seed <= 3; seed++)
+        {
+            string code = generateProgram(shape, 8 << 10, seed);
+            REQUIRE (code.size() >= (8 << 10));
+            REQUIRE (code == generateProgram(shape, 8 << 10, seed));
+            REQUIRE (code != generateProgram(shape, 8 << 10, seed + 1));
+
+            // valid programs that end without errors
+            BytecodeProgram program = compile(code);
+            InputBuffer in("");
+            OutputBuffer out;
+            ExecutionLimits limits;
+            limits.fuel = 100000000;
+            REQUIRE (runLimited(program, in, out, limits).status == LimitStatus::Finished);
+            REQUIRE (!out.str().empty());
+
+            // every kind of literal
+            for (auto literal : { "\\b[0-9]+\\b", "\\b[0-9]+[dD]\\b", "\\b[01]+[bB]\\b", "\\b[0-7]+[oO]\\b",
+                                  "\\b0[0-9a-f]+[hH]\\b", "\\b[0-9]+\\.[0-9]+\\b", "\\b[0-9]+[eE][0-9]", "[eE][-+][0-9]" })
+                REQUIRE (regex_search(code, regex(literal)));
+        }
+
+    string parens = generateProgram(findProgramShape("parens"), 8 << 10, 1);
+    REQUIRE (parens.find(string(30, '(')) != string::npos);
+    string blocks = generateProgram(findProgramShape("blocks"), 8 << 10, 1);
+    REQUIRE (regex_search(blocks, regex("begin(\n[^\n]*){20}\n *end")));
+    REQUIRE (generateProgram(findProgramShape("comments"), 8 << 10, 1).find('{') != string::npos);
+    REQUIRE (generateProgram(findProgramShape("mixed"), 0, 1).find("dim i1 integer") == 0);
+}
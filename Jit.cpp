@@ -0,0 +1,151 @@
+#include <cstring>
+#include "Jit.h"
+
+#ifdef RGR_JIT_AVAILABLE
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+    struct JitContext
+    {
+        InputBuffer* input;
+        OutputBuffer* output;
+        string error;
+    };
+
+    // status returned by the generated code: 0 on success, -1 if a helper failed, otherwise the line of a division by zero
+    typedef long long (*JitFunction)(Value* frame, JitContext* context);
+
+    // runtime helpers called from the generated code, exceptions must not escape into it
+    int readIntHelper(JitContext* context, long long* target, long long line)
+    {
+        try
+        {
+            *target = context->input->readInt(line);
+            return 0;
+        }
+        catch(exception& e)
+        {
+            context->error = e.what();
+            return 1;
+        }
+    }
+
+    int readFloatHelper(JitContext* context, double* target, long long line)
+    {
+        try
+        {
+            *target = context->input->readFloat(line);
+            return 0;
+        }
+        catch(exception& e)
+        {
+            context->error = e.what();
+            return 1;
+        }
+    }
+
+    int readBoolHelper(JitContext* context, long long* target, long long line)
+    {
+        try
+        {
+            *target = context->input->readBool(line);
+            return 0;
+        }
+        catch(exception& e)
+        {
+            context->error = e.what();
+            return 1;
+        }
+    }
+
+    void writeIntHelper(JitContext* context, long long value) { context->output->writeInt(value); }
+    void writeFloatHelper(JitContext* context, double value) { context->output->writeFloat(value); }
+    void writeBoolHelper(JitContext* context, long long value) { context->output->writeBool(value != 0); }
+    void writeCharHelper(JitContext* context, long long c) { context->output->writeChar((char)c); }
+
+    class JitHelperCalls : public HelperCalls
+    {
+    public:
+        void call(X86Assembler& as, RuntimeHelper helper) override
+        {
+            const void* function = nullptr;
+            switch (helper)
+            {
+                case RuntimeHelper::ReadInt: function = (const void*)&readIntHelper; break;
+                case RuntimeHelper::ReadFloat: function = (const void*)&readFloatHelper; break;
+                case RuntimeHelper::ReadBool: function = (const void*)&readBoolHelper; break;
+                case RuntimeHelper::WriteInt: function = (const void*)&writeIntHelper; break;
+                case RuntimeHelper::WriteFloat: function = (const void*)&writeFloatHelper; break;
+                case RuntimeHelper::WriteBool: function = (const void*)&writeBoolHelper; break;
+                case RuntimeHelper::WriteChar: function = (const void*)&writeCharHelper; break;
+            }
+
+            as.mov(Reg::RDI, Reg::RBP);
+            as.mov(Reg::RAX, (long long)(intptr_t)function);
+            as.call(Reg::RAX);
+        }
+    };
+}
+
+JitEngine::JitEngine(const TypedProgram& program) : variableCount(program.variables.size()), memory(nullptr), memorySize(0)
+{
+    if (!isAvailable())
+        throw CodegenUnsupported("JIT compilation is not available on this platform");
+
+    Value zero;
+    zero.i = 0;
+    frame.assign(variableCount, zero);
+
+    X86Assembler as;
+    JitHelperCalls calls;
+    compileNative(program, as, frame, calls);
+    vector<uint8_t> code = as.finish();
+
+#ifdef RGR_JIT_AVAILABLE
+    void* mapped = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED)
+        throw CodegenUnsupported("Couldn't map memory for the JIT code");
+
+    memcpy(mapped, code.data(), code.size());
+    if (mprotect(mapped, code.size(), PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap(mapped, code.size());
+        throw CodegenUnsupported("Couldn't make the JIT code executable");
+    }
+
+    memory = mapped;
+    memorySize = code.size();
+#endif
+}
+
+JitEngine::~JitEngine()
+{
+#ifdef RGR_JIT_AVAILABLE
+    if (memory)
+        munmap(memory, memorySize);
+#endif
+}
+
+bool JitEngine::isAvailable()
+{
+#ifdef RGR_JIT_AVAILABLE
+    return true;
+#else
+    return false;
+#endif
+}
+
+void JitEngine::run(InputBuffer& input, OutputBuffer& output)
+{
+    JitContext context { &input, &output, "" };
+    long long status = reinterpret_cast<JitFunction>(memory)(frame.data(), &context);
+
+    if (status > 0)
+        execution_error("Division by zero", (size_t)status);
+    if (status < 0)
+        throw runtime_error(context.error);
+}
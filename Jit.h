@@ -0,0 +1,44 @@
+#ifndef RGR_JIT_H
+#define RGR_JIT_H
+
+#include "NativeCodegen.h"
+
+/*
+ * x86-64 JIT compiler.
+ *
+ * The typed program is translated to native code by the shared code generator and placed in memory mapped
+ * executable, "read" and "write" call the runtime buffers through small helpers.
+ *
+ * Runtime errors never unwind through generated code: helpers record them and the generated function
+ * returns a status the engine turns into the usual exception.
+ *
+ * The JIT is available on x86-64 Unix systems only, elsewhere, and when the code can't be mapped executable, the
+ * constructor throws CodegenUnsupported and the caller falls back to another engine.
+ */
+
+#if defined(__x86_64__) && defined(__unix__)
+#define RGR_JIT_AVAILABLE
+#endif
+
+class JitEngine
+{
+private:
+    std::vector<Value> frame;           // variables first, then float constants and loop limits
+    size_t variableCount;
+    void* memory;
+    size_t memorySize;
+public:
+    explicit JitEngine(const TypedProgram& program);
+    ~JitEngine();
+
+    JitEngine(const JitEngine&) = delete;
+    JitEngine& operator=(const JitEngine&) = delete;
+
+    static bool isAvailable();
+
+    void run(InputBuffer& input, OutputBuffer& output);
+    std::vector<Value> getVariables() { return std::vector<Value>(frame.begin(), frame.begin() + variableCount); }
+    size_t getCodeSize() { return memorySize; }
+};
+
+#endif //RGR_JIT_H
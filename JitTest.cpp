@@ -0,0 +1,115 @@
+#include "catch.hpp"
+#include "TestSupport.h"
+#include "Jit.h"
+#include "X86.h"
+
+using namespace std;
+
+namespace
+{
+    string runJit(string code, string input = "")
+    {
+        return run(JitEngine(lower(code)), input);
+    }
+}
+
+TEST_CASE( "x86 encoding", "[jit]" ) {
+    X86Assembler as;
+    as.mov(Reg::RAX, Reg::RCX);
+    as.alu(AluOp::Add, Reg::R12, 1);
+    as.load(Reg::RSI, Reg::RBX, 16);
+    as.movsd(XReg::XMM9, Reg::RBX, 8);
+    as.setcc(Cond::L, Reg::RSI);
+
+    Label label = as.newLabel();
+    as.bind(label);
+    as.jcc(Cond::NE, label);
+
+    vector<uint8_t> expected = {
+            0x48, 0x89, 0xC8,                       // mov rax, rcx
+            0x49, 0x83, 0xC4, 0x01,                 // add r12, 1
+            0x48, 0x8B, 0x73, 0x10,                 // mov rsi, [rbx + 16]
+            0xF2, 0x44, 0x0F, 0x10, 0x4B, 0x08,     // movsd xmm9, [rbx + 8]
+            0x40, 0x0F, 0x9C, 0xC6,                 // setl sil
+            0x48, 0x0F, 0xB6, 0xF6,                 // movzx rsi, sil
+            0x0F, 0x85, 0xFA, 0xFF, 0xFF, 0xFF,     // jne back to itself
+    };
+    REQUIRE (as.finish() == expected);
+}
+
+TEST_CASE( "JIT matches the VM", "[jit]" ) {
+    if (!JitEngine::isAvailable())
+        return;
+
+    vector<string> programs = {
+            "write(10 - 3 - 2, 7 / 2, (0 - 7) / 2, 7.0 / 2, 0ffh and 10b, not 0, not true, 3000000000 * 4)",
+            "dim a, b integer : a as 0 - 9223372036854775807 - 1 : b as 0 - 1 : write(a / b, a / (0 - 1), a * b)",
+            "dim i, s integer : for i as 1 to 100 do s as s + i * i : write(s, i)",
+            "dim i integer : for i as 5 to 1 do write(i) : write(i)",
+            "dim i, n integer : n as 3 : for i as n to n * 2 do n as n + 1 : write(i, n)",
+            "dim a integer : while a < 10 do a as a + 3 : write(a)",
+            "dim f float : dim i integer : for i as 1 to 4 do f as f + i / 2 : write(f, f > i, i < f, f <= 2.5, f >= i)",
+            "dim f, g float : f as 0.0 / 0.0 : g as 1.0 : write(f = f, f <> f, f < 1, g = g, g <> 2, 1 >= f)",
+            "dim f float : f as 0.0 / 0.0 : while f < 2.5 do f as 1 : if not (f >= 2) then write(f)",
+            "dim a, b, c, d, e, f integer : a as 1 : b as 2 : c as 3 : d as 4 : e as 5 : f as 6\n"
+            "write(a + b * (c - d / (e + f * (a - b))), (a < b) = (c > d), a or b and not c)",
+            "dim i, j, n integer\n"
+            "for i as 1 to 10 do\n"
+            "    for j as i to 10 do\n"
+            "        if i * j > 50 then n as n + 1 else if i = j then n as n - 1\n"
+            "write(n)",
+            "dim a, b integer : dim f float : dim c bool : read(a, b, f, c) : if c then write(a / b, f * a) else write(0)",
+    };
+
+    for (auto& program : programs)
+        REQUIRE (runJit(program, "7 2 1.5 true") == runVM(program, "7 2 1.5 true"));
+}
+
+TEST_CASE( "JIT compiles expressions deeper than its scratch registers", "[jit]" ) {
+    if (!JitEngine::isAvailable())
+        return;
+
+    vector<string> programs = {
+            "dim a integer : read(a) : write(a * (a + (a * (a + (a * (a + (a * (a + 1))))))))",
+            "dim a, b integer : read(a, b)\n"
+            "write(b - (a * (b + (a - (b * (a + (b - (a * (b + (a / (b - (a + 1))))))))))))",
+            "dim a, b integer : read(a, b) : write(a < (b + (a * (b - (a + (b * (a - (b + (a * (b - 1))))))))))",
+            "dim a, b integer : read(a, b) : write(a / (b - 5), a / (a + (b / (a - (b / (a + (b / (a - (b / (a + 1))))))))))",
+            "dim f, g float : read(f, g)\n"
+            "write(f * (g + (f * (g - (f * (g + (f * (g - (f * (g + (f * (g - (f * (g + (f * (g - (f * (g + (f / (g + 3))))))))))))))))))))",
+            "dim f, g float : read(f, g)\n"
+            "if f < (g + (f * (g - (f * (g + (f * (g - (f * (g + (f * (g - (f * (g + (f * (g - (f * (g + (g - 1)))))))))))))))))) then write(1)",
+    };
+
+    for (auto& program : programs)
+        REQUIRE (runJit(program, "3 -2") == runVM(program, "3 -2"));
+}
+
+TEST_CASE( "JIT state and errors", "[jit]" ) {
+    if (!JitEngine::isAvailable())
+        return;
+
+    TypedProgram program = lower("dim a, b, c, d, e integer : dim f float\n"
+                                 "a as 6 : f as a * 1.5 : b as a / 4 : c as 1 : d as 2 : e as c + d");
+    JitEngine engine(program);
+
+    InputBuffer in("");
+    OutputBuffer out;
+    engine.run(in, out);
+
+    vector<Value> variables = engine.getVariables();
+    REQUIRE (variables[0].i == 6);
+    REQUIRE (variables[1].i == 1);
+    REQUIRE (variables[4].i == 3);
+    REQUIRE (variables[5].f == 9.0);
+
+    REQUIRE (runJit("dim a integer\nwrite(1)\nwrite(1 / a)") == "1\nRuntime error on line 3: Division by zero");
+    REQUIRE (runJit("dim a integer : read(a)", "abc") == runVM("dim a integer : read(a)", "abc"));
+    REQUIRE (runJit("dim a integer : read(a)", "abc").find("line 1") != string::npos);
+
+    // the separator before a failing value isn't written
+    InputBuffer empty("");
+    OutputBuffer partial;
+    REQUIRE_THROWS (JitEngine(lower("dim a integer : write(3, 1.5, a / a)")).run(empty, partial));
+    REQUIRE (partial.str() == "3 1.5");
+}
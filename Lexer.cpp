@@ -3,7 +3,9 @@
 //
 
 #include "Lexer.h"
-#include <regex>
+#include "Trace.h"
+#include <functional>
+#include <set>
 #include <sstream>
 #include <map>
 using namespace std;
@@ -12,33 +14,98 @@ using namespace std;
 
 namespace
 {
-    map<TokenType, regex> regexps = {
-            { TokenType::relation_op, regex("<>|<=|>=|=|<|>") },
-            { TokenType::add_op, regex("or|\\+|-") },
-            { TokenType::mul_op, regex("and|\\*|/") },
-            { TokenType::un_op, regex("not") },
-            { TokenType::bool_const, regex("true|false") },
-            { TokenType::identifier, regex("[A-Za-z][A-Za-z0-9]*") },
-            { TokenType::int_number, regex("[0-1]+[bB]|[0-7]+[oO]|[0-9A-Fa-f]+[hH]|[0-9]+[dD]?") },
-            { TokenType::float_number, regex("[0-9]+[eE][\\+\\-]?[0-9]+|[0-9]*\\.[0-9]+([eE][\\+\\-]?[0-9]+)?")},
-            { TokenType::dim, regex("dim")},
-            { TokenType::type, regex("integer|float|bool")},
-            { TokenType::if_, regex("if")},
-            { TokenType::then_, regex("then")},
-            { TokenType::else_, regex("else")},
-            { TokenType::for_, regex("for")},
-            { TokenType::to_, regex("to")},
-            { TokenType::do_, regex("do")},
-            { TokenType::while_, regex("while")},
-            { TokenType::read_, regex("read")},
-            { TokenType::write_, regex("write")},
-            { TokenType::as_, regex("as")},
-            { TokenType::comma, regex(",") },
-            { TokenType::op_separator, regex(":|\n") },
-            { TokenType::openbr, regex("\\(") },
-            { TokenType::closebr, regex("\\)") },
-            { TokenType::begin, regex("begin") },
-            { TokenType::end, regex("end") },
+    function<bool(const string&)> oneOf(set<string> words)
+    {
+        return [words](const string& token) { return words.count(token) > 0; };
+    }
+
+    typedef bool (*CharClass)(char);
+
+    bool isLetter(char c) { return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'); }
+    bool isDecimal(char c) { return c >= '0' && c <= '9'; }
+    bool isBinary(char c) { return c == '0' || c == '1'; }
+    bool isOctal(char c) { return c >= '0' && c <= '7'; }
+    bool isHex(char c) { return isDecimal(c) || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f'); }
+    bool isLetterOrDigit(char c) { return isLetter(c) || isDecimal(c); }
+
+    // position after the characters of the class from the given one
+    size_t skip(const string& token, size_t from, CharClass charClass)
+    {
+        while (from < token.size() && charClass(token[from]))
+            from++;
+        return from;
+    }
+
+    // nonempty and of the class, but for the last character when it is the suffix
+    bool isNumberWithSuffix(const string& token, CharClass digits, char suffix)
+    {
+        return token.size() >= 2 && tolower(token.back()) == suffix && skip(token, 0, digits) == token.size() - 1;
+    }
+
+    // [0-1]+[bB]|[0-7]+[oO]|[0-9A-Fa-f]+[hH]|[0-9]+[dD]?
+    bool isIntNumber(const string& token)
+    {
+        return isNumberWithSuffix(token, isBinary, 'b') || isNumberWithSuffix(token, isOctal, 'o')
+               || isNumberWithSuffix(token, isHex, 'h') || isNumberWithSuffix(token, isDecimal, 'd')
+               || (!token.empty() && skip(token, 0, isDecimal) == token.size());
+    }
+
+    // [eE][\+\-]?[0-9]+ from the given position to the end
+    bool isExponent(const string& token, size_t from)
+    {
+        if (from == token.size() || tolower(token[from]) != 'e')
+            return false;
+        from++;
+        if (from < token.size() && (token[from] == '+' || token[from] == '-'))
+            from++;
+        return from < token.size() && skip(token, from, isDecimal) == token.size();
+    }
+
+    // [0-9]+[eE][\+\-]?[0-9]+|[0-9]*\.[0-9]+([eE][\+\-]?[0-9]+)?
+    bool isFloatNumber(const string& token)
+    {
+        size_t whole = skip(token, 0, isDecimal);
+        if (whole == token.size() || token[whole] != '.')
+            return whole > 0 && isExponent(token, whole);
+        size_t fraction = skip(token, whole + 1, isDecimal);
+        return fraction > whole + 1 && (fraction == token.size() || isExponent(token, fraction));
+    }
+
+    // [A-Za-z][A-Za-z0-9]*
+    bool isIdentifier(const string& token)
+    {
+        return !token.empty() && isLetter(token[0]) && skip(token, 1, isLetterOrDigit) == token.size();
+    }
+
+    // every token type is matched in one pass over the token, a backtracking regex would recurse once per character
+    // of a long token
+    map<TokenType, function<bool(const string&)>> matchers = {
+            { TokenType::relation_op, oneOf({ "<>", "<=", ">=", "=", "<", ">" }) },
+            { TokenType::add_op, oneOf({ "or", "+", "-" }) },
+            { TokenType::mul_op, oneOf({ "and", "*", "/" }) },
+            { TokenType::un_op, oneOf({ "not" }) },
+            { TokenType::bool_const, oneOf({ "true", "false" }) },
+            { TokenType::identifier, isIdentifier },
+            { TokenType::int_number, isIntNumber },
+            { TokenType::float_number, isFloatNumber },
+            { TokenType::dim, oneOf({ "dim" }) },
+            { TokenType::type, oneOf({ "integer", "float", "bool" }) },
+            { TokenType::if_, oneOf({ "if" }) },
+            { TokenType::then_, oneOf({ "then" }) },
+            { TokenType::else_, oneOf({ "else" }) },
+            { TokenType::for_, oneOf({ "for" }) },
+            { TokenType::to_, oneOf({ "to" }) },
+            { TokenType::do_, oneOf({ "do" }) },
+            { TokenType::while_, oneOf({ "while" }) },
+            { TokenType::read_, oneOf({ "read" }) },
+            { TokenType::write_, oneOf({ "write" }) },
+            { TokenType::as_, oneOf({ "as" }) },
+            { TokenType::comma, oneOf({ "," }) },
+            { TokenType::op_separator, oneOf({ ":", "\n" }) },
+            { TokenType::openbr, oneOf({ "(" }) },
+            { TokenType::closebr, oneOf({ ")" }) },
+            { TokenType::begin, oneOf({ "begin" }) },
+            { TokenType::end, oneOf({ "end" }) },
     };
 
     map<TokenType, string> dumpClasses = {
@@ -167,14 +234,15 @@ Token parseToken(string token, size_t line)
 {
     for (auto type: priorityList)
     {
-        if (regex_match(token, regexps[type]))
+        if (matchers[type](token))
             return Token(type, token, line);
     }
     throw std::runtime_error(token + " is not a valid token");
 }
 
-std::vector<Token> lexString(std::string str)
+std::vector<Token> scanTokens(std::string str)
 {
+    TraceSpan span("scanTokens");
     size_t ptr = 0, line = 1;
     string nextToken;
     vector<Token> tokens;
@@ -189,6 +257,12 @@ std::vector<Token> lexString(std::string str)
             line++;
     }
 
+    return tokens;
+}
+
+std::vector<Token> dropRedundantSeparators(const std::vector<Token>& tokens)
+{
+    TraceSpan span("dropRedundantSeparators");
     vector<Token> result;
     for (size_t i = 0; i < tokens.size(); i++)
     {
@@ -200,6 +274,11 @@ std::vector<Token> lexString(std::string str)
     return result;
 }
 
+std::vector<Token> lexString(std::string str)
+{
+    return dropRedundantSeparators(scanTokens(str));
+}
+
 std::ostream& operator<<(std::ostream& stream, const Token& t)
 {
     return stream << " { " << dumpClasses[t.type] << ", " << t.content << ", " << t.line << " } ";
@@ -25,6 +25,11 @@ struct Token
 };
 
 Token parseToken(std::string token, size_t line = 1);
+// every token of the source
+std::vector<Token> scanTokens(std::string str);
+// separators before another separator, "end" or the end of the source say nothing and are left out
+std::vector<Token> dropRedundantSeparators(const std::vector<Token>& tokens);
+// both of the above
 std::vector<Token> lexString(std::string str);
 
 std::ostream& operator<<(std::ostream& stream, const Token& t);
@@ -4,6 +4,8 @@
 
 #include "catch.hpp"
 #include "Lexer.h"
+#include <random>
+#include <regex>
 
 using namespace std;
 
@@ -190,4 +192,54 @@ TEST_CASE ( "lexing whole string test", "[lexString]" ) {
         REQUIRE(lexString("{if a > b then c as b - a else c as a - b}\n3") == expected3);
 
     }
-}
\ No newline at end of file
+}
+TEST_CASE( "token types match the regular grammar", "[parseToken]" ) {
+    // the token grammar the lexer once matched with std::regex, in the same priority
+    vector<pair<TokenType, regex>> grammar = {
+            { TokenType::begin, regex("begin") }, { TokenType::end, regex("end") },
+            { TokenType::openbr, regex("\\(") }, { TokenType::closebr, regex("\\)") },
+            { TokenType::op_separator, regex(":|\n") }, { TokenType::bool_const, regex("true|false") },
+            { TokenType::if_, regex("if") }, { TokenType::then_, regex("then") }, { TokenType::else_, regex("else") },
+            { TokenType::for_, regex("for") }, { TokenType::to_, regex("to") }, { TokenType::do_, regex("do") },
+            { TokenType::dim, regex("dim") }, { TokenType::while_, regex("while") }, { TokenType::read_, regex("read") },
+            { TokenType::write_, regex("write") }, { TokenType::as_, regex("as") }, { TokenType::un_op, regex("not") },
+            { TokenType::type, regex("integer|float|bool") }, { TokenType::comma, regex(",") },
+            { TokenType::relation_op, regex("<>|<=|>=|=|<|>") }, { TokenType::add_op, regex("or|\\+|-") },
+            { TokenType::mul_op, regex("and|\\*|/") },
+            { TokenType::int_number, regex("[0-1]+[bB]|[0-7]+[oO]|[0-9A-Fa-f]+[hH]|[0-9]+[dD]?") },
+            { TokenType::float_number, regex("[0-9]+[eE][\\+\\-]?[0-9]+|[0-9]*\\.[0-9]+([eE][\\+\\-]?[0-9]+)?") },
+            { TokenType::identifier, regex("[A-Za-z][A-Za-z0-9]*") },
+    };
+
+    vector<string> tokens = { "", "0", "1b", "2b", "17o", "8o", "0ffh", "ffh", "h", "12d", "d", "1.", ".5", "1.5e", "1.5e+3",
+                              "1e5", "1e", "e5", ".e5", "1.e5", "<>", "=<", "a1", "1a", "integerx", "andor", "\n\n" };
+    mt19937 random(1);
+    const char alphabet[] = "01789abdefhoABDEFHO.+-<>=*/:()\n,xyz";
+    for (int i = 0; i < 20000; i++)
+    {
+        string token;
+        size_t length = random() % 6 + 1;
+        for (size_t j = 0; j < length; j++)
+            token += alphabet[random() % (sizeof(alphabet) - 1)];
+        tokens.push_back(token);
+    }
+    for (auto word : { "begin", "end", "true", "false", "if", "then", "else", "for", "to", "do", "dim", "while", "read",
+                       "write", "as", "not", "integer", "float", "bool", "or", "and" })
+        tokens.push_back(word);
+
+    for (auto& token : tokens)
+    {
+        auto type = find_if(grammar.begin(), grammar.end(), [&](const pair<TokenType, regex>& rule) {
+            return regex_match(token, rule.second);
+        });
+        if (type == grammar.end())
+            REQUIRE_THROWS (parseToken(token));
+        else
+            REQUIRE ((parseToken(token).type == type->first));
+    }
+
+    // long tokens take time in proportion to their length
+    REQUIRE (parseToken(string(1 << 20, 'a')).type == TokenType::identifier);
+    REQUIRE (parseToken(string(1 << 20, '1') + "e+5").type == TokenType::float_number);
+    REQUIRE_THROWS (parseToken(string(1 << 20, '1') + "x"));
+}
@@ -0,0 +1,838 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include "NativeCodegen.h"
+using namespace std;
+
+namespace
+{
+    // RAX and RDX are left out for division, RBX holds the frame and RBP the context
+    const Reg intScratch[] = { Reg::RCX, Reg::RSI, Reg::RDI, Reg::R8, Reg::R9, Reg::R10, Reg::R11 };
+    const Reg variableRegisters[] = { Reg::R12, Reg::R13, Reg::R14, Reg::R15 };
+    const size_t intScratchCount = sizeof(intScratch) / sizeof(intScratch[0]);
+    const size_t variableRegisterCount = sizeof(variableRegisters) / sizeof(variableRegisters[0]);
+    const size_t floatScratchCount = 16;
+
+    // first free integer and float scratch registers
+    struct Depth
+    {
+        size_t i, f;
+    };
+
+    struct IntOperand
+    {
+        enum Kind { Register, Memory, Immediate } kind;
+        Reg reg;
+        int32_t value;      // displacement or immediate
+    };
+
+    struct FloatOperand
+    {
+        bool memory;
+        XReg reg;
+        int32_t displacement;
+    };
+
+    int32_t displacement(size_t slot) { return (int32_t)(slot * sizeof(Value)); }
+
+    bool fitsImmediate(ExprPtr expr)
+    {
+        return (expr->kind == ExprKind::IntConst || expr->kind == ExprKind::BoolConst) && expr->intValue == (int32_t)expr->intValue;
+    }
+
+    Cond intCondition(BinaryOp op)
+    {
+        switch (op)
+        {
+            case BinaryOp::Less: return Cond::L;
+            case BinaryOp::Greater: return Cond::G;
+            case BinaryOp::LessEqual: return Cond::LE;
+            case BinaryOp::GreaterEqual: return Cond::GE;
+            case BinaryOp::Equal: return Cond::E;
+            default: return Cond::NE;
+        }
+    }
+
+    class NativeCompiler
+    {
+    private:
+        const TypedProgram& program;
+        X86Assembler& as;
+        vector<Value>& frame;
+        HelperCalls& calls;
+
+        vector<int> registerOf;                         // index in variableRegisters, -1 for variables in the frame
+        map<long long, size_t> floatConstants;          // bit pattern to frame slot
+        vector<pair<Label, size_t>> divisionErrors;
+        Label exitLabel, helperErrorLabel;
+        int writeSlot;                                  // frame slot keeping a written value across the separator, -1 until needed
+        int borrowSlot;                                 // frame slot keeping a scratch register borrowed as a divisor
+        vector<size_t> spillSlots;                      // frame slots of operands spilled when the scratch registers run out
+        size_t spilled;                                 // spill slots in use
+
+        // operands get a register of the next depth only while one is left, see spilledIntOperand
+        Reg intRegister(size_t depth)
+        {
+            assert(depth < intScratchCount);
+            return intScratch[depth];
+        }
+
+        XReg floatRegister(size_t depth)
+        {
+            assert(depth < floatScratchCount);
+            return (XReg)depth;
+        }
+
+        size_t newFrameSlot()
+        {
+            Value zero;
+            zero.i = 0;
+            frame.push_back(zero);
+            return frame.size() - 1;
+        }
+
+        // spill slots nest like the expressions spilling to them, the deepest one is freed first
+        int32_t spill()
+        {
+            if (spilled == spillSlots.size())
+                spillSlots.push_back(newFrameSlot());
+            return displacement(spillSlots[spilled++]);
+        }
+
+        void unspill()
+        {
+            spilled--;
+        }
+
+        bool needsRegister(ExprPtr expr)
+        {
+            return !fitsImmediate(expr) && expr->kind != ExprKind::Variable && expr->kind != ExprKind::FloatConst;
+        }
+
+        bool inRegister(size_t slot) { return registerOf[slot] >= 0; }
+        Reg variableRegister(size_t slot) { return variableRegisters[registerOf[slot]]; }
+
+        size_t floatConstantSlot(double value)
+        {
+            long long bits;
+            memcpy(&bits, &value, sizeof(bits));
+
+            auto it = floatConstants.find(bits);
+            if (it != floatConstants.end())
+                return it->second;
+
+            Value constant;
+            constant.f = value;
+            frame.push_back(constant);
+            floatConstants[bits] = frame.size() - 1;
+            return frame.size() - 1;
+        }
+
+        // loops weigh their uses more, so the variables of inner loops get the registers
+        void countUses(ExprPtr expr, long long weight, vector<long long>& uses)
+        {
+            if (!expr)
+                return;
+            if (expr->kind == ExprKind::Variable)
+                uses[expr->slot] += weight;
+            countUses(expr->left, weight, uses);
+            countUses(expr->right, weight, uses);
+        }
+
+        void countUses(StmtPtr stmt, long long weight, vector<long long>& uses)
+        {
+            if (!stmt)
+                return;
+
+            long long inner = stmt->kind == StmtKind::While || stmt->kind == StmtKind::For ? min(weight * 16, 1LL << 40) : weight;
+            if (stmt->kind == StmtKind::Assign || stmt->kind == StmtKind::For)
+                uses[stmt->slot] += inner;
+            for (auto slot : stmt->slots)
+                uses[slot] += weight;
+
+            countUses(stmt->value, stmt->kind == StmtKind::While ? inner : weight, uses);
+            countUses(stmt->limit, weight, uses);
+            for (auto& value : stmt->values)
+                countUses(value, weight, uses);
+
+            countUses(stmt->body, inner, uses);
+            countUses(stmt->elseBody, inner, uses);
+            for (auto& statement : stmt->statements)
+                countUses(statement, weight, uses);
+        }
+
+        void allocateRegisters()
+        {
+            size_t count = program.variables.size();
+            vector<long long> uses(count, 0);
+            countUses(program.body, 1, uses);
+
+            vector<size_t> candidates;
+            for (size_t slot = 0; slot < count; slot++)
+                if (program.variables[slot].type != DataType::Float && uses[slot] > 0)
+                    candidates.push_back(slot);
+
+            stable_sort(candidates.begin(), candidates.end(), [&](size_t a, size_t b) { return uses[a] > uses[b]; });
+
+            registerOf.assign(count, -1);
+            for (size_t i = 0; i < candidates.size() && i < variableRegisterCount; i++)
+                registerOf[candidates[i]] = (int)i;
+        }
+
+        void loadInt(Reg destination, size_t slot)
+        {
+            if (inRegister(slot))
+                as.mov(destination, variableRegister(slot));
+            else
+                as.load(destination, Reg::RBX, displacement(slot));
+        }
+
+        IntOperand intOperand(ExprPtr expr, Depth depth)
+        {
+            if (fitsImmediate(expr))
+                return { IntOperand::Immediate, Reg::RAX, (int32_t)expr->intValue };
+
+            if (expr->kind == ExprKind::Variable)
+            {
+                if (inRegister(expr->slot))
+                    return { IntOperand::Register, variableRegister(expr->slot), 0 };
+                return { IntOperand::Memory, Reg::RBX, displacement(expr->slot) };
+            }
+
+            compileInt(expr, depth);
+            return { IntOperand::Register, intRegister(depth.i), 0 };
+        }
+
+        // no scratch register is left for the right operand: the left one waits in the frame while the right one is
+        // computed in the same register, then the two trade places through RAX. The slot is freed at once, as the
+        // operand is used before anything else spills.
+        IntOperand spilledIntOperand(ExprPtr right, Depth depth)
+        {
+            Reg destination = intRegister(depth.i);
+            int32_t slot = spill();
+            as.store(Reg::RBX, slot, destination);
+            compileInt(right, depth);
+            as.load(Reg::RAX, Reg::RBX, slot);
+            as.store(Reg::RBX, slot, destination);
+            as.mov(destination, Reg::RAX);
+            unspill();
+            return { IntOperand::Memory, Reg::RBX, slot };
+        }
+
+        void apply(AluOp op, Reg destination, const IntOperand& operand)
+        {
+            if (operand.kind == IntOperand::Register)
+                as.alu(op, destination, operand.reg);
+            else if (operand.kind == IntOperand::Memory)
+                as.alu(op, destination, Reg::RBX, operand.value);
+            else
+                as.alu(op, destination, operand.value);
+        }
+
+        void multiply(Reg destination, const IntOperand& operand)
+        {
+            if (operand.kind == IntOperand::Register)
+                as.imul(destination, operand.reg);
+            else if (operand.kind == IntOperand::Memory)
+                as.imul(destination, Reg::RBX, operand.value);
+            else
+                as.imul(destination, operand.value);
+        }
+
+        // same semantics as divideInt: a zero divisor is an error, a divisor of -1 negates with wrapping
+        void divide(Reg dividend, const IntOperand& operand, Depth depth, size_t line)
+        {
+            Reg divisor = operand.reg;
+            bool checked = false, borrowed = false;
+
+            if (operand.kind == IntOperand::Immediate)
+            {
+                if (operand.value == -1)
+                {
+                    as.neg(dividend);
+                    return;
+                }
+                checked = operand.value != 0;
+            }
+
+            if (operand.kind != IntOperand::Register)
+            {
+                // past the last scratch register the first one is borrowed and given back after the division
+                borrowed = depth.i == intScratchCount;
+                divisor = intRegister(borrowed ? 0 : depth.i);
+                assert(divisor != dividend);
+                if (borrowed)
+                {
+                    if (borrowSlot < 0)
+                        borrowSlot = (int)newFrameSlot();
+                    as.store(Reg::RBX, displacement(borrowSlot), divisor);
+                }
+                if (operand.kind == IntOperand::Memory)
+                    as.load(divisor, Reg::RBX, operand.value);
+                else
+                    as.mov(divisor, (long long)operand.value);
+            }
+
+            Label done = as.newLabel();
+            if (!checked)
+            {
+                Label error = as.newLabel(), regular = as.newLabel();
+                divisionErrors.push_back(make_pair(error, line));
+
+                as.test(divisor, divisor);
+                as.jcc(Cond::E, error);
+                as.alu(AluOp::Cmp, divisor, -1);
+                as.jcc(Cond::NE, regular);
+                as.neg(dividend);
+                as.jmp(done);
+                as.bind(regular);
+            }
+
+            as.mov(Reg::RAX, dividend);
+            as.cqo();
+            as.idiv(divisor);
+            as.mov(dividend, Reg::RAX);
+            as.bind(done);
+            if (borrowed)
+                as.load(divisor, Reg::RBX, displacement(borrowSlot));
+        }
+
+        FloatOperand floatOperand(ExprPtr expr, Depth depth)
+        {
+            if (expr->kind == ExprKind::Variable)
+                return { true, XReg::XMM0, displacement(expr->slot) };
+            if (expr->kind == ExprKind::FloatConst)
+                return { true, XReg::XMM0, displacement(floatConstantSlot(expr->floatValue)) };
+
+            compileFloat(expr, depth);
+            return { false, floatRegister(depth.f), 0 };
+        }
+
+        // as spilledIntOperand, the float registers trade places through RAX
+        FloatOperand spilledFloatOperand(ExprPtr right, Depth depth)
+        {
+            XReg destination = floatRegister(depth.f);
+            int32_t slot = spill();
+            as.movsd(Reg::RBX, slot, destination);
+            compileFloat(right, depth);
+            as.movq(Reg::RAX, destination);
+            as.movsd(destination, Reg::RBX, slot);
+            as.store(Reg::RBX, slot, Reg::RAX);
+            unspill();
+            return { true, XReg::XMM0, slot };
+        }
+
+        // the right operand of a float operation, whose left one is in the register of the depth
+        FloatOperand rightFloatOperand(ExprPtr right, Depth depth)
+        {
+            if (depth.f + 1 == floatScratchCount && needsRegister(right))
+                return spilledFloatOperand(right, depth);
+            return floatOperand(right, { depth.i, depth.f + 1 });
+        }
+
+        // compares the operands of a float comparison other than equality, the result is the returned condition
+        // in the A/AE form, which is false for unordered operands
+        Cond compareFloats(ExprPtr expr, Depth depth)
+        {
+            XReg left = floatRegister(depth.f);
+            compileFloat(expr->left, depth);
+
+            if (expr->op == BinaryOp::Less || expr->op == BinaryOp::LessEqual)
+            {
+                Cond cond = expr->op == BinaryOp::Less ? Cond::A : Cond::AE;
+                if (depth.f + 1 == floatScratchCount)
+                {
+                    // the right operand is computed over the spilled left one and compared with it in the frame
+                    int32_t slot = spill();
+                    as.movsd(Reg::RBX, slot, left);
+                    compileFloat(expr->right, depth);
+                    as.ucomisd(left, Reg::RBX, slot);
+                    unspill();
+                    return cond;
+                }
+
+                XReg right = floatRegister(depth.f + 1);
+                compileFloat(expr->right, { depth.i, depth.f + 1 });
+                as.ucomisd(right, left);
+                return cond;
+            }
+
+            FloatOperand operand = rightFloatOperand(expr->right, depth);
+            if (operand.memory)
+                as.ucomisd(left, Reg::RBX, operand.displacement);
+            else
+                as.ucomisd(left, operand.reg);
+
+            switch (expr->op)
+            {
+                case BinaryOp::Greater: return Cond::A;
+                case BinaryOp::GreaterEqual: return Cond::AE;
+                case BinaryOp::Equal: return Cond::E;
+                default: return Cond::NE;
+            }
+        }
+
+        void compileInt(ExprPtr expr, Depth depth)
+        {
+            Reg destination = intRegister(depth.i);
+
+            switch (expr->kind)
+            {
+                case ExprKind::IntConst:
+                case ExprKind::BoolConst:
+                    as.mov(destination, expr->intValue);
+                    return;
+
+                case ExprKind::Variable:
+                    loadInt(destination, expr->slot);
+                    return;
+
+                case ExprKind::Not:
+                    compileInt(expr->left, depth);
+                    if (expr->type == DataType::Integer)
+                        as.notReg(destination);
+                    else
+                        as.alu(AluOp::Xor, destination, 1);
+                    return;
+
+                default:
+                    assert(expr->kind == ExprKind::Binary);
+                    break;
+            }
+
+            if (isComparison(expr->op) && expr->left->type == DataType::Float)
+            {
+                Cond cond = compareFloats(expr, depth);
+                as.setcc(cond, destination);
+
+                // unordered operands set ZF, so equality also needs the parity flag
+                if (expr->op == BinaryOp::Equal)
+                {
+                    as.setcc(Cond::NP, Reg::RAX);
+                    as.alu(AluOp::And, destination, Reg::RAX);
+                }
+                else if (expr->op == BinaryOp::NotEqual)
+                {
+                    as.setcc(Cond::P, Reg::RAX);
+                    as.alu(AluOp::Or, destination, Reg::RAX);
+                }
+                return;
+            }
+
+            compileInt(expr->left, depth);
+            IntOperand operand = depth.i + 1 == intScratchCount && needsRegister(expr->right)
+                                 ? spilledIntOperand(expr->right, depth) : intOperand(expr->right, { depth.i + 1, depth.f });
+
+            if (isComparison(expr->op))
+            {
+                apply(AluOp::Cmp, destination, operand);
+                as.setcc(intCondition(expr->op), destination);
+                return;
+            }
+
+            switch (expr->op)
+            {
+                case BinaryOp::Add: apply(AluOp::Add, destination, operand); break;
+                case BinaryOp::Sub: apply(AluOp::Sub, destination, operand); break;
+                case BinaryOp::And: apply(AluOp::And, destination, operand); break;
+                case BinaryOp::Or: apply(AluOp::Or, destination, operand); break;
+                case BinaryOp::Mul: multiply(destination, operand); break;
+                default: divide(destination, operand, { depth.i + 1, depth.f }, expr->line); break;
+            }
+        }
+
+        void compileFloat(ExprPtr expr, Depth depth)
+        {
+            XReg destination = floatRegister(depth.f);
+
+            switch (expr->kind)
+            {
+                case ExprKind::FloatConst:
+                    if (expr->floatValue == 0 && !signbit(expr->floatValue))
+                        as.xorpd(destination, destination);
+                    else
+                        as.movsd(destination, Reg::RBX, displacement(floatConstantSlot(expr->floatValue)));
+                    return;
+
+                case ExprKind::Variable:
+                    as.movsd(destination, Reg::RBX, displacement(expr->slot));
+                    return;
+
+                case ExprKind::IntToFloat:
+                {
+                    ExprPtr operand = expr->left;
+                    if (operand->kind == ExprKind::Variable && inRegister(operand->slot))
+                    {
+                        as.xorpd(destination, destination);
+                        as.cvtsi2sd(destination, variableRegister(operand->slot));
+                    }
+                    else if (operand->kind == ExprKind::Variable)
+                    {
+                        as.xorpd(destination, destination);
+                        as.cvtsi2sd(destination, Reg::RBX, displacement(operand->slot));
+                    }
+                    else
+                    {
+                        compileInt(operand, depth);
+                        as.xorpd(destination, destination);
+                        as.cvtsi2sd(destination, intRegister(depth.i));
+                    }
+                    return;
+                }
+
+                default:
+                    assert(expr->kind == ExprKind::Binary);
+                    break;
+            }
+
+            compileFloat(expr->left, depth);
+            FloatOperand operand = rightFloatOperand(expr->right, depth);
+
+            SseOp op;
+            switch (expr->op)
+            {
+                case BinaryOp::Add: op = SseOp::Add; break;
+                case BinaryOp::Sub: op = SseOp::Sub; break;
+                case BinaryOp::Mul: op = SseOp::Mul; break;
+                default: op = SseOp::Div; break;
+            }
+
+            if (operand.memory)
+                as.sseOp(op, destination, Reg::RBX, operand.displacement);
+            else
+                as.sseOp(op, destination, operand.reg);
+        }
+
+        // jumps to target when the condition evaluates to "when", comparisons set the flags directly
+        void branch(ExprPtr condition, bool when, Label target)
+        {
+            Depth depth = { 0, 0 };
+
+            if (condition->kind == ExprKind::BoolConst)
+            {
+                if ((condition->intValue != 0) == when)
+                    as.jmp(target);
+                return;
+            }
+
+            if (condition->kind == ExprKind::Not)
+            {
+                branch(condition->left, !when, target);
+                return;
+            }
+
+            if (condition->kind == ExprKind::Binary && isComparison(condition->op))
+            {
+                if (condition->left->type == DataType::Float)
+                {
+                    if (condition->op != BinaryOp::Equal && condition->op != BinaryOp::NotEqual)
+                    {
+                        // B and BE hold for unordered operands, so the negated branch is taken for NaN
+                        Cond cond = compareFloats(condition, depth);
+                        as.jcc(when ? cond : inverse(cond), target);
+                        return;
+                    }
+                }
+                else
+                {
+                    Reg left = intRegister(0);
+                    if (condition->left->kind == ExprKind::Variable && inRegister(condition->left->slot))
+                        left = variableRegister(condition->left->slot);
+                    else
+                        compileInt(condition->left, depth);
+
+                    apply(AluOp::Cmp, left, intOperand(condition->right, { 1, 0 }));
+                    Cond cond = intCondition(condition->op);
+                    as.jcc(when ? cond : inverse(cond), target);
+                    return;
+                }
+            }
+
+            compileInt(condition, depth);
+            as.test(intRegister(0), intRegister(0));
+            as.jcc(when ? Cond::NE : Cond::E, target);
+        }
+
+        void callHelper(RuntimeHelper helper)
+        {
+            calls.call(as, helper);
+        }
+
+        void compileAssignment(size_t slot, ExprPtr value)
+        {
+            if (value->type == DataType::Float)
+            {
+                compileFloat(value, { 0, 0 });
+                as.movsd(Reg::RBX, displacement(slot), XReg::XMM0);
+                return;
+            }
+
+            if (!inRegister(slot))
+            {
+                compileInt(value, { 0, 0 });
+                as.store(Reg::RBX, displacement(slot), intRegister(0));
+                return;
+            }
+
+            // "a as a op b" updates the register in place
+            Reg target = variableRegister(slot);
+            if (value->kind == ExprKind::Binary && value->left->kind == ExprKind::Variable && value->left->slot == slot)
+            {
+                switch (value->op)
+                {
+                    case BinaryOp::Add: apply(AluOp::Add, target, intOperand(value->right, { 0, 0 })); return;
+                    case BinaryOp::Sub: apply(AluOp::Sub, target, intOperand(value->right, { 0, 0 })); return;
+                    case BinaryOp::And: apply(AluOp::And, target, intOperand(value->right, { 0, 0 })); return;
+                    case BinaryOp::Or: apply(AluOp::Or, target, intOperand(value->right, { 0, 0 })); return;
+                    case BinaryOp::Mul: multiply(target, intOperand(value->right, { 0, 0 })); return;
+                    default: break;
+                }
+            }
+
+            compileInt(value, { 0, 0 });
+            as.mov(target, intRegister(0));
+        }
+
+        void compareCounter(size_t slot, const IntOperand& limit)
+        {
+            if (inRegister(slot))
+            {
+                apply(AluOp::Cmp, variableRegister(slot), limit);
+                return;
+            }
+
+            as.load(intRegister(0), Reg::RBX, displacement(slot));
+            apply(AluOp::Cmp, intRegister(0), limit);
+        }
+
+        void compileFor(StmtPtr stmt)
+        {
+            size_t slot = stmt->slot;
+            compileAssignment(slot, stmt->value);
+
+            IntOperand limit;
+            if (fitsImmediate(stmt->limit))
+                limit = { IntOperand::Immediate, Reg::RAX, (int32_t)stmt->limit->intValue };
+            else
+            {
+                Value zero;
+                zero.i = 0;
+                frame.push_back(zero);
+
+                compileInt(stmt->limit, { 0, 0 });
+                as.store(Reg::RBX, displacement(frame.size() - 1), intRegister(0));
+                limit = { IntOperand::Memory, Reg::RBX, displacement(frame.size() - 1) };
+            }
+
+            Label body = as.newLabel(), end = as.newLabel();
+            compareCounter(slot, limit);
+            as.jcc(Cond::G, end);
+
+            as.bind(body);
+            compileStmt(stmt->body);
+
+            if (inRegister(slot))
+                as.alu(AluOp::Add, variableRegister(slot), 1);
+            else
+                as.aluMemory(AluOp::Add, Reg::RBX, displacement(slot), 1);
+            compareCounter(slot, limit);
+            as.jcc(Cond::LE, body);
+            as.bind(end);
+        }
+
+        void compileRead(StmtPtr stmt)
+        {
+            for (auto slot : stmt->slots)
+            {
+                RuntimeHelper helper;
+                switch (program.variables[slot].type)
+                {
+                    case DataType::Integer: helper = RuntimeHelper::ReadInt; break;
+                    case DataType::Float: helper = RuntimeHelper::ReadFloat; break;
+                    default: helper = RuntimeHelper::ReadBool; break;
+                }
+
+                as.lea(Reg::RSI, Reg::RBX, displacement(slot));
+                as.mov(Reg::RDX, (long long)stmt->line);
+                callHelper(helper);
+                as.test32(Reg::RAX, Reg::RAX);
+                as.jcc(Cond::NE, helperErrorLabel);
+
+                if (inRegister(slot))
+                    as.load(variableRegister(slot), Reg::RBX, displacement(slot));
+            }
+        }
+
+        void writeChar(char c)
+        {
+            as.mov(Reg::RSI, (long long)c);
+            callHelper(RuntimeHelper::WriteChar);
+        }
+
+        void compileWrite(StmtPtr stmt)
+        {
+            for (size_t i = 0; i < stmt->values.size(); i++)
+            {
+                ExprPtr value = stmt->values[i];
+                bool isFloat = value->type == DataType::Float;
+                if (isFloat)
+                    compileFloat(value, { 0, 0 });
+                else
+                {
+                    compileInt(value, { 0, 0 });
+                    as.mov(Reg::RSI, intRegister(0));
+                }
+
+                // the separator is written once the value is computed, as the VM does, the value waits in the frame
+                if (i > 0)
+                {
+                    if (writeSlot < 0)
+                    {
+                        Value zero;
+                        zero.i = 0;
+                        frame.push_back(zero);
+                        writeSlot = (int)frame.size() - 1;
+                    }
+
+                    if (isFloat)
+                        as.movsd(Reg::RBX, displacement(writeSlot), XReg::XMM0);
+                    else
+                        as.store(Reg::RBX, displacement(writeSlot), Reg::RSI);
+                    writeChar(' ');
+                    if (isFloat)
+                        as.movsd(XReg::XMM0, Reg::RBX, displacement(writeSlot));
+                    else
+                        as.load(Reg::RSI, Reg::RBX, displacement(writeSlot));
+                }
+
+                callHelper(isFloat ? RuntimeHelper::WriteFloat
+                                   : value->type == DataType::Bool ? RuntimeHelper::WriteBool : RuntimeHelper::WriteInt);
+            }
+            writeChar('\n');
+        }
+
+        void compileStmt(StmtPtr stmt)
+        {
+            switch (stmt->kind)
+            {
+                case StmtKind::Assign:
+                    compileAssignment(stmt->slot, stmt->value);
+                    break;
+
+                case StmtKind::If:
+                {
+                    Label elseLabel = as.newLabel();
+                    branch(stmt->value, false, elseLabel);
+                    compileStmt(stmt->body);
+                    if (stmt->elseBody)
+                    {
+                        Label end = as.newLabel();
+                        as.jmp(end);
+                        as.bind(elseLabel);
+                        compileStmt(stmt->elseBody);
+                        as.bind(end);
+                    }
+                    else
+                        as.bind(elseLabel);
+                    break;
+                }
+
+                case StmtKind::While:
+                {
+                    Label body = as.newLabel(), test = as.newLabel();
+                    as.jmp(test);
+                    as.bind(body);
+                    compileStmt(stmt->body);
+                    as.bind(test);
+                    branch(stmt->value, true, body);
+                    break;
+                }
+
+                case StmtKind::For:
+                    compileFor(stmt);
+                    break;
+
+                case StmtKind::Read:
+                    compileRead(stmt);
+                    break;
+
+                case StmtKind::Write:
+                    compileWrite(stmt);
+                    break;
+
+                case StmtKind::Block:
+                    for (auto& statement : stmt->statements)
+                        compileStmt(statement);
+                    break;
+            }
+        }
+
+        void moveVariables(bool load)
+        {
+            for (size_t slot = 0; slot < registerOf.size(); slot++)
+            {
+                if (!inRegister(slot))
+                    continue;
+                if (load)
+                    as.load(variableRegister(slot), Reg::RBX, displacement(slot));
+                else
+                    as.store(Reg::RBX, displacement(slot), variableRegister(slot));
+            }
+        }
+    public:
+        NativeCompiler(const TypedProgram& _program, X86Assembler& _as, vector<Value>& _frame, HelperCalls& _calls)
+                : program(_program), as(_as), frame(_frame), calls(_calls), writeSlot(-1), borrowSlot(-1), spilled(0) {}
+
+        void compile()
+        {
+            allocateRegisters();
+            exitLabel = as.newLabel();
+            helperErrorLabel = as.newLabel();
+
+            // six pushes and the return address, the extra 8 bytes align the stack for helper calls
+            as.push(Reg::RBX);
+            as.push(Reg::RBP);
+            as.push(Reg::R12);
+            as.push(Reg::R13);
+            as.push(Reg::R14);
+            as.push(Reg::R15);
+            as.alu(AluOp::Sub, Reg::RSP, 8);
+            as.mov(Reg::RBX, Reg::RDI);
+            as.mov(Reg::RBP, Reg::RSI);
+            moveVariables(true);
+
+            compileStmt(program.body);
+            as.mov(Reg::RAX, 0LL);
+
+            as.bind(exitLabel);
+            moveVariables(false);
+            as.alu(AluOp::Add, Reg::RSP, 8);
+            as.pop(Reg::R15);
+            as.pop(Reg::R14);
+            as.pop(Reg::R13);
+            as.pop(Reg::R12);
+            as.pop(Reg::RBP);
+            as.pop(Reg::RBX);
+            as.ret();
+
+            for (auto& error : divisionErrors)
+            {
+                as.bind(error.first);
+                as.mov(Reg::RAX, (long long)error.second);
+                as.jmp(exitLabel);
+            }
+
+            as.bind(helperErrorLabel);
+            as.mov(Reg::RAX, -1LL);
+            as.jmp(exitLabel);
+
+        }
+    };
+}
+
+void compileNative(const TypedProgram& program, X86Assembler& as, vector<Value>& frame, HelperCalls& calls)
+{
+    NativeCompiler(program, as, frame, calls).compile();
+}
@@ -0,0 +1,42 @@
+#ifndef RGR_NATIVECODEGEN_H
+#define RGR_NATIVECODEGEN_H
+
+#include "TypedTree.h"
+#include "Runtime.h"
+#include "X86.h"
+
+/*
+ * x86-64 code generator shared by the JIT and the executable builder.
+ *
+ * The program becomes a function "long long (Value* frame, void* context)". The most used integer and bool
+ * variables live in callee-saved registers, the rest of the variables, float constants and "for" limits live
+ * in the frame addressed from RBX, the context stays in RBP. Expressions are evaluated in scratch general
+ * purpose and SSE registers, operands nested deeper than there are registers wait in frame slots, loops become
+ * native loops closed by a compare and branch.
+ *
+ * "read" and "write" call runtime helpers, the way they are reached is up to the backend. The function returns 0
+ * on success, -1 when a read helper reports a failure and the line of a division by zero otherwise.
+ */
+
+enum class RuntimeHelper { ReadInt, ReadFloat, ReadBool, WriteInt, WriteFloat, WriteBool, WriteChar };
+
+// helpers follow the System V calling convention: RDI gets the context, RSI the value (XMM0 for floats)
+// or the address of the variable to read, RDX the line, read helpers return 0 in EAX on success
+class HelperCalls
+{
+public:
+    virtual ~HelperCalls() {}
+    virtual void call(X86Assembler& as, RuntimeHelper helper) = 0;
+};
+
+// thrown for programs the backend can't compile, the caller falls back to another engine
+class CodegenUnsupported : public std::runtime_error
+{
+public:
+    explicit CodegenUnsupported(const std::string& what) : std::runtime_error(what) {}
+};
+
+// emits the function at the current position, float constants, loop limits and spill slots are appended to the frame
+void compileNative(const TypedProgram& program, X86Assembler& as, std::vector<Value>& frame, HelperCalls& calls);
+
+#endif //RGR_NATIVECODEGEN_H
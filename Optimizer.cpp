@@ -0,0 +1,952 @@
+#include "Optimizer.h"
+#include "Trace.h"
+#include "Runtime.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <tuple>
+using namespace std;
+
+namespace
+{
+    bool isInt(ExprPtr expr, long long value)
+    {
+        return expr->kind == ExprKind::IntConst && expr->intValue == value;
+    }
+
+    bool isBool(ExprPtr expr, bool value)
+    {
+        return expr->kind == ExprKind::BoolConst && expr->intValue == (value ? 1 : 0);
+    }
+
+    // positive zero isn't an identity of the float addition: -0.0 + 0.0 is 0.0
+    bool isFloat(ExprPtr expr, double value)
+    {
+        return expr->kind == ExprKind::FloatConst && expr->floatValue == value && !signbit(expr->floatValue);
+    }
+
+    template<class T>
+    bool compare(BinaryOp op, T a, T b)
+    {
+        switch (op)
+        {
+            case BinaryOp::Less: return a < b;
+            case BinaryOp::Greater: return a > b;
+            case BinaryOp::LessEqual: return a <= b;
+            case BinaryOp::GreaterEqual: return a >= b;
+            case BinaryOp::Equal: return a == b;
+            default: return a != b;
+        }
+    }
+
+    ExprPtr evaluate(BinaryOp op, ExprPtr left, ExprPtr right, size_t line)
+    {
+        if (left->type == DataType::Float)
+        {
+            double a = left->floatValue, b = right->floatValue;
+            if (isComparison(op))
+                return makeBoolConst(compare(op, a, b), line);
+
+            switch (op)
+            {
+                case BinaryOp::Add: return makeFloatConst(a + b, line);
+                case BinaryOp::Sub: return makeFloatConst(a - b, line);
+                case BinaryOp::Mul: return makeFloatConst(a * b, line);
+                case BinaryOp::Div: return makeFloatConst(a / b, line);
+                default: return 0;
+            }
+        }
+
+        long long a = left->intValue, b = right->intValue;
+        if (isComparison(op))
+            return makeBoolConst(compare(op, a, b), line);
+
+        long long value;
+        switch (op)
+        {
+            case BinaryOp::Add: value = wrapAdd(a, b); break;
+            case BinaryOp::Sub: value = wrapSub(a, b); break;
+            case BinaryOp::Mul: value = wrapMul(a, b); break;
+            case BinaryOp::Div:
+                // the division by zero stays to fail when the program gets there
+                if (b == 0)
+                    return 0;
+                value = divideInt(a, b, line);
+                break;
+            case BinaryOp::And: value = a & b; break;
+            case BinaryOp::Or: value = a | b; break;
+            default: return 0;
+        }
+        return left->type == DataType::Bool ? makeBoolConst(value != 0, line) : makeIntConst(value, line);
+    }
+
+    // result of the identity or 0 if none applies
+    ExprPtr simplify(BinaryOp op, ExprPtr left, ExprPtr right, size_t line)
+    {
+        switch (left->type)
+        {
+            case DataType::Integer:
+                if ((op == BinaryOp::Add || op == BinaryOp::Or) && isInt(left, 0))
+                    return right;
+                if ((op == BinaryOp::Add || op == BinaryOp::Sub || op == BinaryOp::Or) && isInt(right, 0))
+                    return left;
+                if (op == BinaryOp::Mul && isInt(left, 1))
+                    return right;
+                if ((op == BinaryOp::Mul || op == BinaryOp::Div) && isInt(right, 1))
+                    return left;
+                if (op == BinaryOp::And && isInt(left, -1))
+                    return right;
+                if (op == BinaryOp::And && isInt(right, -1))
+                    return left;
+                if ((op == BinaryOp::Mul || op == BinaryOp::And) && (isInt(left, 0) || isInt(right, 0))
+                    && !mayFail(left) && !mayFail(right))
+                    return makeIntConst(0, line);
+                break;
+            case DataType::Bool:
+                if ((op == BinaryOp::And && isBool(left, true)) || (op == BinaryOp::Or && isBool(left, false)))
+                    return right;
+                if ((op == BinaryOp::And && isBool(right, true)) || (op == BinaryOp::Or && isBool(right, false)))
+                    return left;
+                if ((op == BinaryOp::And || op == BinaryOp::Or) && !mayFail(left) && !mayFail(right))
+                {
+                    bool absorbing = op == BinaryOp::Or;
+                    if (isBool(left, absorbing) || isBool(right, absorbing))
+                        return makeBoolConst(absorbing, line);
+                }
+                break;
+            case DataType::Float:
+                if (op == BinaryOp::Mul && isFloat(left, 1))
+                    return right;
+                if ((op == BinaryOp::Mul || op == BinaryOp::Div) && isFloat(right, 1))
+                    return left;
+                if (op == BinaryOp::Sub && isFloat(right, 0))
+                    return left;
+                break;
+            default:
+                break;
+        }
+        return 0;
+    }
+
+    ExprPtr fold(ExprPtr expr)
+    {
+        switch (expr->kind)
+        {
+            case ExprKind::Not:
+            {
+                ExprPtr operand = fold(expr->left);
+                if (operand->kind == ExprKind::IntConst)
+                    return makeIntConst(~operand->intValue, expr->line);
+                if (operand->kind == ExprKind::BoolConst)
+                    return makeBoolConst(!operand->intValue, expr->line);
+                if (operand->kind == ExprKind::Not)
+                    return operand->left;
+                return operand == expr->left ? expr : makeNot(operand, expr->line);
+            }
+            case ExprKind::IntToFloat:
+            {
+                ExprPtr operand = fold(expr->left);
+                if (operand->kind == ExprKind::IntConst)
+                    return makeFloatConst((double)operand->intValue, operand->line);
+                return operand == expr->left ? expr : makeIntToFloat(operand);
+            }
+            case ExprKind::Binary:
+            {
+                ExprPtr left = fold(expr->left), right = fold(expr->right);
+                ExprPtr result;
+                if (isConstant(left) && isConstant(right))
+                    result = evaluate(expr->op, left, right, expr->line);
+                if (!result)
+                    result = simplify(expr->op, left, right, expr->line);
+                if (result)
+                    return result;
+                return left == expr->left && right == expr->right ? expr : makeBinary(expr->op, left, right, expr->line);
+            }
+            default:
+                return expr;
+        }
+    }
+
+    void foldStmt(StmtPtr stmt)
+    {
+        if (!stmt)
+            return;
+
+        if (stmt->value)
+            stmt->value = fold(stmt->value);
+        if (stmt->limit)
+            stmt->limit = fold(stmt->limit);
+        for (auto& value : stmt->values)
+            value = fold(value);
+
+        foldStmt(stmt->body);
+        foldStmt(stmt->elseBody);
+        for (auto& inner : stmt->statements)
+            foldStmt(inner);
+    }
+
+    // key of a node in the DAG: its own fields and the identity of its already shared operands,
+    // the line only tells apart integer divisions, which report it
+    typedef tuple<ExprKind, DataType, long long, long long, size_t, BinaryOp, Expr*, Expr*, size_t> ExprKey;
+
+    class ExpressionSharing
+    {
+    private:
+        map<ExprKey, ExprPtr> nodes;
+    public:
+        ExprPtr share(ExprPtr expr)
+        {
+            if (!expr)
+                return expr;
+
+            ExprPtr left = share(expr->left), right = share(expr->right);
+            long long bits;
+            memcpy(&bits, &expr->floatValue, sizeof(bits));
+            bool reportsLine = expr->kind == ExprKind::Binary && expr->op == BinaryOp::Div && expr->type == DataType::Integer;
+            ExprKey key(expr->kind, expr->type, expr->intValue, bits, expr->slot, expr->op, left.get(), right.get(),
+                        reportsLine ? expr->line : 0);
+
+            auto it = nodes.find(key);
+            if (it != nodes.end())
+                return it->second;
+
+            ExprPtr node = expr;
+            if (left != expr->left || right != expr->right)
+            {
+                node = make_shared<Expr>(*expr);
+                node->left = left;
+                node->right = right;
+            }
+            nodes[key] = node;
+            return node;
+        }
+
+        // copy of the expression with every occurrence of target replaced
+        ExprPtr replace(ExprPtr expr, ExprPtr target, ExprPtr replacement)
+        {
+            if (expr == target)
+                return replacement;
+            if (!expr->left)
+                return expr;
+
+            ExprPtr left = replace(expr->left, target, replacement);
+            ExprPtr right = expr->right ? replace(expr->right, target, replacement) : expr->right;
+            if (left == expr->left && right == expr->right)
+                return expr;
+
+            ExprPtr node = make_shared<Expr>(*expr);
+            node->left = left;
+            node->right = right;
+            return share(node);
+        }
+    };
+
+    size_t occurrences(ExprPtr expr, ExprPtr target)
+    {
+        if (!expr)
+            return 0;
+        if (expr == target)
+            return 1;
+        return occurrences(expr->left, target) + occurrences(expr->right, target);
+    }
+
+    // subexpressions in preorder, so the larger ones come first
+    void subexpressions(ExprPtr expr, vector<ExprPtr>& result)
+    {
+        if (!expr)
+            return;
+        result.push_back(expr);
+        subexpressions(expr->left, result);
+        subexpressions(expr->right, result);
+    }
+
+    // values are worth keeping when computing them takes more than a load
+    bool worthKeeping(ExprPtr expr)
+    {
+        return expr->kind == ExprKind::Binary
+               || ((expr->kind == ExprKind::Not || expr->kind == ExprKind::IntToFloat) && expr->left->left);
+    }
+
+    vector<ExprPtr*> expressionsOf(StmtPtr stmt)
+    {
+        vector<ExprPtr*> result;
+        if (stmt->kind == StmtKind::Assign)
+            result.push_back(&stmt->value);
+        for (auto& value : stmt->values)
+            result.push_back(&value);
+        return result;
+    }
+
+    bool isStraight(StmtPtr stmt)
+    {
+        return stmt->kind == StmtKind::Assign || stmt->kind == StmtKind::Write || stmt->kind == StmtKind::Read;
+    }
+
+    class CommonSubexpressions
+    {
+    private:
+        TypedProgram& program;
+        ExpressionSharing sharing;
+        size_t temporaries;
+
+        // last statement from "first" on that still sees the value the expression had before "first":
+        // the one assigning its variables still evaluates its own expressions before the assignment
+        size_t validUntil(const vector<StmtPtr>& statements, size_t first, ExprPtr expr)
+        {
+            set<size_t> slots;
+            usedSlots(expr, slots);
+
+            auto assignsAny = [&](StmtPtr stmt) {
+                return any_of(slots.begin(), slots.end(), [&](size_t slot) { return assigns(stmt, slot); });
+            };
+            size_t last = first;
+            while (last + 1 < statements.size() && isStraight(statements[last + 1]) && !assignsAny(statements[last]))
+                last++;
+            return last;
+        }
+
+        // the largest subexpression of the statement that is computed again before its variables change
+        ExprPtr findCommon(const vector<StmtPtr>& statements, size_t index)
+        {
+            StmtPtr stmt = statements[index];
+            vector<ExprPtr*> roots = expressionsOf(stmt);
+
+            for (size_t k = 0; k < roots.size(); k++)
+            {
+                vector<ExprPtr> candidates;
+                subexpressions(*roots[k], candidates);
+
+                for (auto& candidate : candidates)
+                {
+                    if (!worthKeeping(candidate))
+                        continue;
+
+                    // computing a failing division earlier must not skip output or another error before it
+                    if (mayFail(candidate) && ((stmt->kind == StmtKind::Write && k > 0) || mayFail(*roots[k], candidate)))
+                        continue;
+
+                    size_t count = 0, last = validUntil(statements, index, candidate);
+                    for (size_t j = index; j <= last; j++)
+                        for (auto root : expressionsOf(statements[j]))
+                            count += occurrences(*root, candidate);
+                    if (count > 1)
+                        return candidate;
+                }
+            }
+            return 0;
+        }
+
+        void region(vector<StmtPtr>& statements)
+        {
+            for (auto& stmt : statements)
+                for (auto root : expressionsOf(stmt))
+                    *root = sharing.share(*root);
+
+            for (size_t i = 0; i < statements.size(); i++)
+            {
+                if (!isStraight(statements[i]))
+                {
+                    visit(statements[i]);
+                    continue;
+                }
+
+                while (ExprPtr common = findCommon(statements, i))
+                {
+                    size_t slot = program.variables.size();
+                    program.variables.push_back(Variable { "_cse" + to_string(++temporaries), common->type });
+                    ExprPtr temporary = sharing.share(makeVariable(slot, common->type, common->line));
+
+                    size_t last = validUntil(statements, i, common);
+                    for (size_t j = i; j <= last; j++)
+                        for (auto root : expressionsOf(statements[j]))
+                            *root = sharing.replace(*root, common, temporary);
+
+                    StmtPtr assignment = make_shared<Stmt>(StmtKind::Assign, statements[i]->line);
+                    assignment->slot = slot;
+                    assignment->value = common;
+                    // the new assignment comes first, its value may share a part with later statements too
+                    statements.insert(statements.begin() + i, assignment);
+                }
+            }
+        }
+
+        void visit(StmtPtr stmt)
+        {
+            if (!stmt)
+                return;
+
+            if (stmt->kind == StmtKind::Block)
+            {
+                region(stmt->statements);
+                return;
+            }
+
+            // a single statement body is a region of its own
+            for (StmtPtr* body : { &stmt->body, &stmt->elseBody })
+                if (*body && (*body)->kind != StmtKind::Block)
+                {
+                    StmtPtr block = make_shared<Stmt>(StmtKind::Block, (*body)->line);
+                    block->statements.push_back(*body);
+                    region(block->statements);
+                    *body = block->statements.size() == 1 ? block->statements[0] : block;
+                }
+                else
+                    visit(*body);
+
+            for (auto expr : { &stmt->value, &stmt->limit })
+                if (*expr)
+                    *expr = sharing.share(*expr);
+        }
+    public:
+        CommonSubexpressions(TypedProgram& _program) : program(_program), temporaries(0) {}
+
+        void run()
+        {
+            visit(program.body);
+        }
+    };
+
+    void assignedSlots(StmtPtr stmt, set<size_t>& slots)
+    {
+        if (!stmt)
+            return;
+        if (stmt->kind == StmtKind::Assign || stmt->kind == StmtKind::For)
+            slots.insert(stmt->slot);
+        slots.insert(stmt->slots.begin(), stmt->slots.end());
+
+        assignedSlots(stmt->body, slots);
+        assignedSlots(stmt->elseBody, slots);
+        for (auto& inner : stmt->statements)
+            assignedSlots(inner, slots);
+    }
+
+    class LoopInvariants
+    {
+    private:
+        TypedProgram& program;
+        string* report;
+        size_t temporaries;
+
+        struct Loop
+        {
+            set<size_t> assigned;
+            map<string, ExprPtr> temporaries;   // hoisted expression text to its temporary
+            vector<StmtPtr> hoisted;
+        };
+
+        bool isInvariant(ExprPtr expr, const Loop& loop)
+        {
+            set<size_t> slots;
+            usedSlots(expr, slots);
+            for (auto slot : slots)
+                if (loop.assigned.count(slot))
+                    return false;
+            return true;
+        }
+
+        // replaces the largest invariant subexpressions with temporaries assigned before the loop; the loop may run
+        // zero times, so only expressions that can't fail are computed ahead
+        ExprPtr hoist(ExprPtr expr, Loop& loop)
+        {
+            if (worthKeeping(expr) && !mayFail(expr) && isInvariant(expr, loop))
+            {
+                string text = dumpExpr(program, expr);
+                ExprPtr& temporary = loop.temporaries[text];
+                if (!temporary)
+                {
+                    size_t slot = program.variables.size();
+                    program.variables.push_back(Variable { "_licm" + to_string(++temporaries), expr->type });
+                    temporary = makeVariable(slot, expr->type, expr->line);
+
+                    StmtPtr assignment = make_shared<Stmt>(StmtKind::Assign, expr->line);
+                    assignment->slot = slot;
+                    assignment->value = expr;
+                    loop.hoisted.push_back(assignment);
+                    if (report)
+                        *report += "line " + to_string(expr->line) + ": hoisted " + program.variables[slot].name + " as " + text + "\n";
+                }
+                return temporary;
+            }
+
+            if (!expr->left)
+                return expr;
+
+            ExprPtr left = hoist(expr->left, loop);
+            ExprPtr right = expr->right ? hoist(expr->right, loop) : expr->right;
+            if (left == expr->left && right == expr->right)
+                return expr;
+
+            ExprPtr node = make_shared<Expr>(*expr);
+            node->left = left;
+            node->right = right;
+            return node;
+        }
+
+        // every expression of the body is evaluated once per iteration or more, nested loop bounds included
+        void hoistFrom(StmtPtr stmt, Loop& loop)
+        {
+            if (!stmt)
+                return;
+
+            for (auto expr : { &stmt->value, &stmt->limit })
+                if (*expr)
+                    *expr = hoist(*expr, loop);
+            for (auto& value : stmt->values)
+                value = hoist(value, loop);
+
+            hoistFrom(stmt->body, loop);
+            hoistFrom(stmt->elseBody, loop);
+            for (auto& inner : stmt->statements)
+                hoistFrom(inner, loop);
+        }
+
+        // inner loops go first, what they hoist can move further out of the enclosing loops
+        StmtPtr visit(StmtPtr stmt)
+        {
+            if (!stmt)
+                return stmt;
+
+            stmt->body = visit(stmt->body);
+            stmt->elseBody = visit(stmt->elseBody);
+            for (auto& inner : stmt->statements)
+                inner = visit(inner);
+
+            if (stmt->kind != StmtKind::While && stmt->kind != StmtKind::For)
+                return stmt;
+
+            Loop loop;
+            assignedSlots(stmt, loop.assigned);
+            if (stmt->kind == StmtKind::While)
+                stmt->value = hoist(stmt->value, loop);
+            hoistFrom(stmt->body, loop);
+
+            if (loop.hoisted.empty())
+                return stmt;
+
+            StmtPtr block = make_shared<Stmt>(StmtKind::Block, stmt->line);
+            block->statements = loop.hoisted;
+            block->statements.push_back(stmt);
+            return block;
+        }
+    public:
+        LoopInvariants(TypedProgram& _program, string* _report) : program(_program), report(_report), temporaries(0) {}
+
+        void run()
+        {
+            program.body = visit(program.body);
+        }
+    };
+
+    class InductionVariables
+    {
+    private:
+        TypedProgram& program;
+        string* report;
+        size_t temporaries;
+
+        ExprPtr temporary(ExprPtr value, vector<StmtPtr>& statements)
+        {
+            size_t slot = program.variables.size();
+            program.variables.push_back(Variable { "_iv" + to_string(++temporaries), value->type });
+
+            StmtPtr assignment = make_shared<Stmt>(StmtKind::Assign, value->line);
+            assignment->slot = slot;
+            assignment->value = value;
+            statements.push_back(assignment);
+            return makeVariable(slot, value->type, value->line);
+        }
+
+        static ExprPtr negate(ExprPtr expr, size_t line)
+        {
+            if (expr->kind == ExprKind::IntConst)
+                return makeIntConst(wrapSub(0, expr->intValue), line);
+            if (expr->kind == ExprKind::Binary && expr->op == BinaryOp::Sub && isInt(expr->left, 0))
+                return expr->right;
+            return makeBinary(BinaryOp::Sub, makeIntConst(0, line), expr, line);
+        }
+
+        // an empty coefficient stands for zero
+        static ExprPtr combine(BinaryOp op, ExprPtr left, ExprPtr right, size_t line)
+        {
+            if (left && isInt(left, 0))
+                left = 0;
+            if (right && isInt(right, 0))
+                right = 0;
+            if (op == BinaryOp::Mul && left && right && (isInt(left, 1) || isInt(right, 1)))
+                return isInt(left, 1) ? right : left;
+            if (!right)
+                return op == BinaryOp::Mul ? right : left;
+            if (!left)
+                return op == BinaryOp::Add ? right : op == BinaryOp::Mul ? left : negate(right, line);
+            return makeBinary(op, left, right, line);
+        }
+
+        static bool isInvariant(ExprPtr expr, const set<size_t>& assigned)
+        {
+            set<size_t> slots;
+            usedSlots(expr, slots);
+            for (auto slot : slots)
+                if (assigned.count(slot))
+                    return false;
+            return !mayFail(expr);
+        }
+
+        // splits the expression into scale * counter + offset with loop-invariant scale and offset
+        static bool isAffine(ExprPtr expr, size_t counter, const set<size_t>& assigned, ExprPtr& scale, ExprPtr& offset)
+        {
+            if (expr->type != DataType::Integer)
+                return false;
+            if (expr->kind == ExprKind::Variable && expr->slot == counter)
+            {
+                scale = makeIntConst(1, expr->line);
+                offset = 0;
+                return true;
+            }
+            if (isInvariant(expr, assigned))
+            {
+                scale = 0;
+                offset = expr;
+                return true;
+            }
+            if (expr->kind != ExprKind::Binary)
+                return false;
+
+            ExprPtr leftScale, leftOffset, rightScale, rightOffset;
+            if (!isAffine(expr->left, counter, assigned, leftScale, leftOffset)
+                || !isAffine(expr->right, counter, assigned, rightScale, rightOffset))
+                return false;
+
+            switch (expr->op)
+            {
+                case BinaryOp::Add:
+                case BinaryOp::Sub:
+                    scale = combine(expr->op, leftScale, rightScale, expr->line);
+                    offset = combine(expr->op, leftOffset, rightOffset, expr->line);
+                    return true;
+                case BinaryOp::Mul:
+                    if (leftScale && rightScale)
+                        return false;
+                    if (leftScale)
+                        swap(leftScale, rightScale), swap(leftOffset, rightOffset);
+                    scale = combine(BinaryOp::Mul, leftOffset, rightScale, expr->line);
+                    offset = combine(BinaryOp::Mul, leftOffset, rightOffset, expr->line);
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        static void flatten(StmtPtr stmt, vector<StmtPtr>& result)
+        {
+            if (stmt->kind == StmtKind::Block)
+                for (auto& inner : stmt->statements)
+                    flatten(inner, result);
+            else
+                result.push_back(stmt);
+        }
+
+        struct Reduction
+        {
+            size_t slot;
+            ExprPtr scale, offset;
+        };
+
+        // writes a sum or difference using the variable once as variable + rest
+        static bool splitAccumulator(ExprPtr expr, size_t slot, ExprPtr& rest)
+        {
+            if (expr->kind == ExprKind::Variable && expr->slot == slot)
+            {
+                rest = 0;
+                return true;
+            }
+            if (expr->kind != ExprKind::Binary || (expr->op != BinaryOp::Add && expr->op != BinaryOp::Sub))
+                return false;
+
+            ExprPtr inner;
+            if (slotUses(expr->left, slot))
+            {
+                if (!splitAccumulator(expr->left, slot, inner))
+                    return false;
+                rest = combine(expr->op, inner, expr->right, expr->line);
+                return true;
+            }
+            if (expr->op == BinaryOp::Add && splitAccumulator(expr->right, slot, inner))
+            {
+                rest = combine(BinaryOp::Add, expr->left, inner, expr->line);
+                return true;
+            }
+            return false;
+        }
+
+        // a body of assignments "s as s + e", e affine in the counter and not using any s; the sum may be written
+        // in any order, subtracting e as well
+        bool findReductions(StmtPtr loop, vector<Reduction>& reductions)
+        {
+            vector<StmtPtr> body;
+            flatten(loop->body, body);
+
+            set<size_t> assigned;
+            assignedSlots(loop, assigned);
+
+            // the limit is computed once the counter has its initial value
+            if (slotUses(loop->limit, loop->slot))
+                return false;
+
+            for (auto& stmt : body)
+            {
+                if (stmt->kind != StmtKind::Assign || stmt->slot == loop->slot || stmt->value->type != DataType::Integer
+                    || slotUses(stmt->value, stmt->slot) != 1)
+                    return false;
+                for (auto& reduction : reductions)
+                    if (reduction.slot == stmt->slot)
+                        return false;
+
+                ExprPtr term;
+                Reduction reduction { stmt->slot, 0, 0 };
+                if (!splitAccumulator(stmt->value, stmt->slot, term)
+                    || (term && !isAffine(term, loop->slot, assigned, reduction.scale, reduction.offset)))
+                    return false;
+                reductions.push_back(reduction);
+            }
+            return !reductions.empty();
+        }
+
+        // the sum over counter = first..last is n * offset + scale * (n * first + m * (m + 1) / 2) with m = last - first
+        // and n = m + 1, exact in wrapping arithmetic; the halving is done on whichever of m and m + 1 is even.
+        // When the counter's range doesn't fit in the difference or the limit is the largest integer, which makes
+        // the loop endless, the loop runs as it is
+        StmtPtr closedForm(StmtPtr loop, const vector<Reduction>& reductions)
+        {
+            size_t line = loop->line;
+            auto integer = [&](long long value) { return makeIntConst(value, line); };
+            auto binary = [&](BinaryOp op, ExprPtr left, ExprPtr right) { return makeBinary(op, left, right, line); };
+
+            StmtPtr block = make_shared<Stmt>(StmtKind::Block, line);
+            ExprPtr first = isConstant(loop->value) ? loop->value : temporary(loop->value, block->statements);
+            ExprPtr last = isConstant(loop->limit) ? loop->limit : temporary(loop->limit, block->statements);
+
+            StmtPtr guarded = make_shared<Stmt>(StmtKind::If, line);
+            guarded->value = binary(BinaryOp::And,
+                                    binary(BinaryOp::And, binary(BinaryOp::LessEqual, first, last), binary(BinaryOp::Less, last, integer(LLONG_MAX))),
+                                    binary(BinaryOp::GreaterEqual, binary(BinaryOp::Sub, last, first), integer(0)));
+
+            StmtPtr computed = make_shared<Stmt>(StmtKind::Block, line);
+            ExprPtr steps = temporary(binary(BinaryOp::Sub, last, first), computed->statements);
+            ExprPtr odd = binary(BinaryOp::And, steps, integer(1));
+            ExprPtr triangle = binary(BinaryOp::Mul,
+                                      binary(BinaryOp::Add, binary(BinaryOp::Div, steps, integer(2)), odd),
+                                      binary(BinaryOp::Sub, binary(BinaryOp::Add, steps, integer(1)), odd));
+            ExprPtr count = binary(BinaryOp::Add, steps, integer(1));
+            ExprPtr counterSum = temporary(combine(BinaryOp::Add, combine(BinaryOp::Mul, count, first, line), triangle, line),
+                                           computed->statements);
+
+            for (auto& reduction : reductions)
+            {
+                ExprPtr sum = combine(BinaryOp::Add, combine(BinaryOp::Mul, count, reduction.offset, line),
+                                      combine(BinaryOp::Mul, reduction.scale, counterSum, line), line);
+                if (!sum)
+                    continue;
+
+                StmtPtr assignment = make_shared<Stmt>(StmtKind::Assign, line);
+                assignment->slot = reduction.slot;
+                assignment->value = fold(binary(BinaryOp::Add, makeVariable(reduction.slot, DataType::Integer, line), sum));
+                computed->statements.push_back(assignment);
+            }
+
+            StmtPtr counter = make_shared<Stmt>(StmtKind::Assign, line);
+            counter->slot = loop->slot;
+            counter->value = binary(BinaryOp::Add, last, integer(1));
+            computed->statements.push_back(counter);
+
+            loop->value = first;
+            loop->limit = last;
+            guarded->body = computed;
+            guarded->elseBody = loop;
+            block->statements.push_back(guarded);
+
+            if (report)
+                *report += "line " + to_string(line) + ": loop over " + program.variables[loop->slot].name + " in closed form\n";
+            return block;
+        }
+
+        // "counter * k" and "k * counter" with k invariant in the loop
+        static bool isScaledCounter(ExprPtr expr, size_t counter, const set<size_t>& assigned, ExprPtr& factor)
+        {
+            if (expr->kind != ExprKind::Binary || expr->op != BinaryOp::Mul || expr->type != DataType::Integer)
+                return false;
+            auto isCounter = [&](ExprPtr side) { return side->kind == ExprKind::Variable && side->slot == counter; };
+            if (isCounter(expr->left) && isInvariant(expr->right, assigned))
+                factor = expr->right;
+            else if (isCounter(expr->right) && isInvariant(expr->left, assigned))
+                factor = expr->left;
+            else
+                return false;
+            return true;
+        }
+
+        struct Scaling
+        {
+            size_t counter;
+            set<size_t> assigned;
+            map<string, pair<ExprPtr, ExprPtr>> products;   // factor text to the factor and its variable
+        };
+
+        ExprPtr reduce(ExprPtr expr, Scaling& scaling)
+        {
+            ExprPtr factor;
+            if (isScaledCounter(expr, scaling.counter, scaling.assigned, factor))
+            {
+                auto& product = scaling.products[dumpExpr(program, factor)];
+                if (!product.second)
+                {
+                    size_t slot = program.variables.size();
+                    program.variables.push_back(Variable { "_iv" + to_string(++temporaries), DataType::Integer });
+                    product = { factor, makeVariable(slot, DataType::Integer, expr->line) };
+                    if (report)
+                        *report += "line " + to_string(expr->line) + ": strength-reduced " + dumpExpr(program, expr)
+                                   + " to " + program.variables[slot].name + "\n";
+                }
+                return product.second;
+            }
+
+            if (!expr->left)
+                return expr;
+
+            ExprPtr left = reduce(expr->left, scaling);
+            ExprPtr right = expr->right ? reduce(expr->right, scaling) : expr->right;
+            if (left == expr->left && right == expr->right)
+                return expr;
+
+            ExprPtr node = make_shared<Expr>(*expr);
+            node->left = left;
+            node->right = right;
+            return node;
+        }
+
+        void reduceIn(StmtPtr stmt, Scaling& scaling)
+        {
+            if (!stmt)
+                return;
+
+            for (auto expr : { &stmt->value, &stmt->limit })
+                if (*expr)
+                    *expr = reduce(*expr, scaling);
+            for (auto& value : stmt->values)
+                value = reduce(value, scaling);
+
+            reduceIn(stmt->body, scaling);
+            reduceIn(stmt->elseBody, scaling);
+            for (auto& inner : stmt->statements)
+                reduceIn(inner, scaling);
+        }
+
+        // every product of the counter and an invariant k becomes a variable starting at first * k and growing by k
+        // at the end of each iteration, provided the body doesn't assign the counter
+        StmtPtr strengthReduce(StmtPtr loop)
+        {
+            Scaling scaling;
+            scaling.counter = loop->slot;
+            set<size_t> inBody;
+            assignedSlots(loop->body, inBody);
+            if (inBody.count(loop->slot))
+                return loop;
+
+            assignedSlots(loop, scaling.assigned);
+            reduceIn(loop->body, scaling);
+            if (scaling.products.empty())
+                return loop;
+
+            size_t line = loop->line;
+            StmtPtr block = make_shared<Stmt>(StmtKind::Block, line);
+            if (loop->value->kind != ExprKind::Variable && !isConstant(loop->value))
+                loop->value = temporary(loop->value, block->statements);
+
+            StmtPtr body = make_shared<Stmt>(StmtKind::Block, line);
+            body->statements.push_back(loop->body);
+            for (auto& product : scaling.products)
+            {
+                ExprPtr factor = product.second.first, variable = product.second.second;
+                StmtPtr initial = make_shared<Stmt>(StmtKind::Assign, line);
+                initial->slot = variable->slot;
+                initial->value = fold(makeBinary(BinaryOp::Mul, loop->value, factor, line));
+                block->statements.push_back(initial);
+
+                StmtPtr step = make_shared<Stmt>(StmtKind::Assign, line);
+                step->slot = variable->slot;
+                step->value = makeBinary(BinaryOp::Add, variable, factor, line);
+                body->statements.push_back(step);
+            }
+
+            loop->body = body;
+            block->statements.push_back(loop);
+            return block;
+        }
+
+        // inner loops go first
+        StmtPtr visit(StmtPtr stmt)
+        {
+            if (!stmt)
+                return stmt;
+
+            stmt->body = visit(stmt->body);
+            stmt->elseBody = visit(stmt->elseBody);
+            for (auto& inner : stmt->statements)
+                inner = visit(inner);
+
+            if (stmt->kind != StmtKind::For)
+                return stmt;
+
+            vector<Reduction> reductions;
+            if (findReductions(stmt, reductions))
+                return closedForm(stmt, reductions);
+            return strengthReduce(stmt);
+        }
+    public:
+        InductionVariables(TypedProgram& _program, string* _report) : program(_program), report(_report), temporaries(0) {}
+
+        void run()
+        {
+            program.body = visit(program.body);
+        }
+    };
+}
+
+void foldConstants(TypedProgram& program)
+{
+    foldStmt(program.body);
+}
+
+void eliminateCommonSubexpressions(TypedProgram& program)
+{
+    CommonSubexpressions(program).run();
+}
+
+void reduceInductionVariables(TypedProgram& program, string* report)
+{
+    InductionVariables(program, report).run();
+}
+
+void hoistLoopInvariants(TypedProgram& program, string* report)
+{
+    LoopInvariants(program, report).run();
+}
+
+void optimizeProgram(TypedProgram& program, string* report)
+{
+    TraceSpan span("optimizeProgram");
+    {
+        TraceSpan pass("foldConstants");
+        foldConstants(program);
+    }
+    {
+        TraceSpan pass("reduceInductionVariables");
+        reduceInductionVariables(program, report);
+    }
+    {
+        TraceSpan pass("eliminateCommonSubexpressions");
+        eliminateCommonSubexpressions(program);
+    }
+    TraceSpan pass("hoistLoopInvariants");
+    hoistLoopInvariants(program, report);
+}
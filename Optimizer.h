@@ -0,0 +1,34 @@
+#ifndef RGR_OPTIMIZER_H
+#define RGR_OPTIMIZER_H
+
+#include "TypedTree.h"
+
+/*
+ * Optimization passes over the typed program, shared by all backends.
+ *
+ * The passes keep the observable behavior: the output, the runtime errors and the lines they are reported on.
+ * Expressions have no side effects except that an integer division may fail, so a subexpression is only dropped
+ * when it can't contain such a division.
+ */
+
+// evaluates constant subexpressions with the language's semantics and applies algebraic identities
+// (x + 0, x * 1, not not x, b and true, ...), every folded subtree becomes a single constant
+void foldConstants(TypedProgram& program);
+
+// shares structurally equal subexpressions in a DAG and, within straight-line statement lists, computes
+// an expression repeated before its variables change once into a fresh temporary "_cseN"
+void eliminateCommonSubexpressions(TypedProgram& program);
+
+// replaces a "for" loop whose body only adds or subtracts affine functions of the counter to variables with its closed
+// form, guarded to run the loop when its range is too large; otherwise products of the counter and a loop-invariant
+// value become fresh temporaries "_ivN" increased by that value every iteration. The report gets a line per loop changed
+void reduceInductionVariables(TypedProgram& program, std::string* report = 0);
+
+// computes the subexpressions of "while" and "for" loops whose variables the loop doesn't assign into fresh
+// temporaries "_licmN" before the loop, the report gets a line per hoisted expression
+void hoistLoopInvariants(TypedProgram& program, std::string* report = 0);
+
+// runs all passes in order
+void optimizeProgram(TypedProgram& program, std::string* report = 0);
+
+#endif //RGR_OPTIMIZER_H
@@ -0,0 +1,226 @@
+#include "catch.hpp"
+#include "TestSupport.h"
+#include "Optimizer.h"
+
+using namespace std;
+
+namespace
+{
+    // typed statements of the folded program without the declarations
+    string folded(string code)
+    {
+        TypedProgram program = lower(code);
+        foldConstants(program);
+
+        string result;
+        for (auto& stmt : program.body->statements)
+            result += stmt->kind == StmtKind::Assign ? dumpExpr(program, stmt->value) + "\n" : "";
+        return result;
+    }
+
+    void requireSameBehavior(string code, string input = "")
+    {
+        TypedProgram optimized = lower(code);
+        optimizeProgram(optimized);
+        REQUIRE( runVM(compileBytecode(optimized), input) == runVM(code, input) );
+    }
+}
+
+TEST_CASE( "constant folding", "[optimizer]" ) {
+    const string declarations = "dim a, b integer : dim x, y float : dim c, d bool\n";
+
+    SECTION( "constants" ) {
+        REQUIRE( folded(declarations + "a as 2 + 3 * 4") == "14\n" );
+        REQUIRE( folded(declarations + "a as 10b + 0ffh + 7o + 9d") == "273\n" );
+        REQUIRE( folded(declarations + "a as 9223372036854775807 + 1") == "-9223372036854775808\n" );
+        REQUIRE( folded(declarations + "a as (0 - 9223372036854775807 - 1) / (0 - 1)") == "-9223372036854775808\n" );
+        REQUIRE( folded(declarations + "a as 0 - 7 / 2 : a as not 0 : a as 12 and 10 or 1") == "-3\n-1\n9\n" );
+        REQUIRE( folded(declarations + "x as 1 / 2.0 : x as 3") == "0.5f\n3f\n" );
+        REQUIRE( folded(declarations + "c as 1 < 2.5 : c as not (true and false) : c as 3 <> 3") == "true\ntrue\nfalse\n" );
+        REQUIRE( folded(declarations + "a as b + (2 * 3)") == "(b + 6)\n" );
+    }
+
+    SECTION( "identities" ) {
+        REQUIRE( folded(declarations + "a as b * 1 + 0 : a as 0 + 1 * (b - 0) / 1") == "b\nb\n" );
+        REQUIRE( folded(declarations + "a as b or 0 and 5 : a as (0 - 1) and b") == "b\nb\n" );
+        REQUIRE( folded(declarations + "c as not not c and true : c as false or d") == "c\nd\n" );
+        REQUIRE( folded(declarations + "a as not not b : a as b * 0 : c as d and false : c as d or true") == "b\n0\nfalse\ntrue\n" );
+        REQUIRE( folded(declarations + "x as y * 1.0 : x as y / 1 : x as y - 0.0") == "y\ny\ny\n" );
+    }
+
+    SECTION( "kept" ) {
+        // the division by zero has to happen at run time, on its line
+        REQUIRE( folded(declarations + "a as 1 / 0") == "(1 / 0)\n" );
+        REQUIRE( folded(declarations + "a as b / a * 0 : c as (b / a > 0) and false") == "((b / a) * 0)\n(((b / a) > 0) and false)\n" );
+        REQUIRE( folded(declarations + "a as b / 2 * 0") == "0\n" );
+        // -0.0 + 0.0 is 0.0
+        REQUIRE( folded(declarations + "x as y + 0.0") == "(y + 0f)\n" );
+    }
+
+    SECTION( "behavior" ) {
+        requireSameBehavior("write(2 + 3 * 4, 7.0 / 2, 1 / 3.0, not 5, 1.0e300 * 1.0e300, 0.0 / 0.0)");
+        requireSameBehavior("dim a integer : read(a) : write(a * 1 + 0, a / 1, a * 0, not not a)", "-9");
+        requireSameBehavior("dim a integer : write(1) : a as 5 / 0 * 0", "");
+        requireSameBehavior("dim x float : read(x) : write(x - 0.0, x * 1.0, x + 0.0)", "-0.0");
+    }
+}
+
+namespace
+{
+    string withoutCommon(string code)
+    {
+        TypedProgram program = lower(code);
+        eliminateCommonSubexpressions(program);
+        return dumpTypedProgram(program);
+    }
+}
+
+TEST_CASE( "common subexpressions", "[optimizer]" ) {
+    const string declarations = "dim a, b, c, x, y integer\n";
+    const string dims = "dim a integer\ndim b integer\ndim c integer\ndim x integer\ndim y integer\n";
+
+    SECTION( "straight-line code" ) {
+        REQUIRE( withoutCommon(declarations + "x as a * b + c\ny as a * b + c\nwrite(a * b)") ==
+                 dims + "dim _cse1 integer\ndim _cse2 integer\n"
+                        "_cse2 as (a * b)\n_cse1 as (_cse2 + c)\nx as _cse1\ny as _cse1\nwrite(_cse2)\n" );
+        REQUIRE( withoutCommon(declarations + "x as a / b + a / b") ==
+                 dims + "dim _cse1 integer\n_cse1 as (a / b)\nx as (_cse1 + _cse1)\n" );
+    }
+
+    SECTION( "redefinitions" ) {
+        REQUIRE( withoutCommon(declarations + "x as a * b : a as 1 : y as a * b") ==
+                 dims + "x as (a * b)\na as 1\ny as (a * b)\n" );
+        REQUIRE( withoutCommon(declarations + "a as a * b : y as a * b") == dims + "a as (a * b)\ny as (a * b)\n" );
+        REQUIRE( withoutCommon(declarations + "x as a * b : read(b) : y as a * b") ==
+                 dims + "x as (a * b)\nread(b)\ny as (a * b)\n" );
+        REQUIRE( withoutCommon(declarations + "x as a * b : a as a * b") ==
+                 dims + "dim _cse1 integer\n_cse1 as (a * b)\nx as _cse1\na as _cse1\n" );
+    }
+
+    SECTION( "divisions keep their place" ) {
+        // "1 " has to be written before the division fails
+        REQUIRE( withoutCommon(declarations + "write(1, a / b, a / b)") == dims + "write(1, (a / b), (a / b))\n" );
+        REQUIRE( withoutCommon(declarations + "x as c / a + a / b\ny as a / b") == dims + "x as ((c / a) + (a / b))\ny as (a / b)\n" );
+    }
+
+    SECTION( "loop bodies" ) {
+        REQUIRE( withoutCommon(declarations + "for x as 1 to 10 do begin y as x * x + 1 : c as x * x end") ==
+                 dims + "dim _cse1 integer\nfor x as 1 to 10 do\n    begin\n        _cse1 as (x * x)\n"
+                        "        y as (_cse1 + 1)\n        c as _cse1\n    end\n" );
+    }
+
+    SECTION( "behavior" ) {
+        requireSameBehavior(declarations + "read(a, b) : x as a * b + 1 : write(x, a * b + 1, a * b) : a as a * b : write(a * b, a / b + a / b)", "6 3");
+        requireSameBehavior(declarations + "read(a, b) : write(a * b, a / b, a / b)", "6 0");
+        requireSameBehavior(declarations + "read(a, b) : x as a / b * 2 : write(a / b)", "6 0");
+        requireSameBehavior("dim i, s integer : dim f float : for i as 1 to 50 do begin s as s + i * i : f as f + i * i / 3.0 end : write(s, f)");
+    }
+}
+
+namespace
+{
+    string hoisted(string code, string* report = 0)
+    {
+        TypedProgram program = lower(code);
+        hoistLoopInvariants(program, report);
+        return dumpTypedProgram(program);
+    }
+}
+
+TEST_CASE( "loop-invariant code motion", "[optimizer]" ) {
+    const string declarations = "dim a, b, i, s integer : dim f float\n";
+    const string dims = "dim a integer\ndim b integer\ndim i integer\ndim s integer\ndim f float\n";
+
+    SECTION( "loops" ) {
+        string report;
+        REQUIRE( hoisted(declarations + "for i as 1 to b * 2 do s as s + a * b + i", &report) ==
+                 dims + "dim _licm1 integer\n"
+                        "begin\n    _licm1 as (a * b)\n    for i as 1 to (b * 2) do\n        s as ((s + _licm1) + i)\nend\n" );
+        REQUIRE( report == "line 2: hoisted _licm1 as (a * b)\n" );
+
+        REQUIRE( hoisted(declarations + "while s < a * b do begin s as s + 1 : f as f + 1.0 / b end") ==
+                 dims + "dim _licm1 integer\ndim _licm2 float\n"
+                        "begin\n    _licm1 as (a * b)\n    _licm2 as (1f / float(b))\n"
+                        "    while (s < _licm1) do\n        begin\n            s as (s + 1)\n"
+                        "            f as (f + _licm2)\n        end\nend\n" );
+    }
+
+    SECTION( "nested loops" ) {
+        // the product of the inner loop moves out of both loops
+        REQUIRE( hoisted(declarations + "for i as 1 to 10 do for s as 1 to 10 do b as b + a * a") ==
+                 dims + "dim _licm1 integer\ndim _licm2 integer\n"
+                        "begin\n    _licm2 as (a * a)\n    for i as 1 to 10 do\n        begin\n            _licm1 as _licm2\n"
+                        "            for s as 1 to 10 do\n                b as (b + _licm1)\n        end\nend\n" );
+    }
+
+    SECTION( "kept" ) {
+        // assigned in the loop, or failing when the loop doesn't run
+        REQUIRE( hoisted(declarations + "for i as 1 to 10 do begin s as a * b : a as i end") ==
+                 dims + "for i as 1 to 10 do\n    begin\n        s as (a * b)\n        a as i\n    end\n" );
+        REQUIRE( hoisted(declarations + "while s < 10 do begin s as s + a / b end") ==
+                 dims + "while (s < 10) do\n    begin\n        s as (s + (a / b))\n    end\n" );
+        REQUIRE( hoisted(declarations + "for i as 1 to 10 do read(a) : write(a * b)").find("_licm") == string::npos );
+    }
+
+    SECTION( "behavior" ) {
+        requireSameBehavior(declarations + "read(a, b) : for i as 1 to 100 do begin s as s + a * b + i / b : f as f + 1.0 / (a + b) end : write(s, f, i)", "3 4");
+        requireSameBehavior(declarations + "read(a, b) : for i as 1 to 0 do s as a / b : write(s)", "3 0");
+        requireSameBehavior(declarations + "read(a, b) : while s < a * b do begin s as s + 1 : if s > 5 then a as a - 1 end : write(s, a)", "3 4");
+    }
+}
+
+namespace
+{
+    string reduced(string code, string* report = 0)
+    {
+        TypedProgram program = lower(code);
+        reduceInductionVariables(program, report);
+        return dumpTypedProgram(program);
+    }
+}
+
+TEST_CASE( "induction variables", "[optimizer]" ) {
+    const string declarations = "dim a, b, i, k, s, t integer\n";
+    const string dims = "dim a integer\ndim b integer\ndim i integer\ndim k integer\ndim s integer\ndim t integer\n";
+
+    SECTION( "strength reduction" ) {
+        string report;
+        REQUIRE( reduced(declarations + "for i as a to b do write(i * k, 3 * i)", &report) ==
+                 dims + "dim _iv1 integer\ndim _iv2 integer\n"
+                        "begin\n    _iv2 as (a * 3)\n    _iv1 as (a * k)\n    for i as a to b do\n        begin\n"
+                        "            write(_iv1, _iv2)\n            _iv2 as (_iv2 + 3)\n            _iv1 as (_iv1 + k)\n"
+                        "        end\nend\n" );
+        REQUIRE( report == "line 2: strength-reduced (i * k) to _iv1\nline 2: strength-reduced (3 * i) to _iv2\n" );
+
+        // the counter or the factor change in the body
+        REQUIRE( reduced(declarations + "for i as 1 to 10 do begin write(i * k) : i as i + 1 end").find("_iv") == string::npos );
+        REQUIRE( reduced(declarations + "for i as 1 to 10 do begin write(i * k) : read(k) end").find("_iv") == string::npos );
+    }
+
+    SECTION( "closed form" ) {
+        string report;
+        string result = reduced(declarations + "for i as a to b do begin s as s + i * k + 1 : t as t - i end", &report);
+        REQUIRE( report == "line 2: loop over i in closed form\n" );
+        REQUIRE( result.find("    else\n        for i as _iv1 to _iv2 do") != string::npos );
+
+        // not a reduction: the sum uses another accumulator, or the limit uses the counter
+        REQUIRE( reduced(declarations + "for i as 1 to 10 do begin s as s + i : t as t + s end").find("closed") == string::npos );
+        REQUIRE( reduced(declarations + "for i as 1 to 10 do s as s * i").find("_iv") == string::npos );
+        report = "";
+        reduced(declarations + "for i as 1 to i + 10 do s as s + i", &report);
+        REQUIRE( report == "" );
+    }
+
+    SECTION( "behavior" ) {
+        const string loop = declarations + "read(a, b, k) : for i as a to b do begin s as s + i * k + 1 : t as t - (2 * i - k) end : write(s, t, i)";
+        for (string input : { "1 100 3", "100 1 3", "-50 50 7", "5 5 0", "9223372036854775000 9223372036854775806 3",
+                              "-9223372036854775807 -9223372036854775000 1000000007" })
+            requireSameBehavior(loop, input);
+        requireSameBehavior(declarations + "read(a, b, k) : for i as a to b do write(i * k, k * (i * 2))", "-3 10 9223372036854775807");
+
+        // a billion iterations take no time
+        TypedProgram program = lower(declarations + "read(b) : for i as 1 to b do s as s + i : write(s, i)");
+        optimizeProgram(program);
+        REQUIRE( runVM(compileBytecode(program), "3000000000") == "4500000001500000000 3000000001\n" );
+    }
+}
@@ -0,0 +1,241 @@
+#include "Parallel.h"
+#include "Trace.h"
+#include <algorithm>
+using namespace std;
+
+namespace
+{
+    // every statement of the body in order, with the nesting flattened
+    void allStatements(StmtPtr stmt, vector<StmtPtr>& result)
+    {
+        if (!stmt)
+            return;
+        result.push_back(stmt);
+        allStatements(stmt->body, result);
+        allStatements(stmt->elseBody, result);
+        for (auto& inner : stmt->statements)
+            allStatements(inner, result);
+    }
+
+    // statements of the body run on every iteration, in order
+    void topLevel(StmtPtr stmt, vector<StmtPtr>& result)
+    {
+        if (stmt->kind == StmtKind::Block)
+            for (auto& inner : stmt->statements)
+                topLevel(inner, result);
+        else
+            result.push_back(stmt);
+    }
+
+    // uses of the variable in the statement's own expressions
+    size_t usesIn(StmtPtr stmt, size_t slot)
+    {
+        size_t result = slotUses(stmt->value, slot) + slotUses(stmt->limit, slot);
+        for (auto& value : stmt->values)
+            result += slotUses(value, slot);
+        return result;
+    }
+
+    bool mentions(StmtPtr stmt, size_t slot)
+    {
+        vector<StmtPtr> statements;
+        allStatements(stmt, statements);
+        for (auto& inner : statements)
+            if (assigns(inner, slot) || usesIn(inner, slot))
+                return true;
+        return false;
+    }
+
+    class LoopAnalysis
+    {
+    private:
+        StmtPtr loop;
+        vector<StmtPtr> statements, top;
+        set<size_t> assigned;
+
+        bool isInduction(size_t slot, ParallelVariable& variable)
+        {
+            StmtPtr update;
+            for (auto& stmt : statements)
+                if (assigns(stmt, slot))
+                {
+                    if (update)
+                        return false;
+                    update = stmt;
+                }
+            if (update->kind != StmtKind::Assign || find(top.begin(), top.end(), update) == top.end())
+                return false;
+
+            ExprPtr value = update->value, step;
+            auto isSelf = [&](ExprPtr expr) { return expr->kind == ExprKind::Variable && expr->slot == slot; };
+            if (value->type != DataType::Integer || value->kind != ExprKind::Binary)
+                return false;
+            if ((value->op == BinaryOp::Add || value->op == BinaryOp::Sub) && isSelf(value->left))
+                step = value->right;
+            else if (value->op == BinaryOp::Add && isSelf(value->right))
+                step = value->left;
+            else
+                return false;
+
+            set<size_t> slots;
+            usedSlots(step, slots);
+            for (auto used : slots)
+                if (assigned.count(used))
+                    return false;
+            if (mayFail(step))
+                return false;
+
+            variable.role = ParallelRole::Induction;
+            variable.op = value->op;
+            variable.step = step;
+            return true;
+        }
+
+        bool isReduction(size_t slot, ParallelVariable& variable)
+        {
+            BinaryOp op = BinaryOp::Less;
+            size_t updates = 0, used = 0;
+            for (auto& stmt : statements)
+            {
+                used += usesIn(stmt, slot);
+                if (!assigns(stmt, slot))
+                    continue;
+                if (stmt->kind != StmtKind::Assign || stmt->value->kind != ExprKind::Binary)
+                    return false;
+
+                ExprPtr value = stmt->value;
+                auto isSelf = [&](ExprPtr expr) { return expr->kind == ExprKind::Variable && expr->slot == slot; };
+                if (!isSelf(value->left) && !(value->op != BinaryOp::Sub && isSelf(value->right)))
+                    return false;
+
+                BinaryOp kind = value->op == BinaryOp::Sub ? BinaryOp::Add : value->op;
+                if (kind != BinaryOp::Add && kind != BinaryOp::Mul && kind != BinaryOp::And && kind != BinaryOp::Or)
+                    return false;
+                if (value->type == DataType::Float || (value->type == DataType::Bool && kind != BinaryOp::And && kind != BinaryOp::Or))
+                    return false;
+                if (updates > 0 && kind != op)
+                    return false;
+                op = kind;
+                updates++;
+            }
+
+            // the variable appears only as the left side of its own updates
+            if (used != updates)
+                return false;
+
+            variable.role = ParallelRole::Reduction;
+            variable.op = op;
+            return true;
+        }
+
+        bool isPrivate(size_t slot)
+        {
+            for (auto& stmt : top)
+            {
+                if (!mentions(stmt, slot))
+                    continue;
+                return (stmt->kind == StmtKind::Assign || stmt->kind == StmtKind::For) && stmt->slot == slot
+                       && !slotUses(stmt->value, slot);
+            }
+            return false;
+        }
+    public:
+        explicit LoopAnalysis(StmtPtr _loop) : loop(_loop)
+        {
+            allStatements(loop->body, statements);
+            topLevel(loop->body, top);
+            for (auto& stmt : statements)
+                if (stmt->kind == StmtKind::Assign || stmt->kind == StmtKind::For)
+                    assigned.insert(stmt->slot);
+            assigned.insert(loop->slot);
+        }
+
+        bool run(ParallelLoop& result)
+        {
+            for (auto& stmt : statements)
+                if (stmt->kind == StmtKind::Read || stmt->kind == StmtKind::Write || assigns(stmt, loop->slot))
+                    return false;
+
+            for (auto slot : assigned)
+            {
+                if (slot == loop->slot)
+                    continue;
+
+                ParallelVariable variable { slot, ParallelRole::Private, BinaryOp::Add, 0 };
+                if (!isInduction(slot, variable) && !isReduction(slot, variable) && !isPrivate(slot))
+                    return false;
+                result.variables.push_back(variable);
+            }
+            return true;
+        }
+    };
+}
+
+bool analyzeParallelLoop(const TypedProgram&, StmtPtr loop, ParallelLoop& result)
+{
+    if (loop->kind != StmtKind::For)
+        return false;
+    return LoopAnalysis(loop).run(result);
+}
+
+ThreadPool::ThreadPool(size_t threads) : task(0), next(0), count(0), done(0), batch(0), stopping(false)
+{
+    for (size_t i = 1; i < threads; i++)
+        workers.emplace_back([this] { loop(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    started.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+// takes tasks of the current batch until none is left
+void ThreadPool::work(unique_lock<std::mutex>& lock)
+{
+    while (next < count)
+    {
+        size_t index = next++;
+        lock.unlock();
+        {
+            TraceSpan span("task", "pool");
+            (*task)(index);
+        }
+        lock.lock();
+        if (++done == count)
+            finished.notify_all();
+    }
+}
+
+void ThreadPool::loop()
+{
+    unique_lock<std::mutex> lock(mutex);
+    size_t seen = 0;
+    while (true)
+    {
+        started.wait(lock, [&] { return stopping || batch != seen; });
+        if (stopping)
+            return;
+        seen = batch;
+        work(lock);
+    }
+}
+
+void ThreadPool::run(size_t _count, const function<void(size_t)>& _task)
+{
+    unique_lock<std::mutex> lock(mutex);
+    task = &_task;
+    next = 0;
+    count = _count;
+    done = 0;
+    batch++;
+    started.notify_all();
+
+    work(lock);
+    finished.wait(lock, [&] { return done == count; });
+}
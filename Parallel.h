@@ -0,0 +1,65 @@
+#ifndef RGR_PARALLEL_H
+#define RGR_PARALLEL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "TypedTree.h"
+
+/*
+ * Parallel "for" loops.
+ *
+ * Variables are the only state, so iterations of a "for" loop are independent when every variable its body assigns
+ * (nested loop counters included) is one of:
+ *  - private: every iteration assigns it before using it, the value after the loop is the last iteration's;
+ *  - a reduction: only updated as "s as s op e" with one of +, - (both counted as addition), *, "and", "or" on
+ *    integers or "and", "or" on bools, and not used otherwise, so partial results of ranges of iterations combine
+ *    in order into the same value in the wrapping arithmetic;
+ *  - an induction variable: assigned once per iteration, outside conditions and nested loops, as "v as v + k" or
+ *    "v as v - k" with k not changing in the loop and not failing, so its value at any iteration is known up front.
+ * The body mustn't assign the counter nor read or write.
+ */
+
+enum class ParallelRole { Private, Reduction, Induction };
+
+struct ParallelVariable
+{
+    size_t slot;
+    ParallelRole role;
+    BinaryOp op;        // Reduction: Add, Mul, And or Or; Induction: Add or Sub
+    ExprPtr step;       // Induction
+};
+
+struct ParallelLoop
+{
+    std::vector<ParallelVariable> variables;
+};
+
+// true if the iterations of the "for" loop are independent as above
+bool analyzeParallelLoop(const TypedProgram& program, StmtPtr loop, ParallelLoop& result);
+
+// fixed set of worker threads running batches of numbered tasks, the calling thread takes part in every batch
+class ThreadPool
+{
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable started, finished;
+    const std::function<void(size_t)>* task;
+    size_t next, count, done, batch;
+    bool stopping;
+
+    void work(std::unique_lock<std::mutex>& lock);
+    void loop();
+public:
+    explicit ThreadPool(size_t threads);
+    ~ThreadPool();
+
+    size_t size() const { return workers.size() + 1; }
+
+    // calls task(0) ... task(count - 1) across the threads and returns once all are done, tasks mustn't throw
+    void run(size_t count, const std::function<void(size_t)>& task);
+};
+
+#endif //RGR_PARALLEL_H
@@ -0,0 +1,82 @@
+#include "catch.hpp"
+#include "TestSupport.h"
+#include "Parallel.h"
+#include "Closure.h"
+
+using namespace std;
+
+namespace
+{
+    // roles of the variables of the program's first statement after the declarations, by name
+    string analyzed(string code)
+    {
+        TypedProgram program = lower(code);
+        ParallelLoop loop;
+        if (!analyzeParallelLoop(program, program.body->statements[0], loop))
+            return "serial";
+
+        string result;
+        for (auto& variable : loop.variables)
+        {
+            const char* roles[] = { "private", "reduction", "induction" };
+            result += program.variables[variable.slot].name + " " + roles[(int)variable.role] + ";";
+        }
+        return result;
+    }
+
+    string runParallel(string code, string input = "")
+    {
+        return run(ClosureEngine(lower(code), 4), input);
+    }
+
+}
+
+TEST_CASE( "parallel loop analysis", "[parallel]" ) {
+    const string declarations = "dim i, j, s, t, k integer : dim b bool : dim f float\n";
+
+    REQUIRE( analyzed(declarations + "for i as 1 to 10 do s as s + i * i") == "s reduction;" );
+    REQUIRE( analyzed(declarations + "for i as 1 to 10 do begin t as i / 3 : s as s * t : b as b or (t > 2) end")
+             == "s reduction;t private;b reduction;" );
+    REQUIRE( analyzed(declarations + "for i as 1 to 10 do begin k as k + 3 : s as s - k * k end") == "s reduction;k induction;" );
+    REQUIRE( analyzed(declarations + "for i as 1 to 10 do for j as 1 to i do if j > 3 then s as s + j") == "j private;s reduction;" );
+
+    // output, loop-carried variables, a reduction read in the loop, the counter changed, floats
+    REQUIRE( analyzed(declarations + "for i as 1 to 10 do write(i)") == "serial" );
+    REQUIRE( analyzed(declarations + "for i as 1 to 10 do begin s as t : t as i end") == "serial" );
+    REQUIRE( analyzed(declarations + "for i as 1 to 10 do begin s as s + i : t as s end") == "serial" );
+    REQUIRE( analyzed(declarations + "for i as 1 to 10 do begin s as s + i : s as s * 2 end") == "serial" );
+    REQUIRE( analyzed(declarations + "for i as 1 to 10 do i as i + 1") == "serial" );
+    REQUIRE( analyzed(declarations + "for i as 1 to 10 do f as f + i") == "serial" );
+    REQUIRE( analyzed(declarations + "for i as 1 to 10 do if i > 5 then k as k + 1 else t as k") == "serial" );
+}
+
+TEST_CASE( "parallel loops match the VM", "[parallel]" ) {
+    const string declarations = "dim i, j, s, t, k, n integer : dim b bool\n";
+    vector<string> programs = {
+            "read(n) : for i as 1 to n do s as s + i * i * i : write(s, i)",
+            "read(n) : for i as n to n * 3 do begin t as i / 7 : s as s * (t or 1) : b as b or (t = 1000) end : write(s, t, b, i)",
+            "read(n) : k as 5 : for i as 0 - n to n do begin k as k - 3 : s as s + k * i end : write(s, k, i)",
+            "read(n) : b as true : for i as 1 to n do b as b and (i <> 0) : write(b)",
+            "read(n) : s as 0 - 1 : for i as 1 to n do s as s and not (i and 1024) : write(s)",
+            "read(n) : for i as 2 to n do begin t as 2 : j as 0 : while t * t <= i do begin if i / t * t = i then j as 1 : t as t + 1 end : s as s + 1 - j end : write(s, t, j)",
+            "read(n) : for i as 1 to n do for j as 1 to 10 do s as s + i * j : write(s, j)",
+            "read(n) : for i as 1 to n do s as s + 100 / (i - n + 50) : write(s)",
+            "read(n) : for i as 1 to n do s as s + 100 / (i - 777) + 1 / (i - n + 5) : write(s)",
+            "read(n) : for i as 9223372036854775807 - n to 9223372036854775806 do s as s + i : write(s, i)",
+    };
+
+    for (auto& program : programs)
+        for (string input : { "5", "20000" })
+            REQUIRE( runParallel(declarations + program, input) == runVM(declarations + program, input) );
+}
+
+TEST_CASE( "thread pool", "[parallel]" ) {
+    ThreadPool pool(4);
+    REQUIRE( pool.size() == 4 );
+    for (size_t count : { 0, 1, 3, 100 })
+    {
+        vector<int> done(count, 0);
+        pool.run(count, [&](size_t task) { done[task]++; });
+        REQUIRE( done == vector<int>(count, 1) );
+    }
+}
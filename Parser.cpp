@@ -3,6 +3,7 @@
 //
 
 #include "Parser.h"
+#include "Trace.h"
 #include <cassert>
 using namespace std;
 
@@ -11,6 +12,19 @@ void parsing_error(string error, size_t line)
     throw runtime_error("Error on line " + to_string(line) + ": " + error);
 }
 
+std::string dumpType(DataType type)
+{
+    return type == DataType::Integer ? "integer" : type == DataType::Float ? "float" : type == DataType::Bool ? "bool" : type == DataType::None ? "none" : "invalid";
+}
+
+namespace
+{
+    // the checks and lowering after parsing recurse once per level, deeper nesting would overflow the stack
+    const size_t deepestNesting = 1000;
+    // the same for the syntax tree as a whole, operator chains and nested statements included, lists excluded
+    const size_t deepestTree = 6000;
+}
+
 bool OneTokenNode::feed(SyntaxStack &st, const Token &tok)
 {
     if (tok.type != acceptedToken())
@@ -24,21 +38,50 @@ bool OneTokenNode::feed(SyntaxStack &st, const Token &tok)
 
 SyntaxNodePtr parseInput(SyntaxNodePtr target, std::vector<Token> tokens)
 {
-    tokens.push_back(Token(TokenType::eof, "end of file", tokens.back().line));
+    tokens.push_back(Token(TokenType::eof, "end of file", tokens.empty() ? 1 : tokens.back().line));
     SyntaxStack stack;
     stack.push_front(target);
 
     auto token = tokens.begin();
 
+    // an item is parsed from taking its node off the stack to taking the tail after it
+    TraceSpan span("parseInput");
+    bool traceItems = isTracingItems();
+    unique_ptr<TraceSpan> item;
+    size_t nesting = 0;
+    vector<size_t> depths { 0 };    // of the nodes on the stack, the last one is the depth of its front
+
     while (!stack.empty())
     {
         assert (token != tokens.end());
 
         SyntaxNodePtr node = stack.front();
         stack.pop_front();
-
-        if (node->feed(stack, *token))
+        size_t depth = depths.back();
+        depths.pop_back();
+        if (depth > deepestTree)
+            parsing_error("Expression or statement is nested too deeply", token->line);
+
+        if (traceItems && dynamic_cast<ProgramItemNode*>(node.get()))
+            item.reset(new TraceSpan("parse item", "item", token->line));
+        else if (traceItems && dynamic_cast<ProgramTailNode*>(node.get()))
+            item.reset();
+
+        size_t pending = stack.size();
+        bool consumed = node->feed(stack, *token);
+        // the rest of a list is at the depth of the list
+        depths.insert(depths.end(), stack.size() - pending, dynamic_cast<ListTailNode*>(node.get()) ? depth - 1 : depth + 1);
+        if (consumed)
+        {
+            if (token->type == TokenType::openbr || token->type == TokenType::begin)
+            {
+                if (++nesting > deepestNesting)
+                    parsing_error("Brackets or blocks are nested too deeply", token->line);
+            }
+            else if ((token->type == TokenType::closebr || token->type == TokenType::end) && nesting > 0)
+                nesting--;
             token++;
+        }
     }
 
     if (token != tokens.end() && token->type != TokenType::eof)
@@ -74,11 +117,6 @@ namespace
             st.push_front(*it);
     }
 
-    std::string dumpType(DataType type)
-    {
-        return type == DataType::Integer ? "integer" : type == DataType::Float ? "float" : type == DataType::Bool ? "bool" : type == DataType::None ? "none" : "invalid";
-    }
-
     std::map<tuple<DataType, std::string, DataType>, DataType > compatibilityMatrix {
             { make_tuple(DataType::Integer, "<", DataType::Integer), DataType::Bool },
             { make_tuple(DataType::Integer, ">", DataType::Integer), DataType::Bool },
@@ -99,10 +137,10 @@ namespace
             { make_tuple(DataType::Float, ">=", DataType::Float), DataType::Bool },
             { make_tuple(DataType::Float, "<>", DataType::Float), DataType::Bool },
             { make_tuple(DataType::Float, "=", DataType::Float), DataType::Bool },
-            { make_tuple(DataType::Float, "+", DataType::Float), DataType::Bool },
-            { make_tuple(DataType::Float, "-", DataType::Float), DataType::Bool },
-            { make_tuple(DataType::Float, "*", DataType::Float), DataType::Bool },
-            { make_tuple(DataType::Float, "/", DataType::Float), DataType::Bool },
+            { make_tuple(DataType::Float, "+", DataType::Float), DataType::Float },
+            { make_tuple(DataType::Float, "-", DataType::Float), DataType::Float },
+            { make_tuple(DataType::Float, "*", DataType::Float), DataType::Float },
+            { make_tuple(DataType::Float, "/", DataType::Float), DataType::Float },
 
             { make_tuple(DataType::Bool, "and", DataType::Bool), DataType::Bool },
             { make_tuple(DataType::Bool, "or", DataType::Bool), DataType::Bool },
@@ -143,6 +181,66 @@ namespace
     {
         return operation == "" ? t1 : compatibilityMatrix.find(make_tuple(t1, operation, t2))->second;
     }
+
+    /*
+     * The grammar builds "a - b - c" as a right-nested chain Head(a, Tail(-, Head(b, Tail(-, Head(c, Tail()))))),
+     * but the operations are left-associative, so the type of the chain is folded from the left.
+     * The chain is walked iteratively by its first node, and every node of the chain gets the resulting type.
+     */
+    template<class Head, class Tail>
+    void foldChainType(Head* head, SemanticContext& context, size_t line)
+    {
+        vector<WithType*> chainNodes;
+        DataType result = DataType::None;
+        string operation;
+
+        Head* node = head;
+        while (node)
+        {
+            auto& subNodes = node->getSubNodes();
+            WithType* operand = dynamic_cast<WithType*>(subNodes[0].get());
+            Tail* tail = dynamic_cast<Tail*>(subNodes[1].get());
+
+            assert(operand);
+            assert(tail);
+
+            subNodes[0]->semanticProcess(context);
+
+            if (operation == "")
+                result = operand->getType();
+            else if (!checkTypeCompatibility(operation, result, operand->getType()))
+                parsing_error("Types " + dumpType(result) + " and " + dumpType(operand->getType())
+                              + " are not compatible for " + operation + " operation", line);
+            else
+                result = getResultType(operation, result, operand->getType());
+
+            chainNodes.push_back(node);
+            operation = tail->getOperation();
+            if (operation == "")
+            {
+                tail->setType(DataType::None);
+                node = 0;
+            }
+            else
+            {
+                chainNodes.push_back(tail);
+                node = dynamic_cast<Head*>(tail->getSubNodes()[1].get());
+                assert(node);
+            }
+        }
+
+        for (auto chainNode : chainNodes)
+            chainNode->setType(result);
+    }
+
+    void checkCondition(SyntaxNodePtr condition, std::string statement, size_t line)
+    {
+        ExpressionNode* expressionNode = dynamic_cast<ExpressionNode*>(condition.get());
+        assert(expressionNode);
+
+        if (expressionNode->getType() != DataType::Bool)
+            parsing_error("Condition of " + statement + " must be bool, " + dumpType(expressionNode->getType()) + " found instead", line);
+    }
 }
 
 bool TransformableNode::feed(SyntaxStack &st, const Token &tok)
@@ -434,13 +532,62 @@ void NodeWithSubnodes::semanticProcess(SemanticContext &context)
         node->semanticProcess(context);
 }
 
+// the subnodes held only here are taken apart in a loop, deep trees would overflow the stack in nested destructors
+NodeWithSubnodes::~NodeWithSubnodes()
+{
+    SyntaxNodeList pending;
+    pending.swap(subNodes);
+    while (!pending.empty())
+    {
+        SyntaxNodePtr node = move(pending.back());
+        pending.pop_back();
+
+        NodeWithSubnodes* inner = node.use_count() == 1 ? dynamic_cast<NodeWithSubnodes*>(node.get()) : 0;
+        if (inner)
+        {
+            pending.insert(pending.end(), make_move_iterator(inner->subNodes.begin()), make_move_iterator(inner->subNodes.end()));
+            inner->subNodes.clear();
+        }
+    }
+}
+
+ListNode* ListNode::next()
+{
+    NodeWithSubnodes* tail = dynamic_cast<NodeWithSubnodes*>(subNodes[1].get());
+    assert(tail);
+    auto& rest = tail->getSubNodes();
+    return rest.empty() ? 0 : dynamic_cast<ListNode*>(rest[1].get());
+}
+
+void ListNode::semanticProcess(SemanticContext &context)
+{
+    for (ListNode* node = this; node; node = node->next())
+        node->subNodes[0]->semanticProcess(context);
+}
+
 SyntaxNodePtr parseInputWithSemantic(SyntaxNodePtr target, std::string code)
 {
     SemanticContext context;
-    parseInput(target, lexString(code))->semanticProcess(context);
+    parseInput(target, lexString(code));
+    TraceSpan span("semanticProcess");
+    target->semanticProcess(context);
     return target;
 }
 
+bool ProgramItemNode::feed(SyntaxStack &st, const Token &tok)
+{
+    line = tok.line;
+    return TransformableNode::feed(st, tok);
+}
+
+void ProgramItemNode::semanticProcess(SemanticContext &context)
+{
+    if (!isTracingItems())
+        return NodeWithSubnodes::semanticProcess(context);
+    TraceSpan span("check item", "item", line);
+    NodeWithSubnodes::semanticProcess(context);
+}
+
 void DeclarationNode::semanticProcess(SemanticContext &context)
 {
     IdentifierListNode* identifierListNode = dynamic_cast<IdentifierListNode*>(subNodes[1].get());
@@ -470,23 +617,11 @@ DataType TypeNode::getType()
 
 void IdentifierListNode::gatherIdentifiers(std::list<std::string> &identifiers)
 {
-    IdentifierNode* identifierNode = dynamic_cast<IdentifierNode*>(subNodes[0].get());
-    IdentifierListTailNode* identifierListTailNode = dynamic_cast<IdentifierListTailNode*>(subNodes[1].get());
-
-    assert(identifierNode);
-    assert(identifierListTailNode);
-
-    identifiers.push_back(identifierNode->getContent());
-    identifierListTailNode->gatherIdentifiers(identifiers);
-}
-
-void IdentifierListTailNode::gatherIdentifiers(std::list<std::string> &identifiers)
-{
-    if (subNodes.size() > 1)
+    for (ListNode* node = this; node; node = node->next())
     {
-        IdentifierListNode* identifierListNode = dynamic_cast<IdentifierListNode*>(subNodes[1].get());
-        assert(identifierListNode);
-        identifierListNode->gatherIdentifiers(identifiers);
+        IdentifierNode* identifierNode = dynamic_cast<IdentifierNode*>(node->getSubNodes()[0].get());
+        assert(identifierNode);
+        identifiers.push_back(identifierNode->getContent());
     }
 }
 
@@ -529,34 +664,20 @@ void FactorNode::semanticProcess(SemanticContext &context)
     if (!subNode) subNode = dynamic_cast<BoolConstNode*>(subNodes[0].get());
     if (!subNode) subNode = subNodes.size() > 1 ? dynamic_cast<OperandNode*>(subNodes[1].get()) : 0;
     if (!subNode) subNode = subNodes.size() > 1 ? dynamic_cast<ExpressionNode*>(subNodes[1].get()) : 0;
+    if (!subNode) subNode = subNodes.size() > 1 ? dynamic_cast<FactorNode*>(subNodes[1].get()) : 0;
 
     assert(subNode);
 
     UnaryOperationNode* unaryOp = dynamic_cast<UnaryOperationNode*>(subNodes[0].get());
     if (unaryOp && subNode->getType() == DataType::Float)
-        throw "\"not\" operation can't be applied to float";
+        throw runtime_error("\"not\" operation can't be applied to float");
 
     type = subNode->getType();
 }
 
 void ExpressionNode::semanticProcess(SemanticContext &context)
 {
-    NodeWithSubnodes::semanticProcess(context);
-
-    OperandNode* operandNode = dynamic_cast<OperandNode*>(subNodes[0].get());
-    ExpressionTailNode* expressionTailNode = dynamic_cast<ExpressionTailNode*>(subNodes[1].get());
-
-    assert(operandNode);
-    assert(expressionTailNode);
-
-    if (!checkTypeCompatibility(expressionTailNode->getOperation(), operandNode->getType(), expressionTailNode->getType()))
-        parsing_error("Types " + dumpType(operandNode->getType()) + " and " + dumpType(expressionTailNode->getType())
-                            + " are not compatible for " + expressionTailNode->getOperation() + " operation", line);
-
-    if (expressionTailNode->getOperation() == "")
-        type = operandNode->getType();
-    else
-        type = DataType::Bool;
+    foldChainType<ExpressionNode, ExpressionTailNode>(this, context, line);
 }
 
 std::string TailNode::getOperation()
@@ -584,44 +705,12 @@ void AssignmentNode::semanticProcess(SemanticContext &context)
 
 void OperandNode::semanticProcess(SemanticContext &context)
 {
-    NodeWithSubnodes::semanticProcess(context);
-
-    AddendNode* addendNode = dynamic_cast<AddendNode*>(subNodes[0].get());
-    OperandTailNode* operandTailNode = dynamic_cast<OperandTailNode*>(subNodes[1].get());
-
-    assert(addendNode);
-    assert(operandTailNode);
-
-    std::string operation = operandTailNode->getOperation();
-    DataType t1 = addendNode->getType();
-    DataType t2 = operandTailNode->getType();
-
-    if (!checkTypeCompatibility(operation, t1, t2))
-        parsing_error("Types " + dumpType(t1) + " and " + dumpType(t2)
-                            + " are not compatible for " + operation + " operation", line);
-
-    type = getResultType(operation, t1, t2);
+    foldChainType<OperandNode, OperandTailNode>(this, context, line);
 }
 
 void AddendNode::semanticProcess(SemanticContext &context)
 {
-    NodeWithSubnodes::semanticProcess(context);
-
-    FactorNode* factorNode = dynamic_cast<FactorNode*>(subNodes[0].get());
-    AddendTailNode* addendTailNode = dynamic_cast<AddendTailNode*>(subNodes[1].get());
-
-    assert(factorNode);
-    assert(addendTailNode);
-
-    std::string operation = addendTailNode->getOperation();
-    DataType t1 = factorNode->getType();
-    DataType t2 = addendTailNode->getType();
-
-    if (!checkTypeCompatibility(operation, t1, t2))
-        parsing_error("Types " + dumpType(t1) + " and " + dumpType(t2)
-                            + " are not compatible for " + operation + " operation", line);
-
-    type = getResultType(operation, t1, t2);
+    foldChainType<AddendNode, AddendTailNode>(this, context, line);
 }
 
 void ExpressionTailNode::semanticProcess(SemanticContext &context)
@@ -671,3 +760,37 @@ std::string OneTokenNode::dumpInternal()
     else
         return className() + className() + " { " + tokenContent + " }\n";
 }
+
+void ConditionNode::semanticProcess(SemanticContext &context)
+{
+    NodeWithSubnodes::semanticProcess(context);
+
+    checkCondition(subNodes[1], "if", line);
+}
+
+void WhileLoopNode::semanticProcess(SemanticContext &context)
+{
+    NodeWithSubnodes::semanticProcess(context);
+
+    checkCondition(subNodes[1], "while", line);
+}
+
+void ForLoopNode::semanticProcess(SemanticContext &context)
+{
+    NodeWithSubnodes::semanticProcess(context);
+
+    AssignmentNode* assignmentNode = dynamic_cast<AssignmentNode*>(subNodes[1].get());
+    ExpressionNode* limitNode = dynamic_cast<ExpressionNode*>(subNodes[3].get());
+
+    assert(assignmentNode);
+    assert(limitNode);
+
+    IdentifierNode* counterNode = dynamic_cast<IdentifierNode*>(assignmentNode->getSubNodes()[0].get());
+    assert(counterNode);
+
+    if (counterNode->getType() != DataType::Integer)
+        parsing_error("Loop counter " + counterNode->getContent() + " must be integer", line);
+
+    if (limitNode->getType() != DataType::Integer)
+        parsing_error("Loop limit must be integer, " + dumpType(limitNode->getType()) + " found instead", line);
+}
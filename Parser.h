@@ -18,6 +18,8 @@ typedef std::list<SyntaxNodePtr> SyntaxStack;
 
 enum class DataType { None, Integer, Float, Bool, Invalid };
 
+std::string dumpType(DataType type);
+
 class SemanticContext
 {
 private:
@@ -34,6 +36,7 @@ protected:
 public:
     WithType() { type = DataType::Invalid; }
     DataType getType() { return type; }
+    void setType(DataType _type) { type = _type; }
 };
 
 class SyntaxNode
@@ -62,6 +65,7 @@ public:
     virtual bool feed(SyntaxStack& st, const Token& tok);
     virtual void semanticProcess(SemanticContext &context);
     std::string getContent() { return tokenContent; }
+    size_t getLine() { return line; }
 };
 
 class IntNumberNode : public OneTokenNode, public WithType
@@ -104,7 +108,9 @@ class NodeWithSubnodes : public SyntaxNode
 protected:
     SyntaxNodeList subNodes;
 public:
+    virtual ~NodeWithSubnodes();
     virtual std::string dump(int shift = 0);
+    const SyntaxNodeList& getSubNodes() { return subNodes; }
     virtual void semanticProcess(SemanticContext &context);
 };
 
@@ -169,6 +175,7 @@ protected:
     size_t line;
 public:
     virtual bool feed(SyntaxStack& st, const Token& tok);
+    size_t getLine() { return line; }
 };
 
 class AddendNode : public ExpandableNode, public WithType
@@ -195,6 +202,26 @@ public:
     std::string getOperation();
 };
 
+/*
+ * A list: an item and a tail holding a separator and the rest of the list, or nothing at its end. Every item nests
+ * a level deeper, so the items are walked in a loop and the nesting doesn't count towards the depth limit of the parser.
+ */
+class ListNode : public ExpandableNode
+{
+protected:
+    virtual std::string className() { return "ListNode"; }
+public:
+    // the rest of the list, 0 at its end
+    ListNode* next();
+    virtual void semanticProcess(SemanticContext &context);
+};
+
+class ListTailNode : public TailNode
+{
+protected:
+    virtual std::string className() { return "ListTailNode"; }
+};
+
 class AddendTailNode : public TailNode, public WithType
 {
 protected:
@@ -340,7 +367,7 @@ public:
     DataType getType();
 };
 
-class IdentifierListNode : public ExpandableNode
+class IdentifierListNode : public ListNode
 {
 protected:
     virtual SyntaxNodeList expand();
@@ -352,7 +379,7 @@ public:
     std::list<std::string> gatherIdentifiers();
 };
 
-class IdentifierListTailNode : public TailNode
+class IdentifierListTailNode : public ListTailNode
 {
 protected:
     virtual std::set<TokenType> acceptedTokens();
@@ -361,8 +388,6 @@ protected:
 public:
     IdentifierListTailNode() {}
     IdentifierListTailNode(SyntaxNodeList nodes) { subNodes = nodes; }
-
-    void gatherIdentifiers(std::list<std::string>& identifiers);
 };
 
 class CommaNode : public OneTokenNode
@@ -405,6 +430,8 @@ protected:
 public:
     ConditionNode() {}
     ConditionNode(SyntaxNodeList nodes) { subNodes = nodes; }
+
+    virtual void semanticProcess(SemanticContext &context);
 };
 
 class ReadingNode : public ExpandableNode
@@ -447,7 +474,7 @@ public:
     WriteNode(std::string content) { tokenContent = content; }
 };
 
-class ExpressionListNode : public ExpandableNode
+class ExpressionListNode : public ListNode
 {
 protected:
     virtual SyntaxNodeList expand();
@@ -457,7 +484,7 @@ public:
     ExpressionListNode(SyntaxNodeList nodes) { subNodes = nodes; }
 };
 
-class ExpressionListTailNode : public TailNode
+class ExpressionListTailNode : public ListTailNode
 {
 protected:
     virtual std::set<TokenType> acceptedTokens();
@@ -528,6 +555,8 @@ protected:
 public:
     ForLoopNode() {}
     ForLoopNode(SyntaxNodeList nodes) { subNodes = nodes; }
+
+    virtual void semanticProcess(SemanticContext &context);
 };
 
 class ForNode : public OneTokenNode
@@ -568,6 +597,8 @@ protected:
 public:
     WhileLoopNode() {}
     WhileLoopNode(SyntaxNodeList nodes) { subNodes = nodes; }
+
+    virtual void semanticProcess(SemanticContext &context);
 };
 
 class WhileNode : public OneTokenNode
@@ -620,7 +651,7 @@ public:
     OperatorSepNode(std::string content) { tokenContent = content; }
 };
 
-class OperatorListNode : public ExpandableNode
+class OperatorListNode : public ListNode
 {
 protected:
     virtual SyntaxNodeList expand();
@@ -630,7 +661,7 @@ public:
     OperatorListNode(SyntaxNodeList nodes) { subNodes = nodes; }
 };
 
-class OperatorListTailNode : public TailNode
+class OperatorListTailNode : public ListTailNode
 {
 protected:
     virtual std::set<TokenType> acceptedTokens();
@@ -641,7 +672,7 @@ public:
     OperatorListTailNode(SyntaxNodeList nodes) { subNodes = nodes; }
 };
 
-class ProgramNode : public ExpandableNode
+class ProgramNode : public ListNode
 {
 protected:
     virtual SyntaxNodeList expand();
@@ -656,12 +687,16 @@ class ProgramItemNode : public TransformableNode
 protected:
     virtual std::string className() { return "ProgramItemNode"; }
     virtual TransformationMap transformationMap();
+    size_t line = 0;
 public:
     ProgramItemNode() {}
     ProgramItemNode(SyntaxNodePtr innerNode) { subNodes.push_back(innerNode); }
+
+    virtual bool feed(SyntaxStack& st, const Token& tok);
+    virtual void semanticProcess(SemanticContext &context);
 };
 
-class ProgramTailNode : public TailNode
+class ProgramTailNode : public ListTailNode
 {
 protected:
     virtual std::set<TokenType> acceptedTokens();
@@ -121,4 +121,35 @@ TEST_CASE( "main test" )
         REQUIRE_NOTHROW(parseInputWithSemantic(make_shared<ProgramNode>(), "dim a bool : dim b integer : a as b < 3 "));
         REQUIRE_THROWS(parseInputWithSemantic(make_shared<ProgramNode>(), "dim a bool : dim b integer : a as b - 3 "));
     }
+
+    SECTION ("nesting depth limit") {
+        auto nested = [](size_t depth) {
+            return "dim a integer : a as " + string(depth, '(') + "1" + string(depth, ')');
+        };
+        REQUIRE_NOTHROW(parseInputWithSemantic(make_shared<ProgramNode>(), nested(1000)));
+        REQUIRE_THROWS(parseInputWithSemantic(make_shared<ProgramNode>(), nested(1001)));
+        REQUIRE_THROWS(parseInputWithSemantic(make_shared<ProgramNode>(), nested(100000)));
+        REQUIRE_THROWS(parseInputWithSemantic(make_shared<ProgramNode>(), ""));
+        REQUIRE_THROWS(parseInputWithSemantic(make_shared<ProgramNode>(), " : {comment}"));
+        // the limit is on depth, not on the number of brackets
+        string flat = "dim a integer : a as (1)";
+        for (int i = 0; i < 2000; i++)
+            flat += " + (1)";
+        REQUIRE_NOTHROW(parseInputWithSemantic(make_shared<ProgramNode>(), flat));
+        // operator chains nest too, so a long enough one is rejected as well
+        for (int i = 0; i < 8000; i++)
+            flat += " + (1)";
+        REQUIRE_THROWS(parseInputWithSemantic(make_shared<ProgramNode>(), flat));
+        // but lists don't count, however long
+        string dims = "dim a0";
+        string writes = " : write(a0";
+        string statements;
+        for (int i = 1; i < 20000; i++)
+        {
+            dims += ",a" + to_string(i);
+            writes += ",a" + to_string(i);
+            statements += " : a0 as a0 + 1";
+        }
+        REQUIRE_NOTHROW(parseInputWithSemantic(make_shared<ProgramNode>(), dims + " integer" + statements + writes + ")"));
+    }
 }
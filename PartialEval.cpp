@@ -0,0 +1,213 @@
+#include "PartialEval.h"
+#include "Runtime.h"
+using namespace std;
+
+namespace
+{
+    bool readsInput(StmtPtr stmt)
+    {
+        if (!stmt)
+            return false;
+        if (stmt->kind == StmtKind::Read)
+            return true;
+        if (readsInput(stmt->body) || readsInput(stmt->elseBody))
+            return true;
+        for (auto& inner : stmt->statements)
+            if (readsInput(inner))
+                return true;
+        return false;
+    }
+
+    struct BudgetExhausted {};
+
+    // the output is collected in memory, a program writing more than that is left to run normally
+    const size_t outputLimit = 1 << 24;
+
+    template<class T>
+    long long compare(BinaryOp op, T a, T b)
+    {
+        switch (op)
+        {
+            case BinaryOp::Less: return a < b;
+            case BinaryOp::Greater: return a > b;
+            case BinaryOp::LessEqual: return a <= b;
+            case BinaryOp::GreaterEqual: return a >= b;
+            case BinaryOp::Equal: return a == b;
+            default: return a != b;
+        }
+    }
+
+    class Evaluator
+    {
+    private:
+        vector<Value> slots;
+        OutputBuffer output;
+        size_t budget, outputUsed;
+
+        void step()
+        {
+            if (budget == 0)
+                throw BudgetExhausted();
+            budget--;
+        }
+
+        Value evaluate(ExprPtr expr)
+        {
+            Value result;
+            result.i = 0;
+            switch (expr->kind)
+            {
+                case ExprKind::IntConst:
+                case ExprKind::BoolConst:
+                    result.i = expr->intValue;
+                    break;
+                case ExprKind::FloatConst:
+                    result.f = expr->floatValue;
+                    break;
+                case ExprKind::Variable:
+                    result = slots[expr->slot];
+                    break;
+                case ExprKind::Not:
+                    result.i = evaluate(expr->left).i;
+                    result.i = expr->type == DataType::Bool ? !result.i : ~result.i;
+                    break;
+                case ExprKind::IntToFloat:
+                    result.f = (double)evaluate(expr->left).i;
+                    break;
+                case ExprKind::Binary:
+                {
+                    Value left = evaluate(expr->left), right = evaluate(expr->right);
+                    if (expr->left->type == DataType::Float)
+                    {
+                        double a = left.f, b = right.f;
+                        switch (expr->op)
+                        {
+                            case BinaryOp::Add: result.f = a + b; break;
+                            case BinaryOp::Sub: result.f = a - b; break;
+                            case BinaryOp::Mul: result.f = a * b; break;
+                            case BinaryOp::Div: result.f = a / b; break;
+                            default: result.i = compare(expr->op, a, b); break;
+                        }
+                    }
+                    else
+                    {
+                        long long a = left.i, b = right.i;
+                        switch (expr->op)
+                        {
+                            case BinaryOp::Add: result.i = wrapAdd(a, b); break;
+                            case BinaryOp::Sub: result.i = wrapSub(a, b); break;
+                            case BinaryOp::Mul: result.i = wrapMul(a, b); break;
+                            case BinaryOp::Div: result.i = divideInt(a, b, expr->line); break;
+                            case BinaryOp::And: result.i = a & b; break;
+                            case BinaryOp::Or: result.i = a | b; break;
+                            default: result.i = compare(expr->op, a, b); break;
+                        }
+                    }
+                    break;
+                }
+            }
+            return result;
+        }
+
+        void execute(StmtPtr stmt)
+        {
+            step();
+            switch (stmt->kind)
+            {
+                case StmtKind::Assign:
+                    slots[stmt->slot] = evaluate(stmt->value);
+                    break;
+                case StmtKind::If:
+                    if (evaluate(stmt->value).i)
+                        execute(stmt->body);
+                    else if (stmt->elseBody)
+                        execute(stmt->elseBody);
+                    break;
+                case StmtKind::While:
+                    while (evaluate(stmt->value).i)
+                    {
+                        step();
+                        execute(stmt->body);
+                    }
+                    break;
+                case StmtKind::For:
+                {
+                    long long& counter = slots[stmt->slot].i;
+                    counter = evaluate(stmt->value).i;
+                    long long limit = evaluate(stmt->limit).i;
+                    for (; counter <= limit; counter = wrapAdd(counter, 1))
+                    {
+                        step();
+                        execute(stmt->body);
+                    }
+                    break;
+                }
+                case StmtKind::Write:
+                    outputUsed += stmt->values.size() * (maxFormattedLength + 1);
+                    if (outputUsed > outputLimit)
+                        throw BudgetExhausted();
+
+                    for (size_t i = 0; i < stmt->values.size(); i++)
+                    {
+                        // the separator is written once the value is known, as the VM does
+                        Value value = evaluate(stmt->values[i]);
+                        if (i > 0)
+                            output.writeChar(' ');
+                        switch (stmt->values[i]->type)
+                        {
+                            case DataType::Float: output.writeFloat(value.f); break;
+                            case DataType::Bool: output.writeBool(value.i != 0); break;
+                            default: output.writeInt(value.i); break;
+                        }
+                    }
+                    output.writeChar('\n');
+                    break;
+                case StmtKind::Block:
+                    for (auto& inner : stmt->statements)
+                        execute(inner);
+                    break;
+                case StmtKind::Read:
+                    break;
+            }
+        }
+    public:
+        Evaluator(const TypedProgram& program, size_t _budget) : budget(_budget), outputUsed(0)
+        {
+            Value zero;
+            zero.i = 0;
+            slots.assign(program.variables.size(), zero);
+        }
+
+        bool run(StmtPtr body, PrecomputedOutput& result)
+        {
+            try
+            {
+                execute(body);
+            }
+            catch(BudgetExhausted&)
+            {
+                return false;
+            }
+            catch(runtime_error& e)
+            {
+                result.error = e.what();
+            }
+
+            result.output = output.str();
+            return true;
+        }
+    };
+}
+
+bool readsInput(const TypedProgram& program)
+{
+    return readsInput(program.body);
+}
+
+bool precomputeOutput(const TypedProgram& program, size_t budget, PrecomputedOutput& result)
+{
+    if (readsInput(program))
+        return false;
+
+    return Evaluator(program, budget).run(program.body, result);
+}
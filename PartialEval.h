@@ -0,0 +1,27 @@
+#ifndef RGR_PARTIALEVAL_H
+#define RGR_PARTIALEVAL_H
+
+#include "TypedTree.h"
+
+/*
+ * Whole-program partial evaluation.
+ *
+ * A program without "read" gets no input, so its output is known at compile time. Such a program is evaluated
+ * up front, counting executed statements and loop iterations against a budget; when it finishes within the budget
+ * its output and runtime error replace running it. Otherwise it is compiled as usual.
+ */
+
+struct PrecomputedOutput
+{
+    std::string output;
+    std::string error;      // runtime error the program stopped with, empty if it finished
+};
+
+const size_t defaultPrecomputeBudget = 10000000;
+
+bool readsInput(const TypedProgram& program);
+
+// false if the program reads input or doesn't finish within the budget
+bool precomputeOutput(const TypedProgram& program, size_t budget, PrecomputedOutput& result);
+
+#endif //RGR_PARTIALEVAL_H
@@ -0,0 +1,47 @@
+#include "catch.hpp"
+#include "TestSupport.h"
+#include "PartialEval.h"
+
+using namespace std;
+
+namespace
+{
+    string precomputed(string code, size_t budget = defaultPrecomputeBudget)
+    {
+        PrecomputedOutput result;
+        if (!precomputeOutput(lower(code), budget, result))
+            return "not precomputed";
+        return result.output + result.error;
+    }
+}
+
+TEST_CASE( "partial evaluation", "[precompute]" ) {
+    const string programs[] = {
+        "write(1 + 2 * 3, 7.0 / 2, not 5, 1.0e300 * 1.0e300, 1 < 2.5)",
+        "dim i, s integer : dim f float\n"
+        "for i as 1 to 100 do begin s as s + i * i : f as f + 1.0 / i end\n"
+        "write(s, f, i)",
+        "dim n integer : dim b bool : n as 1000\n"
+        "while n > 0 do begin b as not b : n as n / 2 end\n"
+        "if b then write(n) else write(0 - n)",
+        "dim i integer : for i as 9223372036854775805 to 9223372036854775806 do write(i)",
+        "dim a integer : write(1, 2) : write(3, a / a)",
+    };
+
+    for (auto& code : programs)
+        REQUIRE( precomputed(code) == runVM(code) );
+
+    REQUIRE( precomputed("dim a integer : write(a / 0)") == "Runtime error on line 1: Division by zero" );
+}
+
+TEST_CASE( "partial evaluation limits", "[precompute]" ) {
+    REQUIRE( precomputed("dim a integer : write(1) : read(a)") == "not precomputed" );
+    REQUIRE( precomputed("dim a integer : if a > 0 then read(a)") == "not precomputed" );
+
+    // the budget counts statements and loop iterations
+    string loop = "dim i integer : for i as 1 to 1000 do write(i)";
+    REQUIRE( precomputed(loop, 100) == "not precomputed" );
+    REQUIRE( precomputed(loop, 3000) == runVM(loop) );
+    REQUIRE( precomputed("dim b bool : while not b do b as b", 100000) == "not precomputed" );
+    REQUIRE( precomputed("dim i integer : for i as 1 to 9223372036854775807 do write(i)") == "not precomputed" );
+}
@@ -0,0 +1,113 @@
+#include "Profile.h"
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <sstream>
+using namespace std;
+
+namespace
+{
+    const size_t tableRows = 10;
+
+    string kindName(StmtKind kind)
+    {
+        switch (kind)
+        {
+            case StmtKind::Assign: return "as";
+            case StmtKind::If: return "if";
+            case StmtKind::While: return "while";
+            case StmtKind::For: return "for";
+            case StmtKind::Read: return "read";
+            case StmtKind::Write: return "write";
+            default: return "block";
+        }
+    }
+}
+
+Profile::Profile(const TypedProgram& program)
+{
+    add(program.body);
+}
+
+void Profile::add(StmtPtr stmt)
+{
+    if (!stmt)
+        return;
+    if (stmt->kind != StmtKind::Block)
+    {
+        numbers[stmt.get()] = statements.size();
+        statements.push_back(ProfiledStatement { stmt, 0, 0 });
+    }
+    add(stmt->body);
+    add(stmt->elseBody);
+    for (auto& inner : stmt->statements)
+        add(inner);
+}
+
+ProfiledStatement* Profile::find(StmtPtr stmt)
+{
+    auto number = numbers.find(stmt.get());
+    return number == numbers.end() ? nullptr : &statements[number->second];
+}
+
+string Profile::report(const string& source) const
+{
+    // a line ran as often as its most executed statement
+    map<size_t, size_t> lineCounts;
+    for (auto& statement : statements)
+        lineCounts[statement.stmt->line] = max(lineCounts[statement.stmt->line], statement.count);
+
+    ostringstream out;
+    istringstream lines(source);
+    string text;
+    for (size_t line = 1; getline(lines, text); line++)
+    {
+        auto count = lineCounts.find(line);
+        if (count != lineCounts.end())
+            out << setw(12) << count->second;
+        else
+            out << setw(12) << "";
+        out << " | " << text << "\n";
+    }
+
+    // iterations of a loop are the runs of the first statement of its body
+    auto iterations = [&](const ProfiledStatement& loop) -> size_t {
+        StmtPtr first = loop.stmt->body;
+        while (first && first->kind == StmtKind::Block)
+            first = first->statements.empty() ? nullptr : first->statements[0];
+        return first ? statements[numbers.at(first.get())].count : 0;
+    };
+
+    vector<const ProfiledStatement*> loops, hot;
+    for (auto& statement : statements)
+    {
+        if (statement.stmt->kind == StmtKind::While || statement.stmt->kind == StmtKind::For)
+            loops.push_back(&statement);
+        if (statement.count > 0)
+            hot.push_back(&statement);
+    }
+    stable_sort(loops.begin(), loops.end(), [](const ProfiledStatement* a, const ProfiledStatement* b) {
+        return a->nanoseconds > b->nanoseconds;
+    });
+    stable_sort(hot.begin(), hot.end(), [](const ProfiledStatement* a, const ProfiledStatement* b) {
+        return a->count > b->count;
+    });
+
+    out << "\nLoops by time (nested loops included):\n";
+    out << setw(8) << "line" << setw(8) << "loop" << setw(12) << "runs" << setw(14) << "iterations" << setw(14) << "ms"
+        << setw(14) << "ns/iteration" << "\n";
+    for (size_t i = 0; i < loops.size() && i < tableRows; i++)
+    {
+        const ProfiledStatement& loop = *loops[i];
+        size_t body = iterations(loop);
+        out << setw(8) << loop.stmt->line << setw(8) << kindName(loop.stmt->kind) << setw(12) << loop.count
+            << setw(14) << body << setw(14) << fixed << setprecision(3) << loop.nanoseconds / 1e6
+            << setw(14) << setprecision(1) << (body ? (double)loop.nanoseconds / body : 0.0) << "\n";
+    }
+
+    out << "\nMost executed statements:\n";
+    out << setw(8) << "line" << setw(8) << "kind" << setw(12) << "count" << "\n";
+    for (size_t i = 0; i < hot.size() && i < tableRows; i++)
+        out << setw(8) << hot[i]->stmt->line << setw(8) << kindName(hot[i]->stmt->kind) << setw(12) << hot[i]->count << "\n";
+    return out.str();
+}
@@ -0,0 +1,44 @@
+#ifndef RGR_PROFILE_H
+#define RGR_PROFILE_H
+
+#include <unordered_map>
+#include "TypedTree.h"
+
+/*
+ * Line-level execution profile.
+ *
+ * Every statement of the typed program but blocks gets a number in source order, and a profiled run (see
+ * ClosureEngine) adds one to the statement's counter each time it runs and the time spent in each run of a "while"
+ * or "for" loop, nested loops included, to the loop's total. The counters are dense arrays indexed by the number,
+ * so counting costs an increment per statement and timing two clock reads per run of a loop.
+ *
+ * The report is the source listing with every line preceded by the count of its most executed statement, then the
+ * loops sorted by time and the most executed statements.
+ */
+
+struct ProfiledStatement
+{
+    StmtPtr stmt;
+    size_t count;
+    long long nanoseconds;      // loops only
+};
+
+class Profile
+{
+private:
+    std::unordered_map<const Stmt*, size_t> numbers;
+
+    void add(StmtPtr stmt);
+public:
+    std::vector<ProfiledStatement> statements;
+
+    explicit Profile(const TypedProgram& program);
+
+    // counter of the statement, blocks have none
+    ProfiledStatement* find(StmtPtr stmt);
+
+    // the listing and the tables, for the source the program was compiled from
+    std::string report(const std::string& source) const;
+};
+
+#endif //RGR_PROFILE_H
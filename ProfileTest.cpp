@@ -0,0 +1,48 @@
+#include "catch.hpp"
+#include "TestSupport.h"
+#include "Closure.h"
+
+using namespace std;
+
+TEST_CASE( "profiled runs count statements and time loops", "[profile]" ) {
+    string code = "dim n, i, s integer\n"
+                  "read(n)\n"
+                  "for i as 1 to n do\n"
+                  "    if (i and 1) = 1 then s as s + i\n"
+                  "while s > 10 do s as s / 2\n"
+                  "write(s)\n";
+    TypedProgram program = lower(code);
+    Profile profile(program);
+
+    InputBuffer in("10");
+    OutputBuffer out;
+    ClosureEngine(program, 4, &profile).run(in, out);
+    REQUIRE (out.str() == "6\n");
+
+    vector<pair<size_t, size_t>> counts;
+    for (auto& statement : profile.statements)
+        counts.emplace_back(statement.stmt->line, statement.count);
+    REQUIRE (counts == (vector<pair<size_t, size_t>> { {2, 1}, {3, 1}, {4, 10}, {4, 5}, {5, 1}, {5, 2}, {6, 1} }));
+
+    for (auto& statement : profile.statements)
+        if (statement.stmt->kind == StmtKind::For || statement.stmt->kind == StmtKind::While)
+            REQUIRE (statement.nanoseconds > 0);
+        else
+            REQUIRE (statement.nanoseconds == 0);
+
+    string report = profile.report(code);
+    REQUIRE (report.find("          10 |     if (i and 1) = 1 then s as s + i\n") != string::npos);
+    REQUIRE (report.find("             | dim n, i, s integer\n") != string::npos);
+    REQUIRE (report.find("       3     for           1            10") != string::npos);
+    REQUIRE (report.find("Most executed statements:\n    line    kind       count\n       4      if          10\n") != string::npos);
+}
+
+TEST_CASE( "profiled runs keep the counts of a failing run", "[profile]" ) {
+    TypedProgram program = lower("dim i, x integer : for i as 0 to 5 do x as x + 10 / (3 - i)");
+    Profile profile(program);
+    InputBuffer in("");
+    OutputBuffer out;
+    REQUIRE_THROWS (ClosureEngine(program, 1, &profile).run(in, out));
+    REQUIRE (profile.statements[1].count == 4);
+    REQUIRE (profile.statements[0].nanoseconds > 0);
+}
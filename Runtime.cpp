@@ -0,0 +1,784 @@
+#include "Runtime.h"
+#include <cstdlib>
+#include <cctype>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+using namespace std;
+
+void execution_error(string error, size_t line)
+{
+    throw runtime_error("Runtime error on line " + to_string(line) + ": " + error);
+}
+
+namespace
+{
+    const size_t inputBlockSize = 1 << 20;
+    const size_t outputBlockSize = 1 << 20;
+
+    // value of every character as a digit, 100 for non-digits
+    struct DigitTable
+    {
+        unsigned char values[256];
+
+        DigitTable()
+        {
+            for (int c = 0; c < 256; c++)
+                values[c] = 100;
+            for (int c = '0'; c <= '9'; c++)
+                values[c] = (unsigned char)(c - '0');
+            for (int c = 'a'; c <= 'f'; c++)
+                values[c] = values[c - 'a' + 'A'] = (unsigned char)(c - 'a' + 10);
+        }
+    };
+
+    const DigitTable digitTable;
+
+    int digitValue(char c)
+    {
+        return digitTable.values[(unsigned char)c];
+    }
+
+    bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    // the characters isspace() takes in the C locale
+    bool isSpace(char c)
+    {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+    const char digitPairs[] =
+            "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+            "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+
+    size_t decimalLength(uint64_t value)
+    {
+        size_t length = 1;
+        for (uint64_t power = 10; length < 20 && value >= power; power *= 10)
+            length++;
+        return length;
+    }
+
+    // decimal digits of the number, written two at a time from the end, returns their count
+    size_t writeDigits(unsigned long long number, char* buffer)
+    {
+        size_t length = decimalLength(number);
+
+        char* ptr = buffer + length;
+        while (number >= 100)
+        {
+            ptr -= 2;
+            memcpy(ptr, digitPairs + number % 100 * 2, 2);
+            number /= 100;
+        }
+        if (number >= 10)
+            memcpy(ptr - 2, digitPairs + number * 2, 2);
+        else
+            ptr[-1] = char('0' + number);
+        return length;
+    }
+
+    // adds 8 decimal digits at once if the next 8 characters are digits: the digits of a little-endian word are
+    // checked together and combined pairwise into 2-, 4- and 8-digit numbers with three multiplications
+    bool addEightDigits(const char* ptr, unsigned long long& result)
+    {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        uint64_t chunk;
+        memcpy(&chunk, ptr, 8);
+        if (((chunk & 0xF0F0F0F0F0F0F0F0ULL) | (((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4))
+            != 0x3333333333333333ULL)
+            return false;
+
+        chunk -= 0x3030303030303030ULL;
+        chunk = (chunk * 10 + (chunk >> 8)) & 0x00FF00FF00FF00FFULL;
+        chunk = (chunk * 100 + (chunk >> 16)) & 0x0000FFFF0000FFFFULL;
+        chunk = (chunk * 10000 + (chunk >> 32)) & 0xFFFFFFFFULL;
+        result = result * 100000000 + chunk;
+        return true;
+#else
+        (void)ptr;
+        (void)result;
+        return false;
+#endif
+    }
+
+    const char* skipDigits(const char* ptr, const char* end)
+    {
+        while (ptr < end && isDigit(*ptr))
+            ptr++;
+        return ptr;
+    }
+}
+
+bool parseIntLiteral(const char* begin, const char* end, long long& value)
+{
+    bool negative = false;
+    if (begin < end && (*begin == '-' || *begin == '+'))
+        negative = *begin++ == '-';
+
+    if (begin == end)
+        return false;
+
+    int base = 10;
+    switch (end[-1])
+    {
+        case 'b': case 'B': base = 2; end--; break;
+        case 'o': case 'O': base = 8; end--; break;
+        case 'h': case 'H': base = 16; end--; break;
+        case 'd': case 'D': base = 10; end--; break;
+    }
+
+    // a hexadecimal number has to start with a digit, so that it can't be taken for an identifier
+    if (begin == end || !isDigit(*begin))
+        return false;
+
+    unsigned long long result = 0;
+    const char* ptr = begin;
+    if (base == 10)
+        while (end - ptr >= 8 && addEightDigits(ptr, result))
+            ptr += 8;
+
+    for (; ptr < end; ptr++)
+    {
+        int digit = digitValue(*ptr);
+        if (digit >= base)
+            return false;
+        result = result * base + digit;
+    }
+
+    value = (long long)(negative ? 0 - result : result);
+    return true;
+}
+
+bool parseFloatLiteral(const char* begin, const char* end, double& value)
+{
+    const char* ptr = begin;
+    if (ptr < end && (*ptr == '-' || *ptr == '+'))
+        ptr++;
+
+    const char* digitsEnd = skipDigits(ptr, end);
+    bool hasIntegerPart = digitsEnd != ptr;
+    bool hasFraction = false;
+    ptr = digitsEnd;
+
+    if (ptr < end && *ptr == '.')
+    {
+        digitsEnd = skipDigits(ptr + 1, end);
+        if (digitsEnd == ptr + 1)
+            return false;
+        hasFraction = true;
+        ptr = digitsEnd;
+    }
+
+    bool hasExponent = false;
+    if (ptr < end && (*ptr == 'e' || *ptr == 'E'))
+    {
+        ptr++;
+        if (ptr < end && (*ptr == '-' || *ptr == '+'))
+            ptr++;
+        digitsEnd = skipDigits(ptr, end);
+        if (digitsEnd == ptr)
+            return false;
+        hasExponent = true;
+        ptr = digitsEnd;
+    }
+
+    // digits with an exponent, or optional digits, a point, digits and an optional exponent
+    if (ptr != end || !(hasFraction || (hasIntegerPart && hasExponent)))
+        return false;
+
+    // strtod needs a terminated string, short literals are copied to the stack
+    char local[64];
+    if (end - begin < (ptrdiff_t)sizeof(local))
+    {
+        memcpy(local, begin, end - begin);
+        local[end - begin] = 0;
+        value = strtod(local, 0);
+    }
+    else
+        value = strtod(string(begin, end).c_str(), 0);
+    return true;
+}
+
+long long decodeIntLiteral(const string& literal)
+{
+    long long value;
+    if (!parseIntLiteral(literal.data(), literal.data() + literal.size(), value))
+        throw runtime_error(literal + " is not a valid integer literal");
+    return value;
+}
+
+double decodeFloatLiteral(const string& literal)
+{
+    double value;
+    if (!parseFloatLiteral(literal.data(), literal.data() + literal.size(), value))
+        throw runtime_error(literal + " is not a valid float literal");
+    return value;
+}
+
+size_t formatInt(long long value, char* buffer)
+{
+    unsigned long long magnitude = value < 0 ? 0 - (unsigned long long)value : (unsigned long long)value;
+    size_t length = value < 0;
+    if (value < 0)
+        buffer[0] = '-';
+    length += writeDigits(magnitude, buffer + length);
+    return length;
+}
+
+namespace
+{
+    const int powerOfFiveBits = 125;
+
+    // arbitrary precision unsigned numbers for computing the tables, 32-bit limbs, lowest first
+    typedef vector<uint32_t> BigNumber;
+
+    size_t bitLength(const BigNumber& n)
+    {
+        for (size_t i = n.size(); i > 0; i--)
+            for (int bit = 31; bit >= 0; bit--)
+                if (n[i - 1] >> bit & 1)
+                    return (i - 1) * 32 + bit + 1;
+        return 0;
+    }
+
+    bool bit(const BigNumber& n, long long position)
+    {
+        return position >= 0 && (size_t)position / 32 < n.size() && (n[position / 32] >> (position % 32) & 1);
+    }
+
+    void multiply(BigNumber& n, uint32_t factor)
+    {
+        uint64_t carry = 0;
+        for (auto& limb : n)
+        {
+            carry += (uint64_t)limb * factor;
+            limb = (uint32_t)carry;
+            carry >>= 32;
+        }
+        if (carry)
+            n.push_back((uint32_t)carry);
+    }
+
+    void shiftLeft(BigNumber& n)
+    {
+        uint32_t carry = 0;
+        for (auto& limb : n)
+        {
+            uint32_t next = limb >> 31;
+            limb = limb << 1 | carry;
+            carry = next;
+        }
+        if (carry)
+            n.push_back(carry);
+    }
+
+    // subtracts b if it's not greater, returns whether it did
+    bool subtractIfNotLess(BigNumber& a, const BigNumber& b)
+    {
+        size_t size = max(a.size(), b.size());
+        for (size_t i = size; i > 0; i--)
+        {
+            uint32_t x = i - 1 < a.size() ? a[i - 1] : 0, y = i - 1 < b.size() ? b[i - 1] : 0;
+            if (x != y)
+            {
+                if (x < y)
+                    return false;
+                break;
+            }
+        }
+        a.resize(size, 0);
+        int64_t borrow = 0;
+        for (size_t i = 0; i < size; i++)
+        {
+            borrow += (int64_t)a[i] - (i < b.size() ? b[i] : 0);
+            a[i] = (uint32_t)borrow;
+            borrow >>= 32;
+        }
+        return true;
+    }
+
+    void setBit(uint64_t word[2], int position)
+    {
+        word[position / 64] |= 1ULL << (position % 64);
+    }
+
+    struct PowerOfFiveTablesBuilder : PowerOfFiveTables
+    {
+        PowerOfFiveTablesBuilder()
+        {
+            memset(powers, 0, sizeof(powers));
+            memset(inverses, 0, sizeof(inverses));
+
+            BigNumber power = { 1 };
+            for (size_t i = 0; i < 342; i++, multiply(power, 5))
+            {
+                long long length = (long long)bitLength(power);
+                if (i < 326)
+                    for (int position = 0; position < powerOfFiveBits; position++)
+                        if (bit(power, length - powerOfFiveBits + position))
+                            setBit(powers[i], position);
+
+                // long division of 2^(length - 1 + 125), the first length - 1 bits of the quotient are 0
+                BigNumber remainder(length / 32 + 1, 0);
+                remainder[(length - 1) / 32] = 1U << ((length - 1) % 32);
+                uint64_t* inverse = inverses[i];
+                for (int position = powerOfFiveBits; position >= 0; position--)
+                {
+                    if (subtractIfNotLess(remainder, power))
+                        setBit(inverse, position);
+                    if (position > 0)
+                        shiftLeft(remainder);
+                }
+                if (++inverse[0] == 0)
+                    inverse[1]++;
+            }
+        }
+    };
+
+    // bit length of 5^e, log10(2^e) and log10(5^e) rounded down, for the exponents a double can need
+    int pow5Bits(int e) { return (int)(((uint32_t)e * 1217359) >> 19) + 1; }
+    int log10Pow2(int e) { return (int)(((uint32_t)e * 78913) >> 18); }
+    int log10Pow5(int e) { return (int)(((uint32_t)e * 732923) >> 20); }
+
+    bool multipleOfPowerOf5(uint64_t value, int count)
+    {
+        for (; count > 0; count--, value /= 5)
+            if (value % 5 != 0)
+                return false;
+        return true;
+    }
+
+    bool multipleOfPowerOf2(uint64_t value, int count)
+    {
+        return (value & ((1ULL << count) - 1)) == 0;
+    }
+
+    // m * multiplier / 2^shift, rounded down, for shifts from 65 to 127
+    uint64_t multiplyShift(uint64_t m, const uint64_t multiplier[2], int shift)
+    {
+#ifdef __SIZEOF_INT128__
+        unsigned __int128 low = (unsigned __int128)m * multiplier[0], high = (unsigned __int128)m * multiplier[1];
+        return (uint64_t)(((low >> 64) + high) >> (shift - 64));
+#else
+        auto product = [](uint64_t a, uint64_t b, uint64_t& productHigh) {
+            uint64_t a0 = (uint32_t)a, a1 = a >> 32, b0 = (uint32_t)b, b1 = b >> 32;
+            uint64_t middle = a1 * b0 + (a0 * b0 >> 32), other = a0 * b1 + (uint32_t)middle;
+            productHigh = a1 * b1 + (middle >> 32) + (other >> 32);
+            return a * b;
+        };
+        uint64_t lowHigh, highHigh;
+        product(m, multiplier[0], lowHigh);
+        uint64_t highLow = product(m, multiplier[1], highHigh);
+        uint64_t sum = highLow + lowHigh;
+        highHigh += sum < highLow;
+        return (sum >> (shift - 64)) | (highHigh << (128 - shift));
+#endif
+    }
+
+    /*
+     * The digits "%.*g" prints with the smallest precision that reads back as the value. Ryu's first step gives
+     * the value and the bounds of its rounding interval scaled down by 10^e10 to 17 or more digits, rounded
+     * down, and tells which of them were exact. Removing one digit after another, the value correctly rounded to
+     * the digits left is what "%.*g" prints at that precision; the shortest one inside the interval is kept.
+     * The interval ends belong to it for even significands, as the nearest-even rounding of reading takes ties
+     * there.
+     */
+    void shortestDigits(uint64_t fraction, int biasedExponent, uint64_t& digits, int& precision, int& exponent)
+    {
+        const PowerOfFiveTables& tables = powerOfFiveTables();
+
+        // the value is m2 * 2^(e2 + 2), the interval is [mv - 1 - mmShift, mv + 2] * 2^e2
+        int e2 = (biasedExponent ? biasedExponent : 1) - 1023 - 52 - 2;
+        uint64_t m2 = biasedExponent ? fraction | 1ULL << 52 : fraction;
+        bool acceptBounds = (m2 & 1) == 0;
+        uint64_t mv = 4 * m2;
+        int mmShift = fraction != 0 || biasedExponent <= 1;
+
+        uint64_t vr, vp, vm;
+        int e10;
+        bool vmIsTrailingZeros = false, vrIsTrailingZeros = false;
+        if (e2 >= 0)
+        {
+            int q = log10Pow2(e2) - (e2 > 3);
+            int shift = -e2 + q + powerOfFiveBits + pow5Bits(q) - 1;
+            e10 = q;
+            vr = multiplyShift(mv, tables.inverses[q], shift);
+            vp = multiplyShift(mv + 2, tables.inverses[q], shift);
+            vm = multiplyShift(mv - 1 - mmShift, tables.inverses[q], shift);
+            // only one of mv - 1 - mmShift, mv and mv + 2 can be a multiple of 5
+            if (q <= 21)
+            {
+                if (mv % 5 == 0)
+                    vrIsTrailingZeros = multipleOfPowerOf5(mv, q);
+                else if (acceptBounds)
+                    vmIsTrailingZeros = multipleOfPowerOf5(mv - 1 - mmShift, q);
+                else
+                    vp -= multipleOfPowerOf5(mv + 2, q);
+            }
+        }
+        else
+        {
+            int q = log10Pow5(-e2) - (-e2 > 1);
+            int i = -e2 - q;
+            int shift = q - (pow5Bits(i) - powerOfFiveBits);
+            e10 = q + e2;
+            vr = multiplyShift(mv, tables.powers[i], shift);
+            vp = multiplyShift(mv + 2, tables.powers[i], shift);
+            vm = multiplyShift(mv - 1 - mmShift, tables.powers[i], shift);
+            if (q <= 1)
+            {
+                // mv has at least 2 trailing zero bits, mv - 1 - mmShift is exact when it's mv - 2
+                vrIsTrailingZeros = true;
+                if (acceptBounds)
+                    vmIsTrailingZeros = mmShift == 1;
+                else
+                    vp--;
+            }
+            else if (q < 63)
+                vrIsTrailingZeros = multipleOfPowerOf2(mv, q);
+        }
+
+        // exact only when there are less than 18 digits, otherwise removing one is never too many
+        uint64_t best = vr;
+        int removed = 0, bestRemoved = 0;
+        int lastRemovedDigit = 0;
+        while (vr >= 10)
+        {
+            // no multiple of 10 left in the interval, nor of any higher power
+            if (vp / 10 < vm / 10 || (vp / 10 == vm / 10 && !(vmIsTrailingZeros && vm % 10 == 0)))
+                break;
+
+            vrIsTrailingZeros &= lastRemovedDigit == 0;
+            lastRemovedDigit = (int)(vr % 10);
+            vmIsTrailingZeros &= vm % 10 == 0;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+
+            bool tie = lastRemovedDigit == 5 && vrIsTrailingZeros;
+            uint64_t rounded = vr + (lastRemovedDigit > 5 || (lastRemovedDigit == 5 && !(tie && vr % 2 == 0)));
+            if (rounded <= vp && (rounded > vm || (rounded == vm && vmIsTrailingZeros)))
+            {
+                best = rounded;
+                bestRemoved = removed;
+            }
+        }
+
+        precision = (int)decimalLength(vr) + removed - bestRemoved;
+        digits = best;
+        exponent = e10 + bestRemoved + (int)decimalLength(best) - 1;
+    }
+}
+
+const PowerOfFiveTables& powerOfFiveTables()
+{
+    static const PowerOfFiveTablesBuilder tables;
+    return tables;
+}
+
+/*
+ * The shortest digits that read back as the value, laid out as printf's "%.*g" does with the smallest precision
+ * that round-trips, so the output stays that of the formatting loop trying precisions 1 to 17. The digits come
+ * from integer arithmetic alone, without printf, strtod or the locale.
+ */
+size_t formatFloat(double value, char* buffer)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint64_t fraction = bits & ((1ULL << 52) - 1);
+    int biasedExponent = (int)(bits >> 52 & 0x7ff);
+
+    if (biasedExponent == 0x7ff && fraction != 0)
+    {
+        memcpy(buffer, "nan", 3);
+        return 3;
+    }
+
+    size_t length = 0;
+    if (bits >> 63)
+        buffer[length++] = '-';
+    if (biasedExponent == 0x7ff)
+    {
+        memcpy(buffer + length, "inf", 3);
+        return length + 3;
+    }
+    if (biasedExponent == 0 && fraction == 0)
+    {
+        buffer[length++] = '0';
+        return length;
+    }
+
+    uint64_t significand;
+    int precision, exponent;
+    shortestDigits(fraction, biasedExponent, significand, precision, exponent);
+
+    char digits[maxFormattedLength];
+    size_t count = writeDigits(significand, digits);
+    while (count > 1 && digits[count - 1] == '0')
+        count--;
+
+    if (exponent < -4 || exponent >= precision)
+    {
+        buffer[length++] = digits[0];
+        if (count > 1)
+        {
+            buffer[length++] = '.';
+            memcpy(buffer + length, digits + 1, count - 1);
+            length += count - 1;
+        }
+        buffer[length++] = 'e';
+        buffer[length++] = exponent < 0 ? '-' : '+';
+        unsigned exponentMagnitude = (unsigned)std::abs(exponent);
+        if (exponentMagnitude < 10)
+            buffer[length++] = '0';
+        length += writeDigits(exponentMagnitude, buffer + length);
+    }
+    else if (exponent < 0)
+    {
+        buffer[length++] = '0';
+        buffer[length++] = '.';
+        for (int i = -1; i > exponent; i--)
+            buffer[length++] = '0';
+        memcpy(buffer + length, digits, count);
+        length += count;
+    }
+    else
+    {
+        size_t integerDigits = (size_t)exponent + 1;
+        for (size_t i = 0; i < integerDigits; i++)
+            buffer[length++] = i < count ? digits[i] : '0';
+        if (count > integerDigits)
+        {
+            buffer[length++] = '.';
+            memcpy(buffer + length, digits + integerDigits, count - integerDigits);
+            length += count - integerDigits;
+        }
+    }
+    return length;
+}
+
+InputBuffer::InputBuffer(FILE* _file) : file(_file), position(0), filled(0), open(false)
+{
+    struct stat info;
+    long offset = ftell(file);
+    if (fstat(fileno(file), &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0 && offset >= 0
+        && offset <= info.st_size)
+    {
+        size_t size = (size_t)info.st_size;
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+        if (mapped != MAP_FAILED)
+        {
+            madvise(mapped, size, MADV_SEQUENTIAL);
+            mapping = shared_ptr<const char>((const char*)mapped, [size](const char* data) { munmap((void*)data, size); });
+            position = (size_t)offset;
+            filled = size;
+            file = 0;
+            return;
+        }
+    }
+    buffer.resize(inputBlockSize);
+}
+
+InputBuffer::InputBuffer(const string& data)
+        : file(0), buffer(data.begin(), data.end()), position(0), filled(data.size()), open(false)
+{
+}
+
+InputBuffer::InputBuffer() : file(0), position(0), filled(0), open(true)
+{
+}
+
+void InputBuffer::feed(const char* data, size_t size)
+{
+    buffer.erase(buffer.begin(), buffer.begin() + position);
+    filled -= position;
+    position = 0;
+    buffer.insert(buffer.end(), data, data + size);
+    filled += size;
+}
+
+void InputBuffer::close()
+{
+    open = false;
+}
+
+bool InputBuffer::ready()
+{
+    if (!open)
+        return true;
+
+    while (position < filled && isSpace(buffer[position]))
+        position++;
+
+    size_t tokenEnd = position;
+    while (tokenEnd < filled && !isSpace(buffer[tokenEnd]))
+        tokenEnd++;
+    return tokenEnd < filled;
+}
+
+bool InputBuffer::refill()
+{
+    if (!file)
+        return false;
+
+    // keep the unread part, it may be the beginning of a token split between two blocks
+    if (position > 0)
+    {
+        memmove(buffer.data(), buffer.data() + position, filled - position);
+        filled -= position;
+        position = 0;
+    }
+
+    if (filled == buffer.size())
+        buffer.resize(buffer.size() * 2);
+
+    size_t count = fread(buffer.data() + filled, 1, buffer.size() - filled, file);
+    filled += count;
+    return count > 0;
+}
+
+void InputBuffer::nextToken(const char*& begin, const char*& end, size_t line)
+{
+    // refilling may move the buffer, the text is looked up again after it
+    const char* data = text();
+    for (;;)
+    {
+        while (position < filled && isSpace(data[position]))
+            position++;
+
+        if (position < filled)
+            break;
+
+        if (!refill())
+            execution_error("Unexpected end of input", line);
+        data = text();
+    }
+
+    size_t tokenEnd = position;
+    for (;;)
+    {
+        while (tokenEnd < filled && !isSpace(data[tokenEnd]))
+            tokenEnd++;
+
+        if (tokenEnd < filled)
+            break;
+
+        size_t offset = tokenEnd - position;
+        bool more = refill();
+        data = text();
+        tokenEnd = position + offset;
+        if (!more)
+            break;
+    }
+
+    begin = data + position;
+    end = data + tokenEnd;
+    position = tokenEnd;
+}
+
+long long InputBuffer::readInt(size_t line)
+{
+    const char *begin, *end;
+    nextToken(begin, end, line);
+
+    long long value;
+    if (!parseIntLiteral(begin, end, value))
+        execution_error("Integer expected, \"" + string(begin, end) + "\" found instead", line);
+    return value;
+}
+
+double InputBuffer::readFloat(size_t line)
+{
+    const char *begin, *end;
+    nextToken(begin, end, line);
+
+    double value;
+    if (parseFloatLiteral(begin, end, value))
+        return value;
+
+    long long intValue;
+    if (!parseIntLiteral(begin, end, intValue))
+        execution_error("Float expected, \"" + string(begin, end) + "\" found instead", line);
+    return (double)intValue;
+}
+
+bool InputBuffer::readBool(size_t line)
+{
+    const char *begin, *end;
+    nextToken(begin, end, line);
+
+    string token(begin, end);
+    if (token != "true" && token != "false")
+        execution_error("Bool expected, \"" + token + "\" found instead", line);
+    return token == "true";
+}
+
+OutputBuffer::OutputBuffer(FILE* _file) : file(_file), buffer(outputBlockSize), used(0), limit(SIZE_MAX), written(0)
+{
+}
+
+OutputBuffer::OutputBuffer() : file(0), buffer(outputBlockSize), used(0), limit(SIZE_MAX), written(0)
+{
+}
+
+OutputBuffer::~OutputBuffer()
+{
+    flush();
+}
+
+void OutputBuffer::writeInt(long long value)
+{
+    reserve(maxFormattedLength);
+    used += formatInt(value, buffer.data() + used);
+}
+
+void OutputBuffer::writeFloat(double value)
+{
+    reserve(maxFormattedLength);
+    used += formatFloat(value, buffer.data() + used);
+}
+
+void OutputBuffer::writeBool(bool value)
+{
+    reserve(5);
+    memcpy(buffer.data() + used, value ? "true" : "false", value ? 4 : 5);
+    used += value ? 4 : 5;
+}
+
+void OutputBuffer::flush()
+{
+    size_t count = written < limit ? min(used, limit - written) : 0;
+    if (file)
+    {
+        fwrite(buffer.data(), 1, count, file);
+        fflush(file);
+    }
+    else
+        collected.append(buffer.data(), count);
+
+    written += used;
+    used = 0;
+}
+
+string OutputBuffer::str()
+{
+    flush();
+    return collected;
+}
+
+string OutputBuffer::take()
+{
+    flush();
+    string result;
+    result.swap(collected);
+    return result;
+}
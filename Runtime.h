@@ -0,0 +1,126 @@
+#ifndef RGR_RUNTIME_H
+#define RGR_RUNTIME_H
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+/*
+ * Runtime support shared by the execution backends: literal decoding, arithmetic with the
+ * language's integer semantics and buffered input and output of values.
+ *
+ * Integers are 64-bit and wrap around on overflow, integer division truncates toward zero and
+ * fails on a zero divisor, "and", "or" and "not" are bitwise on integers. Floats are IEEE doubles.
+ *
+ * "write" prints its values separated by a space and ends the line, "read" takes whitespace separated
+ * values written with the same literal syntax the lexer accepts, optionally preceded by a sign.
+ */
+
+// value of a variable or a temporary, bools are stored as integer 0 or 1
+union Value
+{
+    long long i;
+    double f;
+};
+
+[[noreturn]] void execution_error(std::string error, size_t line);
+
+bool parseIntLiteral(const char* begin, const char* end, long long& value);
+bool parseFloatLiteral(const char* begin, const char* end, double& value);
+
+long long decodeIntLiteral(const std::string& literal);
+double decodeFloatLiteral(const std::string& literal);
+
+inline long long wrapAdd(long long a, long long b) { return (long long)((unsigned long long)a + (unsigned long long)b); }
+inline long long wrapSub(long long a, long long b) { return (long long)((unsigned long long)a - (unsigned long long)b); }
+inline long long wrapMul(long long a, long long b) { return (long long)((unsigned long long)a * (unsigned long long)b); }
+
+inline long long divideInt(long long a, long long b, size_t line)
+{
+    if (b == 0)
+        execution_error("Division by zero", line);
+
+    // the only overflowing quotient is LLONG_MIN / -1, which wraps around like the other operations
+    return b == -1 ? wrapSub(0, a) : a / b;
+}
+
+const size_t maxFormattedLength = 32;
+
+size_t formatInt(long long value, char* buffer);
+size_t formatFloat(double value, char* buffer);
+
+// the multipliers of the shortest float formatting, 5^i and 2^k / 5^i cut to their 125 leading bits, low word first;
+// backends formatting floats in generated code use the same tables
+struct PowerOfFiveTables
+{
+    uint64_t powers[326][2];        // 5^i rounded down
+    uint64_t inverses[342][2];      // 2^(bit length of 5^i - 1 + 125) / 5^i rounded up
+};
+
+const PowerOfFiveTables& powerOfFiveTables();
+
+class InputBuffer
+{
+private:
+    FILE* file;
+    std::vector<char> buffer;
+    std::shared_ptr<const char> mapping;    // a regular file is mapped whole instead of being read in blocks
+    size_t position, filled;
+    bool open;          // more input may be fed
+
+    const char* text() const { return mapping ? mapping.get() : buffer.data(); }
+    bool refill();
+    void nextToken(const char*& begin, const char*& end, size_t line);
+public:
+    explicit InputBuffer(FILE* _file);
+    explicit InputBuffer(const std::string& data);
+
+    // input arriving in pieces: it is fed as it comes and closed at its end
+    InputBuffer();
+    void feed(const char* data, size_t size);
+    void close();
+
+    // true if the next read can be done without waiting: a whole token, followed by a space, is buffered or no more
+    // input is coming; always true for a file or a string
+    bool ready();
+
+    long long readInt(size_t line);
+    double readFloat(size_t line);
+    bool readBool(size_t line);
+};
+
+class OutputBuffer
+{
+private:
+    FILE* file;
+    std::string collected;
+    std::vector<char> buffer;
+    size_t used;
+    size_t limit, written;      // bytes let through and bytes flushed so far, past the limit included
+
+    void reserve(size_t size) { if (used + size > buffer.size()) flush(); }
+public:
+    explicit OutputBuffer(FILE* _file);
+    OutputBuffer();
+    ~OutputBuffer();
+
+    void writeInt(long long value);
+    void writeFloat(double value);
+    void writeBool(bool value);
+    void writeChar(char c) { reserve(1); buffer[used++] = c; }
+    void flush();
+
+    // output past the limit is dropped, exceeded() tells when a write went past it
+    void setLimit(size_t bytes) { limit = bytes; }
+    bool exceeded() const { return written + used > limit; }
+
+    // output collected so far when the buffer is not attached to a file
+    std::string str();
+    // the same, leaving the collected output empty
+    std::string take();
+};
+
+#endif //RGR_RUNTIME_H
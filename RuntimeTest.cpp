@@ -0,0 +1,193 @@
+#include "catch.hpp"
+#include "Runtime.h"
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+namespace
+{
+    string formatted(double value)
+    {
+        char buffer[maxFormattedLength];
+        return string(buffer, formatFloat(value, buffer));
+    }
+
+    // the smallest "%.*g" precision that reads back as the value
+    string shortestByPrintf(double value)
+    {
+        char buffer[maxFormattedLength];
+        for (int precision = 1; precision <= 17; precision++)
+        {
+            snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+            if (strtod(buffer, 0) == value)
+                break;
+        }
+        return buffer;
+    }
+}
+
+TEST_CASE( "literal decoding", "[runtime]" ) {
+    SECTION( "integer literals in all bases" ) {
+        REQUIRE (decodeIntLiteral("423423") == 423423);
+        REQUIRE (decodeIntLiteral("423423d") == 423423);
+        REQUIRE (decodeIntLiteral("423423D") == 423423);
+        REQUIRE (decodeIntLiteral("17o") == 15);
+        REQUIRE (decodeIntLiteral("0111011b") == 59);
+        REQUIRE (decodeIntLiteral("0ffh") == 255);
+        REQUIRE (decodeIntLiteral("1bH") == 27);
+        REQUIRE (decodeIntLiteral("-12") == -12);
+        REQUIRE (decodeIntLiteral("18446744073709551615") == -1);
+
+        REQUIRE_THROWS (decodeIntLiteral("423423b"));
+        REQUIRE_THROWS (decodeIntLiteral("423428O"));
+        REQUIRE_THROWS (decodeIntLiteral("ffh"));
+        REQUIRE_THROWS (decodeIntLiteral("1.5"));
+    }
+
+    SECTION( "long decimal literals, decoded 8 digits at a time, wrap around as digit by digit" ) {
+        REQUIRE (decodeIntLiteral("1234567890123456789") == 1234567890123456789LL);
+        REQUIRE (decodeIntLiteral("-00000000000000000009223372036854775808") == LLONG_MIN);
+        REQUIRE (decodeIntLiteral("36893488147419103232") == 0);
+        REQUIRE (decodeIntLiteral("99999999999999999999999999d") == (long long)15908979783594147839ULL);
+        REQUIRE (decodeIntLiteral("12345678") == 12345678);
+
+        REQUIRE_THROWS (decodeIntLiteral("1234567/12345678"));
+        REQUIRE_THROWS (decodeIntLiteral("12345678:1234567"));
+        REQUIRE_THROWS (decodeIntLiteral("123456781234567a"));
+
+        // every digit of every position against the digit by digit rule
+        for (char digit = '0'; digit <= '9'; digit++)
+            for (size_t place = 0; place < 20; place++)
+            {
+                string literal(20, '7');
+                literal[place] = digit;
+                unsigned long long expected = 0;
+                for (char c : literal)
+                    expected = expected * 10 + (c - '0');
+                REQUIRE (decodeIntLiteral(literal) == (long long)expected);
+            }
+    }
+
+    SECTION( "float literals" ) {
+        REQUIRE (decodeFloatLiteral("1.5") == 1.5);
+        REQUIRE (decodeFloatLiteral(".25") == 0.25);
+        REQUIRE (decodeFloatLiteral("1e3") == 1000.0);
+        REQUIRE (decodeFloatLiteral("1.5e+2") == 150.0);
+        REQUIRE (decodeFloatLiteral(".5e-1") == 0.05);
+
+        REQUIRE_THROWS (decodeFloatLiteral("15"));
+        REQUIRE_THROWS (decodeFloatLiteral("1."));
+        REQUIRE_THROWS (decodeFloatLiteral(".3.3"));
+        REQUIRE_THROWS (decodeFloatLiteral("1e"));
+    }
+}
+
+TEST_CASE( "value formatting", "[runtime]" ) {
+    REQUIRE (formatted(0.1) == "0.1");
+    REQUIRE (formatted(1.5) == "1.5");
+    REQUIRE (formatted(3.0) == "3");
+    REQUIRE (formatted(1e20) == "1e+20");
+    REQUIRE (formatted(1.0 / 3) == "0.3333333333333333");
+    REQUIRE (formatted(-2.5e-7) == "-2.5e-07");
+
+    OutputBuffer output;
+    output.writeInt(-9223372036854775807LL - 1);
+    output.writeChar(' ');
+    output.writeBool(true);
+    output.writeChar(' ');
+    output.writeFloat(2.75);
+    REQUIRE (output.str() == "-9223372036854775808 true 2.75");
+}
+
+TEST_CASE( "float formatting matches the shortest printf precision", "[runtime]" ) {
+    vector<double> values = { 0.0, -0.0, 1.0, 0.1, 0.1 + 0.2, 1e15, 1e16, 123456789012345.0, 1234567890123456.0,
+                              1e-5, 1.5e-5, 0.0001, 1e21, 1.0 / 3, 2.0 / 3, 5e-324, 2.2250738585072014e-308,
+                              1.7976931348623157e308, 9.999999999999999e22, 100.0, 1e100, -42.125 };
+    uint64_t bits = 0x123456789abcdefULL;
+    for (int i = 0; i < 100000; i++)
+    {
+        bits = bits * 6364136223846793005ULL + 1442695040888963407ULL;
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        if (!std::isnan(value) && !std::isinf(value))
+            values.push_back(value);
+        values.push_back((double)(long long)(bits >> 20) / 1000);
+    }
+
+    // powers of two have a narrower interval below them, subnormals have few significant bits
+    for (int exponent = -1074; exponent <= 1023; exponent++)
+    {
+        double power = ldexp(1.0, exponent);
+        for (double value : { power, nextafter(power, 0.0), nextafter(power, INFINITY) })
+            values.push_back(value);
+    }
+    for (uint64_t subnormal = 1; subnormal < 1000; subnormal++)
+    {
+        double value;
+        memcpy(&value, &subnormal, sizeof(value));
+        values.push_back(value);
+    }
+
+    for (double value : values)
+        REQUIRE (formatted(value) == shortestByPrintf(value));
+}
+
+TEST_CASE( "buffered input", "[runtime]" ) {
+    InputBuffer input("12 0fh\n -3 true\t1.5e1 7 false");
+
+    REQUIRE (input.readInt(1) == 12);
+    REQUIRE (input.readInt(1) == 15);
+    REQUIRE (input.readInt(1) == -3);
+    REQUIRE (input.readBool(1) == true);
+    REQUIRE (input.readFloat(1) == 15.0);
+    REQUIRE (input.readFloat(1) == 7.0);
+    REQUIRE_THROWS (input.readInt(1));
+    REQUIRE_THROWS (input.readInt(1));
+}
+
+TEST_CASE( "fed input", "[runtime]" ) {
+    InputBuffer input;
+    REQUIRE (!input.ready());
+
+    input.feed(" 1", 2);
+    REQUIRE (!input.ready());
+    input.feed("2 3", 3);
+    REQUIRE (input.ready());
+    REQUIRE (input.readInt(1) == 12);
+    REQUIRE (!input.ready());
+
+    input.close();
+    REQUIRE (input.ready());
+    REQUIRE (input.readInt(1) == 3);
+    REQUIRE_THROWS (input.readInt(1));
+}
+
+TEST_CASE( "output limit", "[runtime]" ) {
+    OutputBuffer output;
+    output.setLimit(6);
+    output.writeInt(1234);
+    REQUIRE (!output.exceeded());
+    output.writeChar(' ');
+    output.writeBool(false);
+    REQUIRE (output.exceeded());
+    REQUIRE (output.str() == "1234 f");
+}
+
+TEST_CASE( "mapped input", "[runtime]" ) {
+    FILE* file = tmpfile();
+    const char* text = "  12 0fh -3\n1.5e1 true 77777777777";
+    fwrite(text, 1, strlen(text), file);
+    rewind(file);
+
+    InputBuffer input(file);
+    REQUIRE (input.readInt(1) == 12);
+    REQUIRE (input.readInt(1) == 15);
+    REQUIRE (input.readInt(1) == -3);
+    REQUIRE (input.readFloat(1) == 15.0);
+    REQUIRE (input.readBool(1) == true);
+    REQUIRE (input.readInt(1) == 77777777777LL);
+    REQUIRE_THROWS (input.readInt(1));
+    fclose(file);
+}
@@ -0,0 +1,241 @@
+#include "Scheduler.h"
+using namespace std;
+
+struct Scheduler::Instance
+{
+    shared_ptr<const BytecodeProgram> program;
+    VirtualMachine vm;
+    InputBuffer input;          // only touched by the worker running the instance
+
+    // the rest is guarded by the mutex, as the host feeds input and takes output while the instance runs
+    std::mutex guard;
+    string incoming, output, error;
+    bool closing;
+    InstanceState state;
+
+    explicit Instance(shared_ptr<const BytecodeProgram> _program)
+            : program(_program), vm(*_program), closing(false), state(InstanceState::Runnable)
+    {
+    }
+};
+
+Scheduler::Scheduler(size_t threads, size_t _quantum)
+        : quantum(_quantum), queued(0), runnable(0), stopping(false), nextWorker(0)
+{
+    threads = max<size_t>(threads, 1);
+    for (size_t i = 0; i < threads; i++)
+        workers.emplace_back(new Worker());
+    for (size_t i = 0; i < threads; i++)
+        this->threads.emplace_back([this, i] { loop(i); });
+}
+
+Scheduler::~Scheduler()
+{
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+Scheduler::Instance& Scheduler::find(size_t id)
+{
+    lock_guard<std::mutex> lock(instancesMutex);
+    if (id >= instances.size())
+        throw runtime_error("No instance " + to_string(id));
+    return *instances[id];
+}
+
+void Scheduler::push(Instance* instance, size_t worker)
+{
+    {
+        lock_guard<std::mutex> lock(workers[worker]->mutex);
+        workers[worker]->queue.push_back(instance);
+    }
+    {
+        lock_guard<std::mutex> lock(mutex);
+        queued++;
+    }
+    wake.notify_one();
+}
+
+// a worker takes from the front of its own queue, a thief from the end of another's
+Scheduler::Instance* Scheduler::pop(size_t worker, bool own)
+{
+    Worker& from = *workers[worker];
+    lock_guard<std::mutex> lock(from.mutex);
+    if (from.queue.empty())
+        return nullptr;
+
+    Instance* instance;
+    if (own)
+    {
+        instance = from.queue.front();
+        from.queue.pop_front();
+    }
+    else
+    {
+        instance = from.queue.back();
+        from.queue.pop_back();
+    }
+    queued--;
+    return instance;
+}
+
+Scheduler::Instance* Scheduler::take(size_t worker)
+{
+    while (!stopping)
+    {
+        if (Instance* instance = pop(worker, true))
+            return instance;
+        for (size_t i = 1; i < workers.size(); i++)
+            if (Instance* instance = pop((worker + i) % workers.size(), false))
+                return instance;
+
+        unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [&] { return stopping || queued > 0; });
+    }
+    return nullptr;
+}
+
+void Scheduler::runSlice(Instance& instance, size_t worker, OutputBuffer& output)
+{
+    {
+        lock_guard<std::mutex> lock(instance.guard);
+        if (!instance.incoming.empty())
+        {
+            instance.input.feed(instance.incoming.data(), instance.incoming.size());
+            instance.incoming.clear();
+        }
+        if (instance.closing)
+            instance.input.close();
+    }
+
+    VmStatus status;
+    string error;
+    try
+    {
+        status = instance.vm.resume(instance.input, output, quantum);
+    }
+    catch (exception& e)
+    {
+        status = VmStatus::Finished;
+        error = e.what();
+    }
+    string written = output.take();
+
+    bool requeue = false;
+    {
+        lock_guard<std::mutex> lock(instance.guard);
+        instance.output += written;
+        instance.error = error;
+
+        // input fed while the instance ran may already be what the read waits for
+        if (status == VmStatus::Suspended && (!instance.incoming.empty() || instance.closing))
+            status = VmStatus::Preempted;
+
+        if (status == VmStatus::Preempted)
+            requeue = true;
+        else
+            instance.state = status == VmStatus::Suspended ? InstanceState::Waiting : InstanceState::Finished;
+    }
+
+    if (requeue)
+    {
+        push(&instance, worker);
+        return;
+    }
+
+    lock_guard<std::mutex> lock(mutex);
+    if (--runnable == 0)
+        idle.notify_all();
+}
+
+// the instance becomes runnable, instances started or woken up by the host go to the workers in turn
+void Scheduler::schedule(Instance& instance)
+{
+    {
+        lock_guard<std::mutex> lock(mutex);
+        runnable++;
+    }
+    push(&instance, nextWorker++ % workers.size());
+}
+
+void Scheduler::loop(size_t worker)
+{
+    // instances write into the worker's buffer, which is emptied into the instance's output after every slice
+    OutputBuffer output;
+    while (Instance* instance = take(worker))
+        runSlice(*instance, worker, output);
+}
+
+size_t Scheduler::spawn(shared_ptr<const BytecodeProgram> program)
+{
+    Instance* instance;
+    size_t id;
+    {
+        lock_guard<std::mutex> lock(instancesMutex);
+        id = instances.size();
+        instances.emplace_back(new Instance(program));
+        instance = instances.back().get();
+    }
+    schedule(*instance);
+    return id;
+}
+
+void Scheduler::feed(size_t id, const string& data)
+{
+    Instance& instance = find(id);
+    {
+        lock_guard<std::mutex> lock(instance.guard);
+        instance.incoming += data;
+        if (instance.state != InstanceState::Waiting)
+            return;
+        instance.state = InstanceState::Runnable;
+    }
+    schedule(instance);
+}
+
+void Scheduler::close(size_t id)
+{
+    Instance& instance = find(id);
+    {
+        lock_guard<std::mutex> lock(instance.guard);
+        instance.closing = true;
+        if (instance.state != InstanceState::Waiting)
+            return;
+        instance.state = InstanceState::Runnable;
+    }
+    schedule(instance);
+}
+
+void Scheduler::wait()
+{
+    unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [&] { return runnable == 0; });
+}
+
+InstanceState Scheduler::state(size_t id)
+{
+    Instance& instance = find(id);
+    lock_guard<std::mutex> lock(instance.guard);
+    return instance.state;
+}
+
+string Scheduler::takeOutput(size_t id)
+{
+    Instance& instance = find(id);
+    lock_guard<std::mutex> lock(instance.guard);
+    string result;
+    result.swap(instance.output);
+    return result;
+}
+
+string Scheduler::error(size_t id)
+{
+    Instance& instance = find(id);
+    lock_guard<std::mutex> lock(instance.guard);
+    return instance.error;
+}
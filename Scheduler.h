@@ -0,0 +1,87 @@
+#ifndef RGR_SCHEDULER_H
+#define RGR_SCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "VM.h"
+
+/*
+ * Many program instances in one process.
+ *
+ * An instance is a VM with its own registers, input and output, sharing the bytecode with the other instances of
+ * the program. Its input is fed in pieces as it arrives; a "read" finding no whole token waits without blocking a
+ * thread: the instance is suspended at the read and set runnable again when more input is fed or the input is
+ * closed.
+ *
+ * Runnable instances are spread across worker threads, each with its own queue. A worker runs the instance at the
+ * front of its queue for a quantum of jumps and puts it back at the end if it isn't done, so that long loops share
+ * the thread fairly; a worker with an empty queue steals from the end of another's.
+ */
+
+enum class InstanceState
+{
+    Runnable,       // queued or running
+    Waiting,        // suspended at a read until more input is fed
+    Finished        // halted or stopped by a runtime error
+};
+
+class Scheduler
+{
+private:
+    struct Instance;
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Instance*> queue;
+    };
+
+    size_t quantum;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex instancesMutex;
+    std::deque<std::unique_ptr<Instance>> instances;
+
+    // guards sleeping workers and the count of runnable instances
+    std::mutex mutex;
+    std::condition_variable wake, idle;
+    std::atomic<size_t> queued;
+    size_t runnable;
+    std::atomic<bool> stopping;
+    std::atomic<size_t> nextWorker;
+
+    Instance& find(size_t id);
+    void push(Instance* instance, size_t worker);
+    Instance* pop(size_t worker, bool own);
+    Instance* take(size_t worker);
+    void schedule(Instance& instance);
+    void runSlice(Instance& instance, size_t worker, OutputBuffer& output);
+    void loop(size_t worker);
+public:
+    // the quantum is the number of jumps an instance runs before giving way
+    explicit Scheduler(size_t threads, size_t _quantum = 10000);
+    ~Scheduler();
+
+    // starts an instance of the program and returns its id, ids are numbered from 0
+    size_t spawn(std::shared_ptr<const BytecodeProgram> program);
+
+    // appends to the instance's input
+    void feed(size_t id, const std::string& data);
+    // no more input is coming, reads past its end fail as they do on a file
+    void close(size_t id);
+
+    // waits until no instance can run on: each has finished or waits for input
+    void wait();
+
+    InstanceState state(size_t id);
+    // output written since the last call
+    std::string takeOutput(size_t id);
+    // runtime error the instance stopped with, empty if it didn't
+    std::string error(size_t id);
+};
+
+#endif //RGR_SCHEDULER_H
@@ -0,0 +1,112 @@
+#include "catch.hpp"
+#include "TestSupport.h"
+#include "Scheduler.h"
+#include <chrono>
+
+using namespace std;
+
+namespace
+{
+    shared_ptr<const BytecodeProgram> compileShared(string code)
+    {
+        return make_shared<BytecodeProgram>(compile(code));
+    }
+}
+
+TEST_CASE( "resumed VM waits for whole tokens", "[scheduler]" ) {
+    auto program = compileShared("dim a, b integer : read(a) : write(a) : read(b) : write(a + b)");
+    VirtualMachine vm(*program);
+    InputBuffer input;
+    OutputBuffer output;
+
+    REQUIRE (vm.resume(input, output, 100) == VmStatus::Suspended);
+    input.feed("4", 1);
+    REQUIRE (vm.resume(input, output, 100) == VmStatus::Suspended);
+    input.feed("0 5", 3);
+    REQUIRE (vm.resume(input, output, 100) == VmStatus::Suspended);
+    REQUIRE (output.str() == "40\n");
+    input.close();
+    REQUIRE (vm.resume(input, output, 100) == VmStatus::Finished);
+    REQUIRE (output.str() == "40\n45\n");
+
+    auto loop = compileShared("dim i, s integer : for i as 1 to 1000 do s as s + i : write(s)");
+    VirtualMachine counting(*loop);
+    InputBuffer none("");
+    OutputBuffer sum;
+    size_t slices = 1;
+    while (counting.resume(none, sum, 10) == VmStatus::Preempted)
+        slices++;
+    REQUIRE (slices > 100);
+    REQUIRE (sum.str() == "500500\n");
+}
+
+TEST_CASE( "scheduled instances match the VM", "[scheduler]" ) {
+    vector<string> programs = {
+            "dim a, b integer : read(a, b) : write(a + b, a * b, a - b, a / b)",
+            "dim n, s, i integer : read(n) : n as n and 1023 : for i as 1 to n do begin read(s) : write(s * i) end",
+            "dim f float : dim b bool : read(f, b) : while b do begin write(f) : read(f, b) end",
+    };
+    vector<string> inputs = { "7 2", "1 0 3 4 5", "2.5 true 3 true -1 false", "12 true abc", "3 1 2 3 4", "" };
+
+    Scheduler scheduler(3, 7);
+    vector<pair<size_t, string>> expected;
+    vector<size_t> ids;
+    for (auto& code : programs)
+    {
+        auto program = compileShared(code);
+        for (auto& input : inputs)
+            for (int copy = 0; copy < 20; copy++)
+            {
+                ids.push_back(scheduler.spawn(program));
+                expected.emplace_back(ids.back(), runVM(*program, input));
+            }
+    }
+
+    // the inputs arrive a character at a time, interleaved across the instances
+    size_t longest = 0;
+    for (auto& input : inputs)
+        longest = max(longest, input.size());
+    for (size_t position = 0; position < longest; position++)
+        for (size_t i = 0; i < ids.size(); i++)
+        {
+            const string& input = inputs[i / 20 % inputs.size()];
+            if (position < input.size())
+                scheduler.feed(ids[i], input.substr(position, 1));
+        }
+    for (auto id : ids)
+        scheduler.close(id);
+    scheduler.wait();
+
+    for (auto& result : expected)
+    {
+        REQUIRE (scheduler.state(result.first) == InstanceState::Finished);
+        REQUIRE ((scheduler.takeOutput(result.first) + scheduler.error(result.first)) == result.second);
+    }
+}
+
+TEST_CASE( "scheduler suspends instances and shares threads", "[scheduler]" ) {
+    Scheduler scheduler(1, 100);
+    size_t echo = scheduler.spawn(compileShared("dim a integer : while true do begin read(a) : write(a) end"));
+    scheduler.wait();
+    REQUIRE (scheduler.state(echo) == InstanceState::Waiting);
+
+    scheduler.feed(echo, "5 6");
+    scheduler.wait();
+    REQUIRE (scheduler.state(echo) == InstanceState::Waiting);
+    REQUIRE (scheduler.takeOutput(echo) == "5\n");
+    REQUIRE (scheduler.takeOutput(echo) == "");
+
+    scheduler.close(echo);
+    scheduler.wait();
+    REQUIRE (scheduler.state(echo) == InstanceState::Finished);
+    REQUIRE (scheduler.takeOutput(echo) == "6\n");
+    REQUIRE (scheduler.error(echo) == "Runtime error on line 1: Unexpected end of input");
+
+    // an endless loop on the only thread gives way to the other instance
+    scheduler.spawn(compileShared("dim x integer : while true do x as x + 1"));
+    size_t finite = scheduler.spawn(compileShared("dim i, s integer : for i as 1 to 100000 do s as s + i : write(s)"));
+    for (int tries = 0; tries < 1000 && scheduler.state(finite) != InstanceState::Finished; tries++)
+        this_thread::sleep_for(chrono::milliseconds(10));
+    REQUIRE (scheduler.state(finite) == InstanceState::Finished);
+    REQUIRE (scheduler.takeOutput(finite) == "5000050000\n");
+}
@@ -0,0 +1,197 @@
+#include "Snapshot.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+namespace
+{
+    const char magic[8] = { 'R', 'G', 'R', 'S', 'N', 'A', 'P', 0 };
+    const uint32_t version = 2;
+    const uint32_t byteOrderMark = 0x01020304;
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint64_t checksum;          // of everything after the header
+        uint64_t entry;
+        uint64_t instructionCount;
+        uint64_t registerCount;
+        uint64_t outputSize;
+    };
+
+    // the sections are laid out as in memory, each aligned for the VM to use in place
+    static_assert(sizeof(Header) % alignof(Instruction) == 0 && sizeof(Instruction) % alignof(size_t) == 0
+                  && sizeof(Header) % alignof(size_t) == 0 && sizeof(size_t) == sizeof(Value), "unaligned sections");
+
+    uint64_t fnv1a(const char* data, size_t size)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= (unsigned char)data[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    template<class T>
+    void append(string& data, const T& value)
+    {
+        data.append((const char*)&value, sizeof(value));
+    }
+
+    // known instructions with register operands and jump targets in range, so the VM never reads outside its arrays
+    bool isValidCode(const BytecodeImage& program)
+    {
+        size_t registers = program.registerCount, instructions = program.size;
+        auto isRegister = [&](int32_t operand) { return operand == 0 || (operand > 0 && (size_t)operand < registers); };
+        auto isTarget = [&](int32_t operand) { return operand >= 0 && (size_t)operand < instructions; };
+
+        for (size_t i = 0; i < instructions; i++)
+        {
+            const Instruction& in = program.code[i];
+            if (in.op > OpCode::WRITE_LINE)
+                return false;
+            switch (in.op)
+            {
+                case OpCode::JMP:
+                    if (!isTarget(in.a))
+                        return false;
+                    break;
+                case OpCode::JMP_IF_FALSE:
+                case OpCode::JMP_IF_TRUE:
+                    if (!isRegister(in.a) || !isTarget(in.b))
+                        return false;
+                    break;
+                default:
+                    if (!isRegister(in.a) || !isRegister(in.b) || !isRegister(in.c))
+                        return false;
+            }
+        }
+
+        // the code ends with HALT, so execution can't run past it
+        return instructions > 0 && program.code[instructions - 1].op == OpCode::HALT && program.entry < instructions;
+    }
+
+    // the whole file, unmapped when the last copy of the pointer goes
+    shared_ptr<const char> mapFile(const string& fileName, size_t& size)
+    {
+        int fd = open(fileName.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw runtime_error("Couldn't open snapshot " + fileName);
+
+        void* data = MAP_FAILED;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            size = (size_t)info.st_size;
+            data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        ::close(fd);
+        if (data == MAP_FAILED)
+            throw runtime_error("Couldn't read snapshot " + fileName);
+        return shared_ptr<const char>((const char*)data, [size](const char* mapped) { munmap((void*)mapped, size); });
+    }
+}
+
+Snapshot takeSnapshot(const BytecodeProgram& program)
+{
+    VirtualMachine vm(program);
+    InputBuffer input;
+    OutputBuffer output;
+    vm.resume(input, output, SIZE_MAX);
+
+    Snapshot snapshot { program, output.str() };
+    snapshot.program.initialRegisters = vm.getRegisters();
+    snapshot.program.entry = vm.position();
+    return snapshot;
+}
+
+void saveSnapshot(const Snapshot& snapshot, const string& fileName)
+{
+    const BytecodeProgram& program = snapshot.program;
+    string body;
+    for (auto& in : program.code)
+    {
+        // the padding is zeroed, so that the checksum doesn't depend on it
+        Instruction saved;
+        memset(&saved, 0, sizeof(saved));
+        saved.op = in.op;
+        saved.a = in.a;
+        saved.b = in.b;
+        saved.c = in.c;
+        append(body, saved);
+    }
+    for (auto line : program.lines)
+        append(body, line);
+    for (auto& value : program.initialRegisters)
+        append(body, value.i);
+    body += snapshot.output;
+
+    Header header;
+    memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.byteOrder = byteOrderMark;
+    header.checksum = fnv1a(body.data(), body.size());
+    header.entry = program.entry;
+    header.instructionCount = program.code.size();
+    header.registerCount = program.initialRegisters.size();
+    header.outputSize = snapshot.output.size();
+
+    FILE* file = fopen(fileName.c_str(), "wb");
+    if (!file)
+        throw runtime_error("Couldn't write snapshot " + fileName);
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(body.data(), 1, body.size(), file) == body.size();
+    if (fclose(file) != 0 || !written)
+        throw runtime_error("Couldn't write snapshot " + fileName);
+}
+
+RestoredSnapshot loadSnapshot(const string& fileName)
+{
+    size_t length = 0;
+    shared_ptr<const char> file = mapFile(fileName, length);
+    auto invalid = [&](const string& reason) { return runtime_error("Invalid snapshot " + fileName + ": " + reason); };
+
+    Header header;
+    if (length < sizeof(header))
+        throw invalid("too short");
+    memcpy(&header, file.get(), sizeof(header));
+    if (memcmp(header.magic, magic, sizeof(magic)) != 0)
+        throw invalid("not a snapshot");
+    if (header.version != version)
+        throw invalid("format version " + to_string(header.version) + ", expected " + to_string(version));
+    if (header.byteOrder != byteOrderMark)
+        throw invalid("saved with another byte order");
+
+    // the sizes are checked one by one, so that their sum can't overflow
+    const char* ptr = file.get() + sizeof(header);
+    size_t left = length - sizeof(header);
+    auto take = [&](uint64_t count, size_t size) {
+        if (count > left / size)
+            throw invalid("truncated");
+        const char* section = ptr;
+        ptr += count * size;
+        left -= count * size;
+        return section;
+    };
+    const char* body = ptr;
+    const char* instructions = take(header.instructionCount, sizeof(Instruction));
+    const char* lines = take(header.instructionCount, sizeof(size_t));
+    const char* registers = take(header.registerCount, sizeof(Value));
+    const char* output = take(header.outputSize, 1);
+    if (left != 0)
+        throw invalid("trailing data");
+    if (fnv1a(body, ptr - body) != header.checksum)
+        throw invalid("checksum mismatch");
+
+    BytecodeImage program((const Instruction*)instructions, (const size_t*)lines, header.instructionCount,
+                          (const Value*)registers, header.registerCount, header.entry);
+    if (!isValidCode(program))
+        throw invalid("unknown instructions or operands out of range");
+    return RestoredSnapshot { file, program, output, header.outputSize };
+}
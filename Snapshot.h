@@ -0,0 +1,44 @@
+#ifndef RGR_SNAPSHOT_H
+#define RGR_SNAPSHOT_H
+
+#include "VM.h"
+
+/*
+ * Snapshots of programs stopped at their first read.
+ *
+ * A program is run by the VM until a "read" finds no input, then its compiled code, registers, the instruction it
+ * stopped at and the output it has written are saved to a file. Restoring the file gives a bytecode program that
+ * starts at that instruction with the saved registers, so a run skips both compiling and the work done before the
+ * first read. A program that doesn't read is saved finished, with all of its output.
+ *
+ * The file is a header (magic, format version, byte order mark, FNV-1a checksum of the rest and the section sizes)
+ * followed by the instructions, their lines, the registers and the output, each in the machine's own layout and
+ * byte order. Loading maps the file into memory and, once the checks pass, the VM runs the code where it lies in
+ * the mapping: nothing is decoded or copied but the registers, which the VM writes. A file of another version, byte
+ * order or with a wrong checksum is refused, as is code with unknown instructions or operands out of range.
+ */
+
+struct Snapshot
+{
+    BytecodeProgram program;
+    std::string output;     // written before the snapshot was taken
+};
+
+// runs the program up to its first read, runtime errors on the way are thrown
+Snapshot takeSnapshot(const BytecodeProgram& program);
+
+// a snapshot file mapped into memory, the program and the output point into the mapping and are valid while a copy
+// of the snapshot is
+struct RestoredSnapshot
+{
+    std::shared_ptr<const char> file;
+    BytecodeImage program;
+    const char* output;
+    size_t outputSize;
+};
+
+// both throw std::runtime_error when the file can't be written or read back
+void saveSnapshot(const Snapshot& snapshot, const std::string& fileName);
+RestoredSnapshot loadSnapshot(const std::string& fileName);
+
+#endif //RGR_SNAPSHOT_H
@@ -0,0 +1,104 @@
+#include "catch.hpp"
+#include "TestSupport.h"
+#include "Snapshot.h"
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+    string temporaryName()
+    {
+        char name[] = "/tmp/rgr_snapshotXXXXXX";
+        close(mkstemp(name));
+        return name;
+    }
+}
+
+TEST_CASE( "restored snapshots go on as the program would", "[snapshot]" ) {
+    vector<string> programs = {
+            "dim i, s integer : for i as 1 to 100000 do s as s + i * i : write(s) : read(i) : write(s + i)",
+            "dim a, b integer : dim f float : f as 1.5 : read(a, b) : write(a / b, f)",
+            "dim i integer : for i as 1 to 3 do write(i)",
+            "dim x integer : write(7) : x as 1 / x",
+    };
+    vector<string> inputs = { "5 2", "3 0", "", "x" };
+    string fileName = temporaryName();
+
+    for (auto& code : programs)
+    {
+        BytecodeProgram program = compile(code);
+        Snapshot snapshot;
+        try
+        {
+            snapshot = takeSnapshot(program);
+        }
+        catch (exception& e)
+        {
+            REQUIRE (runVM(program, "") == "7\n" + string(e.what()));
+            continue;
+        }
+        saveSnapshot(snapshot, fileName);
+        RestoredSnapshot restored = loadSnapshot(fileName);
+        string output(restored.output, restored.outputSize);
+        REQUIRE (output == snapshot.output);
+        for (auto& input : inputs)
+            REQUIRE ((output + runVM(restored.program, input)) == runVM(program, input));
+    }
+
+    // the code is run from the mapped file
+    RestoredSnapshot warm = loadSnapshot(fileName);
+    REQUIRE (warm.program.entry > 0);
+    REQUIRE ((const char*)warm.program.code > warm.file.get());
+    REQUIRE ((const char*)warm.program.lines > (const char*)warm.program.code);
+    REQUIRE (warm.output > (const char*)warm.program.initialRegisters);
+    remove(fileName.c_str());
+}
+
+TEST_CASE( "damaged snapshots are refused", "[snapshot]" ) {
+    string fileName = temporaryName();
+    saveSnapshot(takeSnapshot(compile("dim a integer : write(1) : read(a) : write(a)")), fileName);
+    string data;
+    {
+        ifstream in(fileName, ios::binary);
+        data.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+    auto rewrite = [&](const string& contents) {
+        ofstream out(fileName, ios::binary | ios::trunc);
+        out << contents;
+    };
+    auto errorOf = [&]() -> string {
+        try
+        {
+            loadSnapshot(fileName);
+        }
+        catch (exception& e)
+        {
+            return e.what();
+        }
+        return "";
+    };
+
+    string flipped = data;
+    flipped[flipped.size() - 1] ^= 1;
+    rewrite(flipped);
+    REQUIRE (errorOf().find("checksum mismatch") != string::npos);
+
+    string otherVersion = data;
+    otherVersion[8] = 99;
+    rewrite(otherVersion);
+    REQUIRE (errorOf().find("format version 99") != string::npos);
+
+    rewrite(data.substr(0, data.size() - 3));
+    REQUIRE (errorOf().find("truncated") != string::npos);
+
+    rewrite("#!/bin/sh\necho not a snapshot, but long enough for a header\n");
+    REQUIRE (errorOf().find("not a snapshot") != string::npos);
+
+    rewrite(data);
+    REQUIRE (errorOf() == "");
+    remove(fileName.c_str());
+    REQUIRE_THROWS (loadSnapshot(fileName));
+}
@@ -0,0 +1,1126 @@
+#include "Ssa.h"
+#include <algorithm>
+#include <cstring>
+using namespace std;
+
+namespace
+{
+    bool isTerminator(SsaOp op)
+    {
+        return op == SsaOp::Jump || op == SsaOp::Branch || op == SsaOp::Return;
+    }
+
+    bool isConstantOp(const SsaFunction& function, int value, long long& result)
+    {
+        const SsaInstr& instr = function.values[value];
+        result = instr.constant.i;
+        return instr.op == SsaOp::Const && instr.type != DataType::Float;
+    }
+
+    // an integer division fails on a zero divisor, unless the divisor is a known nonzero constant
+    bool mayFail(const SsaFunction& function, const SsaInstr& instr)
+    {
+        long long divisor;
+        return instr.op == SsaOp::Binary && instr.binary == BinaryOp::Div && instr.type == DataType::Integer
+               && !(isConstantOp(function, instr.operands[1], divisor) && divisor != 0);
+    }
+
+    bool hasEffect(const SsaFunction& function, const SsaInstr& instr)
+    {
+        return instr.op == SsaOp::Read || instr.op == SsaOp::Write || instr.op == SsaOp::WriteChar
+               || isTerminator(instr.op) || mayFail(function, instr);
+    }
+
+    template<class T>
+    long long compare(BinaryOp op, T a, T b)
+    {
+        switch (op)
+        {
+            case BinaryOp::Less: return a < b;
+            case BinaryOp::Greater: return a > b;
+            case BinaryOp::LessEqual: return a <= b;
+            case BinaryOp::GreaterEqual: return a >= b;
+            case BinaryOp::Equal: return a == b;
+            default: return a != b;
+        }
+    }
+
+    // the operation with the language's semantics, the operand type tells integers from floats;
+    // a division by zero throws the runtime error
+    Value evaluate(BinaryOp op, DataType operandType, Value a, Value b, size_t line)
+    {
+        Value result;
+        if (operandType == DataType::Float)
+        {
+            switch (op)
+            {
+                case BinaryOp::Add: result.f = a.f + b.f; break;
+                case BinaryOp::Sub: result.f = a.f - b.f; break;
+                case BinaryOp::Mul: result.f = a.f * b.f; break;
+                case BinaryOp::Div: result.f = a.f / b.f; break;
+                default: result.i = compare(op, a.f, b.f); break;
+            }
+            return result;
+        }
+
+        switch (op)
+        {
+            case BinaryOp::Add: result.i = wrapAdd(a.i, b.i); break;
+            case BinaryOp::Sub: result.i = wrapSub(a.i, b.i); break;
+            case BinaryOp::Mul: result.i = wrapMul(a.i, b.i); break;
+            case BinaryOp::Div: result.i = divideInt(a.i, b.i, line); break;
+            case BinaryOp::And: result.i = a.i & b.i; break;
+            case BinaryOp::Or: result.i = a.i | b.i; break;
+            default: result.i = compare(op, a.i, b.i); break;
+        }
+        return result;
+    }
+
+    Value evaluateNot(DataType type, Value operand)
+    {
+        operand.i = type == DataType::Bool ? !operand.i : ~operand.i;
+        return operand;
+    }
+
+    Value intToFloat(Value operand)
+    {
+        operand.f = (double)operand.i;
+        return operand;
+    }
+
+    void removeEdge(SsaFunction& function, int from, int to)
+    {
+        SsaBlock& target = function.blocks[to];
+        auto position = find(target.predecessors.begin(), target.predecessors.end(), from);
+        size_t index = position - target.predecessors.begin();
+        target.predecessors.erase(position);
+        for (int value : target.code)
+            if (function.values[value].op == SsaOp::Phi)
+                function.values[value].operands.erase(function.values[value].operands.begin() + index);
+
+        auto& successors = function.blocks[from].successors;
+        successors.erase(find(successors.begin(), successors.end(), to));
+    }
+
+    // a phi turning into another instruction leaves the phis at the start of its block
+    void moveAfterPhis(SsaFunction& function, int value)
+    {
+        auto& code = function.blocks[function.values[value].block].code;
+        auto position = find(code.begin(), code.end(), value);
+        auto end = position;
+        while (end + 1 != code.end() && function.values[*(end + 1)].op == SsaOp::Phi)
+            end++;
+        rotate(position, position + 1, end + 1);
+    }
+
+    void removeInstruction(SsaFunction& function, int value)
+    {
+        SsaInstr& instr = function.values[value];
+        auto& code = function.blocks[instr.block].code;
+        code.erase(find(code.begin(), code.end(), value));
+        instr.removed = true;
+    }
+
+    class SsaBuilder
+    {
+    private:
+        const TypedProgram& program;
+        SsaFunction& function;
+
+        vector<map<size_t, int>> definitions;       // per block, variable slot to its current value
+        vector<map<size_t, int>> incompletePhis;    // per unsealed block
+        vector<bool> sealed;
+        int current;
+
+        int newBlock()
+        {
+            function.blocks.emplace_back();
+            definitions.emplace_back();
+            incompletePhis.emplace_back();
+            sealed.push_back(false);
+            return (int)function.blocks.size() - 1;
+        }
+
+        int add(SsaInstr instr, int block, size_t position)
+        {
+            instr.block = block;
+            function.values.push_back(instr);
+            auto& code = function.blocks[block].code;
+            code.insert(code.begin() + position, (int)function.values.size() - 1);
+            return (int)function.values.size() - 1;
+        }
+
+        int emit(SsaInstr instr)
+        {
+            return add(instr, current, function.blocks[current].code.size());
+        }
+
+        int constant(DataType type, Value value, size_t line)
+        {
+            SsaInstr instr(SsaOp::Const, type, line);
+            instr.constant = value;
+            return emit(instr);
+        }
+
+        void addEdge(int from, int to)
+        {
+            function.blocks[from].successors.push_back(to);
+            function.blocks[to].predecessors.push_back(from);
+        }
+
+        void jump(int target)
+        {
+            emit(SsaInstr(SsaOp::Jump, DataType::None, 0));
+            addEdge(current, target);
+        }
+
+        void branch(int condition, int ifTrue, int ifFalse)
+        {
+            SsaInstr instr(SsaOp::Branch, DataType::None, 0);
+            instr.operands.push_back(condition);
+            emit(instr);
+            addEdge(current, ifTrue);
+            addEdge(current, ifFalse);
+        }
+
+        int addPhi(int block, DataType type)
+        {
+            size_t position = 0;
+            auto& code = function.blocks[block].code;
+            while (position < code.size() && function.values[code[position]].op == SsaOp::Phi)
+                position++;
+            return add(SsaInstr(SsaOp::Phi, type, 0), block, position);
+        }
+
+        void addPhiOperands(size_t slot, int phi)
+        {
+            int block = function.values[phi].block;
+            for (int predecessor : function.blocks[block].predecessors)
+            {
+                int operand = readVariable(slot, predecessor);
+                function.values[phi].operands.push_back(operand);
+            }
+        }
+
+        int readVariable(size_t slot, int block)
+        {
+            auto it = definitions[block].find(slot);
+            if (it != definitions[block].end())
+                return it->second;
+
+            DataType type = program.variables[slot].type;
+            auto& predecessors = function.blocks[block].predecessors;
+            int value;
+            if (!sealed[block])
+            {
+                value = addPhi(block, type);
+                incompletePhis[block][slot] = value;
+            }
+            else if (predecessors.empty())
+            {
+                // variables start as zero, the constant goes to the top of the entry block
+                SsaInstr instr(SsaOp::Const, type, 0);
+                value = add(instr, block, 0);
+            }
+            else if (predecessors.size() == 1)
+                value = readVariable(slot, predecessors[0]);
+            else
+            {
+                value = addPhi(block, type);
+                definitions[block][slot] = value;
+                addPhiOperands(slot, value);
+            }
+
+            definitions[block][slot] = value;
+            return value;
+        }
+
+        // the value is computed before the definition is recorded, reading the variable may not see a placeholder
+        void assign(size_t slot, int value)
+        {
+            definitions[current][slot] = value;
+        }
+
+        void seal(int block)
+        {
+            sealed[block] = true;
+            for (auto& incomplete : incompletePhis[block])
+                addPhiOperands(incomplete.first, incomplete.second);
+            incompletePhis[block].clear();
+        }
+
+        int lowerExpr(ExprPtr expr)
+        {
+            Value value;
+            switch (expr->kind)
+            {
+                case ExprKind::IntConst:
+                case ExprKind::BoolConst:
+                    value.i = expr->intValue;
+                    return constant(expr->type, value, expr->line);
+                case ExprKind::FloatConst:
+                    value.f = expr->floatValue;
+                    return constant(expr->type, value, expr->line);
+                case ExprKind::Variable:
+                    return readVariable(expr->slot, current);
+                default:
+                    break;
+            }
+
+            SsaInstr instr(SsaOp::Binary, expr->type, expr->line);
+            if (expr->kind == ExprKind::Not)
+                instr.op = SsaOp::Not;
+            else if (expr->kind == ExprKind::IntToFloat)
+                instr.op = SsaOp::IntToFloat;
+            else
+                instr.binary = expr->op;
+
+            instr.operands.push_back(lowerExpr(expr->left));
+            if (expr->right)
+                instr.operands.push_back(lowerExpr(expr->right));
+            return emit(instr);
+        }
+
+        void lowerStmt(StmtPtr stmt)
+        {
+            switch (stmt->kind)
+            {
+                case StmtKind::Assign:
+                    assign(stmt->slot, lowerExpr(stmt->value));
+                    break;
+
+                case StmtKind::If:
+                {
+                    int condition = lowerExpr(stmt->value);
+                    int thenBlock = newBlock(), elseBlock = stmt->elseBody ? newBlock() : -1, join = newBlock();
+                    branch(condition, thenBlock, stmt->elseBody ? elseBlock : join);
+
+                    seal(thenBlock);
+                    current = thenBlock;
+                    lowerStmt(stmt->body);
+                    jump(join);
+
+                    if (stmt->elseBody)
+                    {
+                        seal(elseBlock);
+                        current = elseBlock;
+                        lowerStmt(stmt->elseBody);
+                        jump(join);
+                    }
+
+                    seal(join);
+                    current = join;
+                    break;
+                }
+
+                case StmtKind::While:
+                {
+                    int header = newBlock(), body = newBlock(), exit = newBlock();
+                    jump(header);
+
+                    current = header;
+                    branch(lowerExpr(stmt->value), body, exit);
+
+                    seal(body);
+                    current = body;
+                    lowerStmt(stmt->body);
+                    jump(header);
+
+                    seal(header);
+                    seal(exit);
+                    current = exit;
+                    break;
+                }
+
+                case StmtKind::For:
+                {
+                    assign(stmt->slot, lowerExpr(stmt->value));
+                    int limit = lowerExpr(stmt->limit);
+
+                    int header = newBlock(), body = newBlock(), exit = newBlock();
+                    jump(header);
+
+                    current = header;
+                    SsaInstr condition(SsaOp::Binary, DataType::Bool, stmt->line);
+                    condition.binary = BinaryOp::LessEqual;
+                    condition.operands = { readVariable(stmt->slot, header), limit };
+                    branch(emit(condition), body, exit);
+
+                    seal(body);
+                    current = body;
+                    lowerStmt(stmt->body);
+
+                    Value one;
+                    one.i = 1;
+                    SsaInstr increment(SsaOp::Binary, DataType::Integer, stmt->line);
+                    increment.operands = { readVariable(stmt->slot, current), constant(DataType::Integer, one, stmt->line) };
+                    assign(stmt->slot, emit(increment));
+                    jump(header);
+
+                    seal(header);
+                    seal(exit);
+                    current = exit;
+                    break;
+                }
+
+                case StmtKind::Read:
+                    for (auto slot : stmt->slots)
+                        assign(slot, emit(SsaInstr(SsaOp::Read, program.variables[slot].type, stmt->line)));
+                    break;
+
+                case StmtKind::Write:
+                {
+                    SsaInstr space(SsaOp::WriteChar, DataType::None, stmt->line), newline = space;
+                    space.constant.i = ' ';
+                    newline.constant.i = '\n';
+
+                    for (size_t i = 0; i < stmt->values.size(); i++)
+                    {
+                        SsaInstr write(SsaOp::Write, DataType::None, stmt->line);
+                        write.operands.push_back(lowerExpr(stmt->values[i]));
+                        if (i > 0)
+                            emit(space);
+                        emit(write);
+                    }
+                    emit(newline);
+                    break;
+                }
+
+                case StmtKind::Block:
+                    for (auto& inner : stmt->statements)
+                        lowerStmt(inner);
+                    break;
+            }
+        }
+    public:
+        SsaBuilder(const TypedProgram& _program, SsaFunction& _function) : program(_program), function(_function), current(0) {}
+
+        void build()
+        {
+            current = newBlock();
+            seal(current);
+            lowerStmt(program.body);
+            emit(SsaInstr(SsaOp::Return, DataType::None, 0));
+        }
+    };
+
+    enum class Lattice { Unknown, Constant, Varying };
+
+    struct Cell
+    {
+        Lattice state;
+        Value value;
+    };
+
+    class ConstantPropagation
+    {
+    private:
+        SsaFunction& function;
+        vector<Cell> cells;
+        vector<vector<int>> users;
+        set<pair<int, int>> executableEdges;
+        vector<bool> executable;
+        vector<pair<int, int>> flowWork;
+        vector<int> valueWork;
+
+        void lower(int value, Cell cell)
+        {
+            Cell& old = cells[value];
+            if (old.state == cell.state && (cell.state != Lattice::Constant || old.value.i == cell.value.i))
+                return;
+            old = cell;
+            for (int user : users[value])
+                valueWork.push_back(user);
+        }
+
+        Cell varying()
+        {
+            Cell cell;
+            cell.state = Lattice::Varying;
+            cell.value.i = 0;
+            return cell;
+        }
+
+        Cell constant(Value value)
+        {
+            Cell cell;
+            cell.state = Lattice::Constant;
+            cell.value = value;
+            return cell;
+        }
+
+        void markEdge(int from, int to)
+        {
+            flowWork.push_back({ from, to });
+        }
+
+        void visit(int value)
+        {
+            SsaInstr& instr = function.values[value];
+            if (instr.removed)
+                return;
+
+            vector<Cell> operands;
+            for (int operand : instr.operands)
+                operands.push_back(cells[operand]);
+            bool anyUnknown = false, anyVarying = false;
+            for (auto& cell : operands)
+            {
+                anyUnknown |= cell.state == Lattice::Unknown;
+                anyVarying |= cell.state == Lattice::Varying;
+            }
+
+            switch (instr.op)
+            {
+                case SsaOp::Const:
+                    lower(value, constant(instr.constant));
+                    break;
+
+                case SsaOp::Phi:
+                {
+                    // only operands flowing along executable edges count
+                    auto& predecessors = function.blocks[instr.block].predecessors;
+                    Cell result;
+                    result.state = Lattice::Unknown;
+                    result.value.i = 0;
+                    for (size_t k = 0; k < predecessors.size(); k++)
+                    {
+                        if (!executableEdges.count({ predecessors[k], instr.block }))
+                            continue;
+                        Cell& cell = operands[k];
+                        if (cell.state == Lattice::Varying
+                            || (cell.state == Lattice::Constant && result.state == Lattice::Constant && cell.value.i != result.value.i))
+                            result = varying();
+                        else if (cell.state == Lattice::Constant && result.state == Lattice::Unknown)
+                            result = cell;
+                        if (result.state == Lattice::Varying)
+                            break;
+                    }
+                    lower(value, result);
+                    break;
+                }
+
+                case SsaOp::Copy:
+                    lower(value, operands[0]);
+                    break;
+
+                case SsaOp::Not:
+                case SsaOp::IntToFloat:
+                case SsaOp::Binary:
+                {
+                    if (anyVarying)
+                        lower(value, varying());
+                    else if (anyUnknown)
+                        break;
+                    else if (instr.op == SsaOp::Not)
+                        lower(value, constant(evaluateNot(instr.type, operands[0].value)));
+                    else if (instr.op == SsaOp::IntToFloat)
+                        lower(value, constant(intToFloat(operands[0].value)));
+                    else if (instr.binary == BinaryOp::Div && function.values[instr.operands[0]].type != DataType::Float
+                             && operands[1].value.i == 0)
+                        lower(value, varying());
+                    else
+                        lower(value, constant(evaluate(instr.binary, function.values[instr.operands[0]].type,
+                                                       operands[0].value, operands[1].value, instr.line)));
+                    break;
+                }
+
+                case SsaOp::Read:
+                    lower(value, varying());
+                    break;
+
+                case SsaOp::Jump:
+                    markEdge(instr.block, function.blocks[instr.block].successors[0]);
+                    break;
+
+                case SsaOp::Branch:
+                {
+                    auto& successors = function.blocks[instr.block].successors;
+                    if (operands[0].state == Lattice::Constant)
+                        markEdge(instr.block, successors[operands[0].value.i ? 0 : 1]);
+                    else if (operands[0].state == Lattice::Varying)
+                    {
+                        markEdge(instr.block, successors[0]);
+                        markEdge(instr.block, successors[1]);
+                    }
+                    break;
+                }
+
+                default:
+                    break;
+            }
+        }
+
+        void solve()
+        {
+            flowWork.push_back({ -1, 0 });
+            while (!flowWork.empty() || !valueWork.empty())
+            {
+                if (!flowWork.empty())
+                {
+                    pair<int, int> edge = flowWork.back();
+                    flowWork.pop_back();
+                    if (edge.first >= 0 && !executableEdges.insert(edge).second)
+                        continue;
+
+                    int block = edge.second;
+                    bool first = !executable[block];
+                    executable[block] = true;
+                    for (int value : function.blocks[block].code)
+                        if (first || function.values[value].op == SsaOp::Phi)
+                            visit(value);
+                    continue;
+                }
+
+                int value = valueWork.back();
+                valueWork.pop_back();
+                if (executable[function.values[value].block])
+                    visit(value);
+            }
+        }
+
+        void rewrite()
+        {
+            for (size_t value = 0; value < function.values.size(); value++)
+            {
+                SsaInstr& instr = function.values[value];
+                if (instr.removed || !executable[instr.block] || cells[value].state != Lattice::Constant)
+                    continue;
+
+                if (instr.op == SsaOp::Phi || instr.op == SsaOp::Copy || instr.op == SsaOp::Not
+                    || instr.op == SsaOp::IntToFloat || instr.op == SsaOp::Binary)
+                {
+                    if (instr.op == SsaOp::Phi)
+                        moveAfterPhis(function, (int)value);
+                    instr.op = SsaOp::Const;
+                    instr.constant = cells[value].value;
+                    instr.operands.clear();
+                }
+            }
+
+            // a constant condition leaves one successor
+            for (size_t block = 0; block < function.blocks.size(); block++)
+            {
+                SsaBlock& current = function.blocks[block];
+                if (current.removed || !executable[block])
+                    continue;
+
+                SsaInstr& terminator = function.values[current.code.back()];
+                if (terminator.op != SsaOp::Branch)
+                    continue;
+
+                int taken = -1;
+                for (int successor : current.successors)
+                    if (executableEdges.count({ (int)block, successor }))
+                        taken = taken == -1 ? successor : -2;
+                if (taken < 0)
+                    continue;
+
+                int dropped = current.successors[0] == taken ? current.successors[1] : current.successors[0];
+                removeEdge(function, block, dropped);
+                terminator.op = SsaOp::Jump;
+                terminator.operands.clear();
+            }
+
+            for (size_t block = 0; block < function.blocks.size(); block++)
+            {
+                SsaBlock& current = function.blocks[block];
+                if (current.removed || executable[block])
+                    continue;
+
+                while (!current.successors.empty())
+                    removeEdge(function, block, current.successors.back());
+                for (int value : current.code)
+                    function.values[value].removed = true;
+                current.code.clear();
+                current.removed = true;
+            }
+
+            // edges from removed blocks are gone, phis of their successors lost those operands
+            for (size_t block = 0; block < function.blocks.size(); block++)
+            {
+                SsaBlock& current = function.blocks[block];
+                auto& predecessors = current.predecessors;
+                for (size_t k = predecessors.size(); k-- > 0;)
+                    if (function.blocks[predecessors[k]].removed)
+                    {
+                        predecessors.erase(predecessors.begin() + k);
+                        for (int value : current.code)
+                            if (function.values[value].op == SsaOp::Phi)
+                                function.values[value].operands.erase(function.values[value].operands.begin() + k);
+                    }
+            }
+        }
+    public:
+        ConstantPropagation(SsaFunction& _function) : function(_function)
+        {
+            Cell unknown;
+            unknown.state = Lattice::Unknown;
+            unknown.value.i = 0;
+            cells.assign(function.values.size(), unknown);
+            users.resize(function.values.size());
+            executable.assign(function.blocks.size(), false);
+
+            for (size_t value = 0; value < function.values.size(); value++)
+                if (!function.values[value].removed)
+                    for (int operand : function.values[value].operands)
+                        users[operand].push_back((int)value);
+        }
+
+        void run()
+        {
+            solve();
+            rewrite();
+        }
+    };
+
+    int resolveCopy(const SsaFunction& function, int value)
+    {
+        while (function.values[value].op == SsaOp::Copy)
+            value = function.values[value].operands[0];
+        return value;
+    }
+
+    // reverse postorder of the blocks reachable from the entry and the immediate dominators, after Cooper, Harvey and Kennedy
+    struct Dominators
+    {
+        vector<int> order, position, immediate;
+
+        Dominators(const SsaFunction& function)
+        {
+            size_t count = function.blocks.size();
+            position.assign(count, -1);
+            immediate.assign(count, -1);
+
+            vector<bool> visited(count, false);
+            vector<pair<int, size_t>> stack = { { 0, 0 } };
+            visited[0] = true;
+            while (!stack.empty())
+            {
+                auto& top = stack.back();
+                auto& successors = function.blocks[top.first].successors;
+                if (top.second < successors.size())
+                {
+                    int next = successors[top.second++];
+                    if (!visited[next])
+                    {
+                        visited[next] = true;
+                        stack.push_back({ next, 0 });
+                    }
+                    continue;
+                }
+                order.push_back(top.first);
+                stack.pop_back();
+            }
+            reverse(order.begin(), order.end());
+            for (size_t i = 0; i < order.size(); i++)
+                position[order[i]] = (int)i;
+
+            immediate[0] = 0;
+            bool changed = true;
+            while (changed)
+            {
+                changed = false;
+                for (size_t i = 1; i < order.size(); i++)
+                {
+                    int block = order[i], result = -1;
+                    for (int predecessor : function.blocks[block].predecessors)
+                    {
+                        if (immediate[predecessor] < 0)
+                            continue;
+                        result = result < 0 ? predecessor : intersect(result, predecessor);
+                    }
+                    if (result != immediate[block])
+                    {
+                        immediate[block] = result;
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        int intersect(int a, int b)
+        {
+            while (a != b)
+            {
+                while (position[a] > position[b])
+                    a = immediate[a];
+                while (position[b] > position[a])
+                    b = immediate[b];
+            }
+            return a;
+        }
+
+        bool dominates(int a, int b)
+        {
+            while (b != a && b != 0)
+                b = immediate[b];
+            return a == b;
+        }
+    };
+
+    string typeName(DataType type)
+    {
+        switch (type)
+        {
+            case DataType::Integer: return "integer";
+            case DataType::Float: return "float";
+            case DataType::Bool: return "bool";
+            default: return "none";
+        }
+    }
+}
+
+SsaFunction buildSsa(const TypedProgram& program)
+{
+    SsaFunction function;
+    SsaBuilder(program, function).build();
+    return function;
+}
+
+void propagateConstants(SsaFunction& function)
+{
+    ConstantPropagation(function).run();
+}
+
+void propagateCopies(SsaFunction& function)
+{
+    // a phi whose operands are one value besides itself is a copy of it
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t value = 0; value < function.values.size(); value++)
+        {
+            SsaInstr& instr = function.values[value];
+            if (instr.removed || instr.op != SsaOp::Phi)
+                continue;
+
+            int same = -1;
+            bool trivial = true;
+            for (int operand : instr.operands)
+            {
+                operand = resolveCopy(function, operand);
+                if (operand == (int)value || operand == same)
+                    continue;
+                if (same >= 0)
+                    trivial = false;
+                same = operand;
+            }
+
+            if (trivial && same >= 0)
+            {
+                instr.op = SsaOp::Copy;
+                instr.operands = { same };
+                changed = true;
+            }
+        }
+    }
+
+    for (auto& instr : function.values)
+        if (!instr.removed)
+            for (int& operand : instr.operands)
+                operand = resolveCopy(function, operand);
+
+    // nothing uses the copies anymore
+    for (size_t value = 0; value < function.values.size(); value++)
+        if (!function.values[value].removed && function.values[value].op == SsaOp::Copy)
+            removeInstruction(function, (int)value);
+}
+
+void eliminateDeadCode(SsaFunction& function)
+{
+    vector<bool> live(function.values.size(), false);
+    vector<int> work;
+    for (size_t value = 0; value < function.values.size(); value++)
+        if (!function.values[value].removed && hasEffect(function, function.values[value]))
+        {
+            live[value] = true;
+            work.push_back((int)value);
+        }
+
+    while (!work.empty())
+    {
+        int value = work.back();
+        work.pop_back();
+        for (int operand : function.values[value].operands)
+            if (!live[operand])
+            {
+                live[operand] = true;
+                work.push_back(operand);
+            }
+    }
+
+    for (size_t value = 0; value < function.values.size(); value++)
+        if (!function.values[value].removed && !live[value])
+            removeInstruction(function, (int)value);
+}
+
+void optimizeSsa(SsaFunction& function)
+{
+    size_t before;
+    do
+    {
+        before = 0;
+        for (auto& instr : function.values)
+            before += instr.removed ? 0 : instr.op == SsaOp::Const ? 1 : 2;
+
+        propagateConstants(function);
+        propagateCopies(function);
+        eliminateDeadCode(function);
+
+        size_t after = 0;
+        for (auto& instr : function.values)
+            after += instr.removed ? 0 : instr.op == SsaOp::Const ? 1 : 2;
+        if (after == before)
+            break;
+    }
+    while (true);
+}
+
+std::string dumpSsa(const SsaFunction& function)
+{
+    string result;
+    char buffer[maxFormattedLength];
+
+    for (size_t block = 0; block < function.blocks.size(); block++)
+    {
+        const SsaBlock& current = function.blocks[block];
+        if (current.removed)
+            continue;
+
+        result += "b" + to_string(block) + ":";
+        for (size_t k = 0; k < current.predecessors.size(); k++)
+            result += (k ? ", b" : " ; preds b") + to_string(current.predecessors[k]);
+        result += "\n";
+
+        for (int value : current.code)
+        {
+            const SsaInstr& instr = function.values[value];
+            auto operand = [](int operand) { return "v" + to_string(operand); };
+
+            result += "    ";
+            if (instr.type != DataType::None)
+                result += "v" + to_string(value) + " " + typeName(instr.type) + " = ";
+
+            switch (instr.op)
+            {
+                case SsaOp::Const:
+                    if (instr.type == DataType::Float)
+                        result += string(buffer, formatFloat(instr.constant.f, buffer));
+                    else if (instr.type == DataType::Bool)
+                        result += instr.constant.i ? "true" : "false";
+                    else
+                        result += string(buffer, formatInt(instr.constant.i, buffer));
+                    break;
+                case SsaOp::Phi:
+                    result += "phi";
+                    for (size_t k = 0; k < instr.operands.size(); k++)
+                        result += string(k ? "," : "") + " [b" + to_string(current.predecessors[k]) + ": " + operand(instr.operands[k]) + "]";
+                    break;
+                case SsaOp::Copy: result += operand(instr.operands[0]); break;
+                case SsaOp::Not: result += "not " + operand(instr.operands[0]); break;
+                case SsaOp::IntToFloat: result += "float " + operand(instr.operands[0]); break;
+                case SsaOp::Binary:
+                    result += operand(instr.operands[0]) + " " + binaryOpName(instr.binary) + " " + operand(instr.operands[1]);
+                    break;
+                case SsaOp::Read: result += "read"; break;
+                case SsaOp::Write: result += "write " + operand(instr.operands[0]); break;
+                case SsaOp::WriteChar: result += instr.constant.i == '\n' ? "write newline" : "write space"; break;
+                case SsaOp::Jump: result += "jump b" + to_string(current.successors[0]); break;
+                case SsaOp::Branch:
+                    result += "branch " + operand(instr.operands[0]) + ", b" + to_string(current.successors[0])
+                              + ", b" + to_string(current.successors[1]);
+                    break;
+                case SsaOp::Return: result += "return"; break;
+            }
+
+            if (instr.op == SsaOp::Read || mayFail(function, instr))
+                result += " ; line " + to_string(instr.line);
+            result += "\n";
+        }
+    }
+    return result;
+}
+
+std::string verifySsa(const SsaFunction& function)
+{
+    Dominators dominators(function);
+    vector<int> positions(function.values.size(), -1);
+
+    for (size_t block = 0; block < function.blocks.size(); block++)
+    {
+        const SsaBlock& current = function.blocks[block];
+        string name = "b" + to_string(block);
+        if (current.removed)
+            continue;
+        if (dominators.position[block] < 0)
+            return name + " is unreachable";
+        if (current.code.empty() || !isTerminator(function.values[current.code.back()].op))
+            return name + " doesn't end with a terminator";
+
+        for (int successor : current.successors)
+        {
+            auto& predecessors = function.blocks[successor].predecessors;
+            if (function.blocks[successor].removed || find(predecessors.begin(), predecessors.end(), (int)block) == predecessors.end())
+                return name + " isn't a predecessor of its successor b" + to_string(successor);
+        }
+        for (int predecessor : current.predecessors)
+        {
+            auto& successors = function.blocks[predecessor].successors;
+            if (find(successors.begin(), successors.end(), (int)block) == successors.end())
+                return name + " isn't a successor of its predecessor b" + to_string(predecessor);
+        }
+
+        bool phis = true;
+        for (size_t i = 0; i < current.code.size(); i++)
+        {
+            int value = current.code[i];
+            const SsaInstr& instr = function.values[value];
+            string where = "v" + to_string(value) + " in " + name;
+            positions[value] = (int)i;
+
+            if (instr.removed || instr.block != (int)block)
+                return where + " is removed or placed in another block";
+            if (instr.op == SsaOp::Phi && !phis)
+                return where + " is a phi after other instructions";
+            phis = instr.op == SsaOp::Phi;
+            if (isTerminator(instr.op) != (i + 1 == current.code.size()))
+                return where + " is a misplaced terminator";
+            if (instr.op == SsaOp::Phi && instr.operands.size() != current.predecessors.size())
+                return where + " has a phi operand count different from the number of predecessors";
+
+            size_t expected = instr.op == SsaOp::Jump ? 1 : instr.op == SsaOp::Branch ? 2 : instr.op == SsaOp::Return ? 0 : current.successors.size();
+            if (expected != current.successors.size())
+                return where + " doesn't match the successors of its block";
+        }
+    }
+
+    for (size_t value = 0; value < function.values.size(); value++)
+    {
+        const SsaInstr& instr = function.values[value];
+        if (instr.removed)
+            continue;
+        string where = "v" + to_string(value);
+
+        for (size_t k = 0; k < instr.operands.size(); k++)
+        {
+            int operand = instr.operands[k];
+            if (operand < 0 || operand >= (int)function.values.size() || function.values[operand].removed)
+                return where + " uses a missing value";
+
+            const SsaInstr& definition = function.values[operand];
+            if (definition.type == DataType::None)
+                return where + " uses v" + to_string(operand) + ", which defines no value";
+
+            // a phi operand has to be available at the end of its predecessor
+            int useBlock = instr.op == SsaOp::Phi ? function.blocks[instr.block].predecessors[k] : instr.block;
+            bool available = definition.block == useBlock
+                             ? instr.op == SsaOp::Phi || positions[operand] < positions[value]
+                             : dominators.dominates(definition.block, useBlock);
+            if (!available)
+                return where + " uses v" + to_string(operand) + ", which doesn't dominate it";
+        }
+
+        auto operandType = [&](size_t k) { return function.values[instr.operands[k]].type; };
+        bool typed = true;
+        switch (instr.op)
+        {
+            case SsaOp::Phi:
+                for (size_t k = 0; k < instr.operands.size(); k++)
+                    typed &= operandType(k) == instr.type;
+                break;
+            case SsaOp::Copy: typed = operandType(0) == instr.type; break;
+            case SsaOp::Not: typed = operandType(0) == instr.type && instr.type != DataType::Float; break;
+            case SsaOp::IntToFloat: typed = operandType(0) == DataType::Integer && instr.type == DataType::Float; break;
+            case SsaOp::Binary:
+                typed = operandType(0) == operandType(1)
+                        && instr.type == (isComparison(instr.binary) ? DataType::Bool : operandType(0));
+                break;
+            case SsaOp::Branch: typed = operandType(0) == DataType::Bool; break;
+            default: break;
+        }
+        if (!typed)
+            return where + " has operands of wrong types";
+    }
+    return "";
+}
+
+SsaEngine::SsaEngine(const TypedProgram& program) : function(buildSsa(program))
+{
+    optimizeSsa(function);
+}
+
+void SsaEngine::run(InputBuffer& input, OutputBuffer& output)
+{
+    vector<Value> values(function.values.size());
+    vector<Value> incoming;
+    int block = 0, from = -1;
+
+    while (true)
+    {
+        const SsaBlock& current = function.blocks[block];
+
+        // phis read their operands for the edge taken before any of them is assigned
+        size_t start = 0;
+        if (from >= 0)
+        {
+            size_t edge = find(current.predecessors.begin(), current.predecessors.end(), from) - current.predecessors.begin();
+            incoming.clear();
+            while (start < current.code.size() && function.values[current.code[start]].op == SsaOp::Phi)
+                incoming.push_back(values[function.values[current.code[start++]].operands[edge]]);
+            for (size_t i = 0; i < incoming.size(); i++)
+                values[current.code[i]] = incoming[i];
+        }
+
+        for (size_t i = start; i < current.code.size(); i++)
+        {
+            int value = current.code[i];
+            const SsaInstr& instr = function.values[value];
+            auto operand = [&](size_t k) { return values[instr.operands[k]]; };
+
+            switch (instr.op)
+            {
+                case SsaOp::Const: values[value] = instr.constant; break;
+                case SsaOp::Phi: break;
+                case SsaOp::Copy: values[value] = operand(0); break;
+                case SsaOp::Not: values[value] = evaluateNot(instr.type, operand(0)); break;
+                case SsaOp::IntToFloat: values[value] = intToFloat(operand(0)); break;
+                case SsaOp::Binary:
+                    values[value] = evaluate(instr.binary, function.values[instr.operands[0]].type, operand(0), operand(1), instr.line);
+                    break;
+                case SsaOp::Read:
+                    if (instr.type == DataType::Float)
+                        values[value].f = input.readFloat(instr.line);
+                    else if (instr.type == DataType::Bool)
+                        values[value].i = input.readBool(instr.line);
+                    else
+                        values[value].i = input.readInt(instr.line);
+                    break;
+                case SsaOp::Write:
+                {
+                    DataType type = function.values[instr.operands[0]].type;
+                    if (type == DataType::Float)
+                        output.writeFloat(operand(0).f);
+                    else if (type == DataType::Bool)
+                        output.writeBool(operand(0).i != 0);
+                    else
+                        output.writeInt(operand(0).i);
+                    break;
+                }
+                case SsaOp::WriteChar: output.writeChar((char)instr.constant.i); break;
+                case SsaOp::Jump:
+                    from = block;
+                    block = current.successors[0];
+                    break;
+                case SsaOp::Branch:
+                    from = block;
+                    block = current.successors[operand(0).i ? 0 : 1];
+                    break;
+                case SsaOp::Return:
+                    output.flush();
+                    return;
+            }
+        }
+    }
+}
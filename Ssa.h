@@ -0,0 +1,80 @@
+#ifndef RGR_SSA_H
+#define RGR_SSA_H
+
+#include "TypedTree.h"
+#include "Runtime.h"
+
+/*
+ * Mid-level IR in SSA form.
+ *
+ * The typed program's structured control flow becomes a control-flow graph of basic blocks. Every instruction defines
+ * at most one typed value, numbered by its index; variables disappear, a value reaching a block from several
+ * predecessors is merged by a phi at the start of the block with one operand per predecessor, in their order.
+ * Every block ends with exactly one terminator: jump, branch (true successor first) or return.
+ *
+ * The IR is built with the algorithm of Braun et al.: definitions are tracked per block and phis are placed on demand,
+ * blocks of loop headers get their phi operands once the back edge is known. Variables start as zero constants.
+ *
+ * Passes: sparse conditional constant propagation (constants through phis of reachable edges only, constant branches
+ * become jumps and unreachable blocks are removed), copy propagation (trivial phis included) and dead code elimination,
+ * keeping input, output, control flow and divisions that may fail. Removed instructions and blocks keep their numbers.
+ */
+
+enum class SsaOp { Const, Phi, Copy, Not, IntToFloat, Binary, Read, Write, WriteChar, Jump, Branch, Return };
+
+struct SsaInstr
+{
+    SsaOp op;
+    DataType type;              // type of the defined value, None for instructions without one
+    BinaryOp binary;
+    size_t line;
+    Value constant;             // Const, the character of WriteChar
+    std::vector<int> operands;  // Phi has one per predecessor of its block
+    int block;
+    bool removed;
+
+    SsaInstr(SsaOp _op, DataType _type, size_t _line)
+            : op(_op), type(_type), binary(BinaryOp::Add), line(_line), block(-1), removed(false) { constant.i = 0; }
+};
+
+struct SsaBlock
+{
+    std::vector<int> code;              // phis first, the terminator last
+    std::vector<int> predecessors;
+    std::vector<int> successors;        // of the terminator, in its order
+    bool removed = false;
+};
+
+struct SsaFunction
+{
+    std::vector<SsaInstr> values;
+    std::vector<SsaBlock> blocks;       // the entry is block 0
+};
+
+SsaFunction buildSsa(const TypedProgram& program);
+
+void propagateConstants(SsaFunction& function);
+void propagateCopies(SsaFunction& function);
+void eliminateDeadCode(SsaFunction& function);
+
+// all passes until nothing changes
+void optimizeSsa(SsaFunction& function);
+
+std::string dumpSsa(const SsaFunction& function);
+
+// description of the first broken invariant, empty if the function is well formed
+std::string verifySsa(const SsaFunction& function);
+
+// runs the optimized IR directly, the reference for checking it against the other engines
+class SsaEngine
+{
+private:
+    SsaFunction function;
+public:
+    explicit SsaEngine(const TypedProgram& program);
+
+    void run(InputBuffer& input, OutputBuffer& output);
+    const SsaFunction& getFunction() { return function; }
+};
+
+#endif //RGR_SSA_H
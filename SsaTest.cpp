@@ -0,0 +1,131 @@
+#include "catch.hpp"
+#include "TestSupport.h"
+#include "Ssa.h"
+
+using namespace std;
+
+namespace
+{
+    string runSsa(string code, string input = "")
+    {
+        return run(SsaEngine(lower(code)), input);
+    }
+
+    size_t countLive(const SsaFunction& function, SsaOp op)
+    {
+        size_t count = 0;
+        for (auto& instr : function.values)
+            count += !instr.removed && instr.op == op;
+        return count;
+    }
+}
+
+TEST_CASE( "SSA construction", "[ssa]" ) {
+    SsaFunction function = buildSsa(lower("dim a, i integer : read(a) : for i as 1 to 3 do a as a + i : write(a)"));
+    REQUIRE( verifySsa(function) == "" );
+    REQUIRE( dumpSsa(function) ==
+             "b0:\n"
+             "    v0 integer = read ; line 1\n"
+             "    v1 integer = 1\n"
+             "    v2 integer = 3\n"
+             "    jump b1\n"
+             "b1: ; preds b0, b2\n"
+             "    v4 integer = phi [b0: v1], [b2: v10]\n"
+             "    v7 integer = phi [b0: v0], [b2: v8]\n"
+             "    v5 bool = v4 <= v2\n"
+             "    branch v5, b2, b3\n"
+             "b2: ; preds b1\n"
+             "    v8 integer = v7 + v4\n"
+             "    v9 integer = 1\n"
+             "    v10 integer = v4 + v9\n"
+             "    jump b1\n"
+             "b3: ; preds b1\n"
+             "    write v7\n"
+             "    write newline\n"
+             "    return\n" );
+
+    // a variable never assigned on a path reads as zero
+    function = buildSsa(lower("dim a integer : dim f float : if a > 0 then f as 1.5 : write(f)"));
+    REQUIRE( verifySsa(function) == "" );
+    REQUIRE( dumpSsa(function).find("v6 float = phi [b0: v7], [b1: v4]") != string::npos );
+}
+
+TEST_CASE( "SSA passes", "[ssa]" ) {
+    // the first branch is always taken, so the loop's counter is the only phi left
+    string code = "dim a, b, i integer : a as 5 : b as a * 2\n"
+                  "for i as 1 to 10 do if b = 10 then a as a + 0 else a as a + i\n"
+                  "write(a, i)";
+    SsaFunction function = buildSsa(lower(code));
+
+    propagateConstants(function);
+    REQUIRE( verifySsa(function) == "" );
+    REQUIRE( countLive(function, SsaOp::Branch) == 1 );
+    propagateCopies(function);
+    REQUIRE( verifySsa(function) == "" );
+    REQUIRE( countLive(function, SsaOp::Copy) == 0 );
+    eliminateDeadCode(function);
+    REQUIRE( verifySsa(function) == "" );
+
+    optimizeSsa(function);
+    REQUIRE( verifySsa(function) == "" );
+    REQUIRE( countLive(function, SsaOp::Phi) == 1 );
+    REQUIRE( dumpSsa(function).find("write v") != string::npos );
+
+    // unused values go away, a division that may fail stays
+    function = buildSsa(lower("dim a, b integer : read(b) : a as b * 3 : a as b / 7 : a as 7 / b : write(1)"));
+    optimizeSsa(function);
+    REQUIRE( verifySsa(function) == "" );
+    REQUIRE( countLive(function, SsaOp::Binary) == 1 );
+    REQUIRE( dumpSsa(function).find("v5 / v0 ; line 1") != string::npos );
+
+    // a division by zero is never folded
+    function = buildSsa(lower("dim a integer : a as 0 : write(1 / a)"));
+    optimizeSsa(function);
+    REQUIRE( countLive(function, SsaOp::Binary) == 1 );
+}
+
+TEST_CASE( "SSA verifier", "[ssa]" ) {
+    SsaFunction function = buildSsa(lower("dim a integer : read(a) : while a > 0 do a as a - 1 : write(a)"));
+    REQUIRE( verifySsa(function) == "" );
+
+    SsaFunction broken = function;
+    broken.blocks[0].code.pop_back();
+    REQUIRE( verifySsa(broken).find("terminator") != string::npos );
+
+    // the loop's phi takes the value from the body, which doesn't dominate the header's other predecessor
+    broken = function;
+    for (auto& instr : broken.values)
+        if (instr.op == SsaOp::Phi)
+            swap(instr.operands[0], instr.operands[1]);
+    REQUIRE( verifySsa(broken).find("doesn't dominate") != string::npos );
+
+    broken = function;
+    broken.values[0].type = DataType::Float;
+    REQUIRE( verifySsa(broken) != "" );
+}
+
+TEST_CASE( "SSA engine matches the VM", "[ssa]" ) {
+    vector<string> programs = {
+            "write(10 - 3 - 2, 7 / 2, 7.0 / 2, 0ffh and 10b, not 0, not true)",
+            "dim i, s integer : for i as 1 to 100 do s as s + i * i : write(s, i)",
+            "dim i integer : for i as 5 to 1 do write(i) : write(i)",
+            "dim i integer : for i as 9223372036854775805 to 9223372036854775806 do write(i) : write(i)",
+            "dim a integer : while a < 10 do a as a + 3 : write(a)",
+            "dim f float : dim i integer : for i as 1 to 4 do f as f + i / 2 : write(f, f > i, i < f)",
+            "dim f float : f as 0.0 / 0.0 : write(f = f, f <> f, f < 1)",
+            "dim i, j, n integer\n"
+            "for i as 1 to 10 do\n"
+            "    for j as i to 10 do\n"
+            "        if i * j > 50 then n as n + 1 else if i = j then n as n - 1\n"
+            "write(n)",
+            "dim a, b integer : dim f float : dim c bool : read(a, b, f, c) : if c then write(a / b, f * a) else write(0)",
+            "dim a, b integer : read(a, b) : while a <> b do if a > b then a as a - b else b as b - a : write(a)",
+            "dim a, b integer : dim c bool : read(a, b) : c as a > b : if c then begin a as b : b as 0 end : write(a, b, c)",
+            "dim a integer : write(3, 1.5, a / a)",
+            "dim a integer : read(a) : write(1) : a as 5 / (a - 7) : write(2)",
+            "dim a, b integer : read(a, b, a)",
+    };
+
+    for (auto& program : programs)
+        REQUIRE( runSsa(program, "7 2 1.5 true") == runVM(program, "7 2 1.5 true") );
+}
@@ -0,0 +1,133 @@
+#include "Stats.h"
+#include "Trace.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <new>
+#include <sstream>
+#include <sys/resource.h>
+using namespace std;
+
+namespace
+{
+    atomic<bool> counting;
+    atomic<size_t> allocationCount, allocatedBytes;
+
+    double cpuMilliseconds()
+    {
+        timespec time;
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+        return time.tv_sec * 1e3 + time.tv_nsec / 1e6;
+    }
+
+    long peakResidentKilobytes()
+    {
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    }
+}
+
+#ifdef RGR_ALLOCATION_STATS
+
+void* operator new(size_t size)
+{
+    if (counting.load(memory_order_relaxed))
+    {
+        allocationCount.fetch_add(1, memory_order_relaxed);
+        allocatedBytes.fetch_add(size, memory_order_relaxed);
+    }
+
+    while (true)
+    {
+        if (void* memory = malloc(size ? size : 1))
+            return memory;
+        new_handler handler = get_new_handler();
+        if (!handler)
+            throw bad_alloc();
+        handler();
+    }
+}
+
+void operator delete(void* memory) noexcept
+{
+    free(memory);
+}
+
+bool allocationStatsAvailable()
+{
+    return true;
+}
+
+#else
+
+bool allocationStatsAvailable()
+{
+    return false;
+}
+
+#endif
+
+void StatsRecorder::measure(const string& name, const function<void()>& phase)
+{
+    size_t allocationsBefore = allocationCount, bytesBefore = allocatedBytes;
+    double cpuBefore = cpuMilliseconds();
+    auto wallBefore = chrono::steady_clock::now();
+
+    // the phase is recorded when it fails as well, then the failure goes on
+    struct Record
+    {
+        StatsRecorder& recorder;
+        const string& name;
+        size_t allocationsBefore, bytesBefore;
+        double cpuBefore;
+        chrono::steady_clock::time_point wallBefore;
+
+        ~Record()
+        {
+            counting = false;
+            double wall = chrono::duration<double, milli>(chrono::steady_clock::now() - wallBefore).count();
+            recorder.phases.push_back(PhaseStats { name, wall, cpuMilliseconds() - cpuBefore,
+                                                   allocationCount - allocationsBefore, allocatedBytes - bytesBefore,
+                                                   peakResidentKilobytes() });
+        }
+    } record { *this, name, allocationsBefore, bytesBefore, cpuBefore, wallBefore };
+
+    TraceSpan span(name.c_str());
+    counting = true;
+    phase();
+}
+
+string StatsRecorder::report() const
+{
+    ostringstream out;
+    out << left << setw(16) << "phase" << right << setw(12) << "wall ms" << setw(12) << "cpu ms" << setw(14) << "allocations"
+        << setw(14) << "bytes" << setw(14) << "peak RSS KB" << "\n";
+    out << fixed << setprecision(3);
+    for (auto& phase : phases)
+    {
+        out << left << setw(16) << phase.name << right << setw(12) << phase.wallMilliseconds << setw(12) << phase.cpuMilliseconds;
+        if (allocationStatsAvailable())
+            out << setw(14) << phase.allocations << setw(14) << phase.allocatedBytes;
+        else
+            out << setw(14) << "n/a" << setw(14) << "n/a";
+        out << setw(14) << phase.peakResidentKilobytes << "\n";
+    }
+
+    if (!counts.empty())
+        out << "\n";
+    for (auto& count : counts)
+        out << count.first << ": " << count.second << "\n";
+    return out.str();
+}
+
+size_t countSyntaxNodes(SyntaxNodePtr root)
+{
+    size_t result = 1;
+    if (auto node = dynamic_pointer_cast<NodeWithSubnodes>(root))
+        for (auto& inner : node->getSubNodes())
+            result += countSyntaxNodes(inner);
+    return result;
+}
@@ -0,0 +1,44 @@
+#ifndef RGR_STATS_H
+#define RGR_STATS_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "Parser.h"
+
+/*
+ * Per-phase statistics of the compiler pipeline.
+ *
+ * Each phase is measured for wall and CPU time, heap allocations and the peak resident set size of the process
+ * after it. Allocations are counted by a replacement of the global operator new built only with
+ * RGR_ALLOCATION_STATS (see CMakeLists.txt); it counts only while a phase is measured, and other builds report the
+ * allocations as unavailable.
+ */
+
+struct PhaseStats
+{
+    std::string name;
+    double wallMilliseconds, cpuMilliseconds;
+    size_t allocations, allocatedBytes;
+    long peakResidentKilobytes;
+};
+
+bool allocationStatsAvailable();
+
+class StatsRecorder
+{
+private:
+    std::vector<PhaseStats> phases;
+    std::vector<std::pair<std::string, size_t>> counts;
+public:
+    void measure(const std::string& name, const std::function<void()>& phase);
+    void count(const std::string& name, size_t value) { counts.emplace_back(name, value); }
+
+    const std::vector<PhaseStats>& getPhases() const { return phases; }
+    std::string report() const;
+};
+
+// nodes of the syntax tree, the root included
+size_t countSyntaxNodes(SyntaxNodePtr root);
+
+#endif //RGR_STATS_H
@@ -0,0 +1,41 @@
+#include "catch.hpp"
+#include "Stats.h"
+
+using namespace std;
+
+TEST_CASE( "pipeline statistics", "[stats]" ) {
+    string code = "dim a integer : a as 1 : : write(a) :\n";
+    vector<Token> scanned = scanTokens(code);
+    vector<Token> tokens = dropRedundantSeparators(scanned);
+    REQUIRE (tokens == lexString(code));
+    REQUIRE (scanned.size() > tokens.size());
+
+    SyntaxNodePtr tree = parseInputWithSemantic(make_shared<ProgramNode>(), code);
+    size_t nodes = countSyntaxNodes(tree);
+    REQUIRE (nodes > tokens.size());
+    REQUIRE (countSyntaxNodes(make_shared<IntNumberNode>("1")) == 1);
+
+    StatsRecorder stats;
+    stats.measure("allocate", [] {
+        vector<unique_ptr<int>> values;
+        for (int i = 0; i < 100; i++)
+            values.emplace_back(new int(i));
+    });
+    REQUIRE_THROWS (stats.measure("fail", [] { throw runtime_error("stop"); }));
+    stats.count("syntax nodes", nodes);
+
+    auto& phases = stats.getPhases();
+    REQUIRE (phases.size() == 2);
+    REQUIRE (phases[1].name == "fail");
+    REQUIRE (phases[0].wallMilliseconds >= 0);
+    REQUIRE (phases[0].peakResidentKilobytes > 0);
+    if (allocationStatsAvailable())
+    {
+        REQUIRE (phases[0].allocations >= 100);
+        REQUIRE (phases[0].allocatedBytes >= 100 * sizeof(int));
+    }
+
+    string report = stats.report();
+    REQUIRE (report.find("allocate") != string::npos);
+    REQUIRE (report.find("syntax nodes: " + to_string(nodes) + "\n") != string::npos);
+}
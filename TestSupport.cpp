@@ -0,0 +1,28 @@
+#include "TestSupport.h"
+
+using namespace std;
+
+SyntaxNodePtr parse(const string& code)
+{
+    return parseInputWithSemantic(make_shared<ProgramNode>(), code);
+}
+
+TypedProgram lower(const string& code)
+{
+    return lowerProgram(parse(code));
+}
+
+BytecodeProgram compile(const string& code)
+{
+    return compileBytecode(lower(code));
+}
+
+string runVM(const BytecodeImage& program, const string& input)
+{
+    return run(VirtualMachine(program), input);
+}
+
+string runVM(const string& code, const string& input)
+{
+    return runVM(compile(code), input);
+}
@@ -0,0 +1,35 @@
+#ifndef RGR_TESTSUPPORT_H
+#define RGR_TESTSUPPORT_H
+
+#include "VM.h"
+
+/*
+ * Helpers the tests of the execution backends share: the stages of the front end applied to source text, and a run
+ * of an engine on some input that returns what the program wrote followed by the message of the error that stopped
+ * it, if any, so that engines are compared on their failures as well as on their output.
+ */
+
+SyntaxNodePtr parse(const std::string& code);
+TypedProgram lower(const std::string& code);
+BytecodeProgram compile(const std::string& code);
+
+template<class Engine>
+std::string run(Engine&& engine, const std::string& input = "")
+{
+    InputBuffer in(input);
+    OutputBuffer out;
+    try
+    {
+        engine.run(in, out);
+    }
+    catch (std::exception& e)
+    {
+        return out.str() + e.what();
+    }
+    return out.str();
+}
+
+std::string runVM(const BytecodeImage& program, const std::string& input = "");
+std::string runVM(const std::string& code, const std::string& input = "");
+
+#endif //RGR_TESTSUPPORT_H
@@ -0,0 +1,292 @@
+#include "Threaded.h"
+using namespace std;
+
+namespace
+{
+    bool isTemporary(const BytecodeProgram& program, int reg)
+    {
+        return (size_t)reg >= program.variables.size() + program.constantCount;
+    }
+
+    bool isConstantOne(const BytecodeProgram& program, int reg)
+    {
+        return (size_t)reg >= program.variables.size() && !isTemporary(program, reg)
+               && program.registerTypes[reg] == DataType::Integer && program.initialRegisters[reg].i == 1;
+    }
+
+    bool isComparison(OpCode op, OpCode first)
+    {
+        return op >= first && (int)op < (int)first + 6;
+    }
+
+    // comparisons go in the order LT, GT, LE, GE, EQ, NE, see Bytecode.h
+    int negatedComparison(int comparison)
+    {
+        static const int negated[] = { 3, 2, 1, 0, 5, 4 };
+        return negated[comparison];
+    }
+
+    bool hasJumpTarget(ThreadedOp op)
+    {
+        return op == ThreadedOp::JMP || op == ThreadedOp::JMP_IF_FALSE || op == ThreadedOp::JMP_IF_TRUE || op >= ThreadedOp::JLT_II;
+    }
+
+    int32_t& jumpTarget(ThreadedInstruction& instruction)
+    {
+        switch (instruction.op)
+        {
+            case ThreadedOp::JMP: return instruction.a;
+            case ThreadedOp::JMP_IF_FALSE:
+            case ThreadedOp::JMP_IF_TRUE: return instruction.b;
+            default: return instruction.c;
+        }
+    }
+
+    string threadedOpName(ThreadedOp op)
+    {
+#define RGR_THREADED_OP_NAME(name) #name,
+        static const char* names[] = { RGR_OPCODES(RGR_THREADED_OP_NAME) RGR_SUPERINSTRUCTIONS(RGR_THREADED_OP_NAME) };
+#undef RGR_THREADED_OP_NAME
+
+        return names[(int)op];
+    }
+}
+
+ThreadedEngine::ThreadedEngine(const BytecodeProgram& program) : registers(program.initialRegisters)
+{
+    translate(program);
+}
+
+void ThreadedEngine::translate(const BytecodeProgram& program)
+{
+    const void* const* handlers = 0;
+    execute(0, 0, 0, &handlers);
+
+    const vector<Instruction>& source = program.code;
+
+    // instructions that are jumped to can't be swallowed by a superinstruction
+    vector<bool> isTarget(source.size() + 1, false);
+    for (auto& instruction : source)
+    {
+        if (instruction.op == OpCode::JMP)
+            isTarget[instruction.a] = true;
+        else if (instruction.op == OpCode::JMP_IF_FALSE || instruction.op == OpCode::JMP_IF_TRUE)
+            isTarget[instruction.b] = true;
+    }
+
+    vector<int32_t> newIndex(source.size() + 1);
+    auto emit = [&](ThreadedOp op, int32_t a, int32_t b, int32_t c, size_t pc) {
+        code.push_back(ThreadedInstruction { handlers ? handlers[(int)op] : 0, op, a, b, c });
+        lines.push_back(program.lines[pc]);
+    };
+
+    size_t pc = 0;
+    while (pc < source.size())
+    {
+        newIndex[pc] = code.size();
+        const Instruction& in = source[pc];
+        const Instruction* next = pc + 1 < source.size() && !isTarget[pc + 1] ? &source[pc + 1] : 0;
+        const Instruction* afterNext = next && pc + 2 < source.size() && !isTarget[pc + 2] ? &source[pc + 2] : 0;
+
+        // counter increment, comparison with the limit and branch back to the body of a "for" loop
+        if (in.op == OpCode::ADD_I && in.a == in.b && isConstantOne(program, in.c) && afterNext
+            && next->op == OpCode::CMP_LE_II && next->b == in.a && isTemporary(program, next->a)
+            && afterNext->op == OpCode::JMP_IF_TRUE && afterNext->a == next->a)
+        {
+            emit(ThreadedOp::INC_JLE_I, in.a, next->c, afterNext->b, pc);
+            newIndex[pc + 1] = newIndex[pc + 2] = newIndex[pc];
+            pc += 3;
+            continue;
+        }
+
+        // comparison of two registers and branch on its result, the result itself is a dead temporary
+        if (next && (next->op == OpCode::JMP_IF_TRUE || next->op == OpCode::JMP_IF_FALSE) && next->a == in.a
+            && isTemporary(program, in.a))
+        {
+            bool jumpIfTrue = next->op == OpCode::JMP_IF_TRUE;
+            int fused = -1;
+
+            if (isComparison(in.op, OpCode::CMP_LT_II))
+            {
+                int comparison = (int)in.op - (int)OpCode::CMP_LT_II;
+                fused = (int)ThreadedOp::JLT_II + (jumpIfTrue ? comparison : negatedComparison(comparison));
+            }
+            // a negated float comparison isn't the opposite comparison because of NaN
+            else if (isComparison(in.op, OpCode::CMP_LT_FF) && jumpIfTrue)
+                fused = (int)ThreadedOp::JLT_FF + ((int)in.op - (int)OpCode::CMP_LT_FF);
+
+            if (fused >= 0)
+            {
+                emit(ThreadedOp(fused), in.b, in.c, next->b, pc);
+                newIndex[pc + 1] = newIndex[pc];
+                pc += 2;
+                continue;
+            }
+        }
+
+        emit(ThreadedOp((int)in.op), in.a, in.b, in.c, pc);
+        pc++;
+    }
+    newIndex[source.size()] = code.size();
+
+    for (auto& instruction : code)
+        if (hasJumpTarget(instruction.op))
+            jumpTarget(instruction) = newIndex[jumpTarget(instruction)];
+}
+
+void ThreadedEngine::run(InputBuffer& input, OutputBuffer& output)
+{
+    execute(this, &input, &output, 0);
+}
+
+void ThreadedEngine::execute(ThreadedEngine* engine, InputBuffer* input, OutputBuffer* output, const void* const** handlers)
+{
+#ifdef RGR_COMPUTED_GOTO
+#define RGR_LABEL_ADDRESS(name) &&L_##name,
+    static const void* const labels[] = { RGR_OPCODES(RGR_LABEL_ADDRESS) RGR_SUPERINSTRUCTIONS(RGR_LABEL_ADDRESS) };
+#undef RGR_LABEL_ADDRESS
+
+    if (handlers)
+    {
+        *handlers = labels;
+        return;
+    }
+
+#define CASE(name) L_##name:
+#define NEXT() goto *(in = ip++)->handler
+#else
+    if (handlers)
+    {
+        *handlers = 0;
+        return;
+    }
+
+#define CASE(name) case ThreadedOp::name:
+#define NEXT() continue
+#endif
+
+#define LINE (engine->lines[in - code])
+#define JUMP(target) { ip = code + (target); NEXT(); }
+
+    const ThreadedInstruction* code = engine->code.data();
+    const ThreadedInstruction* ip = code;
+    const ThreadedInstruction* in;
+    Value* r = engine->registers.data();
+
+#ifdef RGR_COMPUTED_GOTO
+    NEXT();
+#else
+    for (;;)
+    {
+        in = ip++;
+        switch (in->op)
+        {
+#endif
+
+    CASE(HALT) return;
+    CASE(MOV) r[in->a] = r[in->b]; NEXT();
+    CASE(I2F) r[in->a].f = (double)r[in->b].i; NEXT();
+
+    CASE(ADD_I) r[in->a].i = wrapAdd(r[in->b].i, r[in->c].i); NEXT();
+    CASE(SUB_I) r[in->a].i = wrapSub(r[in->b].i, r[in->c].i); NEXT();
+    CASE(MUL_I) r[in->a].i = wrapMul(r[in->b].i, r[in->c].i); NEXT();
+    CASE(DIV_I) r[in->a].i = divideInt(r[in->b].i, r[in->c].i, LINE); NEXT();
+    CASE(AND_I) r[in->a].i = r[in->b].i & r[in->c].i; NEXT();
+    CASE(OR_I) r[in->a].i = r[in->b].i | r[in->c].i; NEXT();
+    CASE(NOT_I) r[in->a].i = ~r[in->b].i; NEXT();
+
+    CASE(ADD_F) r[in->a].f = r[in->b].f + r[in->c].f; NEXT();
+    CASE(SUB_F) r[in->a].f = r[in->b].f - r[in->c].f; NEXT();
+    CASE(MUL_F) r[in->a].f = r[in->b].f * r[in->c].f; NEXT();
+    CASE(DIV_F) r[in->a].f = r[in->b].f / r[in->c].f; NEXT();
+
+    CASE(AND_B) r[in->a].i = r[in->b].i & r[in->c].i; NEXT();
+    CASE(OR_B) r[in->a].i = r[in->b].i | r[in->c].i; NEXT();
+    CASE(NOT_B) r[in->a].i = !r[in->b].i; NEXT();
+
+    CASE(CMP_LT_II) r[in->a].i = r[in->b].i < r[in->c].i; NEXT();
+    CASE(CMP_GT_II) r[in->a].i = r[in->b].i > r[in->c].i; NEXT();
+    CASE(CMP_LE_II) r[in->a].i = r[in->b].i <= r[in->c].i; NEXT();
+    CASE(CMP_GE_II) r[in->a].i = r[in->b].i >= r[in->c].i; NEXT();
+    CASE(CMP_EQ_II) r[in->a].i = r[in->b].i == r[in->c].i; NEXT();
+    CASE(CMP_NE_II) r[in->a].i = r[in->b].i != r[in->c].i; NEXT();
+
+    CASE(CMP_LT_FF) r[in->a].i = r[in->b].f < r[in->c].f; NEXT();
+    CASE(CMP_GT_FF) r[in->a].i = r[in->b].f > r[in->c].f; NEXT();
+    CASE(CMP_LE_FF) r[in->a].i = r[in->b].f <= r[in->c].f; NEXT();
+    CASE(CMP_GE_FF) r[in->a].i = r[in->b].f >= r[in->c].f; NEXT();
+    CASE(CMP_EQ_FF) r[in->a].i = r[in->b].f == r[in->c].f; NEXT();
+    CASE(CMP_NE_FF) r[in->a].i = r[in->b].f != r[in->c].f; NEXT();
+
+    CASE(CMP_LT_IF) r[in->a].i = (double)r[in->b].i < r[in->c].f; NEXT();
+    CASE(CMP_GT_IF) r[in->a].i = (double)r[in->b].i > r[in->c].f; NEXT();
+    CASE(CMP_LE_IF) r[in->a].i = (double)r[in->b].i <= r[in->c].f; NEXT();
+    CASE(CMP_GE_IF) r[in->a].i = (double)r[in->b].i >= r[in->c].f; NEXT();
+    CASE(CMP_EQ_IF) r[in->a].i = (double)r[in->b].i == r[in->c].f; NEXT();
+    CASE(CMP_NE_IF) r[in->a].i = (double)r[in->b].i != r[in->c].f; NEXT();
+
+    CASE(CMP_LT_FI) r[in->a].i = r[in->b].f < (double)r[in->c].i; NEXT();
+    CASE(CMP_GT_FI) r[in->a].i = r[in->b].f > (double)r[in->c].i; NEXT();
+    CASE(CMP_LE_FI) r[in->a].i = r[in->b].f <= (double)r[in->c].i; NEXT();
+    CASE(CMP_GE_FI) r[in->a].i = r[in->b].f >= (double)r[in->c].i; NEXT();
+    CASE(CMP_EQ_FI) r[in->a].i = r[in->b].f == (double)r[in->c].i; NEXT();
+    CASE(CMP_NE_FI) r[in->a].i = r[in->b].f != (double)r[in->c].i; NEXT();
+
+    CASE(CMP_EQ_BB) r[in->a].i = r[in->b].i == r[in->c].i; NEXT();
+    CASE(CMP_NE_BB) r[in->a].i = r[in->b].i != r[in->c].i; NEXT();
+
+    CASE(JMP) JUMP(in->a);
+    CASE(JMP_IF_FALSE) if (!r[in->a].i) JUMP(in->b); NEXT();
+    CASE(JMP_IF_TRUE) if (r[in->a].i) JUMP(in->b); NEXT();
+
+    CASE(READ_I) r[in->a].i = input->readInt(LINE); NEXT();
+    CASE(READ_F) r[in->a].f = input->readFloat(LINE); NEXT();
+    CASE(READ_B) r[in->a].i = input->readBool(LINE); NEXT();
+
+    CASE(WRITE_I) output->writeInt(r[in->a].i); NEXT();
+    CASE(WRITE_F) output->writeFloat(r[in->a].f); NEXT();
+    CASE(WRITE_B) output->writeBool(r[in->a].i != 0); NEXT();
+    CASE(WRITE_SPACE) output->writeChar(' '); NEXT();
+    CASE(WRITE_LINE) output->writeChar('\n'); NEXT();
+
+    CASE(JLT_II) if (r[in->a].i < r[in->b].i) JUMP(in->c); NEXT();
+    CASE(JGT_II) if (r[in->a].i > r[in->b].i) JUMP(in->c); NEXT();
+    CASE(JLE_II) if (r[in->a].i <= r[in->b].i) JUMP(in->c); NEXT();
+    CASE(JGE_II) if (r[in->a].i >= r[in->b].i) JUMP(in->c); NEXT();
+    CASE(JEQ_II) if (r[in->a].i == r[in->b].i) JUMP(in->c); NEXT();
+    CASE(JNE_II) if (r[in->a].i != r[in->b].i) JUMP(in->c); NEXT();
+
+    CASE(JLT_FF) if (r[in->a].f < r[in->b].f) JUMP(in->c); NEXT();
+    CASE(JGT_FF) if (r[in->a].f > r[in->b].f) JUMP(in->c); NEXT();
+    CASE(JLE_FF) if (r[in->a].f <= r[in->b].f) JUMP(in->c); NEXT();
+    CASE(JGE_FF) if (r[in->a].f >= r[in->b].f) JUMP(in->c); NEXT();
+    CASE(JEQ_FF) if (r[in->a].f == r[in->b].f) JUMP(in->c); NEXT();
+    CASE(JNE_FF) if (r[in->a].f != r[in->b].f) JUMP(in->c); NEXT();
+
+    CASE(INC_JLE_I)
+        r[in->a].i = wrapAdd(r[in->a].i, 1);
+        if (r[in->a].i <= r[in->b].i) JUMP(in->c);
+        NEXT();
+
+#ifndef RGR_COMPUTED_GOTO
+        }
+    }
+#endif
+
+#undef CASE
+#undef NEXT
+#undef JUMP
+#undef LINE
+}
+
+std::string ThreadedEngine::dump()
+{
+    string result;
+    for (size_t i = 0; i < code.size(); i++)
+    {
+        const ThreadedInstruction& instruction = code[i];
+        result += to_string(i) + " " + threadedOpName(instruction.op) + " " + to_string(instruction.a) + ", "
+                  + to_string(instruction.b) + ", " + to_string(instruction.c) + "\n";
+    }
+    return result;
+}
@@ -0,0 +1,60 @@
+#ifndef RGR_THREADED_H
+#define RGR_THREADED_H
+
+#include "Bytecode.h"
+#include "Runtime.h"
+
+/*
+ * Direct-threaded execution engine.
+ *
+ * The bytecode is pre-decoded into an array of instructions that carry the address of their handler,
+ * and every handler jumps straight to the handler of the next instruction (GCC/Clang computed goto),
+ * so each of them gets its own indirect branch instead of sharing one in a central dispatch loop.
+ * Compilers without that extension, or builds with RGR_SWITCH_DISPATCH defined, use a switch loop.
+ *
+ * Common sequences are combined into superinstructions: a comparison followed by a branch on its result
+ * (the condition of "while" and "if") and the increment, comparison and branch closing a "for" loop.
+ */
+
+#if defined(__GNUC__) && !defined(RGR_SWITCH_DISPATCH)
+#define RGR_COMPUTED_GOTO
+#endif
+
+#define RGR_SUPERINSTRUCTIONS(X) \
+    X(JLT_II) X(JGT_II) X(JLE_II) X(JGE_II) X(JEQ_II) X(JNE_II) \
+    X(JLT_FF) X(JGT_FF) X(JLE_FF) X(JGE_FF) X(JEQ_FF) X(JNE_FF) \
+    X(INC_JLE_I)
+
+#define RGR_THREADED_OP_ENUM(name) name,
+
+// bytecode opcodes keep their numbers, superinstructions follow them
+enum class ThreadedOp : uint16_t { RGR_OPCODES(RGR_THREADED_OP_ENUM) RGR_SUPERINSTRUCTIONS(RGR_THREADED_OP_ENUM) };
+
+#undef RGR_THREADED_OP_ENUM
+
+struct ThreadedInstruction
+{
+    const void* handler;
+    ThreadedOp op;
+    int32_t a, b, c;
+};
+
+class ThreadedEngine
+{
+private:
+    std::vector<ThreadedInstruction> code;
+    std::vector<size_t> lines;
+    std::vector<Value> registers;
+
+    void translate(const BytecodeProgram& program);
+    static void execute(ThreadedEngine* engine, InputBuffer* input, OutputBuffer* output, const void* const** handlers);
+public:
+    explicit ThreadedEngine(const BytecodeProgram& program);
+
+    void run(InputBuffer& input, OutputBuffer& output);
+    const std::vector<Value>& getRegisters() { return registers; }
+
+    std::string dump();
+};
+
+#endif //RGR_THREADED_H
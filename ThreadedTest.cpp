@@ -0,0 +1,45 @@
+#include "catch.hpp"
+#include "TestSupport.h"
+#include "Threaded.h"
+
+using namespace std;
+
+namespace
+{
+    string runThreaded(string code, string input = "")
+    {
+        return run(ThreadedEngine(compile(code)), input);
+    }
+}
+
+TEST_CASE( "threaded engine matches the VM", "[threaded]" ) {
+    vector<string> programs = {
+            "write(10 - 3 - 2, 7 / 2, 7.0 / 2, 0ffh and 10b, not 0)",
+            "dim i, s integer : for i as 1 to 100 do s as s + i * i : write(s, i)",
+            "dim i integer : for i as 5 to 1 do write(i) : write(i)",
+            "dim a integer : while a < 10 do a as a + 3 : write(a)",
+            "dim f float : while f < 2.5 do f as f + 0.5 : write(f)",
+            "dim f float : f as 0.0 / 0.0 : while f < 2.5 do f as 1 : write(f)",
+            "dim i, j, n integer\n"
+            "for i as 1 to 10 do\n"
+            "    for j as i to 10 do\n"
+            "        if i * j > 50 then n as n + 1 else if i = j then n as n - 1\n"
+            "write(n)",
+            "dim a, b integer : dim f float : dim c bool : read(a, b, f, c) : if c then write(a / b, f * a) else write(0)",
+    };
+
+    for (auto& program : programs)
+        REQUIRE (runThreaded(program, "7 2 1.5 true") == runVM(program, "7 2 1.5 true"));
+
+    REQUIRE (runThreaded("dim a integer : write(1 / a)") == "Runtime error on line 1: Division by zero");
+}
+
+TEST_CASE( "superinstructions", "[threaded]" ) {
+    BytecodeProgram program = compile("dim i, s integer : for i as 1 to 10 do s as s + i : while s > 3 do s as s - 4 : write(s)");
+    string dump = ThreadedEngine(program).dump();
+
+    REQUIRE (dump.find("INC_JLE_I") != string::npos);
+    REQUIRE (dump.find("JGT_II") != string::npos);
+    REQUIRE (dump.find("CMP_") == string::npos);
+    REQUIRE (dump.find("JMP_IF_TRUE") == string::npos);
+}
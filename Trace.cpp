@@ -0,0 +1,130 @@
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+#include <unistd.h>
+using namespace std;
+
+namespace
+{
+    struct TraceEvent
+    {
+        string name;
+        const char* category;
+        size_t line;
+        double start, duration;     // microseconds
+    };
+
+    struct ThreadBuffer
+    {
+        size_t thread;
+        vector<TraceEvent> events;
+    };
+
+    atomic<bool> tracing, tracingItems;
+
+    // buffers outlive their threads, so that events of finished threads get written
+    mutex buffersMutex;
+    vector<unique_ptr<ThreadBuffer>> buffers;
+
+    ThreadBuffer& threadBuffer()
+    {
+        thread_local ThreadBuffer* buffer = nullptr;
+        if (!buffer)
+        {
+            lock_guard<mutex> lock(buffersMutex);
+            buffers.emplace_back(new ThreadBuffer { buffers.size() + 1, {} });
+            buffer = buffers.back().get();
+        }
+        return *buffer;
+    }
+
+    double now()
+    {
+        return chrono::duration<double, micro>(chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void writeString(ostringstream& out, const string& text)
+    {
+        out << '"';
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                out << '\\' << c;
+            else if ((unsigned char)c < 0x20)
+            {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out << escaped;
+            }
+            else
+                out << c;
+        }
+        out << '"';
+    }
+}
+
+void startTracing(bool items)
+{
+    tracingItems = items;
+    tracing = true;
+}
+
+bool isTracing()
+{
+    return tracing.load(memory_order_relaxed);
+}
+
+bool isTracingItems()
+{
+    return tracingItems.load(memory_order_relaxed);
+}
+
+TraceSpan::TraceSpan(const char* _name, const char* _category, size_t _line)
+        : name(_name), category(_category), line(_line), start(0), active(isTracing())
+{
+    if (active)
+        start = now();
+}
+
+TraceSpan::~TraceSpan()
+{
+    if (active)
+        threadBuffer().events.push_back(TraceEvent { name, category, line, start, now() - start });
+}
+
+string traceJson()
+{
+    lock_guard<mutex> lock(buffersMutex);
+    ostringstream out;
+    out.precision(3);
+    out << fixed << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (auto& buffer : buffers)
+    {
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << getpid() << ",\"tid\":"
+            << buffer->thread << ",\"args\":{\"name\":\"" << (buffer->thread == 1 ? "main" : "worker " + to_string(buffer->thread - 1))
+            << "\"}}";
+        first = false;
+
+        // a span ends after the spans nested in it, the viewer wants the outer one first
+        vector<TraceEvent> events = buffer->events;
+        stable_sort(events.begin(), events.end(), [](const TraceEvent& a, const TraceEvent& b) { return a.start < b.start; });
+        for (auto& event : events)
+        {
+            out << ",\n{\"name\":";
+            writeString(out, event.name);
+            out << ",\"cat\":\"" << event.category << "\",\"ph\":\"X\",\"ts\":" << event.start << ",\"dur\":" << event.duration
+                << ",\"pid\":" << getpid() << ",\"tid\":" << buffer->thread;
+            if (event.line)
+                out << ",\"args\":{\"line\":" << event.line << "}";
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+    return out.str();
+}
@@ -0,0 +1,43 @@
+#ifndef RGR_TRACE_H
+#define RGR_TRACE_H
+
+#include <string>
+
+/*
+ * Trace of the pipeline in the Chrome trace-event format, which Perfetto and chrome://tracing open.
+ *
+ * A TraceSpan covers the scope it lives in and becomes a complete ("X") event with its start and duration taken
+ * from a monotonic clock; spans nested in time on a thread show nested. Every thread appends its events to its own
+ * buffer without locking, the buffers are only registered once per thread and read when the trace is written, after
+ * the traced work is done. While tracing is off a span costs a check of a flag and allocates nothing: it keeps the
+ * name and category as given, so they must outlive it, as string literals do, and copies them only into an event.
+ *
+ * The pipeline phases are always traced, per-item spans (parsing and checking each top-level item of the program)
+ * only when asked for, as a program has many of them.
+ */
+
+void startTracing(bool items);
+bool isTracing();
+bool isTracingItems();
+
+class TraceSpan
+{
+private:
+    const char* name;
+    const char* category;
+    size_t line;
+    double start;
+    bool active;
+public:
+    // with a line, the line is shown as an argument of the event
+    explicit TraceSpan(const char* _name, const char* _category = "phase", size_t _line = 0);
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+};
+
+// the events of all threads so far as a trace-event JSON document
+std::string traceJson();
+
+#endif //RGR_TRACE_H
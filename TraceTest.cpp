@@ -0,0 +1,54 @@
+#include "catch.hpp"
+#include "Trace.h"
+#include "Parser.h"
+#include "Stats.h"
+#include <thread>
+
+using namespace std;
+
+namespace
+{
+    size_t occurrences(const string& text, const string& part)
+    {
+        size_t result = 0;
+        for (size_t at = text.find(part); at != string::npos; at = text.find(part, at + 1))
+            result++;
+        return result;
+    }
+}
+
+TEST_CASE( "pipeline trace", "[trace]" ) {
+    REQUIRE (!isTracing());
+    {
+        TraceSpan ignored("before tracing");
+    }
+    // spans that aren't traced don't allocate, counted in builds with RGR_ALLOCATION_STATS
+    StatsRecorder stats;
+    stats.measure("untraced", [] { TraceSpan span("parse item", "item", 1); });
+    if (allocationStatsAvailable())
+        REQUIRE (stats.getPhases()[0].allocations == 0);
+
+    startTracing(true);
+    REQUIRE (isTracing());
+    REQUIRE (isTracingItems());
+    parseInputWithSemantic(make_shared<ProgramNode>(), "dim a integer : a as 1 :\nwrite(a) :\n");
+    thread worker([] { TraceSpan span("on \"a\" worker", "test", 7); });
+    worker.join();
+
+    string trace = traceJson();
+    REQUIRE (trace[0] == '{');
+    REQUIRE (trace.find("\"traceEvents\":[") != string::npos);
+    REQUIRE (trace.find("before tracing") == string::npos);
+    REQUIRE (occurrences(trace, "\"name\":\"parse item\"") == 3);
+    REQUIRE (occurrences(trace, "\"name\":\"check item\"") == 3);
+    REQUIRE (trace.find("\"name\":\"scanTokens\"") != string::npos);
+    REQUIRE (trace.find("\"args\":{\"line\":2}") != string::npos);
+
+    // the span around the parse is written before the items in it
+    REQUIRE (trace.find("\"name\":\"parseInput\"") < trace.find("\"name\":\"parse item\""));
+    REQUIRE (trace.find("\"name\":\"semanticProcess\"") < trace.find("\"name\":\"check item\""));
+
+    REQUIRE (trace.find("\"name\":\"main\"") != string::npos);
+    REQUIRE (trace.find("\"name\":\"on \\\"a\\\" worker\",\"cat\":\"test\"") != string::npos);
+    REQUIRE (trace.compare(trace.size() - 4, 4, "\n]}\n") == 0);
+}
@@ -0,0 +1,465 @@
+#include "TypedTree.h"
+#include "Trace.h"
+#include "Runtime.h"
+#include <algorithm>
+#include <cassert>
+using namespace std;
+
+ExprPtr makeIntConst(long long value, size_t line)
+{
+    ExprPtr expr = make_shared<Expr>(ExprKind::IntConst, DataType::Integer, line);
+    expr->intValue = value;
+    return expr;
+}
+
+ExprPtr makeFloatConst(double value, size_t line)
+{
+    ExprPtr expr = make_shared<Expr>(ExprKind::FloatConst, DataType::Float, line);
+    expr->floatValue = value;
+    return expr;
+}
+
+ExprPtr makeBoolConst(bool value, size_t line)
+{
+    ExprPtr expr = make_shared<Expr>(ExprKind::BoolConst, DataType::Bool, line);
+    expr->intValue = value ? 1 : 0;
+    return expr;
+}
+
+ExprPtr makeVariable(size_t slot, DataType type, size_t line)
+{
+    ExprPtr expr = make_shared<Expr>(ExprKind::Variable, type, line);
+    expr->slot = slot;
+    return expr;
+}
+
+ExprPtr makeNot(ExprPtr operand, size_t line)
+{
+    assert(operand->type == DataType::Integer || operand->type == DataType::Bool);
+
+    ExprPtr expr = make_shared<Expr>(ExprKind::Not, operand->type, line);
+    expr->left = operand;
+    return expr;
+}
+
+ExprPtr makeIntToFloat(ExprPtr operand)
+{
+    assert(operand->type == DataType::Integer);
+
+    ExprPtr expr = make_shared<Expr>(ExprKind::IntToFloat, DataType::Float, operand->line);
+    expr->left = operand;
+    return expr;
+}
+
+ExprPtr makeBinary(BinaryOp op, ExprPtr left, ExprPtr right, size_t line)
+{
+    assert(left->type == right->type);
+
+    ExprPtr expr = make_shared<Expr>(ExprKind::Binary, isComparison(op) ? DataType::Bool : left->type, line);
+    expr->op = op;
+    expr->left = left;
+    expr->right = right;
+    return expr;
+}
+
+bool isConstant(ExprPtr expr)
+{
+    return expr->kind == ExprKind::IntConst || expr->kind == ExprKind::FloatConst || expr->kind == ExprKind::BoolConst;
+}
+
+bool isComparison(BinaryOp op)
+{
+    return op == BinaryOp::Less || op == BinaryOp::Greater || op == BinaryOp::LessEqual
+           || op == BinaryOp::GreaterEqual || op == BinaryOp::Equal || op == BinaryOp::NotEqual;
+}
+
+size_t slotUses(ExprPtr expr, size_t slot)
+{
+    if (!expr)
+        return 0;
+    return (expr->kind == ExprKind::Variable && expr->slot == slot) + slotUses(expr->left, slot) + slotUses(expr->right, slot);
+}
+
+void usedSlots(ExprPtr expr, set<size_t>& slots)
+{
+    if (!expr)
+        return;
+    if (expr->kind == ExprKind::Variable)
+        slots.insert(expr->slot);
+    usedSlots(expr->left, slots);
+    usedSlots(expr->right, slots);
+}
+
+bool assigns(StmtPtr stmt, size_t slot)
+{
+    if (stmt->kind == StmtKind::Assign || stmt->kind == StmtKind::For)
+        return stmt->slot == slot;
+    return find(stmt->slots.begin(), stmt->slots.end(), slot) != stmt->slots.end();
+}
+
+bool mayFail(ExprPtr expr, ExprPtr except)
+{
+    if (!expr || expr == except)
+        return false;
+    if (expr->kind == ExprKind::Binary && expr->op == BinaryOp::Div && expr->type == DataType::Integer
+        && !(expr->right->kind == ExprKind::IntConst && expr->right->intValue != 0))
+        return true;
+    return mayFail(expr->left, except) || mayFail(expr->right, except);
+}
+
+std::string binaryOpName(BinaryOp op)
+{
+    switch (op)
+    {
+        case BinaryOp::Add: return "+";
+        case BinaryOp::Sub: return "-";
+        case BinaryOp::Mul: return "*";
+        case BinaryOp::Div: return "/";
+        case BinaryOp::And: return "and";
+        case BinaryOp::Or: return "or";
+        case BinaryOp::Less: return "<";
+        case BinaryOp::Greater: return ">";
+        case BinaryOp::LessEqual: return "<=";
+        case BinaryOp::GreaterEqual: return ">=";
+        case BinaryOp::Equal: return "=";
+        case BinaryOp::NotEqual: return "<>";
+    }
+    return "?";
+}
+
+namespace
+{
+    map<string, BinaryOp> operations = {
+            { "+", BinaryOp::Add },
+            { "-", BinaryOp::Sub },
+            { "or", BinaryOp::Or },
+            { "*", BinaryOp::Mul },
+            { "/", BinaryOp::Div },
+            { "and", BinaryOp::And },
+            { "<", BinaryOp::Less },
+            { ">", BinaryOp::Greater },
+            { "<=", BinaryOp::LessEqual },
+            { ">=", BinaryOp::GreaterEqual },
+            { "=", BinaryOp::Equal },
+            { "<>", BinaryOp::NotEqual },
+    };
+
+    ExprPtr convert(ExprPtr expr, DataType type)
+    {
+        return expr->type == DataType::Integer && type == DataType::Float ? makeIntToFloat(expr) : expr;
+    }
+
+    ExprPtr combine(BinaryOp op, ExprPtr left, ExprPtr right, size_t line)
+    {
+        // the semantic check allows only integer and float to be mixed
+        if (left->type != right->type)
+        {
+            left = convert(left, DataType::Float);
+            right = convert(right, DataType::Float);
+        }
+
+        return makeBinary(op, left, right, line);
+    }
+
+    template<class T>
+    T* as(SyntaxNodePtr node)
+    {
+        T* result = dynamic_cast<T*>(node.get());
+        assert(result);
+        return result;
+    }
+
+    class Lowering
+    {
+    private:
+        TypedProgram& program;
+        map<string, size_t> slots;
+
+        // see foldChainType in Parser.cpp, the chain is folded from the left
+        template<class Head, class Tail, class LowerOperand>
+        ExprPtr lowerChain(SyntaxNodePtr head, LowerOperand lowerOperand)
+        {
+            ExprPtr result;
+            string operation;
+            size_t line = 0;
+
+            Head* node = as<Head>(head);
+            while (node)
+            {
+                ExprPtr operand = lowerOperand(node->getSubNodes()[0]);
+                result = operation == "" ? operand : combine(operations[operation], result, operand, line);
+
+                Tail* tail = as<Tail>(node->getSubNodes()[1]);
+                operation = tail->getOperation();
+                if (operation == "")
+                    node = 0;
+                else
+                {
+                    line = as<OneTokenNode>(tail->getSubNodes()[0])->getLine();
+                    node = as<Head>(tail->getSubNodes()[1]);
+                }
+            }
+
+            return result;
+        }
+
+        ExprPtr lowerFactor(SyntaxNodePtr factor)
+        {
+            auto& subNodes = as<FactorNode>(factor)->getSubNodes();
+
+            if (auto identifier = dynamic_cast<IdentifierNode*>(subNodes[0].get()))
+            {
+                size_t slot = slots.at(identifier->getContent());
+                return makeVariable(slot, program.variables[slot].type, identifier->getLine());
+            }
+
+            if (auto number = dynamic_cast<NumberNode*>(subNodes[0].get()))
+            {
+                OneTokenNode* literal = as<OneTokenNode>(number->getSubNodes()[0]);
+                if (dynamic_cast<FloatNumberNode*>(literal))
+                    return makeFloatConst(decodeFloatLiteral(literal->getContent()), literal->getLine());
+                return makeIntConst(decodeIntLiteral(literal->getContent()), literal->getLine());
+            }
+
+            if (auto boolConst = dynamic_cast<BoolConstNode*>(subNodes[0].get()))
+                return makeBoolConst(boolConst->getContent() == "true", boolConst->getLine());
+
+            if (auto unaryOperation = dynamic_cast<UnaryOperationNode*>(subNodes[0].get()))
+                return makeNot(lowerFactor(subNodes[1]), unaryOperation->getLine());
+
+            return lowerExpression(subNodes[1]);
+        }
+
+        ExprPtr lowerAddend(SyntaxNodePtr addend)
+        {
+            return lowerChain<AddendNode, AddendTailNode>(addend, [this](SyntaxNodePtr node) { return lowerFactor(node); });
+        }
+
+        ExprPtr lowerOperand(SyntaxNodePtr operand)
+        {
+            return lowerChain<OperandNode, OperandTailNode>(operand, [this](SyntaxNodePtr node) { return lowerAddend(node); });
+        }
+
+        ExprPtr lowerExpression(SyntaxNodePtr expression)
+        {
+            return lowerChain<ExpressionNode, ExpressionTailNode>(expression, [this](SyntaxNodePtr node) { return lowerOperand(node); });
+        }
+
+        StmtPtr lowerAssignment(SyntaxNodePtr assignment, StmtPtr stmt)
+        {
+            auto& subNodes = as<AssignmentNode>(assignment)->getSubNodes();
+
+            stmt->slot = slots.at(as<IdentifierNode>(subNodes[0])->getContent());
+            stmt->value = convert(lowerExpression(subNodes[2]), program.variables[stmt->slot].type);
+            return stmt;
+        }
+
+        StmtPtr lowerOperatorList(SyntaxNodePtr operatorList, size_t line)
+        {
+            StmtPtr block = make_shared<Stmt>(StmtKind::Block, line);
+
+            OperatorListNode* node = as<OperatorListNode>(operatorList);
+            while (node)
+            {
+                block->statements.push_back(lowerOperator(node->getSubNodes()[0]));
+
+                auto& tail = as<OperatorListTailNode>(node->getSubNodes()[1])->getSubNodes();
+                node = tail.empty() ? 0 : as<OperatorListNode>(tail[1]);
+            }
+
+            return block;
+        }
+
+        StmtPtr lowerOperator(SyntaxNodePtr node)
+        {
+            // operator can be preceded by empty lines
+            OperatorNode* operatorNode = as<OperatorNode>(node);
+            while (dynamic_cast<OperatorSepNode*>(operatorNode->getSubNodes()[0].get()))
+                operatorNode = as<OperatorNode>(operatorNode->getSubNodes()[1]);
+
+            SyntaxNodePtr inner = operatorNode->getSubNodes()[0];
+            ExpandableNode* statement = as<ExpandableNode>(inner);
+            auto& subNodes = statement->getSubNodes();
+            size_t line = statement->getLine();
+
+            if (dynamic_cast<AssignmentNode*>(statement))
+                return lowerAssignment(inner, make_shared<Stmt>(StmtKind::Assign, line));
+
+            if (dynamic_cast<NestedOperatorNode*>(statement))
+                return lowerOperatorList(subNodes[1], line);
+
+            if (dynamic_cast<ConditionNode*>(statement))
+            {
+                StmtPtr stmt = make_shared<Stmt>(StmtKind::If, line);
+                stmt->value = lowerExpression(subNodes[1]);
+                stmt->body = lowerOperator(subNodes[3]);
+
+                auto& elseBranch = as<ConditionTailNode>(subNodes[4])->getSubNodes();
+                if (!elseBranch.empty())
+                    stmt->elseBody = lowerOperator(elseBranch[1]);
+                return stmt;
+            }
+
+            if (dynamic_cast<ForLoopNode*>(statement))
+            {
+                StmtPtr stmt = lowerAssignment(subNodes[1], make_shared<Stmt>(StmtKind::For, line));
+                stmt->limit = lowerExpression(subNodes[3]);
+                stmt->body = lowerOperator(subNodes[5]);
+                return stmt;
+            }
+
+            if (dynamic_cast<WhileLoopNode*>(statement))
+            {
+                StmtPtr stmt = make_shared<Stmt>(StmtKind::While, line);
+                stmt->value = lowerExpression(subNodes[1]);
+                stmt->body = lowerOperator(subNodes[3]);
+                return stmt;
+            }
+
+            if (dynamic_cast<ReadingNode*>(statement))
+            {
+                StmtPtr stmt = make_shared<Stmt>(StmtKind::Read, line);
+                for (auto& name : as<IdentifierListNode>(subNodes[2])->gatherIdentifiers())
+                    stmt->slots.push_back(slots.at(name));
+                return stmt;
+            }
+
+            StmtPtr stmt = make_shared<Stmt>(StmtKind::Write, line);
+            assert(dynamic_cast<WritingNode*>(statement));
+
+            ExpressionListNode* expressionList = as<ExpressionListNode>(subNodes[2]);
+            while (expressionList)
+            {
+                stmt->values.push_back(lowerExpression(expressionList->getSubNodes()[0]));
+
+                auto& tail = as<ExpressionListTailNode>(expressionList->getSubNodes()[1])->getSubNodes();
+                expressionList = tail.empty() ? 0 : as<ExpressionListNode>(tail[1]);
+            }
+            return stmt;
+        }
+
+        void declare(SyntaxNodePtr declaration)
+        {
+            auto& subNodes = as<DeclarationNode>(declaration)->getSubNodes();
+            DataType type = as<TypeNode>(subNodes[2])->getType();
+
+            for (auto& name : as<IdentifierListNode>(subNodes[1])->gatherIdentifiers())
+            {
+                slots[name] = program.variables.size();
+                program.variables.push_back(Variable { name, type });
+            }
+        }
+    public:
+        Lowering(TypedProgram& _program) : program(_program) {}
+
+        void lower(SyntaxNodePtr root)
+        {
+            program.body = make_shared<Stmt>(StmtKind::Block, 1);
+
+            ProgramNode* node = as<ProgramNode>(root);
+            while (node)
+            {
+                SyntaxNodePtr item = as<ProgramItemNode>(node->getSubNodes()[0])->getSubNodes()[0];
+                if (dynamic_cast<DeclarationNode*>(item.get()))
+                    declare(item);
+                else
+                    program.body->statements.push_back(lowerOperator(item));
+
+                auto& tail = as<ProgramTailNode>(node->getSubNodes()[1])->getSubNodes();
+                node = tail.empty() ? 0 : as<ProgramNode>(tail[1]);
+            }
+        }
+    };
+
+    void dumpStmt(const TypedProgram& program, StmtPtr stmt, int shift, string& result)
+    {
+        string indent(shift * 4, ' ');
+
+        switch (stmt->kind)
+        {
+            case StmtKind::Assign:
+                result += indent + program.variables[stmt->slot].name + " as " + dumpExpr(program, stmt->value) + "\n";
+                break;
+            case StmtKind::If:
+                result += indent + "if " + dumpExpr(program, stmt->value) + " then\n";
+                dumpStmt(program, stmt->body, shift + 1, result);
+                if (stmt->elseBody)
+                {
+                    result += indent + "else\n";
+                    dumpStmt(program, stmt->elseBody, shift + 1, result);
+                }
+                break;
+            case StmtKind::While:
+                result += indent + "while " + dumpExpr(program, stmt->value) + " do\n";
+                dumpStmt(program, stmt->body, shift + 1, result);
+                break;
+            case StmtKind::For:
+                result += indent + "for " + program.variables[stmt->slot].name + " as " + dumpExpr(program, stmt->value)
+                          + " to " + dumpExpr(program, stmt->limit) + " do\n";
+                dumpStmt(program, stmt->body, shift + 1, result);
+                break;
+            case StmtKind::Read:
+                result += indent + "read(";
+                for (size_t i = 0; i < stmt->slots.size(); i++)
+                    result += (i ? ", " : "") + program.variables[stmt->slots[i]].name;
+                result += ")\n";
+                break;
+            case StmtKind::Write:
+                result += indent + "write(";
+                for (size_t i = 0; i < stmt->values.size(); i++)
+                    result += (i ? ", " : "") + dumpExpr(program, stmt->values[i]);
+                result += ")\n";
+                break;
+            case StmtKind::Block:
+                result += indent + "begin\n";
+                for (auto& inner : stmt->statements)
+                    dumpStmt(program, inner, shift + 1, result);
+                result += indent + "end\n";
+                break;
+        }
+    }
+}
+
+TypedProgram lowerProgram(SyntaxNodePtr program)
+{
+    TraceSpan span("lowerProgram");
+    TypedProgram result;
+    Lowering(result).lower(program);
+    return result;
+}
+
+std::string dumpExpr(const TypedProgram& program, ExprPtr expr)
+{
+    char buffer[maxFormattedLength];
+
+    switch (expr->kind)
+    {
+        case ExprKind::IntConst:
+            return string(buffer, formatInt(expr->intValue, buffer));
+        case ExprKind::FloatConst:
+            return string(buffer, formatFloat(expr->floatValue, buffer)) + "f";
+        case ExprKind::BoolConst:
+            return expr->intValue ? "true" : "false";
+        case ExprKind::Variable:
+            return program.variables[expr->slot].name;
+        case ExprKind::Not:
+            return "not " + dumpExpr(program, expr->left);
+        case ExprKind::IntToFloat:
+            return "float(" + dumpExpr(program, expr->left) + ")";
+        case ExprKind::Binary:
+            return "(" + dumpExpr(program, expr->left) + " " + binaryOpName(expr->op) + " " + dumpExpr(program, expr->right) + ")";
+    }
+    return "?";
+}
+
+std::string dumpTypedProgram(const TypedProgram& program)
+{
+    string result;
+    for (auto& variable : program.variables)
+        result += "dim " + variable.name + " " + dumpType(variable.type) + "\n";
+
+    for (auto& stmt : program.body->statements)
+        dumpStmt(program, stmt, 0, result);
+
+    return result;
+}
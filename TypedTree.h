@@ -0,0 +1,101 @@
+#ifndef RGR_TYPEDTREE_H
+#define RGR_TYPEDTREE_H
+
+#include "Parser.h"
+#include <set>
+
+/*
+ * Compact typed form of a checked program that execution backends are built from.
+ *
+ * Lowering removes the parsing artifacts of the syntax tree (tail nodes, separators, braces),
+ * binds every variable to a numbered slot, decodes literals and makes implicit conversions explicit:
+ * both operands of a binary operation always have the same type, and an assigned value always
+ * has the type of its variable.
+ */
+
+enum class ExprKind { IntConst, FloatConst, BoolConst, Variable, Not, IntToFloat, Binary };
+
+enum class BinaryOp { Add, Sub, Mul, Div, And, Or, Less, Greater, LessEqual, GreaterEqual, Equal, NotEqual };
+
+struct Expr;
+struct Stmt;
+
+typedef std::shared_ptr<Expr> ExprPtr;
+typedef std::shared_ptr<Stmt> StmtPtr;
+
+struct Expr
+{
+    ExprKind kind;
+    DataType type;
+    size_t line;
+
+    long long intValue;     // IntConst, BoolConst (0 or 1)
+    double floatValue;      // FloatConst
+    size_t slot;            // Variable
+    BinaryOp op;            // Binary
+    ExprPtr left, right;    // Binary operands, Not and IntToFloat use only the left one
+
+    Expr(ExprKind _kind, DataType _type, size_t _line)
+            : kind(_kind), type(_type), line(_line), intValue(0), floatValue(0), slot(0), op(BinaryOp::Add) {}
+};
+
+enum class StmtKind { Assign, If, While, For, Read, Write, Block };
+
+struct Stmt
+{
+    StmtKind kind;
+    size_t line;
+
+    size_t slot;                        // Assign target, For counter
+    ExprPtr value;                      // Assign value, If and While condition, For initial value
+    ExprPtr limit;                      // For limit, evaluated once after the initial assignment
+    StmtPtr body;                       // If "then" branch, loop body
+    StmtPtr elseBody;                   // If "else" branch, may be empty
+    std::vector<size_t> slots;          // Read targets
+    std::vector<ExprPtr> values;        // Write values
+    std::vector<StmtPtr> statements;    // Block
+
+    Stmt(StmtKind _kind, size_t _line) : kind(_kind), line(_line), slot(0) {}
+};
+
+struct Variable
+{
+    std::string name;
+    DataType type;
+};
+
+struct TypedProgram
+{
+    std::vector<Variable> variables;
+    StmtPtr body;
+};
+
+ExprPtr makeIntConst(long long value, size_t line);
+ExprPtr makeFloatConst(double value, size_t line);
+ExprPtr makeBoolConst(bool value, size_t line);
+ExprPtr makeVariable(size_t slot, DataType type, size_t line);
+ExprPtr makeNot(ExprPtr operand, size_t line);
+ExprPtr makeIntToFloat(ExprPtr operand);
+ExprPtr makeBinary(BinaryOp op, ExprPtr left, ExprPtr right, size_t line);
+
+// IntConst, FloatConst or BoolConst
+bool isConstant(ExprPtr expr);
+bool isComparison(BinaryOp op);
+
+// the times the expression reads the slot
+size_t slotUses(ExprPtr expr, size_t slot);
+void usedSlots(ExprPtr expr, std::set<size_t>& slots);
+// true if the statement itself, not counting the statements nested in it, stores to the slot:
+// an assignment, the counter of a "for" loop or a read
+bool assigns(StmtPtr stmt, size_t slot);
+// true if evaluating the expression may stop the program with a division by zero,
+// not counting the subexpression "except"
+bool mayFail(ExprPtr expr, ExprPtr except = ExprPtr());
+std::string binaryOpName(BinaryOp op);
+
+TypedProgram lowerProgram(SyntaxNodePtr program);
+
+std::string dumpExpr(const TypedProgram& program, ExprPtr expr);
+std::string dumpTypedProgram(const TypedProgram& program);
+
+#endif //RGR_TYPEDTREE_H
@@ -0,0 +1,126 @@
+#include "VM.h"
+using namespace std;
+
+VirtualMachine::VirtualMachine(const BytecodeImage& _program)
+        : program(_program), registers(_program.initialRegisters, _program.initialRegisters + _program.registerCount),
+          next(_program.entry)
+{
+}
+
+void VirtualMachine::run(InputBuffer& input, OutputBuffer& output)
+{
+    execute<false>(input, output, 0);
+}
+
+VmStatus VirtualMachine::resume(InputBuffer& input, OutputBuffer& output, size_t budget)
+{
+    return execute<true>(input, output, budget);
+}
+
+// the checks for suspending are compiled only into the resumable loop, run() is left as fast as before
+template<bool resumable>
+VmStatus VirtualMachine::execute(InputBuffer& input, OutputBuffer& output, size_t budget)
+{
+    const Instruction* code = program.code;
+    const Instruction* ip = code + (resumable ? next : program.entry);
+    Value* r = registers.data();
+
+#define LINE (program.lines[ip - 1 - code])
+#define PREEMPT if (resumable && --budget == 0) { next = ip - code; return VmStatus::Preempted; }
+#define CHECK_OUTPUT if (resumable && output.exceeded()) { next = ip - 1 - code; return VmStatus::OutputLimit; }
+#define WAIT_INPUT if (resumable && !input.ready()) { next = ip - 1 - code; return VmStatus::Suspended; }
+
+    for (;;)
+    {
+        const Instruction& in = *ip++;
+        switch (in.op)
+        {
+            case OpCode::HALT: next = ip - 1 - code; return VmStatus::Finished;
+            case OpCode::MOV: r[in.a] = r[in.b]; break;
+            case OpCode::I2F: r[in.a].f = (double)r[in.b].i; break;
+
+            case OpCode::ADD_I: r[in.a].i = wrapAdd(r[in.b].i, r[in.c].i); break;
+            case OpCode::SUB_I: r[in.a].i = wrapSub(r[in.b].i, r[in.c].i); break;
+            case OpCode::MUL_I: r[in.a].i = wrapMul(r[in.b].i, r[in.c].i); break;
+            case OpCode::DIV_I: r[in.a].i = divideInt(r[in.b].i, r[in.c].i, LINE); break;
+            case OpCode::AND_I: r[in.a].i = r[in.b].i & r[in.c].i; break;
+            case OpCode::OR_I: r[in.a].i = r[in.b].i | r[in.c].i; break;
+            case OpCode::NOT_I: r[in.a].i = ~r[in.b].i; break;
+
+            case OpCode::ADD_F: r[in.a].f = r[in.b].f + r[in.c].f; break;
+            case OpCode::SUB_F: r[in.a].f = r[in.b].f - r[in.c].f; break;
+            case OpCode::MUL_F: r[in.a].f = r[in.b].f * r[in.c].f; break;
+            case OpCode::DIV_F: r[in.a].f = r[in.b].f / r[in.c].f; break;
+
+            case OpCode::AND_B: r[in.a].i = r[in.b].i & r[in.c].i; break;
+            case OpCode::OR_B: r[in.a].i = r[in.b].i | r[in.c].i; break;
+            case OpCode::NOT_B: r[in.a].i = !r[in.b].i; break;
+
+            case OpCode::CMP_LT_II: r[in.a].i = r[in.b].i < r[in.c].i; break;
+            case OpCode::CMP_GT_II: r[in.a].i = r[in.b].i > r[in.c].i; break;
+            case OpCode::CMP_LE_II: r[in.a].i = r[in.b].i <= r[in.c].i; break;
+            case OpCode::CMP_GE_II: r[in.a].i = r[in.b].i >= r[in.c].i; break;
+            case OpCode::CMP_EQ_II: r[in.a].i = r[in.b].i == r[in.c].i; break;
+            case OpCode::CMP_NE_II: r[in.a].i = r[in.b].i != r[in.c].i; break;
+
+            case OpCode::CMP_LT_FF: r[in.a].i = r[in.b].f < r[in.c].f; break;
+            case OpCode::CMP_GT_FF: r[in.a].i = r[in.b].f > r[in.c].f; break;
+            case OpCode::CMP_LE_FF: r[in.a].i = r[in.b].f <= r[in.c].f; break;
+            case OpCode::CMP_GE_FF: r[in.a].i = r[in.b].f >= r[in.c].f; break;
+            case OpCode::CMP_EQ_FF: r[in.a].i = r[in.b].f == r[in.c].f; break;
+            case OpCode::CMP_NE_FF: r[in.a].i = r[in.b].f != r[in.c].f; break;
+
+            case OpCode::CMP_LT_IF: r[in.a].i = (double)r[in.b].i < r[in.c].f; break;
+            case OpCode::CMP_GT_IF: r[in.a].i = (double)r[in.b].i > r[in.c].f; break;
+            case OpCode::CMP_LE_IF: r[in.a].i = (double)r[in.b].i <= r[in.c].f; break;
+            case OpCode::CMP_GE_IF: r[in.a].i = (double)r[in.b].i >= r[in.c].f; break;
+            case OpCode::CMP_EQ_IF: r[in.a].i = (double)r[in.b].i == r[in.c].f; break;
+            case OpCode::CMP_NE_IF: r[in.a].i = (double)r[in.b].i != r[in.c].f; break;
+
+            case OpCode::CMP_LT_FI: r[in.a].i = r[in.b].f < (double)r[in.c].i; break;
+            case OpCode::CMP_GT_FI: r[in.a].i = r[in.b].f > (double)r[in.c].i; break;
+            case OpCode::CMP_LE_FI: r[in.a].i = r[in.b].f <= (double)r[in.c].i; break;
+            case OpCode::CMP_GE_FI: r[in.a].i = r[in.b].f >= (double)r[in.c].i; break;
+            case OpCode::CMP_EQ_FI: r[in.a].i = r[in.b].f == (double)r[in.c].i; break;
+            case OpCode::CMP_NE_FI: r[in.a].i = r[in.b].f != (double)r[in.c].i; break;
+
+            case OpCode::CMP_EQ_BB: r[in.a].i = r[in.b].i == r[in.c].i; break;
+            case OpCode::CMP_NE_BB: r[in.a].i = r[in.b].i != r[in.c].i; break;
+
+            case OpCode::JMP: ip = code + in.a; PREEMPT break;
+            case OpCode::JMP_IF_FALSE: if (!r[in.a].i) ip = code + in.b; PREEMPT break;
+            case OpCode::JMP_IF_TRUE: if (r[in.a].i) ip = code + in.b; PREEMPT break;
+
+            case OpCode::READ_I: WAIT_INPUT r[in.a].i = input.readInt(LINE); break;
+            case OpCode::READ_F: WAIT_INPUT r[in.a].f = input.readFloat(LINE); break;
+            case OpCode::READ_B: WAIT_INPUT r[in.a].i = input.readBool(LINE); break;
+
+            case OpCode::WRITE_I: output.writeInt(r[in.a].i); CHECK_OUTPUT break;
+            case OpCode::WRITE_F: output.writeFloat(r[in.a].f); CHECK_OUTPUT break;
+            case OpCode::WRITE_B: output.writeBool(r[in.a].i != 0); CHECK_OUTPUT break;
+            case OpCode::WRITE_SPACE: output.writeChar(' '); CHECK_OUTPUT break;
+            case OpCode::WRITE_LINE: output.writeChar('\n'); CHECK_OUTPUT break;
+        }
+    }
+
+#undef WAIT_INPUT
+#undef CHECK_OUTPUT
+#undef PREEMPT
+#undef LINE
+}
+
+LimitedRun runLimited(const BytecodeProgram& program, InputBuffer& input, OutputBuffer& output,
+                      const ExecutionLimits& limits)
+{
+    VirtualMachine vm(program);
+    output.setLimit(limits.outputBytes);
+
+    // a budget of 0 never runs out, as it is decremented before it is compared
+    VmStatus status = limits.fuel == 0 ? VmStatus::Preempted : vm.resume(input, output, limits.fuel);
+    switch (status)
+    {
+        case VmStatus::Preempted: return { LimitStatus::OutOfFuel, vm.stoppedLine() };
+        case VmStatus::OutputLimit: return { LimitStatus::OutOfOutput, vm.stoppedLine() };
+        default: return { LimitStatus::Finished, 0 };
+    }
+}
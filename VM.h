@@ -0,0 +1,64 @@
+#ifndef RGR_VM_H
+#define RGR_VM_H
+
+#include "Bytecode.h"
+#include "Runtime.h"
+
+enum class VmStatus
+{
+    Finished,       // the program halted
+    Suspended,      // a read found no whole token in the input, it is retried on the next resume
+    Preempted,      // the budget of jumps ran out
+    OutputLimit     // a write went past the output's limit (see OutputBuffer::setLimit)
+};
+
+class VirtualMachine
+{
+private:
+    BytecodeImage program;
+    std::vector<Value> registers;
+    size_t next;        // instruction resume() continues with
+
+    template<bool resumable>
+    VmStatus execute(InputBuffer& input, OutputBuffer& output, size_t budget);
+public:
+    explicit VirtualMachine(const BytecodeImage& _program);
+
+    void run(InputBuffer& input, OutputBuffer& output);
+
+    // runs on from where the last call stopped until the program halts, waits for input (see InputBuffer::ready),
+    // has taken the given number of jumps, so that a long loop gives way to other programs, or exceeds the output limit
+    VmStatus resume(InputBuffer& input, OutputBuffer& output, size_t budget);
+    // instruction the last resume() stopped at and its line
+    size_t position() const { return next; }
+    size_t stoppedLine() const { return program.lines[next]; }
+    const std::vector<Value>& getRegisters() { return registers; }
+};
+
+/*
+ * Metered execution of untrusted programs.
+ *
+ * Fuel is spent one unit per jump, which every loop iteration takes, so the straight-line code run between two
+ * checks is bounded by the program's length. The checks are those of the resumable VM loop: a counter decremented
+ * at jumps and a comparison after writes, the rest of the instructions run as in VirtualMachine::run().
+ */
+
+struct ExecutionLimits
+{
+    size_t fuel = SIZE_MAX;             // jumps
+    size_t outputBytes = SIZE_MAX;
+};
+
+enum class LimitStatus { Finished, OutOfFuel, OutOfOutput };
+
+struct LimitedRun
+{
+    LimitStatus status;
+    size_t line;        // line reached when a budget ran out
+};
+
+// runs the program within the limits, output past the byte budget is dropped; runtime errors are thrown as by run()
+LimitedRun runLimited(const BytecodeProgram& program, InputBuffer& input, OutputBuffer& output,
+                      const ExecutionLimits& limits);
+
+#endif //RGR_VM_H
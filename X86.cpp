@@ -0,0 +1,446 @@
+#include <cassert>
+#include "X86.h"
+using namespace std;
+
+namespace
+{
+    int number(Reg reg) { return (int)reg; }
+    int number(XReg reg) { return (int)reg; }
+
+    bool isByte(long long value) { return value >= -128 && value <= 127; }
+}
+
+void X86Assembler::dword(uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        byte((uint8_t)(value >> (8 * i)));
+}
+
+void X86Assembler::qword(uint64_t value)
+{
+    dword((uint32_t)value);
+    dword((uint32_t)(value >> 32));
+}
+
+// the prefix is omitted when it carries nothing, except for the byte registers SPL..DIL which need it
+void X86Assembler::rex(bool wide, int reg, int base, bool force, int index)
+{
+    uint8_t prefix = 0x40 | (wide ? 8 : 0) | ((reg >> 3) & 1) << 2 | ((index >> 3) & 1) << 1 | ((base >> 3) & 1);
+    if (prefix != 0x40 || force)
+        byte(prefix);
+}
+
+void X86Assembler::modrmRegister(int reg, int rm)
+{
+    byte(0xC0 | (reg & 7) << 3 | (rm & 7));
+}
+
+// [base + displacement] always has an explicit displacement, so RBP and R13 need no special case,
+// RSP and R12 as a base need a SIB byte
+void X86Assembler::modrmMemory(int reg, Reg base, int32_t displacement)
+{
+    int mode = isByte(displacement) ? 1 : 2;
+    byte(mode << 6 | (reg & 7) << 3 | (number(base) & 7));
+    if ((number(base) & 7) == 4)
+        byte(0x24);
+
+    if (mode == 1)
+        byte((uint8_t)displacement);
+    else
+        dword((uint32_t)displacement);
+}
+
+// [base + index + displacement] through a SIB byte with scale 1, RSP can't be the index
+void X86Assembler::modrmIndexed(int reg, Reg base, Reg index, int32_t displacement)
+{
+    assert(index != Reg::RSP);
+    int mode = isByte(displacement) ? 1 : 2;
+    byte(mode << 6 | (reg & 7) << 3 | 4);
+    byte((number(index) & 7) << 3 | (number(base) & 7));
+
+    if (mode == 1)
+        byte((uint8_t)displacement);
+    else
+        dword((uint32_t)displacement);
+}
+
+void X86Assembler::rel32(Label target)
+{
+    fixups.push_back(make_pair(code.size(), target));
+    dword(0);
+}
+
+void X86Assembler::sse(uint8_t prefix, uint8_t opcode, int reg, int rm, bool wide)
+{
+    byte(prefix);
+    rex(wide, reg, rm);
+    byte(0x0F);
+    byte(opcode);
+    modrmRegister(reg, rm);
+}
+
+void X86Assembler::sseMemory(uint8_t prefix, uint8_t opcode, int reg, Reg base, int32_t displacement, bool wide)
+{
+    byte(prefix);
+    rex(wide, reg, number(base));
+    byte(0x0F);
+    byte(opcode);
+    modrmMemory(reg, base, displacement);
+}
+
+Label X86Assembler::newLabel()
+{
+    labels.push_back(-1);
+    return labels.size() - 1;
+}
+
+void X86Assembler::bind(Label label)
+{
+    assert(labels[label] < 0);
+    labels[label] = code.size();
+}
+
+void X86Assembler::mov(Reg destination, Reg source)
+{
+    rex(true, number(source), number(destination));
+    byte(0x89);
+    modrmRegister(number(source), number(destination));
+}
+
+void X86Assembler::mov(Reg destination, long long immediate)
+{
+    int d = number(destination);
+    if (immediate == (int32_t)immediate)
+    {
+        rex(true, 0, d);
+        byte(0xC7);
+        modrmRegister(0, d);
+        dword((uint32_t)immediate);
+    }
+    else if (immediate >= 0 && immediate <= 0xFFFFFFFFLL)
+    {
+        // writing the 32-bit register clears the upper half
+        rex(false, 0, d);
+        byte(0xB8 + (d & 7));
+        dword((uint32_t)immediate);
+    }
+    else
+    {
+        rex(true, 0, d);
+        byte(0xB8 + (d & 7));
+        qword((uint64_t)immediate);
+    }
+}
+
+void X86Assembler::load(Reg destination, Reg base, int32_t displacement)
+{
+    rex(true, number(destination), number(base));
+    byte(0x8B);
+    modrmMemory(number(destination), base, displacement);
+}
+
+void X86Assembler::store(Reg base, int32_t displacement, Reg source)
+{
+    rex(true, number(source), number(base));
+    byte(0x89);
+    modrmMemory(number(source), base, displacement);
+}
+
+void X86Assembler::lea(Reg destination, Reg base, int32_t displacement)
+{
+    rex(true, number(destination), number(base));
+    byte(0x8D);
+    modrmMemory(number(destination), base, displacement);
+}
+
+void X86Assembler::loadByte(Reg destination, Reg base, Reg index, int32_t displacement)
+{
+    rex(true, number(destination), number(base), false, number(index));
+    byte(0x0F);
+    byte(0xB6);
+    modrmIndexed(number(destination), base, index, displacement);
+}
+
+void X86Assembler::storeByte(Reg base, Reg index, int32_t displacement, Reg source)
+{
+    int s = number(source);
+    rex(false, s, number(base), s >= 4 && s < 8, number(index));
+    byte(0x88);
+    modrmIndexed(s, base, index, displacement);
+}
+
+void X86Assembler::alu(AluOp op, Reg destination, Reg source)
+{
+    rex(true, number(source), number(destination));
+    byte((uint8_t)op * 8 + 1);
+    modrmRegister(number(source), number(destination));
+}
+
+void X86Assembler::alu(AluOp op, Reg destination, int32_t immediate)
+{
+    rex(true, 0, number(destination));
+    byte(isByte(immediate) ? 0x83 : 0x81);
+    modrmRegister((int)op, number(destination));
+    if (isByte(immediate))
+        byte((uint8_t)immediate);
+    else
+        dword((uint32_t)immediate);
+}
+
+void X86Assembler::alu(AluOp op, Reg destination, Reg base, int32_t displacement)
+{
+    rex(true, number(destination), number(base));
+    byte((uint8_t)op * 8 + 3);
+    modrmMemory(number(destination), base, displacement);
+}
+
+void X86Assembler::aluMemory(AluOp op, Reg base, int32_t displacement, int32_t immediate)
+{
+    rex(true, 0, number(base));
+    byte(isByte(immediate) ? 0x83 : 0x81);
+    modrmMemory((int)op, base, displacement);
+    if (isByte(immediate))
+        byte((uint8_t)immediate);
+    else
+        dword((uint32_t)immediate);
+}
+
+void X86Assembler::imul(Reg destination, Reg source)
+{
+    rex(true, number(destination), number(source));
+    byte(0x0F);
+    byte(0xAF);
+    modrmRegister(number(destination), number(source));
+}
+
+void X86Assembler::imul(Reg destination, Reg base, int32_t displacement)
+{
+    rex(true, number(destination), number(base));
+    byte(0x0F);
+    byte(0xAF);
+    modrmMemory(number(destination), base, displacement);
+}
+
+void X86Assembler::imul(Reg destination, int32_t immediate)
+{
+    rex(true, number(destination), number(destination));
+    byte(isByte(immediate) ? 0x6B : 0x69);
+    modrmRegister(number(destination), number(destination));
+    if (isByte(immediate))
+        byte((uint8_t)immediate);
+    else
+        dword((uint32_t)immediate);
+}
+
+void X86Assembler::neg(Reg reg)
+{
+    rex(true, 0, number(reg));
+    byte(0xF7);
+    modrmRegister(3, number(reg));
+}
+
+void X86Assembler::notReg(Reg reg)
+{
+    rex(true, 0, number(reg));
+    byte(0xF7);
+    modrmRegister(2, number(reg));
+}
+
+void X86Assembler::cqo()
+{
+    byte(0x48);
+    byte(0x99);
+}
+
+void X86Assembler::idiv(Reg divisor)
+{
+    rex(true, 0, number(divisor));
+    byte(0xF7);
+    modrmRegister(7, number(divisor));
+}
+
+void X86Assembler::div(Reg divisor)
+{
+    rex(true, 0, number(divisor));
+    byte(0xF7);
+    modrmRegister(6, number(divisor));
+}
+
+void X86Assembler::mul(Reg source)
+{
+    rex(true, 0, number(source));
+    byte(0xF7);
+    modrmRegister(4, number(source));
+}
+
+void X86Assembler::shift(ShiftOp op, Reg reg, uint8_t count)
+{
+    rex(true, 0, number(reg));
+    byte(0xC1);
+    modrmRegister((int)op, number(reg));
+    byte(count);
+}
+
+void X86Assembler::shift(ShiftOp op, Reg reg)
+{
+    rex(true, 0, number(reg));
+    byte(0xD3);
+    modrmRegister((int)op, number(reg));
+}
+
+void X86Assembler::shrd(Reg destination, Reg source)
+{
+    rex(true, number(source), number(destination));
+    byte(0x0F);
+    byte(0xAD);
+    modrmRegister(number(source), number(destination));
+}
+
+void X86Assembler::test(Reg a, Reg b)
+{
+    rex(true, number(b), number(a));
+    byte(0x85);
+    modrmRegister(number(b), number(a));
+}
+
+void X86Assembler::test32(Reg a, Reg b)
+{
+    rex(false, number(b), number(a));
+    byte(0x85);
+    modrmRegister(number(b), number(a));
+}
+
+void X86Assembler::setcc(Cond cond, Reg destination)
+{
+    int d = number(destination);
+    rex(false, 0, d, d >= 4 && d < 8);
+    byte(0x0F);
+    byte(0x90 + (uint8_t)cond);
+    modrmRegister(0, d);
+
+    // movzx destination, destination8
+    rex(true, d, d);
+    byte(0x0F);
+    byte(0xB6);
+    modrmRegister(d, d);
+}
+
+void X86Assembler::jmp(Label target)
+{
+    byte(0xE9);
+    rel32(target);
+}
+
+void X86Assembler::jcc(Cond cond, Label target)
+{
+    byte(0x0F);
+    byte(0x80 + (uint8_t)cond);
+    rel32(target);
+}
+
+void X86Assembler::call(Reg target)
+{
+    rex(false, 0, number(target));
+    byte(0xFF);
+    modrmRegister(2, number(target));
+}
+
+void X86Assembler::call(Label target)
+{
+    byte(0xE8);
+    rel32(target);
+}
+
+void X86Assembler::syscall()
+{
+    byte(0x0F);
+    byte(0x05);
+}
+
+void X86Assembler::push(Reg reg)
+{
+    rex(false, 0, number(reg));
+    byte(0x50 + (number(reg) & 7));
+}
+
+void X86Assembler::pop(Reg reg)
+{
+    rex(false, 0, number(reg));
+    byte(0x58 + (number(reg) & 7));
+}
+
+void X86Assembler::ret()
+{
+    byte(0xC3);
+}
+
+// movapd copies the whole register and avoids the partial write of movsd
+void X86Assembler::movsd(XReg destination, XReg source)
+{
+    sse(0x66, 0x28, number(destination), number(source));
+}
+
+void X86Assembler::movsd(XReg destination, Reg base, int32_t displacement)
+{
+    sseMemory(0xF2, 0x10, number(destination), base, displacement);
+}
+
+void X86Assembler::movsd(Reg base, int32_t displacement, XReg source)
+{
+    sseMemory(0xF2, 0x11, number(source), base, displacement);
+}
+
+void X86Assembler::sseOp(SseOp op, XReg destination, XReg source)
+{
+    sse(0xF2, (uint8_t)op, number(destination), number(source));
+}
+
+void X86Assembler::sseOp(SseOp op, XReg destination, Reg base, int32_t displacement)
+{
+    sseMemory(0xF2, (uint8_t)op, number(destination), base, displacement);
+}
+
+void X86Assembler::ucomisd(XReg a, XReg b)
+{
+    sse(0x66, 0x2E, number(a), number(b));
+}
+
+void X86Assembler::ucomisd(XReg a, Reg base, int32_t displacement)
+{
+    sseMemory(0x66, 0x2E, number(a), base, displacement);
+}
+
+void X86Assembler::cvtsi2sd(XReg destination, Reg source)
+{
+    sse(0xF2, 0x2A, number(destination), number(source), true);
+}
+
+void X86Assembler::cvtsi2sd(XReg destination, Reg base, int32_t displacement)
+{
+    sseMemory(0xF2, 0x2A, number(destination), base, displacement, true);
+}
+
+void X86Assembler::xorpd(XReg destination, XReg source)
+{
+    sse(0x66, 0x57, number(destination), number(source));
+}
+
+void X86Assembler::movq(Reg destination, XReg source)
+{
+    sse(0x66, 0x7E, number(source), number(destination), true);
+}
+
+vector<uint8_t> X86Assembler::finish()
+{
+    for (auto& fixup : fixups)
+    {
+        long long target = labels[fixup.second];
+        assert(target >= 0);
+
+        uint32_t offset = (uint32_t)(target - (long long)(fixup.first + 4));
+        for (int i = 0; i < 4; i++)
+            code[fixup.first + i] = (uint8_t)(offset >> (8 * i));
+    }
+    fixups.clear();
+    return code;
+}
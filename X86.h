@@ -0,0 +1,127 @@
+#ifndef RGR_X86_H
+#define RGR_X86_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Minimal x86-64 machine code assembler used by the native backends.
+ *
+ * Only the instructions the code generators need are supported: 64-bit integer arithmetic and moves
+ * between registers, immediates and memory addressed as base register plus displacement, scalar double
+ * SSE2 arithmetic, conditional branches to labels and calls through a register.
+ * Emitting bytes is portable, only running the result requires an x86-64 processor.
+ */
+
+enum class Reg : uint8_t { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+enum class XReg : uint8_t { XMM0, XMM1, XMM2, XMM3, XMM4, XMM5, XMM6, XMM7,
+                            XMM8, XMM9, XMM10, XMM11, XMM12, XMM13, XMM14, XMM15 };
+
+// condition codes in the encoding order, flipping the lowest bit negates a condition
+enum class Cond : uint8_t { O, NO, B, AE, E, NE, BE, A, S, NS, P, NP, L, GE, LE, G };
+
+// arithmetic group opcodes sharing the encoding, the value is the /digit of the immediate form
+enum class AluOp : uint8_t { Add = 0, Or = 1, Adc = 2, Sbb = 3, And = 4, Sub = 5, Xor = 6, Cmp = 7 };
+
+// shift group opcodes, the value is the /digit
+enum class ShiftOp : uint8_t { Shl = 4, Shr = 5, Sar = 7 };
+
+// scalar double instructions as their opcode byte after the 0F escape
+enum class SseOp : uint8_t { Add = 0x58, Mul = 0x59, Sub = 0x5C, Div = 0x5E };
+
+inline Cond inverse(Cond cond) { return (Cond)((uint8_t)cond ^ 1); }
+
+typedef size_t Label;
+
+class X86Assembler
+{
+private:
+    std::vector<uint8_t> code;
+    std::vector<long long> labels;                      // bound positions, -1 while unbound
+    std::vector<std::pair<size_t, Label>> fixups;       // rel32 fields waiting for their labels
+
+    void byte(uint8_t value) { code.push_back(value); }
+    void dword(uint32_t value);
+    void qword(uint64_t value);
+
+    void rex(bool wide, int reg, int base, bool force = false, int index = 0);
+    void modrmRegister(int reg, int rm);
+    void modrmMemory(int reg, Reg base, int32_t displacement);
+    void modrmIndexed(int reg, Reg base, Reg index, int32_t displacement);
+
+    void rel32(Label target);
+    void sse(uint8_t prefix, uint8_t opcode, int reg, int rm, bool wide = false);
+    void sseMemory(uint8_t prefix, uint8_t opcode, int reg, Reg base, int32_t displacement, bool wide = false);
+public:
+    Label newLabel();
+    void bind(Label label);
+
+    void mov(Reg destination, Reg source);
+    void mov(Reg destination, long long immediate);
+    void load(Reg destination, Reg base, int32_t displacement);
+    void store(Reg base, int32_t displacement, Reg source);
+    void lea(Reg destination, Reg base, int32_t displacement);
+
+    // byte at [base + index + displacement], loads zero extend
+    void loadByte(Reg destination, Reg base, Reg index, int32_t displacement);
+    void storeByte(Reg base, Reg index, int32_t displacement, Reg source);
+
+    void alu(AluOp op, Reg destination, Reg source);
+    void alu(AluOp op, Reg destination, int32_t immediate);
+    void alu(AluOp op, Reg destination, Reg base, int32_t displacement);
+    void aluMemory(AluOp op, Reg base, int32_t displacement, int32_t immediate);
+
+    void imul(Reg destination, Reg source);
+    void imul(Reg destination, Reg base, int32_t displacement);
+    void imul(Reg destination, int32_t immediate);
+    void neg(Reg reg);
+    void notReg(Reg reg);
+    void cqo();
+    void idiv(Reg divisor);
+    void div(Reg divisor);
+
+    // unsigned RDX:RAX = RAX * source
+    void mul(Reg source);
+    void shift(ShiftOp op, Reg reg, uint8_t count);
+    void shift(ShiftOp op, Reg reg);                    // by CL
+
+    // destination = low 64 bits of (source:destination >> CL)
+    void shrd(Reg destination, Reg source);
+    void test(Reg a, Reg b);
+    void test32(Reg a, Reg b);
+
+    // destination = condition ? 1 : 0
+    void setcc(Cond cond, Reg destination);
+
+    void jmp(Label target);
+    void jcc(Cond cond, Label target);
+    void call(Reg target);
+    void call(Label target);
+    void syscall();
+    void push(Reg reg);
+    void pop(Reg reg);
+    void ret();
+
+    void movsd(XReg destination, XReg source);
+    void movsd(XReg destination, Reg base, int32_t displacement);
+    void movsd(Reg base, int32_t displacement, XReg source);
+    void sseOp(SseOp op, XReg destination, XReg source);
+    void sseOp(SseOp op, XReg destination, Reg base, int32_t displacement);
+    void ucomisd(XReg a, XReg b);
+    void ucomisd(XReg a, Reg base, int32_t displacement);
+    void cvtsi2sd(XReg destination, Reg source);
+    void cvtsi2sd(XReg destination, Reg base, int32_t displacement);
+    void xorpd(XReg destination, XReg source);
+
+    // the bits of a double as an integer
+    void movq(Reg destination, XReg source);
+
+    size_t size() const { return code.size(); }
+
+    // patches the branches, every label used must be bound by then
+    std::vector<uint8_t> finish();
+};
+
+#endif //RGR_X86_H
@@ -1,41 +1,510 @@
 #include <fstream>
+#include <sys/stat.h>
+#include <iterator>
+#include <memory>
+#include <map>
+#include "Arguments.h"
 #include "Parser.h"
+#include "VM.h"
+#include "Threaded.h"
+#include "Closure.h"
+#include "Jit.h"
+#include "CEmitter.h"
+#include "Elf.h"
+#include "Optimizer.h"
+#include "Ssa.h"
+#include "Batch.h"
+#include "Scheduler.h"
+#include "Snapshot.h"
+#include "Stats.h"
+#include "Trace.h"
 
 using namespace std;
 
-int main()
+namespace
 {
-    ifstream in("input.txt");
-    ofstream out("ast.txt");
-    ofstream tokfile("tokens.txt");
-    if (!in)
+    int dumpProgram(const string& code)
     {
-        cout << "Couldn't open input file\n";
+        ofstream out("ast.txt");
+        ofstream tokfile("tokens.txt");
+        if (!out || !tokfile)
+        {
+            cout << "Couldn't open output file\n";
+            return 0;
+        }
+        try
+        {
+            for (auto& tok : lexString(code))
+            {
+                tokfile << prettyPrintTokType(tok.type) << "\n";
+            }
+
+            out << parseInputWithSemantic(make_shared<ProgramNode>(), code)->dump();
+
+            cout << "Parsed successfully, abstract syntax tree is dumped to ast.txt file, tokens are dumped to tokens.txt file";
+        }
+        catch(exception& e)
+        {
+            cout << e.what() << endl;
+        }
         return 0;
     }
-    if (!out || !tokfile)
+
+    // the default mode's pipeline phase by phase, with the statistics of every phase printed at the end
+    int runStats(const string& inputName)
+    {
+        StatsRecorder stats;
+        string code, dump;
+        vector<Token> scanned, tokens;
+        SyntaxNodePtr tree;
+        int status = 0;
+        try
+        {
+            stats.measure("input read", [&] {
+                ifstream in(inputName);
+                if (!in)
+                    throw runtime_error("Couldn't open input file");
+                string s;
+                while (getline(in, s))
+                    code += s + "\n";
+            });
+            stats.measure("lexString", [&] { scanned = scanTokens(code); });
+            stats.measure("filtering", [&] { tokens = dropRedundantSeparators(scanned); });
+            stats.measure("parseInput", [&] { tree = parseInput(make_shared<ProgramNode>(), tokens); });
+            stats.measure("semanticProcess", [&] {
+                SemanticContext context;
+                tree->semanticProcess(context);
+            });
+            stats.measure("dump", [&] { dump = tree->dump(); });
+            stats.measure("output write", [&] {
+                ofstream out("ast.txt");
+                ofstream tokfile("tokens.txt");
+                if (!out || !tokfile)
+                    throw runtime_error("Couldn't open output file");
+                for (auto& tok : tokens)
+                    tokfile << prettyPrintTokType(tok.type) << "\n";
+                out << dump;
+            });
+        }
+        catch (exception& e)
+        {
+            cout << e.what() << "\n\n";
+            status = 1;
+        }
+
+        stats.count("tokens", scanned.size());
+        stats.count("tokens after filtering", tokens.size());
+        stats.count("syntax nodes", tree ? countSyntaxNodes(tree) : 0);
+        cout << stats.report();
+        return status;
+    }
+
+    // the JIT falls back to the VM, with a warning, on platforms it doesn't support
+    void execute(const TypedProgram& typed, const string& engine, size_t threads, InputBuffer& input, OutputBuffer& output)
+    {
+        if (engine == "jit")
+        {
+            unique_ptr<JitEngine> jit;
+            try
+            {
+                jit.reset(new JitEngine(typed));
+            }
+            catch(CodegenUnsupported& e)
+            {
+                cerr << "JIT unavailable, running on the VM: " << e.what() << endl;
+            }
+
+            if (jit)
+                jit->run(input, output);
+            else
+                VirtualMachine(compileBytecode(typed)).run(input, output);
+        }
+        else if (engine == "closure")
+            ClosureEngine(typed, threads).run(input, output);
+        else if (engine == "ssa")
+            SsaEngine(typed).run(input, output);
+        else if (engine == "threaded")
+            ThreadedEngine(compileBytecode(typed)).run(input, output);
+        else if (engine == "vm")
+            VirtualMachine(compileBytecode(typed)).run(input, output);
+        else
+            throw runtime_error("Unknown engine " + engine);
+    }
+
+    // runs the program with the engine and the unoptimized program with the VM as the reference on the same input,
+    // prints the engine's output and reports if the output or the error differ
+    int compareWithReference(const TypedProgram& typed, const TypedProgram& unoptimized, const string& engine, size_t threads)
+    {
+        string data((istreambuf_iterator<char>(cin)), istreambuf_iterator<char>());
+
+        auto capture = [&](const TypedProgram& program, const string& name, string& error) {
+            InputBuffer input(data);
+            OutputBuffer output;
+            try
+            {
+                execute(program, name, threads, input, output);
+            }
+            catch(exception& e)
+            {
+                error = e.what();
+            }
+            return output.str();
+        };
+
+        string referenceError, error;
+        string reference = capture(unoptimized, "vm", referenceError);
+        string result = capture(typed, engine, error);
+
+        cout << result;
+        if (!error.empty())
+            cerr << error << endl;
+
+        if (result != reference || error != referenceError)
+        {
+            cerr << "Engine " << engine << " differs from the reference VM" << endl;
+            return 2;
+        }
+        return error.empty() ? 0 : 1;
+    }
+
+    int writeExecutable(const TypedProgram& typed, const string& outputName)
     {
-        cout << "Couldn't open output file\n";
+        vector<uint8_t> image = buildExecutable(typed);
+        ofstream out(outputName, ios::binary);
+        if (!out.write((const char*)image.data(), image.size()))
+        {
+            cerr << "Couldn't write " << outputName << endl;
+            return 1;
+        }
+        out.close();
+        chmod(outputName.c_str(), 0755);
         return 0;
     }
-    try
+
+    // every line of the standard input is the input of one run, the output of each run follows a "lane N:" line
+    int runBatch(const TypedProgram& typed)
+    {
+        vector<string> inputs;
+        string line;
+        while (getline(cin, line))
+            inputs.push_back(line);
+
+        int status = 0;
+        vector<BatchResult> results = BatchEngine(typed).run(inputs);
+        for (size_t lane = 0; lane < results.size(); lane++)
+        {
+            cout << "lane " << lane + 1 << ":\n" << results[lane].output;
+            if (!results[lane].error.empty())
+            {
+                cout << results[lane].error << "\n";
+                status = 1;
+            }
+        }
+        return status;
+    }
+
+    // "N data" lines of the standard input feed "data" and a line break to instance N, started on its first line;
+    // the instances run as their input arrives and each one's output follows an "instance N:" line at the end
+    int runInstances(const TypedProgram& typed, size_t threads)
+    {
+        auto program = make_shared<BytecodeProgram>(compileBytecode(typed));
+        Scheduler scheduler(threads);
+        map<string, size_t> ids;
+        string line;
+        while (getline(cin, line))
+        {
+            size_t split = line.find(' ');
+            string name = line.substr(0, split);
+            if (!ids.count(name))
+                ids[name] = scheduler.spawn(program);
+            scheduler.feed(ids[name], (split == string::npos ? "" : line.substr(split + 1)) + "\n");
+        }
+        for (auto& instance : ids)
+            scheduler.close(instance.second);
+        scheduler.wait();
+
+        int status = 0;
+        for (auto& instance : ids)
+        {
+            cout << "instance " << instance.first << ":\n" << scheduler.takeOutput(instance.second);
+            string error = scheduler.error(instance.second);
+            if (!error.empty())
+            {
+                cout << error << "\n";
+                status = 1;
+            }
+        }
+        return status;
+    }
+
+    // the VM keeps the limits of an untrusted program whatever the engine, exit status 3 tells a budget ran out
+    int runMetered(const TypedProgram& typed, const ExecutionLimits& limits)
+    {
+        BytecodeProgram program = compileBytecode(typed);
+        InputBuffer input(stdin);
+        OutputBuffer output(stdout);
+        LimitedRun result = runLimited(program, input, output, limits);
+        output.flush();
+        if (result.status == LimitStatus::Finished)
+            return 0;
+
+        cerr << "Budget exhausted on line " << result.line << ": "
+             << (result.status == LimitStatus::OutOfFuel ? "fuel" : "output") << endl;
+        return 3;
+    }
+
+    // the output the program wrote before the snapshot comes first, then it goes on reading stdin
+    int runSnapshot(const string& fileName)
+    {
+        try
+        {
+            RestoredSnapshot snapshot = loadSnapshot(fileName);
+            fwrite(snapshot.output, 1, snapshot.outputSize, stdout);
+            InputBuffer input(stdin);
+            OutputBuffer output(stdout);
+            VirtualMachine(snapshot.program).run(input, output);
+        }
+        catch (exception& e)
+        {
+            fflush(stdout);
+            cerr << e.what() << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // the program runs on the closure engine with its input and output, the report goes to profile.txt
+    int runProfiled(const TypedProgram& typed, const string& code)
+    {
+        Profile profile(typed);
+        string error;
+        {
+            InputBuffer input(stdin);
+            OutputBuffer output(stdout);
+            try
+            {
+                ClosureEngine(typed, 1, &profile).run(input, output);
+            }
+            catch (exception& e)
+            {
+                error = e.what();
+            }
+        }
+
+        ofstream out("profile.txt");
+        out << profile.report(code);
+        if (!error.empty())
+        {
+            cerr << error << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    struct Options
+    {
+        string mode, engine = "vm", outputName = "a.out", snapshotName, traceName;
+        bool optimize = true, traceItems = false;
+        size_t threads = max(1u, thread::hardware_concurrency());
+        size_t precomputeBudget = defaultPrecomputeBudget;
+        ExecutionLimits limits;
+        bool limited = false;
+    };
+
+    // the program's own input and output go through stdin and stdout, so errors are reported to stderr
+    int runProgram(const string& code, const Options& options)
+    {
+        const string& mode = options.mode;
+        try
+        {
+            SyntaxNodePtr tree = parseInputWithSemantic(make_shared<ProgramNode>(), code);
+            TypedProgram typed = lowerProgram(tree);
+            string report;
+            if (options.optimize)
+                optimizeProgram(typed, &report);
+
+            if (mode == "--dump-typed")
+            {
+                cout << dumpTypedProgram(typed) << report;
+                return 0;
+            }
+
+            if (mode == "--dump-ssa")
+            {
+                SsaFunction function = buildSsa(typed);
+                if (options.optimize)
+                    optimizeSsa(function);
+                cout << dumpSsa(function);
+                return 0;
+            }
+
+            if (mode == "--disasm")
+            {
+                cout << disassemble(compileBytecode(typed));
+                return 0;
+            }
+
+            if (mode == "--run" && options.limited)
+                return runMetered(typed, options.limits);
+
+            // the optimizer's temporaries and rewritten loops would be counted against lines they don't come from
+            if (mode == "--profile")
+                return runProfiled(lowerProgram(tree), code);
+
+            if (mode == "--snapshot")
+            {
+                saveSnapshot(takeSnapshot(compileBytecode(typed)), options.snapshotName);
+                return 0;
+            }
+
+            // a program without input is run at compile time, its output replaces running or translating it
+            PrecomputedOutput precomputed;
+            bool isPrecomputed = (mode == "--run" || mode == "--emit-c")
+                                 && precomputeOutput(typed, options.precomputeBudget, precomputed);
+
+            if (mode == "--emit-c")
+            {
+                cout << (isPrecomputed ? emitPrecomputedC(precomputed) : emitC(typed));
+                return 0;
+            }
+
+            if (isPrecomputed)
+            {
+                cout << precomputed.output << flush;
+                if (!precomputed.error.empty())
+                {
+                    cerr << precomputed.error << endl;
+                    return 1;
+                }
+                return 0;
+            }
+
+            if (mode == "--build")
+                return writeExecutable(typed, options.outputName);
+
+            if (mode == "--batch")
+                return runBatch(typed);
+
+            if (mode == "--serve")
+                return runInstances(typed, options.threads);
+
+            if (mode == "--diff")
+                return compareWithReference(typed, lowerProgram(tree), options.engine, options.threads);
+
+            InputBuffer input(stdin);
+            OutputBuffer output(stdout);
+            TraceSpan span("execute");
+            execute(typed, options.engine, options.threads, input, output);
+        }
+        catch(exception& e)
+        {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    int runCommand(const string& inputName, const Options& options)
     {
-        string s, code;
-        while (getline(in, s))
-            code += s + "\n";
+        if (options.mode == "--restore")
+            return runSnapshot(options.snapshotName);
 
-        for (auto& tok : lexString(code))
+        if (options.mode == "--stats")
+            return runStats(inputName);
+
+        string code;
         {
-            tokfile << prettyPrintTokType(tok.type) << "\n";
+            TraceSpan span("read source");
+            ifstream in(inputName);
+            if (!in)
+            {
+                cout << "Couldn't open input file\n";
+                return 0;
+            }
+
+            string s;
+            while (getline(in, s))
+                code += s + "\n";
         }
 
-        out << parseInputWithSemantic(make_shared<ProgramNode>(), code)->dump();
+        if (options.mode.empty())
+            return dumpProgram(code);
+
+        return runProgram(code, options);
+    }
+
+    int writeTrace(const string& traceName)
+    {
+        ofstream out(traceName);
+        out << traceJson();
+        if (!out)
+        {
+            cerr << "Couldn't write trace file " << traceName << endl;
+            return 1;
+        }
+        return 0;
+    }
+}
 
-        cout << "Parsed successfully, abstract syntax tree is dumped to ast.txt file, tokens are dumped to tokens.txt file";
+int main(int argc, char* argv[])
+{
+    Options options;
+    string inputName = "input.txt";
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            string arg = argv[i];
+            if (arg == "--run" || arg == "--disasm" || arg == "--diff" || arg == "--emit-c" || arg == "--build"
+                || arg == "--dump-typed" || arg == "--dump-ssa" || arg == "--batch"
+                || arg == "--serve" || arg == "--profile" || arg == "--stats")
+                options.mode = arg;
+            else if (arg == "build")
+                options.mode = "--build";
+            else if (arg == "--no-optimize")
+                options.optimize = false;
+            else if (arg.compare(0, 9, "--engine=") == 0)
+                options.engine = arg.substr(9);
+            else if (arg.compare(0, 20, "--precompute-budget=") == 0)
+                options.precomputeBudget = parseCount(arg);
+            else if (arg.compare(0, 10, "--threads=") == 0)
+                options.threads = max(1ull, parseCount(arg));
+            else if (arg.compare(0, 11, "--snapshot=") == 0 || arg.compare(0, 10, "--restore=") == 0)
+            {
+                options.mode = arg.substr(0, arg.find('='));
+                options.snapshotName = arg.substr(arg.find('=') + 1);
+            }
+            else if (arg.compare(0, 7, "--fuel=") == 0)
+            {
+                options.limits.fuel = parseCount(arg);
+                options.limited = true;
+            }
+            else if (arg.compare(0, 13, "--max-output=") == 0)
+            {
+                options.limits.outputBytes = parseSize(arg);
+                options.limited = true;
+            }
+            else if (arg.compare(0, 8, "--trace=") == 0)
+                options.traceName = arg.substr(8);
+            else if (arg == "--trace-items")
+                options.traceItems = true;
+            else if (arg.compare(0, 9, "--output=") == 0)
+                options.outputName = arg.substr(9);
+            else
+                inputName = arg;
+        }
     }
-    catch(exception& e)
+    catch (exception& e)
     {
-        cout << e.what() << endl;
+        cerr << e.what() << endl;
+        return 1;
     }
-    return 0;
-}
\ No newline at end of file
+
+    if (options.traceName.empty())
+        return runCommand(inputName, options);
+
+    // the trace is written after the work, whatever its outcome
+    startTracing(options.traceItems);
+    int status = runCommand(inputName, options);
+    return writeTrace(options.traceName) ? 1 : status;
+}